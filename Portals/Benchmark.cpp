@@ -0,0 +1,496 @@
+#include "Benchmark.h"
+#include "ObjLoader.h"
+#include "TransformSystem.h"
+#include "MeshBVH.h"
+#include "MeshOptimizer.h"
+#include "PortalMath.h"
+#include "RayTriangle.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+
+using namespace std;
+
+// Keep loading the file until at least this much time has passed, so small files still give stable numbers
+#define BENCHMARK_MIN_SECONDS 0.25
+// Transforms updated per pass by the transform benchmark
+#define BENCHMARK_TRANSFORM_COUNT 10000
+// Portal pairs and cameras run through the portal math per pass
+#define BENCHMARK_PORTAL_COUNT 10000
+// Frames recorded by the frame recording benchmark
+#define BENCHMARK_FRAME_COUNT 200
+
+struct LoaderResult {
+	double seconds;		// Average time per load
+	size_t vertexCount;
+	size_t triangleCount;
+};
+
+static LoaderResult TimeLoader(bool (*load)(const char*, vector<Vertex>&, vector<unsigned int>&), const string& filepath)
+{
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	int iterations = 0;
+	auto start = chrono::high_resolution_clock::now();
+	double elapsed = 0;
+	do {
+		load(filepath.c_str(), vertices, indices);
+		iterations++;
+		elapsed = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	} while (elapsed < BENCHMARK_MIN_SECONDS);
+
+	LoaderResult result;
+	result.seconds = elapsed / iterations;
+	result.vertexCount = vertices.size();
+	result.triangleCount = indices.size() / 3;
+	return result;
+}
+
+// Wrapper so the legacy loader gets a fresh set of vectors each time, like the original Mesh constructor did
+static bool LoadLegacy(const char* filepath, vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	return ObjLoader::LoadLegacy(filepath, vertices, indices);
+}
+
+void Benchmark::Run(const vector<string>& modelPaths, const std::function<void(CommandBuffer&)>& recordFrame)
+{
+	RunObjLoaderBenchmark(modelPaths);
+	RunTransformBenchmark(BENCHMARK_TRANSFORM_COUNT);
+	RunPortalMathBenchmark(BENCHMARK_PORTAL_COUNT);
+	RunRaycastBenchmark(modelPaths);
+	RunRayTriangleBenchmark(modelPaths);
+	RunFrameRecordingBenchmark(recordFrame, BENCHMARK_FRAME_COUNT);
+}
+
+void Benchmark::RunObjLoaderBenchmark(const vector<string>& filepaths)
+{
+	printf("\nOBJ loader benchmark\n");
+	printf("%-16s %9s %9s | %11s %12s %8s | %10s %12s %8s | %7s | %6s %9s | %6s %9s\n",
+		"file", "KB", "tris",
+		"legacy MB/s", "tris/s", "verts",
+		"new MB/s", "tris/s", "verts",
+		"speedup", "ACMR", "optimized", "ATVR", "optimized");
+
+	for (const string& filepath : filepaths) {
+		ifstream file(filepath, ios::binary | ios::ate);
+		if (!file.is_open()) {
+			printf("%s: could not open\n", filepath.c_str());
+			continue;
+		}
+		double megabytes = (double)file.tellg() / (1024.0 * 1024.0);
+		file.close();
+
+		LoaderResult legacy = TimeLoader(LoadLegacy, filepath);
+		LoaderResult current = TimeLoader(ObjLoader::Load, filepath);
+
+		// What the GPU's vertex cache makes of the file's triangle order, and of the order Mesh draws them in
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		ObjLoader::Load(filepath.c_str(), vertices, indices);
+		VertexCacheStats loaded = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		MeshOptimizer::Optimize(vertices, indices);
+		VertexCacheStats optimized = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		string name = filepath.substr(filepath.find_last_of("/\\") + 1);
+		printf("%-16s %9.1f %9zu | %11.1f %12.0f %8zu | %10.1f %12.0f %8zu | %6.1fx | %6.3f %9.3f | %6.3f %9.3f\n",
+			name.c_str(), megabytes * 1024.0, current.triangleCount,
+			megabytes / legacy.seconds, legacy.triangleCount / legacy.seconds, legacy.vertexCount,
+			megabytes / current.seconds, current.triangleCount / current.seconds, current.vertexCount,
+			legacy.seconds / current.seconds, loaded.acmr, optimized.acmr, loaded.atvr, optimized.atvr);
+	}
+}
+
+static float RandomRange(float min, float max)
+{
+	return min + (max - min) * ((float)rand() / RAND_MAX);
+}
+
+// Largest absolute difference between two matrices
+static float MaxDifference(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+{
+	float diff = 0;
+	for (int r = 0; r < 4; r++) {
+		for (int c = 0; c < 4; c++) {
+			diff = (std::max)(diff, fabsf(a.m[r][c] - b.m[r][c]));
+		}
+	}
+	return diff;
+}
+
+void Benchmark::RunTransformBenchmark(int count)
+{
+	srand(1234);
+
+	// Two identical sets, one updated per object and one updated in a batch
+	vector<Transform> single(count);
+	vector<Transform> batched(count);
+	TransformSystem system;
+	for (int i = 0; i < count; i++) {
+		float px = RandomRange(-50, 50), py = RandomRange(-50, 50), pz = RandomRange(-50, 50);
+		float pitch = RandomRange(-3.14159f, 3.14159f), yaw = RandomRange(-3.14159f, 3.14159f), roll = RandomRange(-3.14159f, 3.14159f);
+		float sx = RandomRange(0.1f, 10), sy = RandomRange(0.1f, 10), sz = RandomRange(0.1f, 10);
+		single[i].SetPosition(px, py, pz);
+		single[i].SetPitchYawRoll(pitch, yaw, roll);
+		single[i].SetScale(sx, sy, sz);
+		batched[i].SetPosition(px, py, pz);
+		batched[i].SetPitchYawRoll(pitch, yaw, roll);
+		batched[i].SetScale(sx, sy, sz);
+		system.Add(&batched[i]);
+	}
+
+	// Every pass dirties all the transforms first, like a scene where everything moves each frame
+	int iterations = 0;
+	double singleSeconds = 0;
+	double batchedSeconds = 0;
+	do {
+		for (int i = 0; i < count; i++) {
+			single[i].MoveAbsolute(0, 0, 0);
+			batched[i].MoveAbsolute(0, 0, 0);
+		}
+
+		auto start = chrono::high_resolution_clock::now();
+		for (int i = 0; i < count; i++) {
+			single[i].GetWorldMatrix();
+		}
+		auto middle = chrono::high_resolution_clock::now();
+		system.UpdateMatrices();
+		auto end = chrono::high_resolution_clock::now();
+
+		singleSeconds += chrono::duration<double>(middle - start).count();
+		batchedSeconds += chrono::duration<double>(end - middle).count();
+		iterations++;
+	} while (singleSeconds + batchedSeconds < BENCHMARK_MIN_SECONDS);
+
+	float worldError = 0;
+	float inverseTransposeError = 0;
+	for (int i = 0; i < count; i++) {
+		worldError = (std::max)(worldError, MaxDifference(single[i].GetWorldMatrix(), batched[i].GetWorldMatrix()));
+		inverseTransposeError = (std::max)(inverseTransposeError,
+			MaxDifference(single[i].GetWorldInverseTranspose(), batched[i].GetWorldInverseTranspose()));
+	}
+
+	double singleNs = singleSeconds * 1e9 / ((double)iterations * count);
+	double batchedNs = batchedSeconds * 1e9 / ((double)iterations * count);
+	printf("\nTransform benchmark (%d transforms, %d passes)\n", count, iterations);
+	printf("per object: %8.1f ns/transform\n", singleNs);
+	printf("batched:    %8.1f ns/transform (%.1fx)\n", batchedNs, singleNs / batchedNs);
+	printf("max difference: world %g, inverse transpose %g\n", worldError, inverseTransposeError);
+}
+
+// Time one PortalMath function over every portal, repeating until enough time has passed. Returns ns per call.
+static double TimePortalMath(int count, const std::function<void(int)>& call)
+{
+	int iterations = 0;
+	auto start = chrono::high_resolution_clock::now();
+	double elapsed = 0;
+	do {
+		for (int i = 0; i < count; i++) {
+			call(i);
+		}
+		iterations++;
+		elapsed = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	} while (elapsed < BENCHMARK_MIN_SECONDS);
+	return elapsed * 1e9 / ((double)iterations * count);
+}
+
+void Benchmark::RunPortalMathBenchmark(int count)
+{
+	using namespace DirectX;
+	srand(1234);
+
+	// Random portal pairs, each seen by a random camera looking roughly at the source portal
+	vector<XMFLOAT4X4> sources(count), destinations(count), views(count);
+	vector<PortalMath::PortalFrame> frames(count);
+	vector<XMFLOAT3> starts(count), ends(count);
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.01f, 100.0f));
+	for (int i = 0; i < count; i++) {
+		XMMATRIX scale = XMMatrixScaling(1.2f, 2.4f, 1);
+		XMMATRIX source = scale * XMMatrixRotationY(RandomRange(-3.14159f, 3.14159f)) *
+			XMMatrixTranslation(RandomRange(-20, 20), RandomRange(0, 5), RandomRange(-20, 20));
+		XMMATRIX destination = scale * XMMatrixRotationY(RandomRange(-3.14159f, 3.14159f)) *
+			XMMatrixTranslation(RandomRange(-20, 20), RandomRange(0, 5), RandomRange(-20, 20));
+		XMStoreFloat4x4(&sources[i], source);
+		XMStoreFloat4x4(&destinations[i], destination);
+		XMVECTOR portalPosition = source.r[3];
+		XMVECTOR eye = portalPosition + XMVectorSet(RandomRange(-8, 8), RandomRange(-1, 3), RandomRange(-8, 8), 0);
+		XMStoreFloat4x4(&views[i], XMMatrixLookAtLH(eye, portalPosition, XMVectorSet(0, 1, 0, 0)));
+
+		PortalMath::PortalFrame& frame = frames[i];
+		XMStoreFloat3(&frame.position, portalPosition);
+		XMStoreFloat3(&frame.right, XMVector3Normalize(source.r[0]));
+		XMStoreFloat3(&frame.up, XMVector3Normalize(source.r[1]));
+		XMStoreFloat3(&frame.forward, XMVector3Normalize(source.r[2]));
+		frame.halfExtents = XMFLOAT2(0.6f, 1.2f);
+		XMStoreFloat3(&starts[i], eye);
+		XMStoreFloat3(&ends[i], portalPosition + XMVectorSet(RandomRange(-1, 1), RandomRange(-1, 1), RandomRange(-1, 1), 0));
+	}
+
+	// Every result is kept, so none of the work can be skipped
+	vector<XMFLOAT4X4> results(count);
+	vector<PortalMath::ScreenRect> rects(count);
+	vector<float> times(count);
+	vector<char> visible(count), crossed(count);
+	double sourceToDestinationNs = TimePortalMath(count, [&](int i) {
+		results[i] = PortalMath::SourceToDestination(sources[i], destinations[i]);
+	});
+	double viewNs = TimePortalMath(count, [&](int i) {
+		results[i] = PortalMath::PortalViewMatrix(views[i], sources[i], destinations[i]);
+	});
+	double obliqueNs = TimePortalMath(count, [&](int i) {
+		results[i] = PortalMath::ObliqueProjection(views[i], projection, frames[i].position, frames[i].forward);
+	});
+	double projectNs = TimePortalMath(count, [&](int i) {
+		XMFLOAT4X4 worldViewProj;
+		XMStoreFloat4x4(&worldViewProj, XMLoadFloat4x4(&sources[i]) * XMLoadFloat4x4(&views[i]) * XMLoadFloat4x4(&projection));
+		visible[i] = PortalMath::ProjectPortalQuad(worldViewProj, 1280, 720, rects[i]);
+	});
+	double crossingNs = TimePortalMath(count, [&](int i) {
+		crossed[i] = PortalMath::SweptCrossing(frames[i], starts[i], ends[i], times[i]);
+	});
+	size_t visibleCount = (size_t)std::count(visible.begin(), visible.end(), 1);
+	size_t crossingCount = (size_t)std::count(crossed.begin(), crossed.end(), 1);
+
+	printf("\nPortal math benchmark (%d portals)\n", count);
+	printf("SourceToDestination  %8.1f ns\n", sourceToDestinationNs);
+	printf("PortalViewMatrix     %8.1f ns\n", viewNs);
+	printf("ObliqueProjection    %8.1f ns\n", obliqueNs);
+	printf("ProjectPortalQuad    %8.1f ns (%zu visible)\n", projectNs, visibleCount);
+	printf("SweptCrossing        %8.1f ns (%zu crossings)\n", crossingNs, crossingCount);
+}
+
+// Random rays from a box twice the size of the mesh's bounds, aimed at points inside them
+static void RandomRaysAtMesh(const vector<Vertex>& vertices, int rayCount,
+	vector<DirectX::XMFLOAT3>& outOrigins, vector<DirectX::XMFLOAT3>& outDirections)
+{
+	using namespace DirectX;
+	XMFLOAT3 boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const Vertex& v : vertices) {
+		boundsMin = XMFLOAT3((std::min)(boundsMin.x, v.Position.x), (std::min)(boundsMin.y, v.Position.y), (std::min)(boundsMin.z, v.Position.z));
+		boundsMax = XMFLOAT3((std::max)(boundsMax.x, v.Position.x), (std::max)(boundsMax.y, v.Position.y), (std::max)(boundsMax.z, v.Position.z));
+	}
+	XMFLOAT3 center = XMFLOAT3((boundsMin.x + boundsMax.x) / 2, (boundsMin.y + boundsMax.y) / 2, (boundsMin.z + boundsMax.z) / 2);
+	XMFLOAT3 extent = XMFLOAT3(boundsMax.x - center.x, boundsMax.y - center.y, boundsMax.z - center.z);
+	srand(1234);
+	outOrigins.resize(rayCount);
+	outDirections.resize(rayCount);
+	for (int i = 0; i < rayCount; i++) {
+		outOrigins[i] = XMFLOAT3(
+			center.x + RandomRange(-2, 2) * extent.x,
+			center.y + RandomRange(-2, 2) * extent.y,
+			center.z + RandomRange(-2, 2) * extent.z);
+		XMFLOAT3 target = XMFLOAT3(
+			center.x + RandomRange(-1, 1) * extent.x,
+			center.y + RandomRange(-1, 1) * extent.y,
+			center.z + RandomRange(-1, 1) * extent.z);
+		outDirections[i] = XMFLOAT3(target.x - outOrigins[i].x, target.y - outOrigins[i].y, target.z - outOrigins[i].z);
+	}
+}
+
+// Closest hit by testing every triangle, the reference the BVH is compared against
+static bool RaycastBruteForce(const vector<Vertex>& vertices, const vector<unsigned int>& indices,
+	const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, float& outDistance)
+{
+	bool hit = false;
+	outDistance = maxDistance;
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		float t, u, v;
+		if (RayTriangle::Intersect(origin, direction,
+			vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position,
+			0.0001f, outDistance, t, u, v)) {
+			outDistance = t;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+void Benchmark::RunRaycastBenchmark(const vector<string>& filepaths)
+{
+	using namespace DirectX;
+	const int rayCount = 100000;
+	const int bruteForceRayCount = 1000;
+
+	printf("\nRaycast benchmark (%d rays per mesh)\n", rayCount);
+	printf("%-16s %8s %8s %9s | %12s %12s %12s | %6s %9s\n",
+		"file", "tris", "nodes", "build ms",
+		"first Mray/s", "any Mray/s", "brute Mray/s",
+		"hits", "mismatch");
+
+	for (const string& filepath : filepaths) {
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		if (!ObjLoader::Load(filepath.c_str(), vertices, indices)) {
+			printf("%s: could not open\n", filepath.c_str());
+			continue;
+		}
+
+		MeshBVH bvh;
+		auto buildStart = chrono::high_resolution_clock::now();
+		bvh.Build(vertices, indices);
+		double buildSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - buildStart).count();
+
+		vector<XMFLOAT3> origins, directions;
+		RandomRaysAtMesh(vertices, rayCount, origins, directions);
+
+		// Rays can hit anything up to twice their length away
+		int hits = 0;
+		auto start = chrono::high_resolution_clock::now();
+		for (int i = 0; i < rayCount; i++) {
+			RayHit hit;
+			hits += bvh.Raycast(origins[i], directions[i], 2.0f, hit);
+		}
+		double firstSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		start = chrono::high_resolution_clock::now();
+		int anyHits = 0;
+		for (int i = 0; i < rayCount; i++) {
+			anyHits += bvh.RaycastAny(origins[i], directions[i], 2.0f);
+		}
+		double anySeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		// Check a subset against brute force, which is far too slow for the full set
+		int mismatches = anyHits != hits ? 1 : 0;
+		start = chrono::high_resolution_clock::now();
+		for (int i = 0; i < bruteForceRayCount; i++) {
+			float bruteDistance;
+			bool bruteHit = RaycastBruteForce(vertices, indices, origins[i], directions[i], 2.0f, bruteDistance);
+			RayHit hit;
+			bool bvhHit = bvh.Raycast(origins[i], directions[i], 2.0f, hit);
+			if (bruteHit != bvhHit || (bruteHit && fabsf(bruteDistance - hit.distance) > 1e-5f)) {
+				mismatches++;
+			}
+		}
+		double bruteSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		string name = filepath.substr(filepath.find_last_of("/\\") + 1);
+		printf("%-16s %8zu %8zu %9.2f | %12.2f %12.2f %12.3f | %6d %9d\n",
+			name.c_str(), bvh.GetTriangleCount(), bvh.GetNodeCount(), buildSeconds * 1000.0,
+			rayCount / firstSeconds / 1e6, rayCount / anySeconds / 1e6, bruteForceRayCount / bruteSeconds / 1e6,
+			hits, mismatches);
+	}
+}
+
+void Benchmark::RunRayTriangleBenchmark(const vector<string>& filepaths)
+{
+	using namespace DirectX;
+	const int rayCount = 256;
+	const float maxDistance = 2.0f;
+
+	printf("\nRay-triangle kernel benchmark (%d rays against every triangle)\n", rayCount);
+	printf("%-16s %8s | %12s %12s %12s | %9s %9s\n",
+		"file", "tris", "scalar M/s", "block4 M/s", "packet4 M/s", "block err", "packet err");
+
+	for (const string& filepath : filepaths) {
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		if (!ObjLoader::Load(filepath.c_str(), vertices, indices)) {
+			printf("%s: could not open\n", filepath.c_str());
+			continue;
+		}
+		size_t triangleCount = indices.size() / 3;
+		vector<XMFLOAT3> positions(indices.size());
+		for (size_t i = 0; i < indices.size(); i++) {
+			positions[i] = vertices[indices[i]].Position;
+		}
+		vector<TriangleBlock4> blocks;
+		RayTriangle::BuildBlocks(&positions[0], triangleCount, blocks);
+
+		vector<XMFLOAT3> origins, directions;
+		RandomRaysAtMesh(vertices, rayCount, origins, directions);
+
+		// Closest hit of every ray, found each way
+		vector<float> scalarDistance(rayCount, maxDistance);
+		vector<float> blockDistance(rayCount, maxDistance);
+		vector<float> packetDistance(rayCount, maxDistance);
+
+		auto start = chrono::high_resolution_clock::now();
+		for (int r = 0; r < rayCount; r++) {
+			for (size_t i = 0; i < triangleCount; i++) {
+				float t, u, v;
+				if (RayTriangle::Intersect(origins[r], directions[r], positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 0.0001f, scalarDistance[r], t, u, v))
+					scalarDistance[r] = t;
+			}
+		}
+		double scalarSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		start = chrono::high_resolution_clock::now();
+		for (int r = 0; r < rayCount; r++) {
+			for (const TriangleBlock4& block : blocks) {
+				float t, u, v;
+				if (RayTriangle::IntersectBlock(block, origins[r], directions[r], 0.0001f, blockDistance[r], t, u, v) >= 0)
+					blockDistance[r] = t;
+			}
+		}
+		double blockSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		start = chrono::high_resolution_clock::now();
+		for (int r = 0; r < rayCount; r += 4) {
+			RayPacket4 packet;
+			XMFLOAT4 distance = XMFLOAT4(maxDistance, maxDistance, maxDistance, maxDistance);
+			XMFLOAT4 u = XMFLOAT4(0, 0, 0, 0), v = XMFLOAT4(0, 0, 0, 0);
+			packet.ox = XMFLOAT4(origins[r].x, origins[r + 1].x, origins[r + 2].x, origins[r + 3].x);
+			packet.oy = XMFLOAT4(origins[r].y, origins[r + 1].y, origins[r + 2].y, origins[r + 3].y);
+			packet.oz = XMFLOAT4(origins[r].z, origins[r + 1].z, origins[r + 2].z, origins[r + 3].z);
+			packet.dx = XMFLOAT4(directions[r].x, directions[r + 1].x, directions[r + 2].x, directions[r + 3].x);
+			packet.dy = XMFLOAT4(directions[r].y, directions[r + 1].y, directions[r + 2].y, directions[r + 3].y);
+			packet.dz = XMFLOAT4(directions[r].z, directions[r + 1].z, directions[r + 2].z, directions[r + 3].z);
+			for (size_t i = 0; i < triangleCount; i++) {
+				RayTriangle::IntersectPacket(packet, positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 0.0001f, distance, u, v);
+			}
+			packetDistance[r] = distance.x;
+			packetDistance[r + 1] = distance.y;
+			packetDistance[r + 2] = distance.z;
+			packetDistance[r + 3] = distance.w;
+		}
+		double packetSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		// The wide versions do the same math in the same order, so they should agree exactly with scalar
+		int blockErrors = 0, packetErrors = 0;
+		for (int r = 0; r < rayCount; r++) {
+			blockErrors += fabsf(blockDistance[r] - scalarDistance[r]) > 1e-5f;
+			packetErrors += fabsf(packetDistance[r] - scalarDistance[r]) > 1e-5f;
+		}
+
+		double tests = (double)rayCount * triangleCount / 1e6;
+		string name = filepath.substr(filepath.find_last_of("/\\") + 1);
+		printf("%-16s %8zu | %12.1f %12.1f %12.1f | %9d %9d\n",
+			name.c_str(), triangleCount, tests / scalarSeconds, tests / blockSeconds, tests / packetSeconds,
+			blockErrors, packetErrors);
+	}
+}
+
+void Benchmark::RunFrameRecordingBenchmark(const std::function<void(CommandBuffer&)>& recordFrame, int frames)
+{
+	static const char* commandNames[RENDER_COMMAND_TYPE_COUNT] = {
+		"set pipeline", "set stencil ref", "set rasterizer", "set scissor", "set constants",
+		"set texture", "set sampler", "draw indexed", "clear depth", "copy resource", "draw instanced",
+		"begin zone", "end zone"
+	};
+
+	CommandBuffer commands;
+	NullRenderBackend backend;
+	double recordSeconds = 0;
+	for (int i = 0; i < frames; i++) {
+		commands.Reset();
+		auto start = chrono::high_resolution_clock::now();
+		recordFrame(commands);
+		recordSeconds += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+		backend.Execute(commands);
+	}
+
+	printf("\nFrame recording benchmark (%d frames)\n", frames);
+	printf("record %.3f ms/frame, null replay %.3f us/frame\n",
+		recordSeconds * 1e3 / frames, backend.GetExecuteSeconds() * 1e6 / frames);
+	printf("%zu commands, %zu constant bytes, %zu indices, %zu instances per frame\n",
+		backend.GetCommandCount() / frames, backend.GetConstantBytes() / frames, backend.GetIndexCount() / frames,
+		backend.GetInstanceCount() / frames);
+	for (int type = 0; type < RENDER_COMMAND_TYPE_COUNT; type++) {
+		printf("  %-16s %8zu\n", commandNames[type], backend.GetCommandCount(type) / frames);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "RenderCommands.h"
+
+// Small timing helpers that print their results to the debug console
+class Benchmark {
+public:
+	Benchmark() = delete;
+
+	// Every benchmark below, one table after another, on the given models and frame. Every model must contain
+	// positions, uvs and normals, since the legacy loader can't cope with anything else.
+	static void Run(const std::vector<std::string>& modelPaths, const std::function<void(CommandBuffer&)>& recordFrame);
+
+	// Time the legacy and current OBJ loaders on each file and print MB/s, triangles/s and vertex counts, with the
+	// vertex cache miss (ACMR) and transform to vertex (ATVR) ratios of the loaded mesh before and after MeshOptimizer.
+	// Every file must contain positions, uvs and normals, since the legacy loader can't cope with anything else.
+	static void RunObjLoaderBenchmark(const std::vector<std::string>& filepaths);
+
+	// Time rebuilding the matrices of count random transforms one at a time and with TransformSystem, and print
+	// ns per transform plus the largest difference between the two results.
+	static void RunTransformBenchmark(int count);
+
+	// Time the portal math behind every recursion level and teleport (the destination and virtual camera matrices,
+	// the oblique near plane, the portal's screen bounds and the crossing test) on count random portals and cameras,
+	// and print ns per call.
+	static void RunPortalMathBenchmark(int count);
+
+	// Build a MeshBVH for each file and print the build time and first-hit/any-hit rays per second for random rays
+	// aimed at the mesh, next to a brute force loop over every triangle.
+	static void RunRaycastBenchmark(const std::vector<std::string>& filepaths);
+
+	// Test random rays against every triangle of each file with the scalar, 4 triangle block and 4 ray packet
+	// intersectors. Prints millions of ray-triangle tests per second and how many results differ from scalar.
+	static void RunRayTriangleBenchmark(const std::vector<std::string>& filepaths);
+
+	// Record a frame with recordFrame the given number of times, replaying each through a NullRenderBackend. Prints
+	// the average record and replay times and how many of each command a frame contains. Needs no GPU.
+	static void RunFrameRecordingBenchmark(const std::function<void(CommandBuffer&)>& recordFrame, int frames);
+};
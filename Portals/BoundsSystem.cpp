@@ -0,0 +1,81 @@
+#include "BoundsSystem.h"
+#include <algorithm>
+using namespace DirectX;
+
+BoundsSystem::BoundsSystem()
+{
+}
+
+BoundsSystem::~BoundsSystem()
+{
+}
+
+void BoundsSystem::Add(Entity* entity)
+{
+    entities.push_back(entity);
+}
+
+void BoundsSystem::Remove(Entity* entity)
+{
+    entities.erase(std::remove(entities.begin(), entities.end(), entity), entities.end());
+}
+
+size_t BoundsSystem::GetCount()
+{
+    return entities.size();
+}
+
+void BoundsSystem::UpdateBounds()
+{
+    dirty.clear();
+    for (Entity* entity : entities) {
+        if (entity->transform.boundsDirty) {
+            dirty.push_back(entity);
+        }
+    }
+    if (dirty.empty())
+        return;
+
+    size_t count = dirty.size();
+    localBoxes.resize(count);
+    worldMatrices.resize(count);
+    bounds.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        localBoxes[i] = dirty[i]->GetLocalBox();
+        worldMatrices[i] = dirty[i]->transform.GetWorldMatrix();
+    }
+
+    ComputeBounds(&localBoxes[0], &worldMatrices[0], count, &bounds[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        Entity* entity = dirty[i];
+        entity->bounds = bounds[i];
+        entity->transform.boundsDirty = false;
+        entity->boundsVersion++;
+    }
+}
+
+void BoundsSystem::ComputeBounds(const BoundingBox* localBoxes, const XMFLOAT4X4* worldMatrices, size_t count, EntityBounds* outBounds)
+{
+    for (size_t i = 0; i < count; i++) {
+        XMMATRIX world = XMLoadFloat4x4(&worldMatrices[i]);
+        XMVECTOR localExtents = XMLoadFloat3(&localBoxes[i].Extents);
+        XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&localBoxes[i].Center), world);
+        XMVECTOR extents =
+            XMVectorAbs(world.r[0]) * XMVectorSplatX(localExtents) +
+            XMVectorAbs(world.r[1]) * XMVectorSplatY(localExtents) +
+            XMVectorAbs(world.r[2]) * XMVectorSplatZ(localExtents);
+
+        EntityBounds& bounds = outBounds[i];
+        XMStoreFloat3(&bounds.box.Center, center);
+        XMStoreFloat3(&bounds.box.Extents, extents);
+
+        // The oriented box keeps the local box's shape, so it's only as big as the mesh in any direction
+        BoundingOrientedBox localBox(localBoxes[i].Center, localBoxes[i].Extents, XMFLOAT4(0, 0, 0, 1));
+        localBox.Transform(bounds.orientedBox, world);
+
+        // Through the corners of the oriented box
+        bounds.sphere.Center = bounds.box.Center;
+        bounds.sphere.Radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.orientedBox.Extents)));
+    }
+}
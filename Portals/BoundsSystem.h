@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "Entity.h"
+
+// Updates the world bounds of many Entities at once. Each update gathers the entities whose transforms
+// changed, copies their local boxes and world matrices into contiguous arrays, computes all of their
+// bounds in one pass, and writes them back. Entities that aren't registered, or move after the update,
+// still update their bounds lazily.
+class BoundsSystem
+{
+public:
+    BoundsSystem();
+    ~BoundsSystem();
+
+    void Add(Entity* entity);
+    void Remove(Entity* entity);
+    size_t GetCount();
+
+    // Recompute the bounds of every registered entity whose transform changed
+    void UpdateBounds();
+
+    // The kernel on its own. The axis aligned box uses the absolute value of the world matrix rather than
+    // transforming eight corners: each world axis gets the local half extents weighted by how much of each
+    // local axis points along it, which gives the same box for a third of the work.
+    static void ComputeBounds(
+        const DirectX::BoundingBox* localBoxes,
+        const DirectX::XMFLOAT4X4* worldMatrices,
+        size_t count,
+        EntityBounds* outBounds);
+
+private:
+    std::vector<Entity*> entities;
+    std::vector<Entity*> dirty;
+
+    // Working set, reused between updates
+    std::vector<DirectX::BoundingBox> localBoxes;
+    std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+    std::vector<EntityBounds> bounds;
+};
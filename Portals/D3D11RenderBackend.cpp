@@ -0,0 +1,386 @@
+#include "D3D11RenderBackend.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+D3D11Shader::D3D11Shader(ISimpleShader* shader)
+{
+	this->shader = shader;
+}
+
+D3D11Shader::~D3D11Shader()
+{
+	delete shader;
+}
+
+ISimpleShader* D3D11Shader::GetShader()
+{
+	return shader;
+}
+
+unsigned int D3D11Shader::GetBufferCount()
+{
+	return shader->GetBufferCount();
+}
+
+unsigned int D3D11Shader::GetBufferSize(unsigned int index)
+{
+	return shader->GetBufferSize(index);
+}
+
+const void* D3D11Shader::GetBufferData(unsigned int index)
+{
+	return shader->GetBufferInfo(index)->LocalDataBuffer;
+}
+
+bool D3D11Shader::GetVariable(const char* name, RenderShaderVariable& outVariable)
+{
+	const SimpleShaderVariable* variable = shader->GetVariableInfo(name);
+	if (variable == nullptr) {
+		return false;
+	}
+	outVariable.buffer = variable->ConstantBufferIndex;
+	outVariable.offset = variable->ByteOffset;
+	outVariable.size = variable->Size;
+	return true;
+}
+
+bool D3D11Shader::SetData(const char* name, const void* data, unsigned int size)
+{
+	return shader->SetData(name, data, size);
+}
+
+int D3D11Shader::GetTextureSlot(const char* name)
+{
+	const SimpleSRV* srvInfo = shader->GetShaderResourceViewInfo(name);
+	return srvInfo != nullptr ? (int)srvInfo->BindIndex : -1;
+}
+
+int D3D11Shader::GetSamplerSlot(const char* name)
+{
+	const SimpleSampler* samplerInfo = shader->GetSamplerInfo(name);
+	return samplerInfo != nullptr ? (int)samplerInfo->BindIndex : -1;
+}
+
+// The SimpleShader behind a shader handle
+static ISimpleShader* GetSimpleShader(RenderHandle shader)
+{
+	return static_cast<D3D11Shader*>((RenderShader*)shader)->GetShader();
+}
+
+D3D11RenderBackend::D3D11RenderBackend(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	gpuProfiler(device, context)
+{
+	this->device = device;
+	this->context = context;
+}
+
+D3D11RenderBackend::~D3D11RenderBackend()
+{
+}
+
+// Stands in for "not known" in the bound state, since null is a valid thing to have bound
+static const char unknownObject = 0;
+static const RenderHandle unknown = &unknownObject;
+
+static const D3D11_INPUT_ELEMENT_DESC packedVertexLayout[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+static const D3D11_INPUT_ELEMENT_DESC packedInstancedLayout[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "WORLD_PER_INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD_PER_INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD_PER_INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD_PER_INSTANCE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INVERSE_TRANSPOSE_PER_INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INVERSE_TRANSPOSE_PER_INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INVERSE_TRANSPOSE_PER_INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INVERSE_TRANSPOSE_PER_INSTANCE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "CLIP_PLANE_PER_INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 128, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+};
+
+void D3D11RenderBackend::ForgetState()
+{
+	vertexShader = unknown;
+	pixelShader = unknown;
+	depthStencilState = unknown;
+	stencilReference = 0;
+	rasterizerState = unknown;
+	scissor = { -1, -1, -1, -1 };
+	for (int i = 0; i < RENDER_BACKEND_TRACKED_SLOTS; i++) {
+		textures[i] = unknown;
+		samplers[i] = unknown;
+	}
+	vertexBuffer = unknown;
+	indexBuffer = unknown;
+	vertexStride = 0;
+	// Keep the memory, just forget the contents
+	for (auto& pair : uploadedConstants) {
+		pair.second.clear();
+	}
+}
+
+void D3D11RenderBackend::UploadInstances(const CommandBuffer& commands)
+{
+	PROFILE_ZONE("UploadInstances");
+
+	const std::vector<unsigned char>& instances = commands.GetInstanceData();
+	if (instances.empty()) {
+		return;
+	}
+
+	// Grow in doubling steps so a scene that slowly adds instances doesn't make a new buffer every frame
+	if (instances.size() > instanceBufferSize) {
+		size_t size = (std::max)(instanceBufferSize, (size_t)65536);
+		while (size < instances.size()) {
+			size *= 2;
+		}
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = (UINT)size;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instanceBuffer.Reset();
+		if (FAILED(device->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf()))) {
+			instanceBufferSize = 0;
+			return;
+		}
+		instanceBufferSize = size;
+	}
+
+	// Discarding hands back fresh memory, so last frame's draws can still be reading the old contents
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+		memcpy(mapped.pData, instances.data(), instances.size());
+		context->Unmap(instanceBuffer.Get(), 0);
+		counters[PROFILER_COUNTER_CONSTANT_BYTES] += instances.size();
+	}
+}
+
+void D3D11RenderBackend::SetGeometry(const RenderCommand& command)
+{
+	if (command.draw.vertexBuffer != vertexBuffer || command.draw.stride != vertexStride) {
+		ID3D11Buffer* buffer = (ID3D11Buffer*)command.draw.vertexBuffer;
+		UINT stride = command.draw.stride;
+		UINT offset = 0;
+		context->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+		vertexBuffer = command.draw.vertexBuffer;
+		vertexStride = command.draw.stride;
+		counters[PROFILER_COUNTER_STATE_CHANGES]++;
+	}
+	if (command.draw.indexBuffer != indexBuffer) {
+		context->IASetIndexBuffer((ID3D11Buffer*)command.draw.indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		indexBuffer = command.draw.indexBuffer;
+		counters[PROFILER_COUNTER_STATE_CHANGES]++;
+	}
+}
+
+void D3D11RenderBackend::Execute(const CommandBuffer& commands)
+{
+	PROFILE_ZONE("Execute");
+
+	ForgetState();
+	skippedCount = 0;
+	memset(counters, 0, sizeof(counters));
+	gpuProfiler.BeginFrame();
+	UploadInstances(commands);
+
+	for (const RenderCommand& command : commands.GetCommands()) {
+		switch (command.type) {
+		case RENDER_COMMAND_SET_PIPELINE: {
+			if (command.pipeline.vertexShader == vertexShader && command.pipeline.pixelShader == pixelShader) {
+				skippedCount++;
+				break;
+			}
+			// SimpleShader binds its own constant buffers, samplers and input layout along with the shader
+			if (command.pipeline.vertexShader != vertexShader) {
+				GetSimpleShader(command.pipeline.vertexShader)->SetShader();
+				vertexShader = command.pipeline.vertexShader;
+			}
+			if (command.pipeline.pixelShader != pixelShader) {
+				if (command.pipeline.pixelShader != nullptr) {
+					GetSimpleShader(command.pipeline.pixelShader)->SetShader();
+				}
+				else {
+					context->PSSetShader(NULL, NULL, 0);
+				}
+				pixelShader = command.pipeline.pixelShader;
+			}
+			counters[PROFILER_COUNTER_STATE_CHANGES]++;
+			break;
+		}
+		case RENDER_COMMAND_SET_STENCIL_REF:
+			if (command.stencil.state == depthStencilState && command.stencil.reference == stencilReference) {
+				skippedCount++;
+				break;
+			}
+			context->OMSetDepthStencilState((ID3D11DepthStencilState*)command.stencil.state, command.stencil.reference);
+			depthStencilState = command.stencil.state;
+			stencilReference = command.stencil.reference;
+			counters[PROFILER_COUNTER_STATE_CHANGES]++;
+			break;
+		case RENDER_COMMAND_SET_RASTERIZER:
+			if (command.rasterizer.state == rasterizerState) {
+				skippedCount++;
+				break;
+			}
+			context->RSSetState((ID3D11RasterizerState*)command.rasterizer.state);
+			rasterizerState = command.rasterizer.state;
+			counters[PROFILER_COUNTER_STATE_CHANGES]++;
+			break;
+		case RENDER_COMMAND_SET_SCISSOR: {
+			D3D11_RECT rect = { command.scissor.left, command.scissor.top, command.scissor.right, command.scissor.bottom };
+			if (rect.left == scissor.left && rect.top == scissor.top && rect.right == scissor.right && rect.bottom == scissor.bottom) {
+				skippedCount++;
+				break;
+			}
+			context->RSSetScissorRects(1, &rect);
+			scissor = rect;
+			counters[PROFILER_COUNTER_STATE_CHANGES]++;
+			break;
+		}
+		case RENDER_COMMAND_SET_CONSTANTS: {
+			ISimpleShader* shader = GetSimpleShader(command.constants.shader);
+			ID3D11Buffer* buffer = shader->GetBufferInfo(command.constants.bufferIndex)->ConstantBuffer.Get();
+			const unsigned char* data = commands.GetConstantData(command);
+			std::vector<unsigned char>& uploaded = uploadedConstants[buffer];
+			if (uploaded.size() == command.constants.size && memcmp(uploaded.data(), data, command.constants.size) == 0) {
+				skippedCount++;
+				break;
+			}
+			context->UpdateSubresource(buffer, 0, 0, data, 0, 0);
+			uploaded.assign(data, data + command.constants.size);
+			counters[PROFILER_COUNTER_CONSTANT_BYTES] += command.constants.size;
+			break;
+		}
+		case RENDER_COMMAND_SET_TEXTURE: {
+			unsigned int slot = command.texture.slot;
+			if (slot < RENDER_BACKEND_TRACKED_SLOTS) {
+				if (textures[slot] == command.texture.resource) {
+					skippedCount++;
+					break;
+				}
+				textures[slot] = command.texture.resource;
+			}
+			ID3D11ShaderResourceView* srv = (ID3D11ShaderResourceView*)command.texture.resource;
+			context->PSSetShaderResources(slot, 1, &srv);
+			counters[PROFILER_COUNTER_STATE_CHANGES]++;
+			break;
+		}
+		case RENDER_COMMAND_SET_SAMPLER: {
+			unsigned int slot = command.texture.slot;
+			if (slot < RENDER_BACKEND_TRACKED_SLOTS) {
+				if (samplers[slot] == command.texture.resource) {
+					skippedCount++;
+					break;
+				}
+				samplers[slot] = command.texture.resource;
+			}
+			ID3D11SamplerState* sampler = (ID3D11SamplerState*)command.texture.resource;
+			context->PSSetSamplers(slot, 1, &sampler);
+			counters[PROFILER_COUNTER_STATE_CHANGES]++;
+			break;
+		}
+		case RENDER_COMMAND_DRAW_INDEXED:
+			// Only the buffers are state here. The draw itself always happens.
+			SetGeometry(command);
+			context->DrawIndexed(command.draw.indexCount, 0, 0);
+			counters[PROFILER_COUNTER_DRAW_CALLS]++;
+			break;
+		case RENDER_COMMAND_DRAW_INDEXED_INSTANCED: {
+			if (instanceBuffer == nullptr) {
+				break;
+			}
+			SetGeometry(command);
+			// Every batch starts somewhere different in the instance buffer, so this is set each time
+			UINT stride = command.draw.instanceSize;
+			UINT offset = command.draw.instanceOffset;
+			context->IASetVertexBuffers(1, 1, instanceBuffer.GetAddressOf(), &stride, &offset);
+			context->DrawIndexedInstanced(command.draw.indexCount, command.draw.instanceCount, 0, 0, 0);
+			counters[PROFILER_COUNTER_DRAW_CALLS]++;
+			break;
+		}
+		case RENDER_COMMAND_CLEAR_DEPTH:
+			context->ClearDepthStencilView((ID3D11DepthStencilView*)command.clearDepth.depthStencilView, D3D11_CLEAR_DEPTH,
+				command.clearDepth.depth, 0);
+			counters[PROFILER_COUNTER_DEPTH_CLEARS]++;
+			break;
+		case RENDER_COMMAND_COPY_RESOURCE:
+			context->CopyResource((ID3D11Resource*)command.copy.destination, (ID3D11Resource*)command.copy.source);
+			break;
+		case RENDER_COMMAND_BEGIN_ZONE:
+			gpuProfiler.BeginZone(command.zone.name, command.zone.argName, command.zone.arg);
+			break;
+		case RENDER_COMMAND_END_ZONE:
+			gpuProfiler.EndZone();
+			break;
+		}
+	}
+
+	gpuProfiler.EndFrame();
+	for (int i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+		Profiler::AddCounter(i, counters[i]);
+	}
+}
+
+size_t D3D11RenderBackend::GetSkippedCount()
+{
+	return skippedCount;
+}
+
+GpuProfiler& D3D11RenderBackend::GetGpuProfiler()
+{
+	return gpuProfiler;
+}
+
+RenderHandle D3D11RenderBackend::CreateVertexBuffer(const void* data, unsigned int size)
+{
+	return CreateBuffer(data, size, D3D11_BIND_VERTEX_BUFFER);
+}
+
+RenderHandle D3D11RenderBackend::CreateIndexBuffer(const unsigned int* indices, unsigned int count)
+{
+	return CreateBuffer(indices, count * sizeof(unsigned int), D3D11_BIND_INDEX_BUFFER);
+}
+
+RenderHandle D3D11RenderBackend::CreateBuffer(const void* data, unsigned int size, D3D11_BIND_FLAG bindFlag)
+{
+	// Never written again, so the driver can put it wherever suits the GPU best
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.ByteWidth = size;
+	desc.BindFlags = bindFlag;
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = data;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	if (FAILED(device->CreateBuffer(&desc, &initialData, buffer.GetAddressOf()))) {
+		return nullptr;
+	}
+	buffers.push_back(buffer);
+	return buffer.Get();
+}
+
+void D3D11RenderBackend::DestroyBuffer(RenderHandle buffer)
+{
+	buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+		[buffer](const Microsoft::WRL::ComPtr<ID3D11Buffer>& owned) { return owned.Get() == buffer; }), buffers.end());
+}
+
+const D3D11_INPUT_ELEMENT_DESC* D3D11RenderBackend::GetPackedInputLayoutDesc(UINT& elementCount)
+{
+	elementCount = ARRAYSIZE(packedVertexLayout);
+	return packedVertexLayout;
+}
+
+const D3D11_INPUT_ELEMENT_DESC* D3D11RenderBackend::GetPackedInstancedInputLayoutDesc(UINT& elementCount)
+{
+	elementCount = ARRAYSIZE(packedInstancedLayout);
+	return packedInstancedLayout;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "RenderCommands.h"
+#include "RenderShader.h"
+#include "SimpleShader.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+
+// A SimpleShader as a RenderShader. Takes ownership of the shader, and deletes it along with itself.
+class D3D11Shader : public RenderShader {
+public:
+	D3D11Shader(ISimpleShader* shader);
+	~D3D11Shader();
+
+	ISimpleShader* GetShader();
+
+	unsigned int GetBufferCount() override;
+	unsigned int GetBufferSize(unsigned int index) override;
+	const void* GetBufferData(unsigned int index) override;
+	bool GetVariable(const char* name, RenderShaderVariable& outVariable) override;
+	bool SetData(const char* name, const void* data, unsigned int size) override;
+	int GetTextureSlot(const char* name) override;
+	int GetSamplerSlot(const char* name) override;
+
+private:
+	ISimpleShader* shader;
+};
+
+// Replays command buffers on a Direct3D 11 device context. Shader handles are D3D11Shaders, and everything else is the
+// matching ID3D11 interface.
+// Commands that would set something to what it already is are skipped, constant uploads included: a constant buffer
+// is only updated when its contents differ from what was last uploaded to it.
+// A frame's instance data all goes into one dynamic vertex buffer at the start of Execute. Instanced draws read their
+// share of it through the second vertex buffer slot.
+// What each Execute actually sent to the device is reported to the Profiler's counters. Each Execute is a GPU profiler
+// frame, and the command buffer's zones are timed on the GPU within it.
+#define RENDER_BACKEND_TRACKED_SLOTS 16		// Texture and sampler slots whose bindings are tracked. Higher slots are always set.
+
+class D3D11RenderBackend : public RenderBackend {
+public:
+	D3D11RenderBackend(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~D3D11RenderBackend();
+
+	void Execute(const CommandBuffer& commands) override;
+	RenderHandle CreateVertexBuffer(const void* data, unsigned int size) override;
+	RenderHandle CreateIndexBuffer(const unsigned int* indices, unsigned int count) override;
+	void DestroyBuffer(RenderHandle buffer) override;
+	// Commands skipped by the last Execute because they wouldn't have changed anything
+	size_t GetSkippedCount();
+	GpuProfiler& GetGpuProfiler();
+
+	// Input layout matching PackedVertex
+	static const D3D11_INPUT_ELEMENT_DESC* GetPackedInputLayoutDesc(UINT& elementCount);
+	// PackedVertex in the first vertex buffer and InstanceData in the second
+	static const D3D11_INPUT_ELEMENT_DESC* GetPackedInstancedInputLayoutDesc(UINT& elementCount);
+
+private:
+	// Other code may use the context between frames, so nothing bound is assumed at the start of an Execute
+	void ForgetState();
+	// Copy the command buffer's instance data into instanceBuffer, growing it if needed
+	void UploadInstances(const CommandBuffer& commands);
+	// Bind buffers for a draw, skipping the ones already bound
+	void SetGeometry(const RenderCommand& command);
+	RenderHandle CreateBuffer(const void* data, unsigned int size, D3D11_BIND_FLAG bindFlag);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>> buffers;	// Made by CreateVertexBuffer and CreateIndexBuffer
+	size_t instanceBufferSize = 0;
+	size_t skippedCount = 0;
+	GpuProfiler gpuProfiler;
+	long long counters[PROFILER_COUNTER_COUNT];	// This Execute's, handed to the Profiler at the end
+
+	// Bound by this Execute so far
+	RenderHandle vertexShader;
+	RenderHandle pixelShader;
+	RenderHandle depthStencilState;
+	unsigned int stencilReference;
+	RenderHandle rasterizerState;
+	D3D11_RECT scissor;
+	RenderHandle textures[RENDER_BACKEND_TRACKED_SLOTS];
+	RenderHandle samplers[RENDER_BACKEND_TRACKED_SLOTS];
+	RenderHandle vertexBuffer;
+	RenderHandle indexBuffer;
+	unsigned int vertexStride;
+	std::unordered_map<ID3D11Buffer*, std::vector<unsigned char>> uploadedConstants;
+};
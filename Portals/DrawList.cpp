@@ -0,0 +1,279 @@
+#include "DrawList.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+using namespace std;
+
+// Byte offset of a variable in the given constant buffer, or -1 if it isn't there
+static int VariableOffset(RenderShader* shader, const char* name, int buffer)
+{
+	RenderShaderVariable variable;
+	return shader->GetVariable(name, variable) && (int)variable.buffer == buffer ? (int)variable.offset : -1;
+}
+
+// Record the constant buffer that holds variable, if the shader has it
+static void SetBufferHolding(CommandBuffer& commands, RenderShader* shader, const char* variable)
+{
+	RenderShaderVariable info;
+	if (shader->GetVariable(variable, info)) {
+		commands.SetConstants(shader, info.buffer);
+	}
+}
+
+static void Write(vector<unsigned char>& data, size_t base, int offset, const void* value, size_t size)
+{
+	if (offset >= 0) {
+		memcpy(&data[base + offset], value, size);
+	}
+}
+
+void DrawList::Record(const SceneView& view, const DrawScene& scene, bool instancing)
+{
+	PROFILE_ZONE("DrawList::Record");
+
+	this->view = view;
+	draws.clear();
+	instances.clear();
+
+	// Through a portal the near plane is the exit portal's plane, so this also drops everything behind the exit
+	CullFrustum frustum;
+	FrustumCulling::BuildFrustum(view.view, view.projection, view.screenRect, frustum);
+	FrustumCulling::Cull(frustum, scene.bounds, visible);
+
+	// Then whatever the occluders in view hide, from the view they're seen from
+	occludedCount = 0;
+	if (!scene.occluders.empty()) {
+		occlusion.Begin(view.view, view.projection, view.screenRect);
+		for (const Occluder& occluder : scene.occluders) {
+			if (visible[occluder.bounds]) {
+				occlusion.DrawOccluders(&scene.occluderTriangles[occluder.firstTriangle * 3], occluder.triangleCount);
+			}
+		}
+		occlusion.Finish();
+		for (size_t i = 0; i < scene.boxes.size(); i++) {
+			if (visible[i] && !occlusion.IsVisible(scene.boxes[i])) {
+				visible[i] = 0;
+				occludedCount++;
+			}
+		}
+	}
+
+	XMFLOAT4 noClip(0, 0, 0, 1);
+	for (const DrawItem& item : scene.items) {
+		XMFLOAT4X4 world = item.world;
+		XMFLOAT4X4 worldInverseTranspose = item.worldInverseTranspose;
+		if (item.straddle == nullptr) {
+			if (visible[item.bounds]) {
+				AddDraw(item.entity, world, worldInverseTranspose, noClip);
+			}
+			continue;
+		}
+
+		// Part way through a portal: what's still in front of the entrance, and the rest coming out of the exit
+		if (visible[item.bounds]) {
+			AddDraw(item.entity, world, worldInverseTranspose, item.straddle->sourcePlane);
+		}
+		if (!visible[item.bounds + 1]) {
+			continue;
+		}
+		XMMATRIX offsetWorld = XMLoadFloat4x4(&world) * XMLoadFloat4x4(&item.straddle->sourceToDestination);
+		XMStoreFloat4x4(&world, offsetWorld);
+		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(0, offsetWorld)));
+		AddDraw(item.entity, world, worldInverseTranspose, item.straddle->destinationPlane);
+	}
+
+	// Draws that share a shader, material and mesh end up next to each other, so submitting skips rebinding them.
+	// Within those, nearer draws go first so the depth test can reject more of what's behind them.
+	stable_sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) { return a.sortKey < b.sortKey; });
+	BuildBatches(instancing);
+}
+
+void DrawList::BuildBatches(bool instancing)
+{
+	batches.clear();
+	batchInstances.clear();
+	constantData.clear();
+
+	for (size_t first = 0; first < draws.size();) {
+		// Sorting put every draw of this shader, material and mesh together. Pointers are compared rather than keys,
+		// since the key's fields saturate once a scene has enough different things in it.
+		const Draw& draw = draws[first];
+		size_t end = first + 1;
+		while (end < draws.size() && draws[end].vertexShader == draw.vertexShader && draws[end].material == draw.material &&
+			draws[end].mesh == draw.mesh) {
+			end++;
+		}
+
+		RenderShader* instancedShader = instancing ? draw.material->GetInstancedVertexShaderFor(draw.mesh) : nullptr;
+		if (instancedShader != nullptr && end - first >= DRAW_LIST_MIN_INSTANCES) {
+			// Still front to back within the batch
+			Batch batch = MakeBatch(draw, instancedShader, nullptr);
+			batch.firstInstance = (unsigned int)batchInstances.size();
+			batch.instanceCount = (unsigned int)(end - first);
+			for (size_t i = first; i < end; i++) {
+				batchInstances.push_back(instances[draws[i].instance]);
+			}
+			batches.push_back(batch);
+		}
+		else {
+			for (size_t i = first; i < end; i++) {
+				batches.push_back(MakeBatch(draws[i], draws[i].vertexShader, &instances[draws[i].instance]));
+			}
+		}
+		first = end;
+	}
+}
+
+DrawList::Batch DrawList::MakeBatch(const Draw& draw, RenderShader* shader, const InstanceData* instance)
+{
+	Batch batch;
+	batch.material = draw.material;
+	batch.mesh = draw.mesh;
+	batch.vertexShader = shader;
+	batch.constantsOffset = (unsigned int)constantData.size();
+	batch.firstInstance = 0;
+	batch.instanceCount = 0;
+
+	const ConstantLayout& layout = GetLayout(shader);
+	constantData.resize(constantData.size() + layout.size);
+	size_t base = batch.constantsOffset;
+	if (instance != nullptr) {
+		Write(constantData, base, layout.world, &instance->World, sizeof(XMFLOAT4X4));
+		Write(constantData, base, layout.worldInverseTranspose, &instance->WorldInverseTranspose, sizeof(XMFLOAT4X4));
+		Write(constantData, base, layout.clipPlane, &instance->ClipPlane, sizeof(XMFLOAT4));
+	}
+	if (layout.positionMin >= 0) {
+		// Bounds the packed positions were quantized against
+		XMFLOAT3 localMin = draw.mesh->GetLocalMin();
+		XMFLOAT3 localMax = draw.mesh->GetLocalMax();
+		XMFLOAT3 extent(localMax.x - localMin.x, localMax.y - localMin.y, localMax.z - localMin.z);
+		Write(constantData, base, layout.positionMin, &localMin, sizeof(XMFLOAT3));
+		Write(constantData, base, layout.positionExtent, &extent, sizeof(XMFLOAT3));
+	}
+	return batch;
+}
+
+unsigned int DrawList::SortIndex(std::vector<const void*>& order, const void* object)
+{
+	for (size_t i = 0; i < order.size(); i++) {
+		if (order[i] == object) {
+			return (unsigned int)i;
+		}
+	}
+	order.push_back(object);
+	return (unsigned int)order.size() - 1;
+}
+
+void DrawList::AddDraw(Entity* entity, const XMFLOAT4X4& world, const XMFLOAT4X4& worldInverseTranspose, const XMFLOAT4& clipPlane)
+{
+	Draw draw;
+	draw.material = entity->GetMaterial();
+	draw.mesh = entity->GetMesh();
+	draw.vertexShader = draw.material->GetVertexShaderFor(draw.mesh);
+	draw.instance = (unsigned int)instances.size();
+
+	// Key, from the top bit down: 8 bits of shader, 12 of material, 12 of mesh, then 32 of view depth. Depths are
+	// never negative once clamped, and non-negative floats sort the same as their bit patterns.
+	float depth = world._41 * view.view._13 + world._42 * view.view._23 + world._43 * view.view._33 + view.view._43;
+	depth = (std::max)(depth, 0.0f);
+	unsigned int depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	unsigned long long shader = (std::min)(SortIndex(shaderOrder, draw.vertexShader), 0xFFu);
+	unsigned long long material = (std::min)(SortIndex(materialOrder, draw.material), 0xFFFu);
+	unsigned long long mesh = (std::min)(SortIndex(meshOrder, draw.mesh), 0xFFFu);
+	draw.sortKey = shader << 56 | material << 44 | mesh << 32 | depthBits;
+
+	InstanceData instance;
+	instance.World = world;
+	instance.WorldInverseTranspose = worldInverseTranspose;
+	instance.ClipPlane = clipPlane;
+	instances.push_back(instance);
+	draws.push_back(draw);
+}
+
+const DrawList::ConstantLayout& DrawList::GetLayout(RenderShader* shader)
+{
+	for (const ConstantLayout& layout : layouts) {
+		if (layout.shader == shader) {
+			return layout;
+		}
+	}
+
+	ConstantLayout layout;
+	layout.shader = shader;
+	RenderShaderVariable world;
+	bool hasWorld = shader->GetVariable("world", world) || shader->GetVariable("positionMin", world);
+	layout.drawBuffer = hasWorld ? (int)world.buffer : -1;
+	layout.size = hasWorld ? shader->GetBufferSize(world.buffer) : 0;
+	layout.world = VariableOffset(shader, "world", layout.drawBuffer);
+	layout.worldInverseTranspose = VariableOffset(shader, "worldInverseTranspose", layout.drawBuffer);
+	layout.clipPlane = VariableOffset(shader, "clipPlane", layout.drawBuffer);
+	layout.positionMin = VariableOffset(shader, "positionMin", layout.drawBuffer);
+	layout.positionExtent = VariableOffset(shader, "positionExtent", layout.drawBuffer);
+	layouts.push_back(layout);
+	return layouts.back();
+}
+
+void DrawList::Submit(CommandBuffer& commands, const std::vector<Light>& lights, XMFLOAT3 ambientColor)
+{
+	PROFILE_ZONE("DrawList::Submit");
+
+	RenderShader* boundShader = nullptr;
+	RenderShader* boundPixelShader = nullptr;
+	Material* boundMaterial = nullptr;
+	submittedShaders.clear();
+
+	for (const Batch& draw : batches) {
+		RenderShader* ps = draw.material->GetPixelShader();
+		if (draw.vertexShader != boundShader || ps != boundPixelShader) {
+			commands.SetPipeline(draw.vertexShader, ps);
+			boundShader = draw.vertexShader;
+			boundPixelShader = ps;
+		}
+
+		// Per-view constants, once per shader
+		if (find(submittedShaders.begin(), submittedShaders.end(), draw.vertexShader) == submittedShaders.end()) {
+			draw.vertexShader->SetMatrix4x4("view", view.view);
+			draw.vertexShader->SetMatrix4x4("projection", view.projection);
+			SetBufferHolding(commands, draw.vertexShader, "view");
+			submittedShaders.push_back(draw.vertexShader);
+		}
+		if (ps != nullptr && find(submittedShaders.begin(), submittedShaders.end(), ps) == submittedShaders.end()) {
+			ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+			ps->SetFloat3("ambientColor", ambientColor);
+			ps->SetFloat3("cameraPosition", view.cameraPosition);
+			SetBufferHolding(commands, ps, "lights");
+			submittedShaders.push_back(ps);
+		}
+
+		// The per-draw constants were laid out at record time, so they go straight into the constant buffer
+		const ConstantLayout& layout = GetLayout(draw.vertexShader);
+		if (layout.drawBuffer >= 0) {
+			commands.SetConstants(draw.vertexShader, layout.drawBuffer, &constantData[draw.constantsOffset], layout.size);
+		}
+
+		if (draw.material != boundMaterial) {
+			draw.material->PrepareSurface(commands);
+			boundMaterial = draw.material;
+		}
+
+		if (draw.instanceCount > 0) {
+			draw.mesh->DrawInstanced(commands, &batchInstances[draw.firstInstance], draw.instanceCount);
+		}
+		else {
+			draw.mesh->Draw(commands);
+		}
+	}
+}
+
+size_t DrawList::GetDrawCount()
+{
+	return draws.size();
+}
+
+size_t DrawList::GetOccludedCount()
+{
+	return occludedCount;
+}
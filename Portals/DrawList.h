@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "Entity.h"
+#include "FrustumCulling.h"
+#include "Light.h"
+#include "OcclusionBuffer.h"
+#include "PortalTraversal.h"
+#include "RenderCommands.h"
+#include "RenderShader.h"
+
+// Camera for one pass over the scene: the main view, or the view out of a portal
+struct SceneView {
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT3 cameraPosition;
+	DirectX::XMFLOAT4 screenRect;	// The opening it's seen through: left, top, right, bottom in normalized device coordinates
+};
+
+// Something to draw in every view this frame. The matrices are copied out of the transform up front, since a
+// transform can rebuild its matrices when read and the lists are recorded on several threads at once.
+struct DrawItem {
+	Entity* entity;
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInverseTranspose;
+	const PortalStraddle* straddle;		// Drawn once on each side of the portal when set
+	unsigned int bounds;				// Index of its world box in the frame's bounds. A straddler's exit side box is next.
+};
+
+// An entity whose triangles hide what's behind them in the occlusion buffer
+struct Occluder {
+	unsigned int bounds;				// Index of its world box, so occluders outside a view aren't rasterized
+	unsigned int firstTriangle;			// Into DrawScene::occluderTriangles
+	unsigned int triangleCount;
+};
+
+// Everything the draw lists need to know about the scene for one frame. Gathered once on the main thread, and only
+// read while the lists are recorded.
+struct DrawScene {
+	std::vector<DrawItem> items;
+	std::vector<DirectX::BoundingBox> boxes;			// World bounds, see DrawItem::bounds
+	std::vector<BoundsBlock4> bounds;					// The same boxes, packed for frustum culling
+	std::vector<Occluder> occluders;
+	std::vector<DirectX::XMFLOAT3> occluderTriangles;	// World space, three points each
+};
+
+// The draws for one view of the scene, worked out ahead of time. Recording first culls the frame's bounds against the
+// view's frustum, narrowed to the opening it's seen through, and skips whatever is outside. Then it picks each draw's
+// vertex shader, lays out its per-draw constants exactly as the shader's constant buffer expects, and sorts the draws
+// by a 64 bit key: shader, then material, then mesh, then front to back. None of that touches shared state, so the
+// lists for every portal view can be recorded on separate threads, then submitted one after another to the frame's
+// command buffer in the order the stencil passes need them.
+// When the scene has occluders, the ones that survive frustum culling are drawn into the list's own occlusion buffer,
+// using the same view and clipped projection, and anything they completely hide is culled too.
+// Submitting only records a shader's per-view constants (view, projection, camera position, lights) the first time
+// the shader is used, and a material's constants and textures when the material changes.
+// With instancing on, each run of draws left sharing a material and mesh after sorting becomes one instanced draw, when
+// the material has an instanced shader. The instances are worked out again for every view, from that view's draws.
+#define DRAW_LIST_MIN_INSTANCES 2		// Fewest copies of a mesh worth an instanced draw
+
+class DrawList {
+public:
+	void Record(const SceneView& view, const DrawScene& scene, bool instancing = true);
+	void Submit(CommandBuffer& commands, const std::vector<Light>& lights, DirectX::XMFLOAT3 ambientColor);
+	size_t GetDrawCount();
+	// Boxes hidden by occluders in the last Record, out of those inside the frustum
+	size_t GetOccludedCount();
+
+private:
+	struct Draw {
+		unsigned long long sortKey;
+		Material* material;
+		Mesh* mesh;
+		RenderShader* vertexShader;
+		unsigned int instance;			// Into instances
+	};
+
+	// One draw call: either a single draw, or a run of them drawn instanced
+	struct Batch {
+		Material* material;
+		Mesh* mesh;
+		RenderShader* vertexShader;
+		unsigned int constantsOffset;	// Into constantData
+		unsigned int firstInstance;		// Into batchInstances
+		unsigned int instanceCount;		// 0 when not instanced
+	};
+
+	// Where each per-draw value lives in a vertex shader's constant buffers
+	struct ConstantLayout {
+		RenderShader* shader;
+		int drawBuffer;					// Buffer holding world, or positionMin for instanced shaders. -1 if none.
+		unsigned int size;				// Of drawBuffer
+		int world;
+		int worldInverseTranspose;
+		int clipPlane;
+		int positionMin;
+		int positionExtent;
+	};
+
+	const ConstantLayout& GetLayout(RenderShader* shader);
+	void AddDraw(Entity* entity, const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& worldInverseTranspose,
+		const DirectX::XMFLOAT4& clipPlane);
+	// Group the sorted draws into batches, laying out their per-draw constants
+	void BuildBatches(bool instancing);
+	// Instance is null for an instanced batch, whose world matrices aren't constants
+	Batch MakeBatch(const Draw& draw, RenderShader* shader, const InstanceData* instance);
+	// Position of object in order, added to the end the first time it's seen. Gives the sort key small numbers to
+	// work with that stay the same from view to view.
+	unsigned int SortIndex(std::vector<const void*>& order, const void* object);
+
+	SceneView view;
+	std::vector<unsigned char> visible;		// Per box in the bounds, from culling
+	OcclusionBuffer occlusion;
+	size_t occludedCount = 0;
+	std::vector<Draw> draws;
+	std::vector<InstanceData> instances;		// Each draw's transform and clip plane, in the order they were added
+	std::vector<Batch> batches;
+	std::vector<InstanceData> batchInstances;	// The instanced batches' instances, in draw order
+	std::vector<unsigned char> constantData;
+	std::vector<ConstantLayout> layouts;	// Looked up once per shader, rather than by name for every draw
+	std::vector<const void*> shaderOrder;
+	std::vector<const void*> materialOrder;
+	std::vector<const void*> meshOrder;
+	std::vector<const void*> submittedShaders;	// Given their per-view constants by the current Submit
+};
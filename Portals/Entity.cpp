@@ -1,10 +1,12 @@
 #include "Entity.h"
+#include "BoundsSystem.h"
 using namespace DirectX;
 Entity::Entity(Mesh* mesh, Material* material) {
 	meshPtr = mesh;
 	materialPtr = material;
 	transform = Transform();
-	// Calculate AABB in world space
+	// Calculate AABB in world space the first time it's asked for
+	transform.boundsDirty = true;
 }
 Entity::~Entity() {
 
@@ -22,44 +24,77 @@ Material* Entity::GetMaterial()
 }
 
 BoundingBox Entity::GetBoundingBox() {
-	if (transform.boundsDirty) {
-		XMFLOAT3 localMin = meshPtr->GetLocalMin();
-		XMFLOAT3 localMax = meshPtr->GetLocalMax();
-		XMFLOAT3 worldCorner1 = transform.TransformPoint(XMFLOAT3(localMin.x, localMin.y, localMin.z));
-		XMFLOAT3 worldCorner2 = transform.TransformPoint(XMFLOAT3(localMax.x, localMax.y, localMax.z));
-		XMFLOAT3 extents = XMFLOAT3(
-			abs(worldCorner2.x - worldCorner1.x) / 2,
-			abs(worldCorner2.y - worldCorner1.y) / 2,
-			abs(worldCorner2.z - worldCorner1.z) / 2
-		);
-		boundingBox = BoundingBox(transform.GetPosition(), extents);
-		transform.boundsDirty = false;
-	}
-	return boundingBox;
+	UpdateBounds();
+	return bounds.box;
 }
 
-void Entity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition)
+BoundingOrientedBox Entity::GetOrientedBox() {
+	UpdateBounds();
+	return bounds.orientedBox;
+}
+
+BoundingSphere Entity::GetBoundingSphere() {
+	UpdateBounds();
+	return bounds.sphere;
+}
+
+BoundingBox Entity::GetLocalBox() {
+	XMFLOAT3 localMin = meshPtr->GetLocalMin();
+	XMFLOAT3 localMax = meshPtr->GetLocalMax();
+	return BoundingBox(
+		XMFLOAT3((localMin.x + localMax.x) / 2, (localMin.y + localMax.y) / 2, (localMin.z + localMax.z) / 2),
+		XMFLOAT3((localMax.x - localMin.x) / 2, (localMax.y - localMin.y) / 2, (localMax.z - localMin.z) / 2));
+}
+
+// The same math the BoundsSystem runs in bulk, for one entity
+void Entity::UpdateBounds() {
+	if (!transform.boundsDirty) return;
+	BoundingBox localBox = GetLocalBox();
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	BoundsSystem::ComputeBounds(&localBox, &world, 1, &bounds);
+	transform.boundsDirty = false;
+	boundsVersion++;
+}
+
+unsigned int Entity::GetBoundsVersion()
+{
+	return boundsVersion;
+}
+
+unsigned int Entity::GetTags()
 {
-	materialPtr->PrepareMaterial(&transform, viewMat, projMat, cameraPosition);
+	return tags;
+}
 
-	//context->VSSetConstantBuffers(
-	//	0,  // Which slot (register) to bind the buffer to?
-	//	1,  // How many are we activating?  Can do multiple at once 
-	//	constantBufferVS.GetAddressOf());  // Array of buffers (or the address of one)
+void Entity::SetTags(unsigned int tags)
+{
+	this->tags = tags;
+}
 
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, meshPtr->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(meshPtr->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+XMFLOAT3 Entity::GetVelocity()
+{
+	return velocity;
+}
 
+void Entity::SetVelocity(XMFLOAT3 velocity)
+{
+	this->velocity = velocity;
+}
 
-	// Finally do the actual drawing
-	//  - Do this ONCE PER OBJECT you intend to draw
-	//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
-	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-	//     vertices in the currently set VERTEX BUFFER
-	context->DrawIndexed(
-		meshPtr->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+void Entity::Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition)
+{
+	materialPtr->PrepareMaterial(commands, &transform, viewMat, projMat, cameraPosition, meshPtr);
+	meshPtr->Draw(commands);
+}
+
+void Entity::Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition,
+	XMFLOAT4X4 offset, XMFLOAT4 clipPlane)
+{
+	XMFLOAT4X4 worldMat = transform.GetWorldMatrix();
+	XMMATRIX world = XMLoadFloat4x4(&worldMat) * XMLoadFloat4x4(&offset);
+	XMFLOAT4X4 worldInvTranspose;
+	XMStoreFloat4x4(&worldMat, world);
+	XMStoreFloat4x4(&worldInvTranspose, XMMatrixTranspose(XMMatrixInverse(0, world)));
+	materialPtr->PrepareMaterial(commands, worldMat, worldInvTranspose, viewMat, projMat, cameraPosition, meshPtr, clipPlane);
+	meshPtr->Draw(commands);
 }
\ No newline at end of file
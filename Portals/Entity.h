@@ -1,11 +1,29 @@
 #pragma once
 #include "Transform.h"
 #include "Mesh.h"
-#include "Camera.h"
 #include "Material.h"
 #include <DirectXCollision.h>
 
+// Surface tags, combined into a bitmask per entity. Scene ray casts only consider entities matching their tag mask.
+#define ENTITY_TAG_NONE 0
+#define ENTITY_TAG_SOLID 1			// Blocks rays and the player
+#define ENTITY_TAG_PORTALABLE 2		// Portals can be placed on it
+#define ENTITY_TAG_DYNAMIC 4		// Simulated by the physics world, and carried through portals
+#define ENTITY_TAG_OCCLUDER 8		// Big and solid enough to hide things behind it from occlusion culling
+#define ENTITY_TAG_WALL 16			// One of the room's walls, hidden when wall drawing is turned off
+#define ENTITY_TAG_ALL 0xFFFFFFFF
+
+// World space bounds of an entity, all from the same world matrix
+struct EntityBounds {
+	DirectX::BoundingBox box;					// Tightest axis aligned box around the oriented box
+	DirectX::BoundingOrientedBox orientedBox;	// The mesh's local box, moved into the world
+	DirectX::BoundingSphere sphere;				// Through the oriented box's corners
+};
+
 class Entity {
+	// Batch updates read the transform and write the bounds back directly
+	friend class BoundsSystem;
+
 public:
 	Entity(Mesh* meshPtr, Material* material);
 	~Entity();
@@ -13,11 +31,30 @@ public:
 	Mesh* GetMesh();
 	Transform* GetTransform();
 	Material* GetMaterial();
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
+	void Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
+	// Draw with the world matrix followed by offset (a copy on the far side of a portal), keeping only what's in front of clipPlane
+	void Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition,
+		XMFLOAT4X4 offset, XMFLOAT4 clipPlane);
+	// World bounds, recomputed when the transform has changed since they were last worked out
 	DirectX::BoundingBox GetBoundingBox();
+	DirectX::BoundingOrientedBox GetOrientedBox();
+	DirectX::BoundingSphere GetBoundingSphere();
+	// The mesh's bounds, in its own space
+	DirectX::BoundingBox GetLocalBox();
+	// Incremented every time the bounds are recomputed, so other systems can tell they changed
+	unsigned int GetBoundsVersion();
+	unsigned int GetTags();
+	void SetTags(unsigned int tags);
+	XMFLOAT3 GetVelocity();
+	void SetVelocity(XMFLOAT3 velocity);
 private:
+	void UpdateBounds();
+
 	Transform transform;
 	Mesh* meshPtr;
 	Material* materialPtr;
-	BoundingBox boundingBox;
+	EntityBounds bounds;
+	unsigned int boundsVersion = 0;
+	unsigned int tags = ENTITY_TAG_SOLID;
+	XMFLOAT3 velocity = XMFLOAT3(0, 0, 0);	// World units per second
 };
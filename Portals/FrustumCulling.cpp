@@ -0,0 +1,102 @@
+#include "FrustumCulling.h"
+#include <float.h>
+#include <math.h>
+
+using namespace DirectX;
+using namespace std;
+
+void FrustumCulling::BuildFrustum(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, const XMFLOAT4& screenRect,
+	CullFrustum& outFrustum)
+{
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+
+	// With row vectors, clip space x, y, z and w are dot products with the matrix's columns. Keeping
+	// left * w <= x <= right * w, bottom * w <= y <= top * w and 0 <= z <= w gives a plane for each inequality.
+	XMVECTOR column[4];
+	for (int i = 0; i < 4; i++) {
+		column[i] = XMVectorSet(viewProjection.m[0][i], viewProjection.m[1][i], viewProjection.m[2][i], viewProjection.m[3][i]);
+	}
+	XMVECTOR planes[6] = {
+		column[0] - column[3] * screenRect.x,	// Left
+		column[3] * screenRect.z - column[0],	// Right
+		column[3] * screenRect.y - column[1],	// Top
+		column[1] - column[3] * screenRect.w,	// Bottom
+		column[2],								// Near, or the oblique clip plane
+		column[3] - column[2]					// Far
+	};
+
+	// Normalized, so padding lanes stay outside however the planes were scaled
+	for (int i = 0; i < 6; i++) {
+		float length = XMVectorGetX(XMVector3Length(planes[i]));
+		XMStoreFloat4(&outFrustum.planes[i], length > 0 ? planes[i] / length : planes[i]);
+	}
+}
+
+void FrustumCulling::BuildBlocks(const BoundingBox* boxes, size_t boxCount, vector<BoundsBlock4>& outBlocks)
+{
+	outBlocks.resize((boxCount + 3) / 4);
+	for (size_t i = 0; i < outBlocks.size(); i++) {
+		BoundsBlock4& block = outBlocks[i];
+		float* lanes[6] = { &block.cx.x, &block.cy.x, &block.cz.x, &block.ex.x, &block.ey.x, &block.ez.x };
+		for (int lane = 0; lane < 4; lane++) {
+			size_t box = i * 4 + lane;
+			float values[6] = { 0, 0, 0, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			if (box < boxCount) {
+				const BoundingBox& bounds = boxes[box];
+				values[0] = bounds.Center.x;
+				values[1] = bounds.Center.y;
+				values[2] = bounds.Center.z;
+				values[3] = bounds.Extents.x;
+				values[4] = bounds.Extents.y;
+				values[5] = bounds.Extents.z;
+			}
+			for (int j = 0; j < 6; j++) {
+				lanes[j][lane] = values[j];
+			}
+		}
+	}
+}
+
+bool FrustumCulling::Intersects(const CullFrustum& frustum, const BoundingBox& box)
+{
+	// A box is outside a plane when even its corner furthest along the normal is behind it
+	for (int i = 0; i < 6; i++) {
+		const XMFLOAT4& plane = frustum.planes[i];
+		float distance = plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w;
+		float radius = fabsf(plane.x) * box.Extents.x + fabsf(plane.y) * box.Extents.y + fabsf(plane.z) * box.Extents.z;
+		if (distance + radius < 0) return false;
+	}
+	return true;
+}
+
+int FrustumCulling::IntersectBlock(const CullFrustum& frustum, const BoundsBlock4& block)
+{
+	XMVECTOR cx = XMLoadFloat4(&block.cx), cy = XMLoadFloat4(&block.cy), cz = XMLoadFloat4(&block.cz);
+	XMVECTOR ex = XMLoadFloat4(&block.ex), ey = XMLoadFloat4(&block.ey), ez = XMLoadFloat4(&block.ez);
+
+	// Same test as Intersects, for four boxes against each plane in turn
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR mask = XMVectorTrueInt();
+	for (int i = 0; i < 6; i++) {
+		const XMFLOAT4& plane = frustum.planes[i];
+		XMVECTOR distance = cx * plane.x + cy * plane.y + cz * plane.z + XMVectorReplicate(plane.w);
+		XMVECTOR radius = ex * fabsf(plane.x) + ey * fabsf(plane.y) + ez * fabsf(plane.z);
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(distance + radius, zero));
+	}
+
+	uint32_t lanes[4];
+	XMStoreInt4(lanes, mask);
+	return (lanes[0] ? 1 : 0) | (lanes[1] ? 2 : 0) | (lanes[2] ? 4 : 0) | (lanes[3] ? 8 : 0);
+}
+
+void FrustumCulling::Cull(const CullFrustum& frustum, const vector<BoundsBlock4>& blocks, vector<unsigned char>& outVisible)
+{
+	outVisible.resize(blocks.size() * 4);
+	for (size_t i = 0; i < blocks.size(); i++) {
+		int mask = IntersectBlock(frustum, blocks[i]);
+		for (int lane = 0; lane < 4; lane++) {
+			outVisible[i * 4 + lane] = (mask >> lane) & 1;
+		}
+	}
+}
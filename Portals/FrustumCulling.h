@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+// Four axis aligned boxes in structure-of-arrays form: each XMFLOAT4 holds the same component of four boxes.
+// Unused lanes have negative extents, which are never inside anything.
+struct BoundsBlock4 {
+	DirectX::XMFLOAT4 cx, cy, cz;
+	DirectX::XMFLOAT4 ex, ey, ez;
+};
+
+// The volume a view can draw into, as six world space planes. A point p is inside when
+// dot(plane.xyz, p) + plane.w >= 0 for every plane.
+struct CullFrustum {
+	DirectX::XMFLOAT4 planes[6];
+};
+
+// View frustum culling of axis aligned boxes. The wide versions use DirectXMath vectors, so they run on SSE/NEON,
+// or plain floats with _XM_NO_INTRINSICS_.
+class FrustumCulling {
+public:
+	FrustumCulling() = delete;
+
+	// The planes of a view and projection, with the sides narrowed to screenRect (left, top, right, bottom in
+	// normalized device coordinates). The planes come straight out of the combined matrix, so an oblique projection
+	// gives its clip plane as the near plane, and boxes behind a portal's exit are culled with the rest.
+	static void BuildFrustum(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection,
+		const DirectX::XMFLOAT4& screenRect, CullFrustum& outFrustum);
+
+	// Pack boxes into blocks of four. The last block is padded with empty lanes.
+	static void BuildBlocks(const DirectX::BoundingBox* boxes, size_t boxCount, std::vector<BoundsBlock4>& outBlocks);
+
+	// One box, the reference for the wide versions. True if any of the box may be inside.
+	static bool Intersects(const CullFrustum& frustum, const DirectX::BoundingBox& box);
+	// Four boxes at once. Returns a bit mask of the lanes that may be inside.
+	static int IntersectBlock(const CullFrustum& frustum, const BoundsBlock4& block);
+	// Every box in blocks. Box i is visible when outVisible[i] is non-zero; padding lanes are included, and never are.
+	static void Cull(const CullFrustum& frustum, const std::vector<BoundsBlock4>& blocks, std::vector<unsigned char>& outVisible);
+};
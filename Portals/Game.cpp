@@ -6,8 +6,9 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 #include <math.h>
-#include <iostream>
 #include "MeshFactory.h"
+#include "Benchmark.h"
+#include "Profiler.h"
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -64,11 +65,15 @@ Game::~Game()
 	}
 	delete camera;
 	delete vertexShader;
+	delete packedVertexShader;
+	delete instancedVertexShader;
+	delete packedInstancedVertexShader;
 	delete portalPixelShader;
 	delete lightingPixelShader;
 	delete skyVS;
 	delete skyPS;
 	delete skyBox;
+	delete renderBackend;
 }
 
 // --------------------------------------------------------
@@ -80,6 +85,7 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	renderBackend = new D3D11RenderBackend(device, context);
 	LoadShaders();
 	CreateMaterials();
 	CreateBasicGeometry();
@@ -95,6 +101,7 @@ void Game::Init()
 	// Create the camera once we have the aspect ratio
 	camera = new Camera(0, 2, 0, 5.0f, .15f, XM_PIDIV4, (float)width / height, hWnd);
 	camera->GetTransform()->SetPitchYawRoll(0, PI / 2, 0);
+	portalTraversal.Add(camera->GetTransform(), true);
 	drawSkyBox = true;
 	debugPortals = true;
 
@@ -190,7 +197,15 @@ void Game::Init()
 	rastDesc.DepthBias = -1000;             // Absolute bias
 	rastDesc.SlopeScaledDepthBias = -1.0f;  // Scale bias based on polygon slope
 	rastDesc.DepthBiasClamp = 0.0f;
+	rastDesc.ScissorEnable = true;          // Portal borders are also restricted to the current portal opening
 	device->CreateRasterizerState(&rastDesc, portalRastState.GetAddressOf());
+	// Default rasterizer state, with scissoring so each recursion level only rasterizes inside its parent portal
+	rastDesc = {};
+	rastDesc.FillMode = D3D11_FILL_SOLID;
+	rastDesc.CullMode = D3D11_CULL_BACK;
+	rastDesc.DepthClipEnable = true;
+	rastDesc.ScissorEnable = true;
+	device->CreateRasterizerState(&rastDesc, scissorRastState.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -203,57 +218,48 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShader.cso").c_str());
-	portalPixelShader = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PortalPS.cso").c_str());
-	lightingPixelShader = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"LightingPS.cso").c_str());
-	skyVS = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"SkyVS.cso").c_str());
-	skyPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"SkyPS.cso").c_str());
+	vertexShader = new D3D11Shader(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShader.cso").c_str()));
+
+	// The packed vertex shader's inputs are 16 bit formats that can't be worked out from reflection,
+	// so its input layout is made here from the PackedVertex description
+	Microsoft::WRL::ComPtr<ID3DBlob> packedVSBlob;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> packedInputLayout;
+	D3DReadFileToBlob(GetFullPathTo_Wide(L"PackedVertexShader.cso").c_str(), packedVSBlob.GetAddressOf());
+	UINT elementCount;
+	const D3D11_INPUT_ELEMENT_DESC* packedLayoutDesc = D3D11RenderBackend::GetPackedInputLayoutDesc(elementCount);
+	device->CreateInputLayout(packedLayoutDesc, elementCount, packedVSBlob->GetBufferPointer(), packedVSBlob->GetBufferSize(), packedInputLayout.GetAddressOf());
+	packedVertexShader = new D3D11Shader(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PackedVertexShader.cso").c_str(),
+		packedInputLayout, false));
+
+	// Instanced versions of both. Reflection puts the _PER_INSTANCE inputs in the second vertex buffer on its own,
+	// but the packed one needs its layout spelled out again, instance data included.
+	instancedVertexShader = new D3D11Shader(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"InstancedVertexShader.cso").c_str()));
+	Microsoft::WRL::ComPtr<ID3DBlob> packedInstancedVSBlob;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> packedInstancedInputLayout;
+	D3DReadFileToBlob(GetFullPathTo_Wide(L"PackedInstancedVertexShader.cso").c_str(), packedInstancedVSBlob.GetAddressOf());
+	const D3D11_INPUT_ELEMENT_DESC* packedInstancedLayoutDesc = D3D11RenderBackend::GetPackedInstancedInputLayoutDesc(elementCount);
+	device->CreateInputLayout(packedInstancedLayoutDesc, elementCount, packedInstancedVSBlob->GetBufferPointer(), packedInstancedVSBlob->GetBufferSize(),
+		packedInstancedInputLayout.GetAddressOf());
+	packedInstancedVertexShader = new D3D11Shader(new SimpleVertexShader(device.Get(), context.Get(),
+		GetFullPathTo_Wide(L"PackedInstancedVertexShader.cso").c_str(), packedInstancedInputLayout, true));
+	portalPixelShader = new D3D11Shader(new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PortalPS.cso").c_str()));
+	lightingPixelShader = new D3D11Shader(new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"LightingPS.cso").c_str()));
+	skyVS = new D3D11Shader(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"SkyVS.cso").c_str()));
+	skyPS = new D3D11Shader(new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"SkyPS.cso").c_str()));
+}
+
+// Load a texture and keep it for as long as the game runs, since materials only hold its handle
+ID3D11ShaderResourceView* Game::LoadTexture(const wchar_t* relativePath)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(relativePath).c_str(), 0, srv.GetAddressOf());
+	textures.push_back(srv);
+	return srv.Get();
 }
 
 // Create the basic materials for assignment 5
 void Game::CreateMaterials()
 {
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneAlbedoRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneSpecularRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneNormalRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneMetalnessRSV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorAlbedoRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorSpecularRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorNormalRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorMetalnessRSV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalAlbedoRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSpecularRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalNormalRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalMetalnessRSV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodAlbedoRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodSpecularRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalRSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalnessRSV;
-
-	// Load textures.
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/cobblestone_albedo.png").c_str(), 0, cobblestoneAlbedoRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/cobblestone_roughness.png").c_str(), 0, cobblestoneSpecularRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/cobblestone_normals.png").c_str(), 0, cobblestoneNormalRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/cobblestone_metal.png").c_str(), 0, cobblestoneMetalnessRSV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/paint_albedo.png").c_str(), 0, floorAlbedoRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/paint_roughness.png").c_str(), 0, floorSpecularRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/paint_normals.png").c_str(), 0, floorNormalRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/paint_metal.png").c_str(), 0, floorMetalnessRSV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/floor_albedo.png").c_str(), 0, metalAlbedoRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/floor_roughness.png").c_str(), 0, metalSpecularRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/floor_normals.png").c_str(), 0, metalNormalRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/floor_metal.png").c_str(), 0, metalMetalnessRSV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/wood_albedo.png").c_str(), 0, woodAlbedoRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/wood_roughness.png").c_str(), 0, woodSpecularRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/wood_normals.png").c_str(), 0, woodNormalRSV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/wood_metal.png").c_str(), 0, woodMetalnessRSV.GetAddressOf());
-
 	D3D11_SAMPLER_DESC sampDesc = {};
 	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP; // What happens outside the 0-1 uv range?
 	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -265,39 +271,47 @@ void Game::CreateMaterials()
 
 	// Cobblestone Material
 	materials.insert({ "cobblestone", new Material(XMFLOAT4(1, 1, 1, 0), lightingPixelShader, vertexShader, 0.0f) });
-	materials["cobblestone"]->AddSampler("BasicSampler", sampler);
-	materials["cobblestone"]->AddTextureSRV("Albedo", cobblestoneAlbedoRSV);
-	materials["cobblestone"]->AddTextureSRV("RoughnessMap", cobblestoneSpecularRSV);
-	materials["cobblestone"]->AddTextureSRV("NormalMap", cobblestoneNormalRSV);
-	materials["cobblestone"]->AddTextureSRV("MetalnessMap", cobblestoneMetalnessRSV);
+	materials["cobblestone"]->AddSampler("BasicSampler", sampler.Get());
+	materials["cobblestone"]->AddTexture("Albedo", LoadTexture(L"../../Assets/Textures/cobblestone_albedo.png"));
+	materials["cobblestone"]->AddTexture("RoughnessMap", LoadTexture(L"../../Assets/Textures/cobblestone_roughness.png"));
+	materials["cobblestone"]->AddTexture("NormalMap", LoadTexture(L"../../Assets/Textures/cobblestone_normals.png"));
+	materials["cobblestone"]->AddTexture("MetalnessMap", LoadTexture(L"../../Assets/Textures/cobblestone_metal.png"));
 
 	// Floor Material
 	materials.insert({"floor", new Material(XMFLOAT4(1, 1, 1, 0), lightingPixelShader, vertexShader, 0.0f)});
-	materials["floor"]->AddSampler("BasicSampler", sampler);
-	materials["floor"]->AddTextureSRV("Albedo", floorAlbedoRSV);
-	materials["floor"]->AddTextureSRV("RoughnessMap", floorSpecularRSV);
-	materials["floor"]->AddTextureSRV("NormalMap", floorNormalRSV);
-	materials["floor"]->AddTextureSRV("MetalnessMap", floorMetalnessRSV);
+	materials["floor"]->AddSampler("BasicSampler", sampler.Get());
+	materials["floor"]->AddTexture("Albedo", LoadTexture(L"../../Assets/Textures/paint_albedo.png"));
+	materials["floor"]->AddTexture("RoughnessMap", LoadTexture(L"../../Assets/Textures/paint_roughness.png"));
+	materials["floor"]->AddTexture("NormalMap", LoadTexture(L"../../Assets/Textures/paint_normals.png"));
+	materials["floor"]->AddTexture("MetalnessMap", LoadTexture(L"../../Assets/Textures/paint_metal.png"));
 
 	// Metal Material
 	materials.insert({ "metal", new Material(XMFLOAT4(1, 1, 1, 0), lightingPixelShader, vertexShader, 0.0f) });
-	materials["metal"]->AddSampler("BasicSampler", sampler);
-	materials["metal"]->AddTextureSRV("Albedo", metalAlbedoRSV);
-	materials["metal"]->AddTextureSRV("RoughnessMap", metalSpecularRSV);
-	materials["metal"]->AddTextureSRV("NormalMap", metalNormalRSV);
-	materials["metal"]->AddTextureSRV("MetalnessMap", metalMetalnessRSV);
+	materials["metal"]->AddSampler("BasicSampler", sampler.Get());
+	materials["metal"]->AddTexture("Albedo", LoadTexture(L"../../Assets/Textures/floor_albedo.png"));
+	materials["metal"]->AddTexture("RoughnessMap", LoadTexture(L"../../Assets/Textures/floor_roughness.png"));
+	materials["metal"]->AddTexture("NormalMap", LoadTexture(L"../../Assets/Textures/floor_normals.png"));
+	materials["metal"]->AddTexture("MetalnessMap", LoadTexture(L"../../Assets/Textures/floor_metal.png"));
 
 	materials.insert({ "wood", new Material(XMFLOAT4(1, 1, 1, 0), lightingPixelShader, vertexShader, 0.0f) });
-	materials["wood"]->AddSampler("BasicSampler", sampler);
-	materials["wood"]->AddTextureSRV("Albedo", woodAlbedoRSV);
-	materials["wood"]->AddTextureSRV("RoughnessMap", woodSpecularRSV);
-	materials["wood"]->AddTextureSRV("NormalMap", woodNormalRSV);
-	materials["wood"]->AddTextureSRV("MetalnessMap", woodMetalnessRSV);
+	materials["wood"]->AddSampler("BasicSampler", sampler.Get());
+	materials["wood"]->AddTexture("Albedo", LoadTexture(L"../../Assets/Textures/wood_albedo.png"));
+	materials["wood"]->AddTexture("RoughnessMap", LoadTexture(L"../../Assets/Textures/wood_roughness.png"));
+	materials["wood"]->AddTexture("NormalMap", LoadTexture(L"../../Assets/Textures/wood_normals.png"));
+	materials["wood"]->AddTexture("MetalnessMap", LoadTexture(L"../../Assets/Textures/wood_metal.png"));
 
 	// Portal Material
 	materials.insert({"portal", new Material(XMFLOAT4(1, 1, 1, 0), portalPixelShader, vertexShader, 0.0f)});
-	materials["portal"]->AddSampler("BasicSampler", sampler);
+	materials["portal"]->AddSampler("BasicSampler", sampler.Get());
 	materials["portal"]->GetPixelShader()->SetFloat("borderThickness", portalBorderThickness / 2);
+
+	// Everything except the portals can draw packed meshes, and be instanced
+	for (auto& pair : materials) {
+		if (pair.first != "portal") {
+			pair.second->SetPackedVertexShader(packedVertexShader);
+			pair.second->SetInstancedVertexShaders(instancedVertexShader, packedInstancedVertexShader);
+		}
+	}
 }
 
 // --------------------------------------------------------
@@ -305,36 +319,57 @@ void Game::CreateMaterials()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	Mesh* mesh1 = new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device, context);
+	// Scene geometry is uploaded packed to cut the vertex fetch cost of every recursion level
+	int sceneVertexFormat = packedVertices ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_FULL;
+	Mesh* mesh1 = new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), renderBackend, sceneVertexFormat);
 	meshes.push_back(mesh1);
-	Mesh* mesh2 = new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, context);
+	Mesh* mesh2 = new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), renderBackend, sceneVertexFormat);
 	meshes.push_back(mesh2);
-	Mesh* portalMesh = new Mesh(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), device, context);
+	Mesh* portalMesh = new Mesh(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), renderBackend);
 	meshes.push_back(portalMesh);
-	Mesh* newPortalMesh = MeshFactory::CreateCircleMesh(400, device, context);
+	Mesh* newPortalMesh = MeshFactory::CreateCircleMesh(400, renderBackend);
 	meshes.push_back(newPortalMesh);
 
-	// Create scene mesh.
+	// Create scene mesh. The room never moves, and portals can be placed on its walls.
+	const UINT wallTags = ENTITY_TAG_SOLID | ENTITY_TAG_PORTALABLE | ENTITY_TAG_OCCLUDER | ENTITY_TAG_WALL;
 	entities.insert({ "floor", new Entity(meshes[0], materials["wood"])});
 	entities["floor"]->GetTransform()->SetScale(20, .01f, 20);
 	entities["floor"]->GetTransform()->MoveAbsolute(0, 0, 0);
+	entities["floor"]->SetTags(ENTITY_TAG_SOLID);
+	physicsWorld.AddStatic(entities["floor"]);
 	entities.insert({ "pos_z_wall", new Entity(meshes[0], materials["cobblestone"])});
 	entities["pos_z_wall"]->GetTransform()->SetScale(20, 20, 0.001f);
 	entities["pos_z_wall"]->GetTransform()->SetPitchYawRoll(0, 0, PI / 2);
 	entities["pos_z_wall"]->GetTransform()->SetPosition(0, 10, 10);
+	entities["pos_z_wall"]->SetTags(wallTags);
+	physicsWorld.AddStatic(entities["pos_z_wall"]);
 	entities.insert({ "neg_z_wall", new Entity(meshes[0], materials["cobblestone"])});
 	entities["neg_z_wall"]->GetTransform()->SetScale(20, 20, 0.001f);
 	entities["neg_z_wall"]->GetTransform()->SetPitchYawRoll(0, 0, PI / 2);
 	entities["neg_z_wall"]->GetTransform()->SetPosition(0, 10, -10);
+	entities["neg_z_wall"]->SetTags(wallTags);
+	physicsWorld.AddStatic(entities["neg_z_wall"]);
 	entities.insert({"pos_x_wall", new Entity(meshes[0], materials["cobblestone"])});
 	entities["pos_x_wall"]->GetTransform()->SetScale(0.001f, 20, 20);
 	entities["pos_x_wall"]->GetTransform()->SetPosition(10, 10, 0);
+	entities["pos_x_wall"]->SetTags(wallTags);
+	physicsWorld.AddStatic(entities["pos_x_wall"]);
 	entities.insert({ "neg_x_wall", new Entity(meshes[0], materials["cobblestone"]) });
 	entities["neg_x_wall"]->GetTransform()->SetScale(0.001f, 20, 20);
 	entities["neg_x_wall"]->GetTransform()->SetPosition(-10, 10, 0);
+	entities["neg_x_wall"]->SetTags(wallTags);
+	physicsWorld.AddStatic(entities["neg_x_wall"]);
 	entities.insert({ "sphere", new Entity(meshes[1], materials["metal"])});
 	entities["sphere"]->GetTransform()->SetScale(1, 1, 1);
 	entities["sphere"]->GetTransform()->MoveAbsolute(0, 2, 5);
+	entities["sphere"]->SetTags(ENTITY_TAG_SOLID);
+	// Moved back and forth by UpdateTransforms
+	physicsWorld.AddKinematic(entities["sphere"]);
+	for (const auto& pair : entities) {
+		transformSystem.Add(pair.second->GetTransform());
+		boundsSystem.Add(pair.second);
+		sceneBVH.Insert(pair.second);
+	}
 	
 	// First set of portals
 	/*portals.insert({ "portal_set_1_a", new Portal(meshes[3], materials["portal"], 0, XMFLOAT3(1, 0.6f, 0)) });
@@ -472,11 +507,18 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	PROFILE_ZONE("Update");
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
 
-	UpdateTransforms(deltaTime, totalTime);
+	// Animation and physics advance in fixed steps, independent of the frame rate
+	physicsWorld.Update(deltaTime, GetPortalList(), [this](float stepTime, float simulationTime) {
+		UpdateTransforms(stepTime, simulationTime);
+	});
+	UpdateRecursionDepth(deltaTime);
+	sceneBVH.Update();
 
 	float fov = camera->GetFoV();
 	if (Input::GetInstance().KeyDown('P')) {
@@ -493,6 +535,42 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::GetInstance().KeyPress('M')) {
 		camera->ToggleMouse();
 	}
+	if (Input::GetInstance().KeyPress('R')) {
+		adaptiveRecursion = !adaptiveRecursion;
+	}
+	if (Input::GetInstance().KeyPress('C')) {
+		cachedPortals = !cachedPortals;
+	}
+	if (Input::GetInstance().KeyPress('T')) {
+		ThrowProp();
+	}
+	if (Input::GetInstance().KeyPress('K')) {
+		parallelRecording = !parallelRecording;
+	}
+	if (Input::GetInstance().KeyPress('I')) {
+		instancing = !instancing;
+	}
+	if (Input::GetInstance().KeyPress('H')) {
+		occlusionCulling = !occlusionCulling;
+	}
+	// Print the loader, transform, portal math, ray cast and frame recording timings to the console
+	if (Input::GetInstance().KeyPress(VK_F1)) {
+		Benchmark::Run({
+			GetFullPathTo("../../Assets/Models/cube.obj"),
+			GetFullPathTo("../../Assets/Models/sphere.obj"),
+			GetFullPathTo("../../Assets/Models/torus.obj"),
+			GetFullPathTo("../../Assets/Models/helix.obj") },
+			[this](CommandBuffer& commands) { RecordFrame(commands, currentMaxRecursion); });
+	}
+	// Capture the next frames' profiler zones and counters to a Chrome trace
+	if (Input::GetInstance().KeyPress(VK_F6)) {
+		Profiler::CaptureTrace(GetFullPathTo("profile.json"), 120);
+	}
+	// Print every profiler zone's and counter's percentiles over the recent frames
+	if (Input::GetInstance().KeyPress(VK_F7)) {
+		Profiler::PrintSummary();
+		printf("%d GPU frames dropped\n", renderBackend->GetGpuProfiler().GetDroppedCount());
+	}
 	if (portalPlacementCoolDown > 0.5f) {
 		if (Input::GetInstance().MouseLeftDown()) {
 			TryPlacePortal(0);
@@ -536,7 +614,10 @@ void Game::Update(float deltaTime, float totalTime)
 	portalPlacementCoolDown += deltaTime;
 	camera->Update(deltaTime);
 	CheckPortalCollision();
-	prevPlayerPos = camera->GetTransform()->GetPosition();
+
+	// Rebuild the world matrices of everything that moved this frame in one batch, then the bounds from them
+	transformSystem.UpdateMatrices();
+	boundsSystem.UpdateBounds();
 }
 
 void Game::UpdateTransforms(float deltaTime, float totalTime)
@@ -545,6 +626,32 @@ void Game::UpdateTransforms(float deltaTime, float totalTime)
 	entities["sphere"]->GetTransform()->SetPosition(2 * sin(totalTime), pos.y, pos.z);
 }
 
+// Lower the maximum portal recursion depth while the frame time is over budget, and raise it back
+// once there is enough headroom. Changes are rate limited so a single slow frame doesn't cause popping.
+void Game::UpdateRecursionDepth(float deltaTime)
+{
+	if (!adaptiveRecursion) {
+		currentMaxRecursion = maxRecursionDepth;
+		return;
+	}
+
+	// Exponential moving average of the frame time
+	smoothedFrameTime = smoothedFrameTime == 0 ? deltaTime : smoothedFrameTime + (deltaTime - smoothedFrameTime) * 0.1f;
+
+	recursionAdjustTimer += deltaTime;
+	if (recursionAdjustTimer < 0.5f) {
+		return;
+	}
+	if (smoothedFrameTime > frameTimeBudget && currentMaxRecursion > 0) {
+		currentMaxRecursion--;
+		recursionAdjustTimer = 0;
+	}
+	else if (smoothedFrameTime < frameTimeBudget * 0.75f && currentMaxRecursion < maxRecursionDepth) {
+		currentMaxRecursion++;
+		recursionAdjustTimer = 0;
+	}
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -563,8 +670,28 @@ void Game::Draw(float deltaTime, float totalTime)
 		1.0f,
 		0);
 
-	// Draw Portals
-	DrawPortals(camera->GetView(), camera->GetProjection(), camera->GetTransform()->GetPosition(), 3, 0);
+	// The portal caches from last frame are only usable if nothing in the scene has moved since they were captured.
+	// When they are, only the first levels are rendered and the innermost portals sample the cache instead.
+	size_t signature = ComputeSceneSignature();
+	bool useCache = cachedPortals && signature == sceneSignature;
+	sceneSignature = signature;
+	if (!useCache) {
+		for (auto& pair : portals) {
+			pair.second->InvalidateCache();
+		}
+	}
+	int recursion = useCache ? min(cachedRecursionDepth, currentMaxRecursion) : currentMaxRecursion;
+
+	frameCommands.Reset();
+	{
+		PROFILE_ZONE("RecordFrame");
+		RecordFrame(frameCommands, recursion);
+	}
+	renderBackend->Execute(frameCommands);
+
+	if (cachedPortals) {
+		CapturePortalCaches();
+	}
 	
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
@@ -574,299 +701,211 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Due to the usage of a more sophisticated swap chain,
 	// the render target must be re-bound after every call to Present()
 	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+
+	Profiler::EndFrame();
 }
 
-// Draw anything that is a non-portal.
-void Game::DrawNonPortals(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition)
+// Record everything drawn this frame, from the camera through up to recursion levels of portals.
+// Nothing is sent to the GPU until the commands are executed.
+void Game::RecordFrame(CommandBuffer& commands, int recursion)
 {
+	// The swap chain keeps the back buffer alive, so it's still there when the commands are executed
+	ID3D11Resource* backBuffer;
+	backBufferRTV->GetResource(&backBuffer);
+	backBuffer->Release();
+
+	PortalRenderStates states = {};
+	states.stencilWriteMask = stencilWriteMask.Get();
+	states.innerPortalMask = innerPortalMask.Get();
+	states.undoStencilWriteMask = undoStencilWriteMask.Get();
+	states.portalDepthWrite = portalDepthWrite.Get();
+	states.portalBorderMask = portalBorderMask.Get();
+	states.gEqualRecursionStencilMask = gEqualRecursionStencilMask.Get();
+	states.scissorRasterizer = scissorRastState.Get();
+	states.portalRasterizer = portalRastState.Get();
+	states.depthStencilView = depthStencilView.Get();
+	states.backBuffer = backBuffer;
+	states.screenCaptureTexture = screenCaptureTexture.Get();
+	states.screenCaptureView = screenCaptureSRV.Get();
+	portalRenderer.SetStates(states);
+
+	PortalRenderSettings settings;
+	settings.parallelRecording = parallelRecording;
+	settings.instancing = instancing;
+	settings.occlusionCulling = occlusionCulling;
+	settings.drawWalls = drawWalls;
+	settings.adaptiveRecursion = adaptiveRecursion;
+	settings.minPortalPixelArea = minPortalPixelArea;
+	settings.cachedPortals = cachedPortals;
+	portalRenderer.SetSettings(settings);
+	portalRenderer.SetScreenSize(width, height);
+
+	portalScene.entities.clear();
 	for (auto& pair : entities) {
-		// Skip drawing walls
-		if (!drawWalls && pair.first.find("wall") != string::npos) {
-			continue;
-		}
-		Entity* entity = pair.second;
-		SimplePixelShader* ps = entity->GetMaterial()->GetPixelShader();
-		ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-		ps->SetFloat3("ambientColor", ambientColor);
-		entity->Draw(context, viewMat, projMat, cameraPosition);
+		portalScene.entities.push_back(pair.second);
 	}
+	portalScene.portals.clear();
+	for (auto& pair : portals) {
+		bool left = pair.first == "portal_0";
+		portalScene.portals.push_back({ pair.second, left ? leftPortalTween : rightPortalTween, left ? leftPortalRipple : rightPortalRipple });
+	}
+	portalScene.physicsWorld = &physicsWorld;
+	portalScene.lights = lights;
+	portalScene.ambientColor = ambientColor;
+
+	portalRenderer.RecordFrame(commands, portalScene, camera->GetView(), camera->GetProjection(), camera->GetTransform()->GetPosition(), recursion);
 }
 
-// Draw the portals by calculating the virtual cameras view and clipped projection matrix, and using the stencil buffer.
-void Game::DrawPortals(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition, int maxRecursion, int recursionLevel)
+// Copy what the camera sees through each portal this frame into that portal's cache.
+// Portals that are off screen or facing away have nothing worth keeping.
+void Game::CapturePortalCaches()
 {
-	for (const auto& pair : portals) {
-		Portal* portal = pair.second;
+	XMFLOAT4X4 viewMat = camera->GetView();
+	XMFLOAT4X4 projMat = camera->GetProjection();
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMLoadFloat4x4(&viewMat) * XMLoadFloat4x4(&projMat));
 
-		// No destination portal set, exit early!
-		if (portal->GetDestination() == nullptr) {
+	ID3D11Resource* backBuffer;
+	backBufferRTV->GetResource(&backBuffer);
+	for (auto& pair : portals) {
+		Portal* portal = pair.second;
+		PortalMath::ScreenRect portalRect;
+		if (portal->GetDestination() == nullptr ||
+			!portal->GetScreenRect(viewMat, projMat, (float)width, (float)height, portalRect)) {
+			portal->InvalidateCache();
 			continue;
 		}
+		CapturePortalCache(portal, backBuffer, portalRect, viewProj);
+	}
+	backBuffer->Release();
+}
 
-		// Set portal scale based on tween value for drawing to the stencil buffer
-		float scale = pair.first == "portal_0" ? leftPortalTween : rightPortalTween;
-		XMFLOAT3 originalScale = portal->GetTransform()->GetScale();
-		portal->GetTransform()->SetScale(originalScale.x * (sin(scale * PI / 2)), originalScale.y * (sin(scale * PI / 2)), originalScale.z);
-
-		// Set Depth Stencil State and Draw portal to stencil buffer. 
-		// This isn't actually drawing the portal, but it is incrementing the stencil buffer values in the area of the screen where the portal is.
-		context->OMSetDepthStencilState(stencilWriteMask.Get(), recursionLevel);
-		portal->UnbindPSAndDraw(context, viewMat, projMat, cameraPosition);
-		// Revert portal scale
-		portal->GetTransform()->SetScale(originalScale.x, originalScale.y, originalScale.z);
-
-		// Calculate the view from the perspective of the out portal
-		XMMATRIX rotationMatrix = XMMatrixRotationAxis(XMVectorSet(0, 1, 0, 0), PI);
-		XMFLOAT4X4 destinationWorldMatrix = portal->GetDestination()->GetTransform()->GetWorldMatrix();
-		XMFLOAT4X4 currentWorldMatrix = portal->GetTransform()->GetWorldMatrix();
-		XMMATRIX V = XMMatrixInverse(0, XMLoadFloat4x4(&destinationWorldMatrix))
-			* rotationMatrix
-			* XMLoadFloat4x4(&currentWorldMatrix)
-			* XMLoadFloat4x4(&viewMat);
-		XMFLOAT4X4 viewDest;
-		XMStoreFloat4x4(&viewDest, V);
-
-		// Calculate Oblique Clipped Projection Matrix.
-		XMFLOAT4X4 newProj = portal->GetDestination()->ClippedProjectionMatrix(viewDest, projMat);
-
-		// Calculate new camera position
-		XMFLOAT3 relPos = portal->GetTransform()->InverseTransformPoint(camera->GetTransform()->GetPosition());
-		XMStoreFloat3(
-			&relPos,
-			XMVector3Transform(XMLoadFloat3(&relPos), rotationMatrix)
-		);
-		relPos = portal->GetDestination()->GetTransform()->TransformPoint(relPos);
-
-		// Base case: 
-		if (recursionLevel == maxRecursion) {
-			// Set depth stencil state,
-			context->OMSetDepthStencilState(innerPortalMask.Get(), recursionLevel + 1);
-			// Clear the depth buffer
-			context->ClearDepthStencilView(
-				depthStencilView.Get(),
-				D3D11_CLEAR_DEPTH,
-				1.0f,
-				0);
-			// Draw world constrained to the inner portal
-			DrawNonPortals(viewDest, newProj, relPos);
-			
-			// Draw inner most portal outline
-			portal->GetMaterial()->GetPixelShader()->SetInt("drawRecursive", 0);
-			portal->GetMaterial()->GetPixelShader()->SetFloat("scale", scale);
-			portal->GetMaterial()->GetPixelShader()->SetFloat3("borderColor", portal->GetBorderColor());
-			portal->Draw(context, viewDest, newProj, relPos);
-		}
-		// Recursive case:
-		else {
-			// Draw portals recursively
-			DrawPortals(viewDest, newProj, relPos, maxRecursion, recursionLevel + 1);
-		}
-
-		// Set depth stencil state
-		context->OMSetDepthStencilState(undoStencilWriteMask.Get(), recursionLevel + 1);
-		// Clear the depth buffer
-		context->ClearDepthStencilView(
-			depthStencilView.Get(),
-			D3D11_CLEAR_DEPTH,
-			1.0f,
-			0);
-		// Draw portal into stencil buffer. The undoStencilWriteMask decrements the stencil values where the portal is
-		// eventually returning to a buffer full of zeroes.
-		portal->GetTransform()->SetScale(originalScale.x * (sin(scale * PI / 2)), originalScale.y * (sin(scale * PI / 2)), originalScale.z);
-		portal->UnbindPSAndDraw(context, viewMat, projMat, cameraPosition);
-		portal->GetTransform()->SetScale(originalScale.x, originalScale.y, originalScale.z);
+// Copy the area of the back buffer a portal covers into its cache texture. The texture is screen sized so the
+// copied pixels keep their screen position, and viewProj is stored so later frames can reproject into it.
+void Game::CapturePortalCache(Portal* portal, ID3D11Resource* backBuffer, const PortalMath::ScreenRect& rect, XMFLOAT4X4 viewProj)
+{
+	// (Re)create the cache texture if it doesn't exist yet or the window was resized
+	PortalCacheTexture& cache = portalCacheTextures[portal];
+	D3D11_TEXTURE2D_DESC desc = {};
+	if (cache.texture) {
+		cache.texture->GetDesc(&desc);
+	}
+	if (!cache.texture || desc.Width != width || desc.Height != height) {
+		cache.texture.Reset();
+		cache.srv.Reset();
+		desc = {};
+		desc.Width = width;
+		desc.Height = height;
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		device->CreateTexture2D(&desc, nullptr, cache.texture.GetAddressOf());
+		device->CreateShaderResourceView(cache.texture.Get(), nullptr, cache.srv.GetAddressOf());
 	}
-	
-	// Clear the depth buffer
-	context->ClearDepthStencilView(
-		depthStencilView.Get(),
-		D3D11_CLEAR_DEPTH,
-		1.0f,
-		0);
 
-	// Set depth stencil state
-	context->OMSetDepthStencilState(portalDepthWrite.Get(), 0);
+	D3D11_BOX box = {};
+	box.left = rect.left;
+	box.top = rect.top;
+	box.right = rect.right;
+	box.bottom = rect.bottom;
+	box.front = 0;
+	box.back = 1;
+	context->CopySubresourceRegion(cache.texture.Get(), 0, rect.left, rect.top, 0, backBuffer, 0, &box);
+	portal->SetCache(cache.srv.Get(), viewProj);
+}
 
-	// Draw each portal (a plane) into the depth buffer
+// Hash of everything that affects what is seen through a portal. If it changes between frames the portal caches are stale.
+size_t Game::ComputeSceneSignature()
+{
+	size_t hash = 14695981039346656037ull;
+	auto hashBytes = [&hash](const void* data, size_t size) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
 	for (auto& pair : portals) {
-		// Tween scale for depth drawing
-		float scale = pair.first == "portal_0" ? leftPortalTween : rightPortalTween;
-		XMFLOAT3 originalScale = pair.second->GetTransform()->GetScale();
-		pair.second->GetTransform()->SetScale(originalScale.x * (sin(scale * PI / 2)), originalScale.y * (sin(scale * PI / 2)), originalScale.z);
-		pair.second->UnbindPSAndDraw(context, viewMat, projMat, cameraPosition);
-		// Revert portal scale
-		pair.second->GetTransform()->SetScale(originalScale.x, originalScale.y, originalScale.z);
+		XMFLOAT4X4 world = pair.second->GetTransform()->GetWorldMatrix();
+		hashBytes(&world, sizeof(world));
 	}
+	for (auto& pair : entities) {
+		XMFLOAT4X4 world = pair.second->GetTransform()->GetWorldMatrix();
+		hashBytes(&world, sizeof(world));
+	}
+	// Portals that are still growing in are drawn at a different size every frame
+	hashBytes(&leftPortalTween, sizeof(float));
+	hashBytes(&rightPortalTween, sizeof(float));
+	hashBytes(&drawWalls, sizeof(bool));
+	return hash;
+}
 
-	// Only draw where stencil value >= recursion level
-	// This prevents drawing outside of outside of this level
-	context->OMSetDepthStencilState(gEqualRecursionStencilMask.Get(), recursionLevel);
-	DrawNonPortals(viewMat, projMat, cameraPosition);
-
-	// Copy contents from the back buffer for sampling within the PortalPS
-	ID3D11Resource* backBuffer;
-	backBufferRTV->GetResource(&backBuffer);
-	context->CopyResource(screenCaptureTexture.Get(), backBuffer);
-	backBuffer->Release();
-
-	
-	// Drawing here will do two things:
-	//    a. Draw the colored portal outine
-	//    b. Draw the ripple effect to the portals surface by sampling what we copied from the back buffer
-	context->OMSetDepthStencilState(portalBorderMask.Get(), recursionLevel);
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> oldState;
-	context->RSGetState(oldState.GetAddressOf());
-	context->RSSetState(portalRastState.Get()); // Nudges portal closer to camera to avoid depth test fighting
+vector<Portal*> Game::GetPortalList()
+{
+	vector<Portal*> portalList;
 	for (auto& pair : portals) {
-		Portal* portal = pair.second;
-		float scale = pair.first == "portal_0" ? leftPortalTween : rightPortalTween;
-		float rippleStrength = pair.first == "portal_0" ? leftPortalRipple : rightPortalRipple;
-		portal->GetMaterial()->GetPixelShader()->SetShaderResourceView("SceneCapture", screenCaptureSRV.Get());
-		portal->GetMaterial()->GetPixelShader()->SetInt("drawRecursive", 1);
-		portal->GetMaterial()->GetPixelShader()->SetInt("recursionLevel", recursionLevel);
-		portal->GetMaterial()->GetPixelShader()->SetFloat("scale", scale);
-		portal->GetMaterial()->GetPixelShader()->SetFloat3("borderColor", portal->GetBorderColor());
-		portal->GetMaterial()->GetPixelShader()->SetFloat("portalRippleStrength", rippleStrength);
-
-		portal->Draw(context, viewMat, projMat, cameraPosition);
-	}
-	context->RSSetState(oldState.Get()); // Revert rast state
+		portalList.push_back(pair.second);
+	}
+	return portalList;
 }
 
 // This method checks if the camera is colliding with a portal, and teleports the camera to the destination portal.
 void Game::CheckPortalCollision()
 {
-	XMFLOAT3 cameraPos = camera->GetTransform()->GetPosition();
+	PROFILE_ZONE("CheckPortalCollision");
 
-	for (auto& pair : portals) {
-		Portal* portal = pair.second;
-		// No destination portal set, exit early!
-		if (portal->GetDestination() == nullptr) {
-			continue;
-		}
-		// Calculate the signed distance from the camera to the portal plane
-		XMFLOAT3 portalPos = portal->GetTransform()->GetPosition();
-		XMFLOAT3 diff = XMFLOAT3(cameraPos.x - portalPos.x, cameraPos.y - portalPos.y, cameraPos.z - portalPos.z);
-		XMFLOAT3 forward = portal->GetTransform()->GetForward();
-		float forwardDistFromPortal = XMVector3Dot(XMLoadFloat3(&diff), XMLoadFloat3(&forward)).m128_f32[0];
-
-		// Project the cameras position onto the portal plane's axes, and calculate the magnitude of that projection.
-		XMFLOAT3 right = portal->GetTransform()->GetRight();
-		XMFLOAT3 up = portal->GetTransform()->GetUp();
-		float rightDot = (right.x * diff.x) + (right.y * diff.y) + (right.z * diff.z);
-		float upDot = (up.x * diff.x) + (up.y * diff.y) + (up.z * diff.z);
-		XMFLOAT3 planeProj = XMFLOAT3((right.x * rightDot) + (up.x * upDot), (right.y * rightDot) + (up.y * upDot), (right.z * rightDot) + (up.z * upDot));
-		float dist = sqrt(pow(planeProj.x, 2) + pow(planeProj.y, 2) + pow(planeProj.z, 2));
-
-		const float threshold = 0.00f;
-		// Check if the camera is on the negative side of the plane, AND the magnitude of the cameras projection 
-		// onto the portal plane is within bounds of the portals frame.
-		if (forwardDistFromPortal < threshold && dist <= 1) {
-			XMFLOAT3 destPos = portal->GetDestination()->GetTransform()->GetPosition();
-			XMFLOAT3 portalRot = portal->GetTransform()->GetPitchYawRoll();
-			XMFLOAT3 destRot = portal->GetDestination()->GetTransform()->GetPitchYawRoll();
-			XMFLOAT3 cameraRot = camera->GetTransform()->GetPitchYawRoll();
-			float rotDiff = cameraRot.y + PI - portalRot.y;
-			XMFLOAT3 prevDiff = XMFLOAT3(prevPlayerPos.x - portalPos.x, prevPlayerPos.y - portalPos.y, prevPlayerPos.z - portalPos.z);
-			XMVECTOR xmPrevDiff = XMLoadFloat3(&prevDiff);
-
-			// Calculate local offsets relative to the ENTRANCE portal's axes
-			float rightOffset = XMVector3Dot(xmPrevDiff, XMLoadFloat3(&right)).m128_f32[0];
-			float upOffset = XMVector3Dot(xmPrevDiff, XMLoadFloat3(&up)).m128_f32[0];
-			float forwardOffset = abs(XMVector3Dot(xmPrevDiff, XMLoadFloat3(&forward)).m128_f32[0]);
-
-			// Reconstruct position relative to the DESTINATION portal's axes
-			// We flip the X and Z offsets because entering the 'front' means exiting the 'front'
-			XMFLOAT3 destRight = portal->GetDestination()->GetTransform()->GetRight();
-			XMFLOAT3 destUp = portal->GetDestination()->GetTransform()->GetUp();
-			XMFLOAT3 destForward = portal->GetDestination()->GetTransform()->GetForward();
-			XMVECTOR newPos = XMLoadFloat3(&destPos) - (XMLoadFloat3(&destRight) * rightOffset) + (XMLoadFloat3(&destUp) * upOffset) + (XMLoadFloat3(&destForward) * forwardOffset);
-
-			// Apply the position and the same rotation logic you already have
-			XMStoreFloat3(&cameraPos, newPos);
-			camera->GetTransform()->SetPosition(cameraPos.x, cameraPos.y, cameraPos.z);
-			camera->GetTransform()->SetPitchYawRoll(cameraRot.x, destRot.y + rotDiff, cameraRot.z);
-			// Update the view matrix after teleporting it.
-			camera->UpdateViewMatrix();
-		}
+	// Update the view matrix after teleporting it.
+	if (portalTraversal.Update(GetPortalList(), maxPortalCrossings) > 0) {
+		camera->UpdateViewMatrix();
 	}
 }
 
+// Throw a small cube out from the camera, to push through the portals
+void Game::ThrowProp()
+{
+	if (propCount >= maxProps) {
+		return;
+	}
+	string propKey = "prop_" + to_string(propCount++);
+	XMFLOAT3 position = camera->GetTransform()->GetPosition();
+	XMFLOAT3 forward = camera->GetTransform()->GetForward();
+	XMFLOAT3 rot = camera->GetTransform()->GetPitchYawRoll();
+
+	Entity* prop = new Entity(meshes[0], materials["metal"]);
+	prop->GetTransform()->SetScale(0.3f, 0.3f, 0.3f);
+	prop->GetTransform()->SetPitchYawRoll(rot.x, rot.y, 0);
+	prop->GetTransform()->SetPosition(position.x + forward.x, position.y + forward.y, position.z + forward.z);
+	prop->SetVelocity(XMFLOAT3(forward.x * propThrowSpeed, forward.y * propThrowSpeed, forward.z * propThrowSpeed));
+	prop->SetTags(ENTITY_TAG_DYNAMIC);
+	entities.insert({ propKey, prop });
+	transformSystem.Add(prop->GetTransform());
+	boundsSystem.Add(prop);
+	sceneBVH.Insert(prop);
+	physicsWorld.AddBody(prop, PHYSICS_SHAPE_BOX);
+}
+
 void Game::TryPlacePortal(int id) {
+	PROFILE_ZONE("TryPlacePortal");
 	portalPlacementCoolDown = 0;
 	// Cast a ray starting at the camera and going forward
 	XMFLOAT3 rayOrigin = camera->GetTransform()->GetPosition();
 	XMFLOAT3 cameraForward = camera->GetTransform()->GetForward();
 
-	// Convert to XMVECTORs because BoundingBox::Intersects expects XMVECTOR parameters
-	XMVECTOR originV = XMLoadFloat3(&rayOrigin);
-	XMVECTOR dirV = XMLoadFloat3(&cameraForward);
-	XMVECTOR endV = originV + (maxPortalPlacementDistance * dirV);
-	dirV = XMVector3Normalize(dirV);
-
-	for (const auto& pair : entities) {
-		// Only try to place portals on walls
-		if (pair.first.find("wall") == string::npos) {
-			continue; 
-		}
+	XMStoreFloat3(&cameraForward, XMVector3Normalize(XMLoadFloat3(&cameraForward)));
 
-		Entity* entity = pair.second;
-		float hitDist = 0.0f;
-		// Check if the ray intersects with the bounding box
-		entity->GetBoundingBox().Intersects(originV, dirV, hitDist);
-		if (hitDist == 0 || hitDist >= maxPortalPlacementDistance) {
-			// Either it didn't intersect, or it intersected too far away.
-			continue;
-		}
-		cout << "Hit " << pair.first << " at distance " << hitDist << endl;
-
-		// Convert ray points from world space to local space of the entity
-		XMFLOAT3 startPointLocal = entity->GetTransform()->InverseTransformPoint(rayOrigin);
-		XMFLOAT3 endPointLocal;
-		XMStoreFloat3(&endPointLocal, endV);
-		endPointLocal = entity->GetTransform()->InverseTransformPoint(endPointLocal);
-		XMVECTOR startLocalV = XMLoadFloat3(&startPointLocal);
-		XMVECTOR endLocalV = XMLoadFloat3(&endPointLocal);
-
-		// Loop through each triangle in the mesh and check for intersection with the ray.
-		vector<Vertex> vertices = entity->GetMesh()->GetVertices();
-		vector<UINT> indices = entity->GetMesh()->GetIndices();
-		XMFLOAT3 closestPoint = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
-		XMVECTOR normalAtClosestPoint = XMVectorSet(0, 0, 0, 0);
-		for (int i = 0; i < indices.size(); i+=3) {
-			Vertex v1 = vertices[indices[i]];
-			Vertex v2 = vertices[indices[i + 1]];
-			Vertex v3 = vertices[indices[i + 2]];
-			XMVECTOR p1 = XMLoadFloat3(&v1.Position);
-			XMVECTOR p2 = XMLoadFloat3(&v2.Position);
-			XMVECTOR p3 = XMLoadFloat3(&v3.Position);
-			XMFLOAT3 intersectionPoint;
-			// Ray intersect triangle
-			if (RayTriangleIntersect(startLocalV, endLocalV - startLocalV, p1, p2, p3, intersectionPoint)) {
-				XMFLOAT3 worldPoint = entity->GetTransform()->TransformPoint(intersectionPoint);
-				XMVECTOR worldPointV = XMLoadFloat3(&worldPoint);
-				XMVECTOR closestPointV = XMLoadFloat3(&closestPoint);
-				if (XMVector3LengthSq(worldPointV - originV).m128_f32[0] < XMVector3LengthSq(closestPointV - originV).m128_f32[0]) {
-					closestPoint = worldPoint;
-					// Calculate the normal at the closest point
-					XMVECTOR edge1 = p2 - p1;
-					XMVECTOR edge2 = p3 - p1;
-					normalAtClosestPoint = XMVector3Cross(edge1, edge2);
-					normalAtClosestPoint = XMVector3Normalize(normalAtClosestPoint);
-				}
-				cout << "World Point: " << worldPoint.x << ", " << worldPoint.y << ", " << worldPoint.z << endl;
-			}
-		}
-		// No triangle intersection found.
-		if (closestPoint.x == FLT_MAX) {
-			continue;
-		}
-		cout << "Closest Point: " << closestPoint.x << ", " << closestPoint.y << ", " << closestPoint.z << endl;
+	// Only walls take portals
+	SceneRayHit hit;
+	if (sceneBVH.RaycastScene(rayOrigin, cameraForward, maxPortalPlacementDistance, ENTITY_TAG_PORTALABLE, hit)) {
+		XMFLOAT3 closestPoint = hit.point;
+		XMVECTOR normalAtClosestPoint = XMLoadFloat3(&hit.normal);
 		string portalKey = "portal_" + to_string(id);
 		// Create portal if it doesn't already exist.
 		if (portals.count(portalKey) == 0) {
 			XMFLOAT3 color = id == 0 ? XMFLOAT3(0, 0, 1.0f) : XMFLOAT3(1, 0.6f, 0);
 			portals.insert({ portalKey, new Portal(meshes[3], materials["portal"], id, color) });
+			transformSystem.Add(portals[portalKey]->GetTransform());
 			portals[portalKey]->GetTransform()->SetScale(portalScale.x, portalScale.y, portalScale.z);
 		}
 		string complimentKey = "portal_" + to_string(abs(1 - id));
@@ -888,7 +927,6 @@ void Game::TryPlacePortal(int id) {
 		if (XMVectorGetY(cp) < 0) {
 			yRot = -yRot;
 		}
-		cout << "Y Rotation: " << yRot << endl;
 		portals[portalKey]->GetTransform()->SetPitchYawRoll(0, yRot, 0);
 		if (id == 0) {
 			leftPortalTween = 0;
@@ -900,52 +938,3 @@ void Game::TryPlacePortal(int id) {
 		}
 	}
 }
-
-// Using Moller-Trumbore ray-triangle intersection algorithm. 
-// Returns true if the ray intersects the triangle, and outputs the intersection point.
-bool Game::RayTriangleIntersect(
-	DirectX::XMVECTOR rayOrigin,    // Point 1 of line
-	DirectX::XMVECTOR rayDir,       // Direction (Point 2 - Point 1)
-	DirectX::XMVECTOR V0,           // Triangle Vertex 0
-	DirectX::XMVECTOR V1,           // Triangle Vertex 1
-	DirectX::XMVECTOR V2,           // Triangle Vertex 2
-	DirectX::XMFLOAT3& outPoint     // The actual intersection coordinate
-) {
-	using namespace DirectX;
-
-	XMVECTOR edge1 = V1 - V0;
-	XMVECTOR edge2 = V2 - V0;
-	XMVECTOR pvec = XMVector3Cross(rayDir, edge2);
-	XMVECTOR detVec = XMVector3Dot(edge1, pvec);
-	float det = XMVectorGetX(detVec);
-
-	// If determinant is near zero, ray is parallel to triangle
-	if (det > -0.0001f && det < 0.0001f) return false;
-
-	float invDet = 1.0f / det;
-	XMVECTOR tvec = rayOrigin - V0;
-
-	// Calculate U and test bounds
-	XMVECTOR uVec = XMVector3Dot(tvec, pvec) * invDet;
-	float u = XMVectorGetX(uVec);
-	if (u < 0.0f || u > 1.0f) return false;
-
-	XMVECTOR qvec = XMVector3Cross(tvec, edge1);
-
-	// Calculate V and test bounds
-	XMVECTOR vVec = XMVector3Dot(rayDir, qvec) * invDet;
-	float v = XMVectorGetX(vVec);
-	if (v < 0.0f || u + v > 1.0f) return false;
-
-	// Calculate T (distance along the line)
-	XMVECTOR tResultVec = XMVector3Dot(edge2, qvec) * invDet;
-	float outDistance = XMVectorGetX(tResultVec);
-
-	if (outDistance > 0.0001f) { // Intersection occurs in front of the ray
-		XMVECTOR intersectPos = rayOrigin + (rayDir * outDistance);
-		XMStoreFloat3(&outPoint, intersectPos);
-		return true;
-	}
-
-	return false;
-}
@@ -10,6 +10,14 @@
 #include "Light.h"
 #include "Sky.h"
 #include "Portal.h"
+#include "TransformSystem.h"
+#include "BoundsSystem.h"
+#include "SceneBVH.h"
+#include "PortalTraversal.h"
+#include "PhysicsWorld.h"
+#include "PortalRenderer.h"
+#include "RenderCommands.h"
+#include "D3D11RenderBackend.h"
 
 using namespace std;
 
@@ -27,19 +35,16 @@ public:
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
 	void UpdateTransforms(float deltaTime, float totalTime);
+	void UpdateRecursionDepth(float deltaTime);
 	void Draw(float deltaTime, float totalTime);
-	void DrawNonPortals(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
-	void DrawPortals(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition, int maxRecursion, int recursionLevel);
+	void RecordFrame(CommandBuffer& commands, int recursion);
+	void CapturePortalCaches();
+	void CapturePortalCache(Portal* portal, ID3D11Resource* backBuffer, const PortalMath::ScreenRect& rect, XMFLOAT4X4 viewProj);
+	size_t ComputeSceneSignature();
+	vector<Portal*> GetPortalList();
 	void CheckPortalCollision();
 	void TryPlacePortal(int id);
-	bool RayTriangleIntersect(
-		DirectX::XMVECTOR rayOrigin,    // Point 1 of line
-		DirectX::XMVECTOR rayDir,       // Direction (Point 2 - Point 1)
-		DirectX::XMVECTOR V0,           // Triangle Vertex 0
-		DirectX::XMVECTOR V1,           // Triangle Vertex 1
-		DirectX::XMVECTOR V2,           // Triangle Vertex 2
-		DirectX::XMFLOAT3& outPoint		// The intersection point in 3D space
-	);
+	void ThrowProp();
 
 
 private:
@@ -48,6 +53,7 @@ private:
 	void LoadShaders(); 
 	void CreateMaterials();
 	void CreateBasicGeometry();
+	ID3D11ShaderResourceView* LoadTexture(const wchar_t* relativePath);
 
 	
 	// Note the usage of ComPtr below
@@ -70,13 +76,23 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> screenCaptureTexture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> screenCaptureSRV;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> portalRastState;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> scissorRastState;
 	
 	// Shaders and shader-related constructs
-	SimplePixelShader* portalPixelShader;
-	SimplePixelShader* lightingPixelShader;
-	SimpleVertexShader* vertexShader;
-	SimplePixelShader* skyPS;
-	SimpleVertexShader* skyVS;
+	RenderShader* portalPixelShader;
+	RenderShader* lightingPixelShader;
+	RenderShader* vertexShader;
+	RenderShader* packedVertexShader;
+	RenderShader* instancedVertexShader;
+	RenderShader* packedInstancedVertexShader;
+	RenderShader* skyPS;
+	RenderShader* skyVS;
+	// Materials only hold handles to their textures, so the textures themselves live here
+	vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textures;
+
+	// Each frame is recorded into frameCommands, then replayed by the backend
+	CommandBuffer frameCommands;
+	D3D11RenderBackend* renderBackend;
 
 	DirectX::XMFLOAT3 ambientColor = DirectX::XMFLOAT3(.1, .1, .1);
 	vector<Mesh*> meshes;
@@ -85,6 +101,9 @@ private:
 	unordered_map<string, Material*> materials;
 	vector<Light> lights;
 	Camera* camera;
+	TransformSystem transformSystem;	// Batch matrix updates for entity and portal transforms
+	BoundsSystem boundsSystem;			// Batch world bounds updates for entities
+	SceneBVH sceneBVH;					// Entity bounds, for ray casts against the scene
 	Sky* skyBox;
 	bool drawSkyBox;
 	bool debugPortals;
@@ -94,8 +113,14 @@ private:
 	bool portalAnimation;
 	float portalOffset = 0.01f;
 	float maxPortalPlacementDistance = 50.0f;
+	bool packedVertices = true;		// Load scene meshes as PackedVertex instead of Vertex
 
-	XMFLOAT3 prevPlayerPos = XMFLOAT3(0, 0, 0);
+	PortalTraversal portalTraversal;	// The camera, carried through portals as it moves
+	PhysicsWorld physicsWorld;			// Fixed timestep simulation of the props and the animated sphere
+	int maxPortalCrossings = 4;		// Portals a body can pass through in a single frame
+	int propCount = 0;
+	int maxProps = 64;
+	float propThrowSpeed = 8.0f;
 
 	XMFLOAT3 portalScale = XMFLOAT3(1.2f, 2.4f, 1);
 
@@ -109,6 +134,32 @@ private:
 	float rightPortalRipple = 0.0f;
 	float portalRippleOutSpeed = 0.01f;
 
+	// Adaptive portal recursion
+	bool adaptiveRecursion = true;
+	int maxRecursionDepth = 3;				// Deepest recursion level ever drawn
+	int currentMaxRecursion = 3;			// Recursion level used this frame, lowered while over the frame budget
+	float minPortalPixelArea = 256.0f;		// Nested portals covering fewer pixels than this stop recursing
+	float frameTimeBudget = 1.0f / 60.0f;	// Target frame time in seconds
+	float smoothedFrameTime = 0.0f;
+	float recursionAdjustTimer = 0.0f;
+
+	// Portal cache: the innermost recursion level samples last frame's view through each portal
+	bool cachedPortals = false;
+	int cachedRecursionDepth = 1;			// Recursion levels actually rendered while the cache is valid
+	size_t sceneSignature = 0;				// Hash of portal and entity transforms from the previous frame
+	struct PortalCacheTexture {
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	};
+	unordered_map<Portal*, PortalCacheTexture> portalCacheTextures;
+
+	// Frames are recorded by portalRenderer, from the scene and switches handed to it each frame
+	PortalRenderer portalRenderer;
+	PortalScene portalScene;
+	bool parallelRecording = true;			// Draw lists for every portal view are recorded up front on worker threads
+	bool instancing = true;					// Draw lists batch copies of a mesh and material into instanced draws
+	bool occlusionCulling = true;			// Occluder entities hide what's behind them before it's drawn
+
 	Entity* virtualCamera[2];
 };
 
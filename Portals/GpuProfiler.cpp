@@ -0,0 +1,146 @@
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include <climits>
+
+GpuProfiler::GpuProfiler(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	context(context)
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+}
+
+void GpuProfiler::BeginFrame()
+{
+	if (!Profiler::IsEnabled()) {
+		return;
+	}
+
+	// Read back the oldest frame, if it's done. Only one a frame, and in order, so every CPU frame gets one GPU frame.
+	for (int i = 1; i <= GPU_PROFILER_FRAMES; i++) {
+		Frame& frame = frames[(current + i) % GPU_PROFILER_FRAMES];
+		if (frame.pending) {
+			Collect(frame);
+			break;
+		}
+	}
+
+	current = (current + 1) % GPU_PROFILER_FRAMES;
+	Frame& frame = frames[current];
+	if (frame.pending) {
+		// Waiting for it would stall, so give up on it
+		frame.pending = false;
+		droppedCount++;
+	}
+	if (frame.disjoint == nullptr) {
+		D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		if (FAILED(device->CreateQuery(&desc, frame.disjoint.GetAddressOf()))) {
+			return;
+		}
+	}
+
+	frame.usedTimestamps = 0;
+	frame.zones.clear();
+	frame.cpuStart = Profiler::GetTicks();
+	openZones.clear();
+	context->Begin(frame.disjoint.Get());
+	inFrame = true;
+	BeginZone("GPU frame");
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (!inFrame) {
+		return;
+	}
+	// Close whatever was left open, the frame's own zone last
+	while (!openZones.empty()) {
+		EndZone();
+	}
+	Frame& frame = frames[current];
+	context->End(frame.disjoint.Get());
+	frame.pending = true;
+	inFrame = false;
+}
+
+void GpuProfiler::BeginZone(const char* name, const char* argName, int arg)
+{
+	if (!inFrame) {
+		return;
+	}
+	Frame& frame = frames[current];
+	Zone zone = { name, argName, arg, Timestamp(frame), UINT_MAX };
+	openZones.push_back((unsigned int)frame.zones.size());
+	frame.zones.push_back(zone);
+}
+
+void GpuProfiler::EndZone()
+{
+	if (!inFrame || openZones.empty()) {
+		return;
+	}
+	Frame& frame = frames[current];
+	frame.zones[openZones.back()].end = Timestamp(frame);
+	openZones.pop_back();
+}
+
+int GpuProfiler::GetDroppedCount()
+{
+	return droppedCount;
+}
+
+unsigned int GpuProfiler::Timestamp(Frame& frame)
+{
+	if (frame.usedTimestamps == frame.timestamps.size()) {
+		D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP, 0 };
+		Microsoft::WRL::ComPtr<ID3D11Query> query;
+		if (FAILED(device->CreateQuery(&desc, query.GetAddressOf()))) {
+			return UINT_MAX;
+		}
+		frame.timestamps.push_back(query);
+	}
+	context->End(frame.timestamps[frame.usedTimestamps].Get());
+	return frame.usedTimestamps++;
+}
+
+bool GpuProfiler::Collect(Frame& frame)
+{
+	// Don't flush: asking shouldn't make the driver do anything it wasn't going to
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (context->GetData(frame.disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+		return false;
+	}
+	times.resize(frame.usedTimestamps);
+	for (unsigned int i = 0; i < frame.usedTimestamps; i++) {
+		if (context->GetData(frame.timestamps[i].Get(), &times[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			return false;
+		}
+	}
+	frame.pending = false;
+
+	// The clock changed speed part way through, so the times can't be trusted
+	const Zone& frameZone = frame.zones[0];
+	if (disjoint.Disjoint || frameZone.begin == UINT_MAX) {
+		droppedCount++;
+		return true;
+	}
+
+	// Lined up with the CPU clock from when the frame was submitted, which is as close as the two can be matched
+	double ticksPerGpuTick = (double)Profiler::GetTicksPerSecond() / disjoint.Frequency;
+	UINT64 base = times[frameZone.begin];
+	for (const Zone& zone : frame.zones) {
+		if (zone.begin == UINT_MAX || zone.end == UINT_MAX) {
+			continue;
+		}
+		ProfileEvent event;
+		event.name = zone.name;
+		event.argName = zone.argName;
+		event.arg = zone.arg;
+		event.start = frame.cpuStart + (long long)((times[zone.begin] - base) * ticksPerGpuTick);
+		event.end = frame.cpuStart + (long long)((times[zone.end] - base) * ticksPerGpuTick);
+		Profiler::RecordGpu(event);
+	}
+	return true;
+}
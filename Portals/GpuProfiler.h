@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#define GPU_PROFILER_FRAMES 3	// Frames of queries in flight. A frame's results are read this many frames later at most.
+
+// Times zones of a frame on the GPU with timestamp queries, and passes them on to the Profiler. Every frame gets its own
+// set of queries, and results are only read once the GPU reports them done, so reading never waits on the GPU. A
+// frame still not done by the time its queries come round again is dropped, as is one the GPU's clock wasn't steady for.
+// Each frame is a zone of its own, "GPU frame", which against the CPU's zones tells whether a frame is bound by the GPU
+// or by submitting it.
+class GpuProfiler {
+public:
+	GpuProfiler(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~GpuProfiler();
+
+	// Zones can only be timed between these. Does nothing while the Profiler is disabled.
+	void BeginFrame();
+	void EndFrame();
+	// The name strings have to stay around until the results come back, so use literals
+	void BeginZone(const char* name, const char* argName = nullptr, int arg = 0);
+	void EndZone();
+
+	// Frames whose results were thrown away
+	int GetDroppedCount();
+
+private:
+	struct Zone {
+		const char* name;
+		const char* argName;
+		int arg;
+		unsigned int begin;		// Timestamp indices in the frame, or UINT_MAX if a query couldn't be made
+		unsigned int end;
+	};
+
+	struct Frame {
+		Microsoft::WRL::ComPtr<ID3D11Query> disjoint;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> timestamps;	// Grows to the most a frame has needed
+		unsigned int usedTimestamps = 0;
+		std::vector<Zone> zones;
+		long long cpuStart = 0;		// When the frame was submitted, which the GPU times are placed relative to
+		bool pending = false;		// Submitted and not read back yet
+	};
+
+	// Issue the frame's next timestamp query, returning its index
+	unsigned int Timestamp(Frame& frame);
+	// Read a frame's results if the GPU has them. Returns false if it doesn't yet.
+	bool Collect(Frame& frame);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Frame frames[GPU_PROFILER_FRAMES];
+	int current = 0;
+	bool inFrame = false;
+	std::vector<unsigned int> openZones;
+	std::vector<UINT64> times;
+	int droppedCount = 0;
+};
@@ -0,0 +1,33 @@
+#include "ShaderIncludes.hlsli"
+
+cbuffer PerView : register(b1)
+{
+	matrix view;
+	matrix projection;
+}
+
+// --------------------------------------------------------
+// Same as VertexShader, except the world matrices and clip
+// plane come from the instance buffer, so every copy of a
+// mesh with the same material is drawn in one call.
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input, InstanceInput instance )
+{
+	matrix world = InstanceMatrix(instance.world0, instance.world1, instance.world2, instance.world3);
+	matrix worldInverseTranspose = InstanceMatrix(instance.inverseTranspose0, instance.inverseTranspose1, instance.inverseTranspose2, instance.inverseTranspose3);
+
+	// Set up output struct
+	VertexToPixel output;
+
+	// Screen position of vertex
+	matrix wvp = mul(projection, mul(view, world));
+	output.position = mul(wvp, float4(input.position, 1.0f));
+	output.normal = mul((float3x3)worldInverseTranspose, input.normal); // mul by inverse transpose
+	output.tangent = mul((float3x3)worldInverseTranspose, input.tangent); // again, multiply by inverse transpose
+	output.uv = input.uv;
+	output.screenPosition = input.position;
+	output.worldPosition = mul(world, float4(input.position, 1)).xyz;
+	output.clipDistance = dot(float4(output.worldPosition, 1), instance.clipPlane);
+
+	return output;
+}
\ No newline at end of file
@@ -1,13 +1,19 @@
 #include "ShaderIncludes.hlsli"
 
+// The material's own values
 cbuffer ExternalData: register(b0)
 {
 	float4 colorTint;
-	float3 cameraPosition;
 	float roughness;
-	float3 ambientColor;
 	int hasSpecular;
 	int hasNormal;
+}
+
+// The same for everything drawn from one view
+cbuffer PerView : register(b1)
+{
+	float3 cameraPosition;
+	float3 ambientColor;
 	Light lights[5];
 }
 
@@ -1,8 +1,9 @@
 #include "Material.h"
+#include "Profiler.h"
 #include <iostream>
 using namespace std;
 
-Material::Material(DirectX::XMFLOAT4 colorTint, SimplePixelShader* pixelShader, SimpleVertexShader* vertexShader, float roughness)
+Material::Material(DirectX::XMFLOAT4 colorTint, RenderShader* pixelShader, RenderShader* vertexShader, float roughness)
 {
 	this->colorTint = colorTint;
 	this->pixelShader = pixelShader;
@@ -29,17 +30,17 @@ void Material::SetColorTint(DirectX::XMFLOAT4 newTint)
 	this->colorTint = newTint;
 }
 
-SimplePixelShader* Material::GetPixelShader()
+RenderShader* Material::GetPixelShader()
 {
 	return pixelShader;
 }
 
-void Material::SetPixelShader(SimplePixelShader* newPixelShader)
+void Material::SetPixelShader(RenderShader* newPixelShader)
 {
 	this->pixelShader = newPixelShader;
 }
 
-SimpleVertexShader* Material::GetVertexShader()
+RenderShader* Material::GetVertexShader()
 {
 	return vertexShader;
 }
@@ -49,45 +50,117 @@ float Material::GetRoughnessValue()
 	return roughness;
 }
 
-void Material::SetVertexShader(SimpleVertexShader* newVertexShader)
+void Material::SetVertexShader(RenderShader* newVertexShader)
 {
 	this->vertexShader = newVertexShader;
 }
 
-void Material::AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+void Material::SetPackedVertexShader(RenderShader* newPackedVertexShader)
+{
+	this->packedVertexShader = newPackedVertexShader;
+}
+
+void Material::SetInstancedVertexShaders(RenderShader* newInstancedVertexShader, RenderShader* newPackedInstancedVertexShader)
+{
+	this->instancedVertexShader = newInstancedVertexShader;
+	this->packedInstancedVertexShader = newPackedInstancedVertexShader;
+}
+
+void Material::AddTexture(std::string name, RenderHandle texture)
 {
 	if (name.find("Roughness") != std::string::npos) useSpecular = true;
 	else if (name.find("Normal") != std::string::npos) useNormal = true;
-	textureSRVs.insert({ name, srv });
+	textures.insert({ name, texture });
 }
 
-void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
+void Material::AddSampler(std::string name, RenderHandle sampler)
 {
 	samplers.insert({ name, sampler });
 }
 
-void Material::PrepareMaterial(Transform* transform, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition)
+void Material::PrepareMaterial(CommandBuffer& commands, Transform* transform, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition,
+	Mesh* mesh)
 {
+	PrepareMaterial(commands, transform->GetWorldMatrix(), transform->GetWorldInverseTranspose(), viewMat, projMat, cameraPosition, mesh);
+}
+
+void Material::PrepareMaterial(CommandBuffer& commands, XMFLOAT4X4 worldMat, XMFLOAT4X4 worldInvTranspose, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat,
+	XMFLOAT3 cameraPosition, Mesh* mesh, XMFLOAT4 clipPlane)
+{
+	PROFILE_ZONE("PrepareMaterial");
+
 	// Set the vertex and pixel shaders corresponding to the individual material of the mesh.
-	vertexShader->SetShader();
+	RenderShader* vs = GetVertexShaderFor(mesh);
+	bool packed = vs == packedVertexShader;
+	commands.SetPipeline(vs, pixelShader);
 
 	// Data being sent to GPU
-	vertexShader->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", viewMat);
-	vertexShader->SetMatrix4x4("projection", projMat);
-	vertexShader->SetMatrix4x4("worldInverseTranspose", transform->GetWorldInverseTranspose());
-	vertexShader->CopyAllBufferData();
+	vs->SetMatrix4x4("world", worldMat);
+	vs->SetMatrix4x4("view", viewMat);
+	vs->SetMatrix4x4("projection", projMat);
+	vs->SetMatrix4x4("worldInverseTranspose", worldInvTranspose);
+	vs->SetFloat4("clipPlane", clipPlane);
+	if (packed) {
+		// Bounds the positions were quantized against
+		XMFLOAT3 localMin = mesh->GetLocalMin();
+		XMFLOAT3 localMax = mesh->GetLocalMax();
+		vs->SetFloat3("positionMin", localMin);
+		vs->SetFloat3("positionExtent", XMFLOAT3(localMax.x - localMin.x, localMax.y - localMin.y, localMax.z - localMin.z));
+	}
+	commands.SetConstants(vs);
+
+	PreparePixelShader(commands, cameraPosition);
+}
+
+RenderShader* Material::GetVertexShaderFor(Mesh* mesh)
+{
+	bool packed = mesh != nullptr && mesh->GetVertexFormat() == VERTEX_FORMAT_PACKED && packedVertexShader != nullptr;
+	return packed ? packedVertexShader : vertexShader;
+}
+
+RenderShader* Material::GetInstancedVertexShaderFor(Mesh* mesh)
+{
+	if (mesh != nullptr && mesh->GetVertexFormat() == VERTEX_FORMAT_PACKED) {
+		return packedVertexShader != nullptr ? packedInstancedVertexShader : nullptr;
+	}
+	return instancedVertexShader;
+}
+
+void Material::PreparePixelShader(CommandBuffer& commands, XMFLOAT3 cameraPosition)
+{
+	if (pixelShader == NULL) return;
+	SetSurfaceVariables();
+	pixelShader->SetFloat3("cameraPosition", cameraPosition);
+	commands.SetConstants(pixelShader);
+	RecordTextures(commands);
+}
 
+void Material::PrepareSurface(CommandBuffer& commands)
+{
 	if (pixelShader == NULL) return;
-	pixelShader->SetShader();
+	SetSurfaceVariables();
+	RenderShaderVariable variable;
+	if (pixelShader->GetVariable("colorTint", variable)) {
+		commands.SetConstants(pixelShader, variable.buffer);
+	}
+	else {
+		commands.SetConstants(pixelShader);
+	}
+	RecordTextures(commands);
+}
+
+void Material::SetSurfaceVariables()
+{
 	pixelShader->SetFloat4("colorTint", GetColorTint());
 	pixelShader->SetFloat("roughness", GetRoughnessValue());
-	pixelShader->SetFloat3("cameraPosition", cameraPosition);
 	pixelShader->SetInt("hasSpecular", useSpecular ? 1 : 0);
 	pixelShader->SetInt("hasNormal", useNormal ? 1 : 0);
-	pixelShader->CopyAllBufferData();
-	for (auto& t : textureSRVs) { pixelShader -> SetShaderResourceView(t.first.c_str(), t.second); }
-	for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second); }
+}
+
+void Material::RecordTextures(CommandBuffer& commands)
+{
+	for (auto& t : textures) { commands.SetTexture(pixelShader, t.first.c_str(), t.second); }
+	for (auto& s : samplers) { commands.SetSampler(pixelShader, s.first.c_str(), s.second); }
 }
 
 void Material::UseSpecular(bool shouldUse)
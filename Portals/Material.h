@@ -1,41 +1,63 @@
 #pragma once
 #include <DirectXMath.h>
-#include <Windows.h>
-#include <d3d11.h>
 #include <string>
-#include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include <unordered_map>
-#include "SimpleShader.h"
 #include "Transform.h"
-#include "Camera.h"
+#include "Mesh.h"
+#include "RenderCommands.h"
+#include "RenderShader.h"
 using namespace DirectX;
 class Material {
 public:
-	Material(DirectX::XMFLOAT4 colorTint, SimplePixelShader* pixelShader, SimpleVertexShader* vertexShader, float roughness);
+	Material(DirectX::XMFLOAT4 colorTint, RenderShader* pixelShader, RenderShader* vertexShader, float roughness);
 	~Material();
 
 	// Getters and Setters
 	DirectX::XMFLOAT4 GetColorTint();
-	SimplePixelShader* GetPixelShader();
-	SimpleVertexShader* GetVertexShader();
+	RenderShader* GetPixelShader();
+	RenderShader* GetVertexShader();
+	// The vertex shader that can read mesh's vertex format
+	RenderShader* GetVertexShaderFor(Mesh* mesh);
+	// The vertex shader for drawing many copies of mesh at once, or null if the material can't be instanced
+	RenderShader* GetInstancedVertexShaderFor(Mesh* mesh);
 	float GetRoughnessValue();
 	void SetColorTint(DirectX::XMFLOAT4 newTint);
-	void SetPixelShader(SimplePixelShader* newPixelShader);
-	void SetVertexShader(SimpleVertexShader* newVertexShader);
-	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
-	void PrepareMaterial(Transform* transform, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
+	void SetPixelShader(RenderShader* newPixelShader);
+	void SetVertexShader(RenderShader* newVertexShader);
+	void SetPackedVertexShader(RenderShader* newPackedVertexShader);
+	void SetInstancedVertexShaders(RenderShader* newInstancedVertexShader, RenderShader* newPackedInstancedVertexShader);
+	// Textures and samplers are the backend's, and have to outlive the material
+	void AddTexture(std::string name, RenderHandle texture);
+	void AddSampler(std::string name, RenderHandle sampler);
+	// Record the shaders, constants and textures for drawing with this material.
+	// Pass the mesh being drawn so packed meshes get the vertex shader that can decode them
+	void PrepareMaterial(CommandBuffer& commands, Transform* transform, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition,
+		Mesh* mesh = nullptr);
+	// Same, from explicit world matrices. Anything behind clipPlane (world space, ax + by + cz + d < 0) is clipped away.
+	void PrepareMaterial(CommandBuffer& commands, XMFLOAT4X4 worldMat, XMFLOAT4X4 worldInvTranspose, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat,
+		XMFLOAT3 cameraPosition, Mesh* mesh = nullptr, XMFLOAT4 clipPlane = XMFLOAT4(0, 0, 0, 1));
+	// Just the pixel shader half of PrepareMaterial: its constants and textures, but not the pipeline
+	void PreparePixelShader(CommandBuffer& commands, XMFLOAT3 cameraPosition);
+	// Less again: only the constant buffer with the material's own values, and its textures.
+	// For callers that record the per-view constants (camera position, lights) once for many draws.
+	void PrepareSurface(CommandBuffer& commands);
 	void UseSpecular(bool shouldUse);
 	bool GetUseSpecular();
 
 private:
+	void SetSurfaceVariables();
+	void RecordTextures(CommandBuffer& commands);
+
 	DirectX::XMFLOAT4 colorTint;
-	SimplePixelShader* pixelShader;
-	SimpleVertexShader* vertexShader;
+	RenderShader* pixelShader;
+	RenderShader* vertexShader;
+	RenderShader* packedVertexShader = nullptr;	// Used for meshes in VERTEX_FORMAT_PACKED
+	RenderShader* instancedVertexShader = nullptr;
+	RenderShader* packedInstancedVertexShader = nullptr;
 	float roughness;
-	bool useSpecular;
-	bool useNormal;
+	bool useSpecular = false;
+	bool useNormal = false;
 
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs; 
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+	std::unordered_map<std::string, RenderHandle> textures;
+	std::unordered_map<std::string, RenderHandle> samplers;
 };
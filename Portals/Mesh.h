@@ -1,41 +1,69 @@
 #pragma once
 
-#include <Windows.h>
-#include <d3d11.h>
 #include <string>
-#include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include "Vertex.h"
+#include "MeshBVH.h"
+#include "RenderCommands.h"
 #include <vector>
-#include <fstream>
+#include <float.h>
 #include <DirectXCollision.h>
 
+// Header of a binary mesh cache (.meshbin) file. It is followed directly by
+// vertexCount Vertex structs (tangents included), then indexCount indices, then
+// the mesh's MeshBVH as written by MeshBVH::Save.
+struct MeshCacheHeader {
+	char magic[4];						// "MESH"
+	unsigned int version;				// Bumped whenever the layout or the OBJ import changes
+	unsigned long long sourceSize;		// Size of the OBJ this was built from
+	unsigned long long sourceWriteTime;	// Last write time of the OBJ this was built from
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	DirectX::XMFLOAT3 localMin;
+	DirectX::XMFLOAT3 localMax;
+	unsigned int bvhNodeCount;
+	unsigned int bvhBlockCount;
+};
+
 class Mesh {
 public:
-	Mesh(Vertex vertices[], int number_of_vertices, unsigned int indicies[], int number_of_indicies,
-		Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
-	Mesh(const char* filepath, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	// The buffers are made by backend, which has to outlive the mesh
+	Mesh(Vertex vertices[], int number_of_vertices, unsigned int indicies[], int number_of_indicies, RenderBackend* backend);
+	// vertexFormat picks the layout uploaded to the GPU (VERTEX_FORMAT_FULL or VERTEX_FORMAT_PACKED).
+	// Loaded through a binary cache next to the file, see MeshCache.cpp.
+	Mesh(const char* filepath, RenderBackend* backend, int vertexFormat = VERTEX_FORMAT_FULL);
 	~Mesh();
-	void CreateBuffers(Vertex vertices[], int number_of_vertices, unsigned int indicies[], int number_of_indicies,
-		Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void CreateBuffers(Vertex vertices[], int number_of_vertices, unsigned int indicies[], int number_of_indicies);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+	RenderHandle GetVertexBuffer();
+	RenderHandle GetIndexBuffer();
 	int GetIndexCount();
-	void Draw();
+	int GetVertexFormat();
+	unsigned int GetVertexStride();
+	// Record the draw, with whatever pipeline and constants were recorded before it
+	void Draw(CommandBuffer& commands);
+	// Record drawing the mesh once for each instance
+	void DrawInstanced(CommandBuffer& commands, const InstanceData* instances, unsigned int instanceCount);
 	DirectX::XMFLOAT3 GetLocalMin();
 	DirectX::XMFLOAT3 GetLocalMax();
 	std::vector<Vertex>& GetVertices();
-	std::vector<UINT>& GetIndices();
+	std::vector<unsigned int>& GetIndices();
+	const MeshBVH& GetBVH();
 	void TrySetLocalMinMax(DirectX::XMFLOAT3 pos);
 
 private:
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertex_buffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> index_buffer;
-	Microsoft::WRL::ComPtr <ID3D11DeviceContext> context;
-	int index_count;
+	bool LoadCache(const std::string& cachePath, unsigned long long sourceSize, unsigned long long sourceWriteTime);
+	void WriteCache(const std::string& cachePath, unsigned long long sourceSize, unsigned long long sourceWriteTime);
+
+	RenderBackend* backend;
+	RenderHandle vertex_buffer = nullptr;
+	RenderHandle index_buffer = nullptr;
+	int index_count = 0;
+	int vertexFormat = VERTEX_FORMAT_FULL;
 	// Store vertices and indices for when we need to calculate exact hit point for portal placement
 	std::vector<Vertex> vertices;
-	std::vector<UINT> indices;
+	std::vector<unsigned int> indices;
+	// Built from the above at load time, for ray casts against the exact triangles
+	MeshBVH bvh;
 	// Used to calculate the rough bounding box of the mesh
 	DirectX::XMFLOAT3 localMin = DirectX::XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
 	DirectX::XMFLOAT3 localMax = DirectX::XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
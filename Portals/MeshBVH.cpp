@@ -0,0 +1,387 @@
+#include "MeshBVH.h"
+#include "RayTriangle.h"
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+
+using namespace DirectX;
+using namespace std;
+
+// Number of buckets the centroids are sorted into when looking for the cheapest split
+#define BVH_SAH_BINS 12
+// Leaves never get split below this many triangles, one full block for the 4 wide intersector
+#define BVH_MIN_LEAF_TRIANGLES 4
+// Relative cost of visiting a node vs intersecting a block of four triangles
+#define BVH_TRAVERSAL_COST 1.0f
+// Traversal stack size. The build stops splitting at this depth so the stack can never overflow.
+#define BVH_STACK_SIZE 64
+
+struct BinBounds {
+	XMFLOAT3 boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	void Grow(const XMFLOAT3& p)
+	{
+		boundsMin = XMFLOAT3((std::min)(boundsMin.x, p.x), (std::min)(boundsMin.y, p.y), (std::min)(boundsMin.z, p.z));
+		boundsMax = XMFLOAT3((std::max)(boundsMax.x, p.x), (std::max)(boundsMax.y, p.y), (std::max)(boundsMax.z, p.z));
+	}
+	void Grow(const BinBounds& b)
+	{
+		if (b.boundsMin.x > b.boundsMax.x) return;
+		Grow(b.boundsMin);
+		Grow(b.boundsMax);
+	}
+	float HalfArea() const
+	{
+		if (boundsMin.x > boundsMax.x) return 0;
+		float x = boundsMax.x - boundsMin.x;
+		float y = boundsMax.y - boundsMin.y;
+		float z = boundsMax.z - boundsMin.z;
+		return x * y + y * z + z * x;
+	}
+};
+
+// Leaves are tested four triangles at a time, so their cost goes up in steps of four
+static float BlockCount(unsigned int triangleCount)
+{
+	return (float)((triangleCount + 3) / 4);
+}
+
+static float Component(const XMFLOAT3& v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+MeshBVH::MeshBVH()
+{
+}
+
+MeshBVH::~MeshBVH()
+{
+}
+
+void MeshBVH::Build(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+{
+	nodes.clear();
+	positions.clear();
+	blocks.clear();
+	triangleIds.clear();
+	normals.clear();
+
+	unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+
+	vector<XMFLOAT3> centroids(triangleCount);
+	vector<unsigned int> order(triangleCount);
+	normals.resize(triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++) {
+		const XMFLOAT3& a = vertices[indices[i * 3]].Position;
+		const XMFLOAT3& b = vertices[indices[i * 3 + 1]].Position;
+		const XMFLOAT3& c = vertices[indices[i * 3 + 2]].Position;
+		centroids[i] = XMFLOAT3((a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3, (a.z + b.z + c.z) / 3);
+		order[i] = i;
+
+		XMFLOAT3 e1 = XMFLOAT3(b.x - a.x, b.y - a.y, b.z - a.z);
+		XMFLOAT3 e2 = XMFLOAT3(c.x - a.x, c.y - a.y, c.z - a.z);
+		normals[i] = XMFLOAT3(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+	}
+
+	// Temporarily keep the triangle corners in original order, Subdivide needs them for the bounds
+	positions.resize(triangleCount * 3);
+	for (unsigned int i = 0; i < triangleCount * 3; i++) {
+		positions[i] = vertices[indices[i]].Position;
+	}
+
+	// A binary tree never has more than 2n - 1 nodes
+	nodes.reserve(triangleCount * 2);
+	Node root = {};
+	root.first = 0;
+	root.count = triangleCount;
+	nodes.push_back(root);
+	Subdivide(0, 0, centroids, order);
+
+	// Pack each leaf's triangles into its own run of blocks, and point the leaf at the first one
+	XMFLOAT3 corners[12];
+	for (Node& node : nodes) {
+		if (node.count == 0)
+			continue;
+		unsigned int firstBlock = (unsigned int)blocks.size();
+		for (unsigned int i = 0; i < node.count; i += 4) {
+			unsigned int count = (std::min)(4u, node.count - i);
+			for (unsigned int lane = 0; lane < 4; lane++) {
+				unsigned int tri = lane < count ? order[node.first + i + lane] : UINT_MAX;
+				if (tri != UINT_MAX) {
+					corners[lane * 3] = positions[tri * 3];
+					corners[lane * 3 + 1] = positions[tri * 3 + 1];
+					corners[lane * 3 + 2] = positions[tri * 3 + 2];
+				}
+				triangleIds.push_back(tri);
+			}
+			TriangleBlock4 block;
+			RayTriangle::BuildBlock(corners, count, block);
+			blocks.push_back(block);
+		}
+		node.first = firstBlock;
+	}
+	positions.clear();
+	positions.shrink_to_fit();
+	nodes.shrink_to_fit();
+}
+
+void MeshBVH::Subdivide(unsigned int nodeIndex, int depth, vector<XMFLOAT3>& centroids, vector<unsigned int>& order)
+{
+	// Bounds of the node's triangles and of their centroids
+	BinBounds bounds;
+	BinBounds centroidBounds;
+	unsigned int first = nodes[nodeIndex].first;
+	unsigned int count = nodes[nodeIndex].count;
+	for (unsigned int i = first; i < first + count; i++) {
+		unsigned int tri = order[i];
+		bounds.Grow(positions[tri * 3]);
+		bounds.Grow(positions[tri * 3 + 1]);
+		bounds.Grow(positions[tri * 3 + 2]);
+		centroidBounds.Grow(centroids[tri]);
+	}
+	nodes[nodeIndex].boundsMin = bounds.boundsMin;
+	nodes[nodeIndex].boundsMax = bounds.boundsMax;
+
+	if (count <= BVH_MIN_LEAF_TRIANGLES || depth >= BVH_STACK_SIZE)
+		return;
+
+	// Find the cheapest split plane between the bins along each axis
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		float axisMin = Component(centroidBounds.boundsMin, axis);
+		float axisMax = Component(centroidBounds.boundsMax, axis);
+		if (axisMax - axisMin <= 0)
+			continue;
+
+		BinBounds bins[BVH_SAH_BINS];
+		unsigned int binCounts[BVH_SAH_BINS] = {};
+		float scale = BVH_SAH_BINS / (axisMax - axisMin);
+		for (unsigned int i = first; i < first + count; i++) {
+			unsigned int tri = order[i];
+			int bin = (std::min)(BVH_SAH_BINS - 1, (int)((Component(centroids[tri], axis) - axisMin) * scale));
+			binCounts[bin]++;
+			bins[bin].Grow(positions[tri * 3]);
+			bins[bin].Grow(positions[tri * 3 + 1]);
+			bins[bin].Grow(positions[tri * 3 + 2]);
+		}
+
+		// Sweep from both sides to get the area and count left and right of every plane
+		float leftArea[BVH_SAH_BINS - 1], rightArea[BVH_SAH_BINS - 1];
+		unsigned int leftCount[BVH_SAH_BINS - 1], rightCount[BVH_SAH_BINS - 1];
+		BinBounds leftBounds, rightBounds;
+		unsigned int leftSum = 0, rightSum = 0;
+		for (int i = 0; i < BVH_SAH_BINS - 1; i++) {
+			leftSum += binCounts[i];
+			leftBounds.Grow(bins[i]);
+			leftCount[i] = leftSum;
+			leftArea[i] = leftBounds.HalfArea();
+
+			rightSum += binCounts[BVH_SAH_BINS - 1 - i];
+			rightBounds.Grow(bins[BVH_SAH_BINS - 1 - i]);
+			rightCount[BVH_SAH_BINS - 2 - i] = rightSum;
+			rightArea[BVH_SAH_BINS - 2 - i] = rightBounds.HalfArea();
+		}
+		for (int i = 0; i < BVH_SAH_BINS - 1; i++) {
+			if (leftCount[i] == 0 || rightCount[i] == 0)
+				continue;
+			float cost = BlockCount(leftCount[i]) * leftArea[i] + BlockCount(rightCount[i]) * rightArea[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	// Stay a leaf when splitting isn't cheaper than testing every triangle here
+	float leafCost = BlockCount(count) * bounds.HalfArea();
+	if (bestAxis < 0 || BVH_TRAVERSAL_COST * bounds.HalfArea() + bestCost >= leafCost)
+		return;
+
+	// Partition the triangles around the chosen plane
+	float axisMin = Component(centroidBounds.boundsMin, bestAxis);
+	float scale = BVH_SAH_BINS / (Component(centroidBounds.boundsMax, bestAxis) - axisMin);
+	unsigned int* middle = partition(&order[0] + first, &order[0] + first + count, [&](unsigned int tri) {
+		int bin = (std::min)(BVH_SAH_BINS - 1, (int)((Component(centroids[tri], bestAxis) - axisMin) * scale));
+		return bin <= bestSplit;
+	});
+	unsigned int leftCount = (unsigned int)(middle - (&order[0] + first));
+
+	unsigned int childIndex = (unsigned int)nodes.size();
+	Node left = {};
+	left.first = first;
+	left.count = leftCount;
+	Node right = {};
+	right.first = first + leftCount;
+	right.count = count - leftCount;
+	nodes.push_back(left);
+	nodes.push_back(right);
+
+	nodes[nodeIndex].first = childIndex;
+	nodes[nodeIndex].count = 0;
+	Subdivide(childIndex, depth + 1, centroids, order);
+	Subdivide(childIndex + 1, depth + 1, centroids, order);
+}
+
+// Slab test. Returns the entry distance, or FLT_MAX when the ray misses the box or enters it after maxDistance.
+static float IntersectBounds(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax,
+	const XMFLOAT3& origin, const XMFLOAT3& invDirection, float maxDistance)
+{
+	float tx1 = (boundsMin.x - origin.x) * invDirection.x, tx2 = (boundsMax.x - origin.x) * invDirection.x;
+	float tmin = (std::min)(tx1, tx2), tmax = (std::max)(tx1, tx2);
+	float ty1 = (boundsMin.y - origin.y) * invDirection.y, ty2 = (boundsMax.y - origin.y) * invDirection.y;
+	tmin = (std::max)(tmin, (std::min)(ty1, ty2)), tmax = (std::min)(tmax, (std::max)(ty1, ty2));
+	float tz1 = (boundsMin.z - origin.z) * invDirection.z, tz2 = (boundsMax.z - origin.z) * invDirection.z;
+	tmin = (std::max)(tmin, (std::min)(tz1, tz2)), tmax = (std::min)(tmax, (std::max)(tz1, tz2));
+	if (tmax >= tmin && tmin < maxDistance && tmax > 0)
+		return tmin;
+	return FLT_MAX;
+}
+
+template<bool AnyHit>
+bool MeshBVH::Traverse(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& outHit) const
+{
+	if (nodes.empty())
+		return false;
+
+	// Division by zero gives infinity here, which the slab test handles
+	XMFLOAT3 invDirection = XMFLOAT3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float closest = maxDistance;
+	bool hit = false;
+
+	// Far children waiting to be visited, with the distance where the ray enters them
+	unsigned int stack[BVH_STACK_SIZE];
+	float stackDistance[BVH_STACK_SIZE];
+	int stackSize = 0;
+	const Node* node = &nodes[0];
+	if (IntersectBounds(node->boundsMin, node->boundsMax, origin, invDirection, closest) == FLT_MAX)
+		return false;
+
+	while (true) {
+		if (node->count > 0) {
+			unsigned int lastBlock = node->first + (node->count + 3) / 4;
+			for (unsigned int b = node->first; b < lastBlock; b++) {
+				if (AnyHit) {
+					if (RayTriangle::IntersectBlockAny(blocks[b], origin, direction, 0.0001f, closest))
+						return true;
+					continue;
+				}
+				float t, u, v;
+				int lane = RayTriangle::IntersectBlock(blocks[b], origin, direction, 0.0001f, closest, t, u, v);
+				if (lane >= 0) {
+					hit = true;
+					closest = t;
+					outHit.distance = t;
+					outHit.triangle = triangleIds[b * 4 + lane];
+					outHit.u = u;
+					outHit.v = v;
+				}
+			}
+		}
+		else {
+			// Visit the nearer child first, and skip children that start beyond the closest hit so far
+			unsigned int childIndex = node->first;
+			float dist1 = IntersectBounds(nodes[childIndex].boundsMin, nodes[childIndex].boundsMax, origin, invDirection, closest);
+			float dist2 = IntersectBounds(nodes[childIndex + 1].boundsMin, nodes[childIndex + 1].boundsMax, origin, invDirection, closest);
+			unsigned int nearIndex = childIndex, farIndex = childIndex + 1;
+			if (dist1 > dist2) {
+				swap(dist1, dist2);
+				swap(nearIndex, farIndex);
+			}
+			if (dist1 != FLT_MAX) {
+				if (dist2 != FLT_MAX) {
+					stack[stackSize] = farIndex;
+					stackDistance[stackSize] = dist2;
+					stackSize++;
+				}
+				node = &nodes[nearIndex];
+				continue;
+			}
+		}
+
+		// Pop until we find a node the ray enters before the closest hit so far
+		bool found = false;
+		while (stackSize > 0) {
+			stackSize--;
+			if (stackDistance[stackSize] < closest) {
+				node = &nodes[stack[stackSize]];
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			break;
+	}
+	return hit;
+}
+
+bool MeshBVH::Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& outHit) const
+{
+	return Traverse<false>(origin, direction, maxDistance, outHit);
+}
+
+bool MeshBVH::RaycastAny(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance) const
+{
+	RayHit hit;
+	return Traverse<true>(origin, direction, maxDistance, hit);
+}
+
+XMFLOAT3 MeshBVH::GetTriangleNormal(unsigned int triangle) const
+{
+	return normals[triangle];
+}
+
+size_t MeshBVH::GetNodeCount() const
+{
+	return nodes.size();
+}
+
+size_t MeshBVH::GetTriangleCount() const
+{
+	return normals.size();
+}
+
+size_t MeshBVH::GetBlockCount() const
+{
+	return blocks.size();
+}
+
+size_t MeshBVH::GetSerializedSize(size_t nodeCount, size_t blockCount, size_t triangleCount)
+{
+	return nodeCount * sizeof(Node) + blockCount * (sizeof(TriangleBlock4) + 4 * sizeof(unsigned int)) + triangleCount * sizeof(XMFLOAT3);
+}
+
+// Nodes, then blocks, then the blocks' triangle ids, then the face normals
+void MeshBVH::Save(char* out) const
+{
+	memcpy(out, nodes.data(), nodes.size() * sizeof(Node));
+	out += nodes.size() * sizeof(Node);
+	memcpy(out, blocks.data(), blocks.size() * sizeof(TriangleBlock4));
+	out += blocks.size() * sizeof(TriangleBlock4);
+	memcpy(out, triangleIds.data(), triangleIds.size() * sizeof(unsigned int));
+	out += triangleIds.size() * sizeof(unsigned int);
+	memcpy(out, normals.data(), normals.size() * sizeof(XMFLOAT3));
+}
+
+void MeshBVH::Load(const char* data, size_t nodeCount, size_t blockCount, size_t triangleCount)
+{
+	positions.clear();
+	const Node* nodeData = (const Node*)data;
+	nodes.assign(nodeData, nodeData + nodeCount);
+	data += nodeCount * sizeof(Node);
+	const TriangleBlock4* blockData = (const TriangleBlock4*)data;
+	blocks.assign(blockData, blockData + blockCount);
+	data += blockCount * sizeof(TriangleBlock4);
+	const unsigned int* idData = (const unsigned int*)data;
+	triangleIds.assign(idData, idData + blockCount * 4);
+	data += blockCount * 4 * sizeof(unsigned int);
+	const XMFLOAT3* normalData = (const XMFLOAT3*)data;
+	normals.assign(normalData, normalData + triangleCount);
+}
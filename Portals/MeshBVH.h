@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+#include "RayTriangle.h"
+
+// Result of a ray cast against a mesh, in the mesh's local space
+struct RayHit {
+	float distance;			// Along the ray direction, in units of its length
+	unsigned int triangle;	// Index of the triangle in the mesh's index buffer (first index / 3)
+	float u, v;				// Barycentric coordinates of the hit on that triangle
+};
+
+// Bounding volume hierarchy over the triangles of one mesh, built once at load time with the surface area heuristic.
+// Nodes are stored flattened in a single array with both children of a node next to each other. Each leaf's
+// triangles are packed into consecutive TriangleBlock4s, so leaves are tested four triangles at a time.
+class MeshBVH {
+public:
+	MeshBVH();
+	~MeshBVH();
+
+	void Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+
+	// Closest hit along origin + direction * t for t in (0, maxDistance]. Triangles are two sided.
+	bool Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& outHit) const;
+	// True as soon as any triangle is hit in (0, maxDistance], for occlusion and line of sight tests
+	bool RaycastAny(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance) const;
+
+	// Unnormalized face normal (edge1 x edge2) of a triangle, as used by the portal placement
+	DirectX::XMFLOAT3 GetTriangleNormal(unsigned int triangle) const;
+	size_t GetNodeCount() const;
+	size_t GetTriangleCount() const;
+	size_t GetBlockCount() const;
+
+	// The built hierarchy exactly as it's held in memory, so a mesh cache can store it and skip Build on the next load.
+	// Save writes GetSerializedSize(GetNodeCount(), GetBlockCount(), GetTriangleCount()) bytes, which Load reads back.
+	static size_t GetSerializedSize(size_t nodeCount, size_t blockCount, size_t triangleCount);
+	void Save(char* out) const;
+	void Load(const char* data, size_t nodeCount, size_t blockCount, size_t triangleCount);
+
+private:
+	// 32 bytes. Leaves have a non-zero triangle count and their blocks start at first,
+	// interior nodes have count == 0 and their children at first and first + 1.
+	struct Node {
+		DirectX::XMFLOAT3 boundsMin;
+		unsigned int first;
+		DirectX::XMFLOAT3 boundsMax;
+		unsigned int count;
+	};
+
+	void Subdivide(unsigned int nodeIndex, int depth, std::vector<DirectX::XMFLOAT3>& centroids, std::vector<unsigned int>& order);
+	template<bool AnyHit>
+	bool Traverse(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, RayHit& outHit) const;
+
+	std::vector<Node> nodes;
+	std::vector<DirectX::XMFLOAT3> positions;		// Three per triangle, only kept while building
+	std::vector<TriangleBlock4> blocks;
+	std::vector<unsigned int> triangleIds;		// Original triangle index of every block lane, UINT_MAX for unused lanes
+	std::vector<DirectX::XMFLOAT3> normals;		// Face normal of each original triangle
+};
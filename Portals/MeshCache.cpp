@@ -0,0 +1,147 @@
+// Loading a Mesh from an OBJ file, through a binary cache of the finished vertices. Kept out of Mesh.cpp since the cache
+// is read with Win32 file mapping, while the rest of Mesh builds anywhere.
+#include "Mesh.h"
+#include "ObjLoader.h"
+#include "MeshOptimizer.h"
+#include <Windows.h>
+#include <fstream>
+using namespace DirectX;
+using namespace std;
+
+// Version of the .meshbin format written by this build
+#define MESH_CACHE_VERSION 4
+
+Mesh::Mesh(const char* filepath, RenderBackend* backend, int vertexFormat)
+{
+	this->backend = backend;
+	this->vertexFormat = vertexFormat;
+
+	// Look for a binary cache built from this exact version of the OBJ before parsing any text
+	WIN32_FILE_ATTRIBUTE_DATA sourceInfo;
+	if (!GetFileAttributesExA(filepath, GetFileExInfoStandard, &sourceInfo))
+		return;
+	UINT64 sourceSize = ((UINT64)sourceInfo.nFileSizeHigh << 32) | sourceInfo.nFileSizeLow;
+	UINT64 sourceWriteTime = ((UINT64)sourceInfo.ftLastWriteTime.dwHighDateTime << 32) | sourceInfo.ftLastWriteTime.dwLowDateTime;
+	std::string cachePath = std::string(filepath) + ".meshbin";
+	if (LoadCache(cachePath, sourceSize, sourceWriteTime))
+		return;
+
+	// Parse the OBJ into shared, indexed vertices
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!ObjLoader::Load(filepath, verts, indices))
+		return;
+
+	// Reorder for the vertex cache, overdraw and vertex fetch. Every portal recursion level draws these again,
+	// so it pays off many times over. Cached meshes were saved after this step.
+	MeshOptimizer::Optimize(verts, indices);
+	int vertCounter = (int)verts.size();
+	int indexCounter = (int)indices.size();
+	for (int i = 0; i < vertCounter; i++) {
+		TrySetLocalMinMax(verts[i].Position);
+	}
+
+	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
+
+	// - At this point, "verts" is a vector of Vertex structs, and can be used
+	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
+	//
+	// - The vector "indices" is similar. It's a vector of unsigned ints and
+	//    can be used directly for the index buffer: &indices[0] is the address of the first int
+	//
+	// - "vertCounter" is the number of vertices
+	// - "indexCounter" is the number of indices
+	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+
+	this->vertices = verts;
+	this->indices = indices;
+	bvh.Build(this->vertices, this->indices);
+
+	// Save the final vertices and BVH so the next launch can skip all of the above
+	WriteCache(cachePath, sourceSize, sourceWriteTime);
+}
+
+// Memory map a .meshbin file and create the buffers and BVH straight from it. Returns false if the file
+// is missing, truncated, from an older version, or was built from a different copy of the OBJ.
+bool Mesh::LoadCache(const std::string& cachePath, unsigned long long sourceSize, unsigned long long sourceWriteTime)
+{
+	HANDLE file = CreateFileA(cachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool loaded = false;
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && (UINT64)fileSize.QuadPart >= sizeof(MeshCacheHeader))
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping != nullptr)
+	{
+		const char* data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data != nullptr)
+		{
+			const MeshCacheHeader* header = (const MeshCacheHeader*)data;
+			UINT64 expectedSize = sizeof(MeshCacheHeader) + (UINT64)header->vertexCount * sizeof(Vertex) + (UINT64)header->indexCount * sizeof(UINT) +
+				MeshBVH::GetSerializedSize(header->bvhNodeCount, header->bvhBlockCount, header->indexCount / 3);
+			if (memcmp(header->magic, "MESH", 4) == 0 &&
+				header->version == MESH_CACHE_VERSION &&
+				header->sourceSize == sourceSize &&
+				header->sourceWriteTime == sourceWriteTime &&
+				header->vertexCount > 0 && header->indexCount > 0 &&
+				(UINT64)fileSize.QuadPart == expectedSize)
+			{
+				Vertex* verts = (Vertex*)(data + sizeof(MeshCacheHeader));
+				UINT* inds = (UINT*)(verts + header->vertexCount);
+
+				// The GPU buffers are created directly from the mapped file, no intermediate copy.
+				// Bounds first, since packed vertices are quantized against them.
+				localMin = header->localMin;
+				localMax = header->localMax;
+				CreateBuffers(verts, header->vertexCount, inds, header->indexCount);
+				vertices.assign(verts, verts + header->vertexCount);
+				indices.assign(inds, inds + header->indexCount);
+				bvh.Load((const char*)(inds + header->indexCount), header->bvhNodeCount, header->bvhBlockCount, header->indexCount / 3);
+				loaded = true;
+			}
+			UnmapViewOfFile(data);
+		}
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	return loaded;
+}
+
+// Write the mesh out as a .meshbin file next to its OBJ. Failing to write (read only folder, etc.)
+// isn't an error, the OBJ will just be parsed again next time.
+void Mesh::WriteCache(const std::string& cachePath, unsigned long long sourceSize, unsigned long long sourceWriteTime)
+{
+	if (vertices.empty() || indices.empty())
+		return;
+
+	MeshCacheHeader header = {};
+	memcpy(header.magic, "MESH", 4);
+	header.version = MESH_CACHE_VERSION;
+	header.sourceSize = sourceSize;
+	header.sourceWriteTime = sourceWriteTime;
+	header.vertexCount = (UINT)vertices.size();
+	header.indexCount = (UINT)indices.size();
+	header.localMin = localMin;
+	header.localMax = localMax;
+	header.bvhNodeCount = (UINT)bvh.GetNodeCount();
+	header.bvhBlockCount = (UINT)bvh.GetBlockCount();
+	std::vector<char> bvhData(MeshBVH::GetSerializedSize(bvh.GetNodeCount(), bvh.GetBlockCount(), bvh.GetTriangleCount()));
+	bvh.Save(bvhData.data());
+
+	std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return;
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&vertices[0], sizeof(Vertex) * vertices.size());
+	out.write((const char*)&indices[0], sizeof(UINT) * indices.size());
+	out.write(bvhData.data(), bvhData.size());
+	out.close();
+
+	// Don't leave a partial file behind, it would be rejected on every load anyway
+	if (out.fail())
+		DeleteFileA(cachePath.c_str());
+}
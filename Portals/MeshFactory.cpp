@@ -5,7 +5,7 @@
 using namespace DirectX;
 
 
-Mesh* MeshFactory::CreateCircleMesh(int numSlices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) {
+Mesh* MeshFactory::CreateCircleMesh(int numSlices, RenderBackend* backend) {
 	// Create circle mesh
 	Vertex* verts = new Vertex[numSlices + 1];
 	unsigned int* indices = new unsigned int[numSlices * 3];
@@ -39,7 +39,7 @@ Mesh* MeshFactory::CreateCircleMesh(int numSlices, Microsoft::WRL::ComPtr<ID3D11
 		// Increment angle
 		angle += dAngle;
 	}
-	Mesh* circleMesh = new Mesh(verts, numSlices + 1, indices, numSlices * 3, device, context);
+	Mesh* circleMesh = new Mesh(verts, numSlices + 1, indices, numSlices * 3, backend);
 	delete[] verts;
 	delete[] indices;
 	return circleMesh;
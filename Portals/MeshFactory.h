@@ -11,5 +11,5 @@ class MeshFactory: public DXCore {
 public:
 	MeshFactory() = delete;
 
-	static Mesh* CreateCircleMesh(int numSlices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	static Mesh* CreateCircleMesh(int numSlices, RenderBackend* backend);
 };
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace DirectX;
+using namespace std;
+
+// Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring constants
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRI_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+static float VertexScore(int cachePosition, int remainingValence)
+{
+	// No triangles left that use this vertex, so it doesn't matter when it is used
+	if (remainingValence == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The last triangle's vertices get a fixed score so the next triangle doesn't just reuse the same strip edge
+		if (cachePosition < 3) {
+			score = FORSYTH_LAST_TRI_SCORE;
+		}
+		else {
+			float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	// Boost vertices with few triangles left, to finish them off and avoid leaving lone triangles behind
+	score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingValence, -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangle adjacency for every vertex, stored as one flat array with per vertex offsets
+	vector<int> valence(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++) {
+		valence[indices[i]]++;
+	}
+	vector<int> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+	}
+	vector<int> adjacency(indexCount);
+	vector<int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (int k = 0; k < 3; k++) {
+			adjacency[fill[indices[t * 3 + k]]++] = (int)t;
+		}
+	}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScore[v] = VertexScore(-1, valence[v]);
+	}
+	vector<float> triangleScore(triangleCount);
+	vector<bool> triangleAdded(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	vector<unsigned int> output;
+	output.reserve(indexCount);
+	vector<int> cache;
+	vector<int> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t scanCursor = 0;
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+
+	for (size_t emitted = 0; emitted < triangleCount; emitted++) {
+		// Nothing useful in the cache, fall back to the best remaining triangle anywhere.
+		// Triangles before scanCursor are all added, so the scan never restarts from the beginning.
+		if (bestTriangle < 0) {
+			while (triangleAdded[scanCursor]) scanCursor++;
+			bestTriangle = (int)scanCursor;
+			bestScore = triangleScore[scanCursor];
+			for (size_t t = scanCursor + 1; t < triangleCount; t++) {
+				if (!triangleAdded[t] && triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+
+		// Emit the triangle and remove it from its vertices' adjacency lists
+		triangleAdded[bestTriangle] = true;
+		const unsigned int* tri = &indices[bestTriangle * 3];
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = tri[k];
+			output.push_back(v);
+			int* begin = &adjacency[adjacencyOffset[v]];
+			int* end = begin + valence[v];
+			int* found = find(begin, end, bestTriangle);
+			*found = *(end - 1);
+			valence[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache
+		newCache.clear();
+		newCache.push_back(tri[0]);
+		newCache.push_back(tri[1]);
+		newCache.push_back(tri[2]);
+		for (int v : cache) {
+			if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2]) {
+				newCache.push_back(v);
+			}
+		}
+
+		// Rescore everything whose cache position changed, including vertices that just fell out
+		for (size_t i = 0; i < newCache.size(); i++) {
+			int v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], valence[v]);
+		}
+		if (newCache.size() > FORSYTH_CACHE_SIZE) {
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		swap(cache, newCache);
+
+		// The next triangle is the best one touching the cache
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int v : cache) {
+			for (int a = adjacencyOffset[v]; a < adjacencyOffset[v] + valence[v]; a++) {
+				int t = adjacency[a];
+				const unsigned int* other = &indices[t * 3];
+				float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+				triangleScore[t] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	copy(output.begin(), output.end(), indices);
+}
+
+// A run of triangles that the vertex cache optimizer placed together
+struct TriangleCluster {
+	size_t start;		// First index
+	size_t count;		// Number of indices
+	float sortKey;
+};
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Split the triangle list wherever a triangle misses the cache on all three vertices.
+	// Reordering whole clusters keeps nearly all of the cache locality the previous pass found.
+	const int cacheSize = 16;
+	vector<size_t> cacheTime(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	vector<TriangleCluster> clusters;
+	for (size_t t = 0; t < triangleCount; t++) {
+		int misses = 0;
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = indices[t * 3 + k];
+			if (time - cacheTime[v] > cacheSize) {
+				cacheTime[v] = time++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3) {
+			TriangleCluster cluster = { t * 3, 0, 0.0f };
+			clusters.push_back(cluster);
+		}
+		clusters.back().count += 3;
+	}
+
+	// Center of the whole mesh
+	XMFLOAT3 meshCenter(0, 0, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		meshCenter.x += vertices[v].Position.x;
+		meshCenter.y += vertices[v].Position.y;
+		meshCenter.z += vertices[v].Position.z;
+	}
+	meshCenter.x /= vertexCount;
+	meshCenter.y /= vertexCount;
+	meshCenter.z /= vertexCount;
+
+	// Clusters facing away from the center of the mesh are the most likely to occlude the rest, so they draw first
+	for (TriangleCluster& cluster : clusters) {
+		XMFLOAT3 center(0, 0, 0);
+		XMFLOAT3 normal(0, 0, 0);
+		float area = 0;
+		for (size_t i = cluster.start; i < cluster.start + cluster.count; i += 3) {
+			const XMFLOAT3& a = vertices[indices[i]].Position;
+			const XMFLOAT3& b = vertices[indices[i + 1]].Position;
+			const XMFLOAT3& c = vertices[indices[i + 2]].Position;
+			XMFLOAT3 e1(b.x - a.x, b.y - a.y, b.z - a.z);
+			XMFLOAT3 e2(c.x - a.x, c.y - a.y, c.z - a.z);
+			// Clockwise front faces, so e1 x e2 points out of the front
+			XMFLOAT3 n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+			float triangleArea = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			center.x += (a.x + b.x + c.x) * triangleArea / 3.0f;
+			center.y += (a.y + b.y + c.y) * triangleArea / 3.0f;
+			center.z += (a.z + b.z + c.z) * triangleArea / 3.0f;
+			area += triangleArea;
+		}
+		if (area > 0) {
+			center.x /= area;
+			center.y /= area;
+			center.z /= area;
+		}
+		float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		if (length > 0) {
+			cluster.sortKey = ((center.x - meshCenter.x) * normal.x + (center.y - meshCenter.y) * normal.y + (center.z - meshCenter.z) * normal.z) / length;
+		}
+	}
+	stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	vector<unsigned int> output;
+	output.reserve(indexCount);
+	for (const TriangleCluster& cluster : clusters) {
+		output.insert(output.end(), indices + cluster.start, indices + cluster.start + cluster.count);
+	}
+	copy(output.begin(), output.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	// Number vertices in the order the index buffer first uses them
+	const unsigned int unused = 0xFFFFFFFF;
+	vector<unsigned int> remap(vertexCount, unused);
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused) {
+			newIndex = next++;
+		}
+		indices[i] = newIndex;
+	}
+
+	vector<Vertex> reordered(next);
+	for (size_t v = 0; v < vertexCount; v++) {
+		if (remap[v] != unused) {
+			reordered[remap[v]] = vertices[v];
+		}
+	}
+	copy(reordered.begin(), reordered.end(), vertices);
+	return next;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+	// FIFO cache: a vertex is still cached if fewer than cacheSize misses happened since it was loaded
+	vector<size_t> cacheTime(vertexCount, 0);
+	vector<bool> used(vertexCount, false);
+	size_t time = cacheSize + 1;
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int v = indices[i];
+		if (time - cacheTime[v] > (size_t)cacheSize) {
+			cacheTime[v] = time++;
+			misses++;
+		}
+		if (!used[v]) {
+			used[v] = true;
+			uniqueVertices++;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = indexCount > 0 ? (float)misses / (indexCount / 3) : 0.0f;
+	stats.atvr = uniqueVertices > 0 ? (float)misses / uniqueVertices : 0.0f;
+	return stats;
+}
+
+void MeshOptimizer::Optimize(vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	if (vertices.empty() || indices.empty())
+		return;
+
+	OptimizeVertexCache(&indices[0], indices.size(), vertices.size());
+	OptimizeOverdraw(&indices[0], indices.size(), &vertices[0], vertices.size());
+	vertices.resize(OptimizeVertexFetch(&vertices[0], vertices.size(), &indices[0], indices.size()));
+}
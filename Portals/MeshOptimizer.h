@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// Vertex cache statistics for an index buffer, measured with a simulated FIFO post-transform cache
+struct VertexCacheStats {
+	float acmr;		// Average cache miss ratio: transformed vertices per triangle (0.5 is ideal, 3 is the worst)
+	float atvr;		// Average transform to vertex ratio: transformed vertices per unique vertex (1 is ideal)
+};
+
+// Reorders indexed meshes so the GPU does less work per draw. Run in this order:
+//  1. OptimizeVertexCache - triangle order for post-transform cache hits (Tom Forsyth's algorithm)
+//  2. OptimizeOverdraw    - reorder clusters of triangles so outward facing ones draw first, keeping cache locality
+//  3. OptimizeVertexFetch - vertex order matching first use by the index buffer
+class MeshOptimizer {
+public:
+	MeshOptimizer() = delete;
+
+	static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+	static void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount);
+	// Returns the new vertex count, which is lower if some vertices were never referenced
+	static size_t OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount);
+	static VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+
+	// Run all three passes on a mesh's vectors
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+};
@@ -0,0 +1,445 @@
+#include "ObjLoader.h"
+#include <fstream>
+#include <unordered_map>
+#include <math.h>
+
+using namespace DirectX;
+using namespace std;
+
+#ifndef _MSC_VER
+#define sscanf_s sscanf		// The legacy loader only reads numbers, which the two handle the same way
+#endif
+
+// A face corner: 0-based position, uv and normal indices, -1 when the corner doesn't have one
+struct ObjCorner {
+	int position;
+	int uv;
+	int normal;
+
+	bool operator==(const ObjCorner& other) const {
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+struct ObjCornerHash {
+	size_t operator()(const ObjCorner& c) const {
+		size_t hash = (size_t)(unsigned int)c.position * 73856093u;
+		hash ^= (size_t)(unsigned int)c.uv * 19349663u;
+		hash ^= (size_t)(unsigned int)c.normal * 83492791u;
+		return hash;
+	}
+};
+
+static inline bool IsDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	return p;
+}
+
+static inline const char* SkipLine(const char* p, const char* end) {
+	while (p < end && *p != '\n') p++;
+	return p < end ? p + 1 : p;
+}
+
+static const char* ParseInt(const char* p, const char* end, int& out) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	int value = 0;
+	while (p < end && IsDigit(*p)) {
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+	out = negative ? -value : value;
+	return p;
+}
+
+// Decimal float parser. Much faster than sscanf_s, and more than accurate enough for mesh data:
+// up to 19 significant digits are kept and then scaled by a power of ten.
+static const char* ParseFloat(const char* p, const char* end, float& out) {
+	static const double powersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	p = SkipSpaces(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	while (p < end && IsDigit(*p)) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0) digits++;
+		}
+		else {
+			exponent++;
+		}
+		p++;
+	}
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && IsDigit(*p)) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) digits++;
+				exponent--;
+			}
+			p++;
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		int e;
+		p = ParseInt(p + 1, end, e);
+		exponent += e;
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0) {
+		value = -exponent <= 22 ? value / powersOfTen[-exponent] : value * pow(10.0, exponent);
+	}
+	else if (exponent > 0) {
+		value = exponent <= 22 ? value * powersOfTen[exponent] : value * pow(10.0, exponent);
+	}
+	out = (float)(negative ? -value : value);
+	return p;
+}
+
+// OBJ indices are 1-based, or relative to the end of the list so far when negative.
+// out is 0-based, or -1 when the corner doesn't have one (index 0). Returns false if it's outside the list.
+static inline bool ResolveIndex(int index, size_t count, int& out) {
+	if (index == 0) {
+		out = -1;
+		return true;
+	}
+	out = index > 0 ? index - 1 : (int)count + index;
+	return out >= 0 && out < (int)count;
+}
+
+bool ObjLoader::Load(const char* filepath, vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	// Read the whole file at once, rather than line by line
+	ifstream obj(filepath, ios::binary | ios::ate);
+	if (!obj.is_open())
+		return false;
+	streamsize size = obj.tellg();
+	if (size <= 0)
+		return false;
+	vector<char> data((size_t)size);
+	obj.seekg(0, ios::beg);
+	if (!obj.read(&data[0], size))
+		return false;
+
+	return Parse(&data[0], data.size(), vertices, indices);
+}
+
+bool ObjLoader::Parse(const char* data, size_t size, vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	vector<XMFLOAT3> positions;
+	vector<XMFLOAT3> normals;
+	vector<XMFLOAT2> uvs;
+	vector<unsigned int> face;		// Vertex indices of the face being read
+	unordered_map<ObjCorner, unsigned int, ObjCornerHash> vertexLookup;
+
+	// Rough guesses so the vectors don't have to grow too often. A typical "v" line is ~30 bytes.
+	positions.reserve(size / 64);
+	vertexLookup.reserve(size / 64);
+	vertices.clear();
+	indices.clear();
+
+	const char* p = data;
+	const char* end = data + size;
+	while (p < end) {
+		p = SkipSpaces(p, end);
+		if (p >= end) break;
+
+		if (p[0] == 'v' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+			XMFLOAT3 pos;
+			p = ParseFloat(p + 1, end, pos.x);
+			p = ParseFloat(p, end, pos.y);
+			p = ParseFloat(p, end, pos.z);
+			positions.push_back(pos);
+		}
+		else if (p[0] == 'v' && p + 1 < end && p[1] == 't') {
+			XMFLOAT2 uv;
+			p = ParseFloat(p + 2, end, uv.x);
+			p = ParseFloat(p, end, uv.y);
+			uvs.push_back(uv);
+		}
+		else if (p[0] == 'v' && p + 1 < end && p[1] == 'n') {
+			XMFLOAT3 norm;
+			p = ParseFloat(p + 2, end, norm.x);
+			p = ParseFloat(p, end, norm.y);
+			p = ParseFloat(p, end, norm.z);
+			normals.push_back(norm);
+		}
+		else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+			face.clear();
+			p++;
+			while (true) {
+				p = SkipSpaces(p, end);
+				if (p >= end || !(IsDigit(*p) || *p == '-' || *p == '+')) break;
+
+				// v, v/vt, v//vn or v/vt/vn
+				int v = 0, vt = 0, vn = 0;
+				p = ParseInt(p, end, v);
+				if (p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/') p = ParseInt(p, end, vt);
+					if (p < end && *p == '/') p = ParseInt(p + 1, end, vn);
+				}
+
+				// Every corner needs a position, and any index given has to be in its list
+				ObjCorner corner;
+				if (!ResolveIndex(v, positions.size(), corner.position) || corner.position < 0 ||
+					!ResolveIndex(vt, uvs.size(), corner.uv) ||
+					!ResolveIndex(vn, normals.size(), corner.normal)) {
+					return false;
+				}
+
+				// Reuse the vertex if this exact combination has been seen before
+				auto found = vertexLookup.find(corner);
+				if (found != vertexLookup.end()) {
+					face.push_back(found->second);
+					continue;
+				}
+
+				// Convert to left handed space: flip Z of the position and normal, and flip the UV
+				// since DirectX defines (0,0) as the top left of the texture
+				Vertex vert = {};
+				vert.Position = positions[corner.position];
+				vert.Position.z *= -1.0f;
+				if (corner.uv >= 0) {
+					vert.UV = XMFLOAT2(uvs[corner.uv].x, 1.0f - uvs[corner.uv].y);
+				}
+				else {
+					vert.UV = XMFLOAT2(0, 1);
+				}
+				if (corner.normal >= 0) {
+					vert.Normal = normals[corner.normal];
+					vert.Normal.z *= -1.0f;
+				}
+
+				unsigned int index = (unsigned int)vertices.size();
+				vertices.push_back(vert);
+				vertexLookup.emplace(corner, index);
+				face.push_back(index);
+			}
+
+			// Fan the polygon into triangles, flipping the winding order
+			for (size_t i = 1; i + 1 < face.size(); i++) {
+				indices.push_back(face[0]);
+				indices.push_back(face[i + 1]);
+				indices.push_back(face[i]);
+			}
+		}
+		p = SkipLine(p, end);
+	}
+
+	return !indices.empty();
+}
+
+bool ObjLoader::LoadLegacy(const char* filepath, vector<Vertex>& verts, vector<unsigned int>& indices)
+{
+	// --------------------------------------------------------
+	// Author: Chris Cascioli
+	// --------------------------------------------------------
+	// File input object
+	std::ifstream obj(filepath);
+
+	// Check for successful open
+	if (!obj.is_open())
+		return false;
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;		// UVs from the file
+	int vertCounter = 0;			// Count of vertices
+	int indexCounter = 0;			// Count of indices
+	char chars[100];			// String for line reading
+	// Still have data left?
+	while (obj.good())
+	{
+		// Get the line (100 characters should be more than enough)
+		obj.getline(chars, 100);
+
+		// Check the type of line
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 norm;
+			sscanf_s(
+				chars,
+				"vn %f %f %f",
+				&norm.x, &norm.y, &norm.z);
+
+			// Add to the list of normals
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			// Read the 2 numbers directly into an XMFLOAT2
+			XMFLOAT2 uv;
+			sscanf_s(
+				chars,
+				"vt %f %f",
+				&uv.x, &uv.y);
+
+			// Add to the list of uv's
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 pos;
+			sscanf_s(
+				chars,
+				"v %f %f %f",
+				&pos.x, &pos.y, &pos.z);
+
+			// Add to the positions
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			// Read the face indices into an array
+			// NOTE: This assumes the given obj file contains
+			//  vertex positions, uv coordinates AND normals.
+			unsigned int i[12];
+			int numbersRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			// If we only got the first number, chances are the OBJ
+			// file has no UV coordinates.  This isn't great, but we
+			// still want to load the model without crashing, so we
+			// need to re-read a different pattern (in which we assume
+			// there are no UVs denoted for any of the vertices)
+			if (numbersRead == 1)
+			{
+				// Re-read with a different pattern
+				numbersRead = sscanf_s(
+					chars,
+					"f %d//%d %d//%d %d//%d %d//%d",
+					&i[0], &i[2],
+					&i[3], &i[5],
+					&i[6], &i[8],
+					&i[9], &i[11]);
+
+				// The following indices are where the UVs should 
+				// have been, so give them a valid value
+				i[1] = 1;
+				i[4] = 1;
+				i[7] = 1;
+				i[10] = 1;
+
+				// If we have no UVs, create a single UV coordinate
+				// that will be used for all vertices
+				if (uvs.size() == 0)
+					uvs.push_back(XMFLOAT2(0, 0));
+			}
+
+			// - Create the verts by looking up
+			//    corresponding data from vectors
+			// - OBJ File indices are 1-based, so
+			//    they need to be adusted
+			Vertex v1;
+			v1.Position = positions[i[0] - 1];
+			v1.UV = uvs[i[1] - 1];
+			v1.Normal = normals[i[2] - 1];
+
+			Vertex v2;
+			v2.Position = positions[i[3] - 1];
+			v2.UV = uvs[i[4] - 1];
+			v2.Normal = normals[i[5] - 1];
+
+			Vertex v3;
+			v3.Position = positions[i[6] - 1];
+			v3.UV = uvs[i[7] - 1];
+			v3.Normal = normals[i[8] - 1];
+
+			// The model is most likely in a right-handed space,
+			// especially if it came from Maya.  We want to convert
+			// to a left-handed space for DirectX.  This means we 
+			// need to:
+			//  - Invert the Z position
+			//  - Invert the normal's Z
+			//  - Flip the winding order
+			// We also need to flip the UV coordinate since DirectX
+			// defines (0,0) as the top left of the texture, and many
+			// 3D modeling packages use the bottom left as (0,0)
+
+			// Flip the UV's since they're probably "upside down"
+			v1.UV.y = 1.0f - v1.UV.y;
+			v2.UV.y = 1.0f - v2.UV.y;
+			v3.UV.y = 1.0f - v3.UV.y;
+
+			// Flip Z (LH vs. RH)
+			v1.Position.z *= -1.0f;
+			v2.Position.z *= -1.0f;
+			v3.Position.z *= -1.0f;
+
+			// Flip normal's Z
+			v1.Normal.z *= -1.0f;
+			v2.Normal.z *= -1.0f;
+			v3.Normal.z *= -1.0f;
+
+			// Add the verts to the vector (flipping the winding order)
+			verts.push_back(v1);
+			verts.push_back(v3);
+			verts.push_back(v2);
+			vertCounter += 3;
+
+			// Add three more indices
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+
+			// Was there a 4th face?
+			// - 12 numbers read means 4 faces WITH uv's
+			// - 8 numbers read means 4 faces WITHOUT uv's
+			if (numbersRead == 12 || numbersRead == 8)
+			{
+				// Make the last vertex
+				Vertex v4;
+				v4.Position = positions[i[9] - 1];
+				v4.UV = uvs[i[10] - 1];
+				v4.Normal = normals[i[11] - 1];
+
+				// Flip the UV, Z pos and normal's Z
+				v4.UV.y = 1.0f - v4.UV.y;
+				v4.Position.z *= -1.0f;
+				v4.Normal.z *= -1.0f;
+
+				// Add a whole triangle (flipping the winding order)
+				verts.push_back(v1);
+				verts.push_back(v4);
+				verts.push_back(v3);
+				vertCounter += 3;
+
+				// Add three more indices
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+			}
+		}
+	}
+
+	obj.close();
+	return !indices.empty();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// Reads Wavefront OBJ files into an indexed vertex list ready for Mesh.
+// Vertices are converted to DirectX's left handed space: Z is flipped, V is flipped and the winding order is reversed.
+class ObjLoader {
+public:
+	ObjLoader() = delete;
+
+	// Read and parse a whole OBJ file. Returns false if it can't be opened or is malformed.
+	static bool Load(const char* filepath, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+	// Parse OBJ text that is already in memory, in a single pass.
+	// Identical position/uv/normal triples share one vertex, n-gons are fanned into triangles
+	// and negative (relative) indices are supported.
+	static bool Parse(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+	// The original line by line sscanf_s loader (3 new vertices per triangle, triangles and quads only).
+	// Only kept around to benchmark against.
+	static bool LoadLegacy(const char* filepath, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+};
@@ -0,0 +1,201 @@
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace DirectX;
+using namespace std;
+
+// Clip space w below this counts as on or behind the camera
+#define OCCLUSION_MIN_W 1e-5f
+
+#define OCCLUSION_TILES_X (OCCLUSION_BUFFER_WIDTH / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_TILES_Y (OCCLUSION_BUFFER_HEIGHT / OCCLUSION_TILE_SIZE)
+
+OcclusionBuffer::OcclusionBuffer()
+{
+	depth.resize(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT, 1.0f);
+	tileDepth.resize(OCCLUSION_TILES_X * OCCLUSION_TILES_Y, 1.0f);
+	rectLeft = rectTop = 0;
+	rectRight = OCCLUSION_BUFFER_WIDTH;
+	rectBottom = OCCLUSION_BUFFER_HEIGHT;
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+
+// Project a world space point into the buffer: pixel x and y, and depth. False if it's not in front of the near plane.
+static inline bool ProjectPoint(const XMFLOAT3& point, FXMMATRIX viewProjection, XMFLOAT3& outPixel)
+{
+	XMFLOAT4 clip;
+	XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(point.x, point.y, point.z, 1.0f), viewProjection));
+	if (clip.w < OCCLUSION_MIN_W || clip.z < 0) {
+		return false;
+	}
+	float invW = 1.0f / clip.w;
+	outPixel.x = (clip.x * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH;
+	outPixel.y = (0.5f - clip.y * invW * 0.5f) * OCCLUSION_BUFFER_HEIGHT;
+	outPixel.z = clip.z * invW;
+	return true;
+}
+
+void OcclusionBuffer::Begin(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, const XMFLOAT4& screenRect)
+{
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+	rectLeft = (std::max)(0, (int)floorf((screenRect.x * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH));
+	rectTop = (std::max)(0, (int)floorf((0.5f - screenRect.y * 0.5f) * OCCLUSION_BUFFER_HEIGHT));
+	rectRight = (std::min)(OCCLUSION_BUFFER_WIDTH, (int)ceilf((screenRect.z * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH));
+	rectBottom = (std::min)(OCCLUSION_BUFFER_HEIGHT, (int)ceilf((0.5f - screenRect.w * 0.5f) * OCCLUSION_BUFFER_HEIGHT));
+	fill(depth.begin(), depth.end(), 1.0f);
+	fill(tileDepth.begin(), tileDepth.end(), 1.0f);
+	occluderCount = 0;
+}
+
+void OcclusionBuffer::DrawOccluders(const XMFLOAT3* triangles, size_t triangleCount)
+{
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);	// Pixel centers
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR rectMin = XMVectorReplicate((float)rectLeft);
+	XMVECTOR rectMax = XMVectorReplicate((float)rectRight);
+
+	for (size_t t = 0; t < triangleCount; t++) {
+		XMFLOAT3 v[3];
+		if (!ProjectPoint(triangles[t * 3], vp, v[0]) || !ProjectPoint(triangles[t * 3 + 1], vp, v[1]) ||
+			!ProjectPoint(triangles[t * 3 + 2], vp, v[2])) {
+			continue;
+		}
+
+		// Edge functions, each positive on the inside of its edge once the winding is made counter clockwise on screen
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+		if (fabsf(area) < 1e-6f) {
+			continue;
+		}
+		if (area < 0) {
+			swap(v[1], v[2]);
+			area = -area;
+		}
+
+		int minX = (std::max)(rectLeft, (int)floorf((std::min)({ v[0].x, v[1].x, v[2].x })));
+		int maxX = (std::min)(rectRight - 1, (int)ceilf((std::max)({ v[0].x, v[1].x, v[2].x })));
+		int minY = (std::max)(rectTop, (int)floorf((std::min)({ v[0].y, v[1].y, v[2].y })));
+		int maxY = (std::min)(rectBottom - 1, (int)ceilf((std::max)({ v[0].y, v[1].y, v[2].y })));
+		if (minX > maxX || minY > maxY) {
+			continue;
+		}
+		minX &= ~3;
+		occluderCount++;
+
+		// edge(x, y) = a * x + b * y + c for the edge opposite each corner
+		float a[3], b[3], c[3];
+		for (int i = 0; i < 3; i++) {
+			const XMFLOAT3& p = v[(i + 1) % 3];
+			const XMFLOAT3& q = v[(i + 2) % 3];
+			a[i] = p.y - q.y;
+			b[i] = q.x - p.x;
+			c[i] = p.x * q.y - p.y * q.x;
+		}
+		// Depth is linear in screen space, so it's the corners' depths weighted by the edge functions. Perspective depths
+		// bunch up close to 1, so it's worked out as the first corner's depth plus the others' differences from it,
+		// which keeps the rounding in the edge functions from swamping the differences.
+		float invArea = 1.0f / area;
+		XMVECTOR z0 = XMVectorReplicate(v[0].z);
+		XMVECTOR z1 = XMVectorReplicate((v[1].z - v[0].z) * invArea);
+		XMVECTOR z2 = XMVectorReplicate((v[2].z - v[0].z) * invArea);
+		XMVECTOR a0 = XMVectorReplicate(a[0]), a1 = XMVectorReplicate(a[1]), a2 = XMVectorReplicate(a[2]);
+
+		for (int y = minY; y <= maxY; y++) {
+			float centerY = y + 0.5f;
+			XMVECTOR row0 = XMVectorReplicate(b[0] * centerY + c[0]);
+			XMVECTOR row1 = XMVectorReplicate(b[1] * centerY + c[1]);
+			XMVECTOR row2 = XMVectorReplicate(b[2] * centerY + c[2]);
+			float* pixels = &depth[y * OCCLUSION_BUFFER_WIDTH];
+			for (int x = minX; x <= maxX; x += 4) {
+				XMVECTOR px = XMVectorReplicate((float)x) + laneOffsets;
+				XMVECTOR e0 = a0 * px + row0;
+				XMVECTOR e1 = a1 * px + row1;
+				XMVECTOR e2 = a2 * px + row2;
+				XMVECTOR mask = XMVectorGreaterOrEqual(e0, zero);
+				mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(e1, zero));
+				mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(e2, zero));
+				mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(px, rectMin));
+				mask = XMVectorAndInt(mask, XMVectorLess(px, rectMax));
+
+				XMVECTOR z = z0 + e1 * z1 + e2 * z2;
+				XMFLOAT4* destination = (XMFLOAT4*)&pixels[x];
+				XMVECTOR old = XMLoadFloat4(destination);
+				XMStoreFloat4(destination, XMVectorSelect(old, XMVectorMin(old, z), mask));
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::Finish()
+{
+	for (int ty = 0; ty < OCCLUSION_TILES_Y; ty++) {
+		for (int tx = 0; tx < OCCLUSION_TILES_X; tx++) {
+			XMVECTOR farthest = XMVectorZero();
+			for (int y = 0; y < OCCLUSION_TILE_SIZE; y++) {
+				const float* row = &depth[(ty * OCCLUSION_TILE_SIZE + y) * OCCLUSION_BUFFER_WIDTH + tx * OCCLUSION_TILE_SIZE];
+				for (int x = 0; x < OCCLUSION_TILE_SIZE; x += 4) {
+					farthest = XMVectorMax(farthest, XMLoadFloat4((const XMFLOAT4*)&row[x]));
+				}
+			}
+			XMFLOAT4 lanes;
+			XMStoreFloat4(&lanes, farthest);
+			tileDepth[ty * OCCLUSION_TILES_X + tx] = (std::max)((std::max)(lanes.x, lanes.y), (std::max)(lanes.z, lanes.w));
+		}
+	}
+}
+
+bool OcclusionBuffer::IsVisible(const BoundingBox& box)
+{
+	if (occluderCount == 0) {
+		return true;
+	}
+
+	// Screen rectangle and nearest depth of the box's corners
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	box.GetCorners(corners);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, nearest = FLT_MAX;
+	for (size_t i = 0; i < BoundingBox::CORNER_COUNT; i++) {
+		XMFLOAT3 pixel;
+		if (!ProjectPoint(corners[i], vp, pixel)) {
+			return true;
+		}
+		minX = (std::min)(minX, pixel.x);
+		minY = (std::min)(minY, pixel.y);
+		maxX = (std::max)(maxX, pixel.x);
+		maxY = (std::max)(maxY, pixel.y);
+		nearest = (std::min)(nearest, pixel.z);
+	}
+	// Off the buffer entirely counts as visible; frustum culling decides those
+	if (maxX < 0 || maxY < 0 || minX >= OCCLUSION_BUFFER_WIDTH || minY >= OCCLUSION_BUFFER_HEIGHT) {
+		return true;
+	}
+
+	int tileLeft = (std::max)(0, (int)floorf(minX) / OCCLUSION_TILE_SIZE);
+	int tileTop = (std::max)(0, (int)floorf(minY) / OCCLUSION_TILE_SIZE);
+	int tileRight = (std::min)(OCCLUSION_TILES_X - 1, (int)floorf(maxX) / OCCLUSION_TILE_SIZE);
+	int tileBottom = (std::min)(OCCLUSION_TILES_Y - 1, (int)floorf(maxY) / OCCLUSION_TILE_SIZE);
+	for (int ty = tileTop; ty <= tileBottom; ty++) {
+		for (int tx = tileLeft; tx <= tileRight; tx++) {
+			if (nearest <= tileDepth[ty * OCCLUSION_TILES_X + tx]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+size_t OcclusionBuffer::GetOccluderCount()
+{
+	return occluderCount;
+}
+
+const float* OcclusionBuffer::GetDepth()
+{
+	return depth.data();
+}
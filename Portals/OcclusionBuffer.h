@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#define OCCLUSION_BUFFER_WIDTH 256		// Pixels. A multiple of OCCLUSION_TILE_SIZE, which is a multiple of 4.
+#define OCCLUSION_BUFFER_HEIGHT 128
+#define OCCLUSION_TILE_SIZE 8
+
+// A small depth buffer drawn on the CPU, for finding what's hidden behind big occluders (walls) before it's drawn.
+// Occluder triangles are rasterized four pixels at a time with DirectXMath vectors, keeping the nearest depth at each
+// pixel. Each tile then keeps the farthest depth in it, and a box is hidden when its nearest point is behind that
+// depth in every tile it covers.
+// Depths are the projection's z / w, the same as the GPU's depth buffer, so the view and (oblique) projection of a
+// portal view can be used as they are. Occluder triangles crossing the near plane are left out, and boxes crossing it
+// always count as visible. Nothing behind the exit portal of a portal view can hide anything, just like on the GPU.
+class OcclusionBuffer {
+public:
+	OcclusionBuffer();
+	~OcclusionBuffer();
+
+	// Clear the buffer for a new view. Only the part of the screen inside screenRect (left, top, right, bottom in
+	// normalized device coordinates) is drawn.
+	void Begin(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const DirectX::XMFLOAT4& screenRect);
+	// Rasterize world space triangles, three points each. Either winding.
+	void DrawOccluders(const DirectX::XMFLOAT3* triangles, size_t triangleCount);
+	// Work out the tile depths from the pixels. Call after the last occluder and before testing.
+	void Finish();
+
+	// False when the box is certainly hidden by the occluders
+	bool IsVisible(const DirectX::BoundingBox& box);
+	// Occluder triangles rasterized since Begin
+	size_t GetOccluderCount();
+	const float* GetDepth();
+
+private:
+	DirectX::XMFLOAT4X4 viewProjection;
+	int rectLeft, rectTop, rectRight, rectBottom;	// Pixels, right and bottom exclusive
+	size_t occluderCount = 0;
+	std::vector<float> depth;
+	std::vector<float> tileDepth;					// Farthest depth in each tile
+};
@@ -0,0 +1,44 @@
+#include "ShaderIncludes.hlsli"
+
+// Bounds the mesh's positions were quantized to
+cbuffer ExternalData : register(b0)
+{
+	float3 positionMin;
+	float3 positionExtent;
+}
+
+cbuffer PerView : register(b1)
+{
+	matrix view;
+	matrix projection;
+}
+
+// --------------------------------------------------------
+// PackedVertexShader with the per-instance data of
+// InstancedVertexShader.
+// --------------------------------------------------------
+VertexToPixel main( PackedVertexShaderInput input, InstanceInput instance )
+{
+	matrix world = InstanceMatrix(instance.world0, instance.world1, instance.world2, instance.world3);
+	matrix worldInverseTranspose = InstanceMatrix(instance.inverseTranspose0, instance.inverseTranspose1, instance.inverseTranspose2, instance.inverseTranspose3);
+
+	// Decode the vertex
+	float3 position = positionMin + input.position.xyz * positionExtent;
+	float3 normal = DecodeOctahedral(input.normal);
+	float3 tangent = DecodeOctahedral(input.tangent);
+
+	// Set up output struct
+	VertexToPixel output;
+
+	// Screen position of vertex
+	matrix wvp = mul(projection, mul(view, world));
+	output.position = mul(wvp, float4(position, 1.0f));
+	output.normal = mul((float3x3)worldInverseTranspose, normal); // mul by inverse transpose
+	output.tangent = mul((float3x3)worldInverseTranspose, tangent); // again, multiply by inverse transpose
+	output.uv = input.uv;
+	output.screenPosition = position;
+	output.worldPosition = mul(world, float4(position, 1)).xyz;
+	output.clipDistance = dot(float4(output.worldPosition, 1), instance.clipPlane);
+
+	return output;
+}
\ No newline at end of file
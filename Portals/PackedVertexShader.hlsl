@@ -0,0 +1,44 @@
+#include "ShaderIncludes.hlsli"
+
+// Same as VertexShader, plus the bounds the mesh's positions were quantized to
+cbuffer ExternalData : register(b0) 
+{ 
+	matrix world; 
+	matrix worldInverseTranspose;
+	float4 clipPlane;			// World space, (0, 0, 0, 1) keeps everything
+	float3 positionMin;
+	float3 positionExtent;
+}
+
+cbuffer PerView : register(b1)
+{
+	matrix view;
+	matrix projection;
+}
+
+// --------------------------------------------------------
+// Vertex shader for meshes uploaded as PackedVertex.
+// Decodes the vertex, then does exactly what VertexShader does.
+// --------------------------------------------------------
+VertexToPixel main( PackedVertexShaderInput input )
+{
+	// Decode the vertex
+	float3 position = positionMin + input.position.xyz * positionExtent;
+	float3 normal = DecodeOctahedral(input.normal);
+	float3 tangent = DecodeOctahedral(input.tangent);
+
+	// Set up output struct
+	VertexToPixel output;
+
+	// Screen position of vertex
+	matrix wvp = mul(projection, mul(view, world));
+	output.position = mul(wvp, float4(position, 1.0f));
+	output.normal = mul((float3x3)worldInverseTranspose, normal); // mul by inverse transpose
+	output.tangent = mul((float3x3)worldInverseTranspose, tangent); // again, multiply by inverse transpose
+	output.uv = input.uv;
+	output.screenPosition = position;
+	output.worldPosition = mul(world, float4(position, 1)).xyz;
+	output.clipDistance = dot(float4(output.worldPosition, 1), clipPlane);
+
+	return output;
+}
@@ -0,0 +1,285 @@
+#include "PhysicsWorld.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+// How far a portal can sit in front of a collider and still count as being on it
+#define PHYSICS_PORTAL_SURFACE_MARGIN 0.05f
+// Portals a body can pass through in a single step
+#define PHYSICS_MAX_PORTAL_CROSSINGS 4
+// Slower impacts than this don't bounce, so resting bodies settle instead of jittering
+#define PHYSICS_REST_SPEED 0.5f
+// Fast bodies split a step into pieces no longer than their smallest half extent, up to this many, so they can't
+// skip over thin walls
+#define PHYSICS_MAX_SUBSTEPS 16
+
+PhysicsWorld::PhysicsWorld(float stepsPerSecond)
+{
+	stepTime = 1.0f / stepsPerSecond;
+}
+
+PhysicsWorld::~PhysicsWorld()
+{
+}
+
+void PhysicsWorld::AddBody(Entity* entity, int shape)
+{
+	AddBody(entity, shape, false);
+	traversal.Add(entity);
+}
+
+void PhysicsWorld::AddKinematic(Entity* entity)
+{
+	AddBody(entity, PHYSICS_SHAPE_BOX, true);
+}
+
+void PhysicsWorld::AddBody(Entity* entity, int shape, bool kinematic)
+{
+	Transform* transform = entity->GetTransform();
+	XMFLOAT3 localMin = entity->GetMesh()->GetLocalMin();
+	XMFLOAT3 localMax = entity->GetMesh()->GetLocalMax();
+	XMFLOAT3 scale = transform->GetScale();
+
+	Body body;
+	body.entity = entity;
+	body.shape = shape;
+	body.kinematic = kinematic;
+	body.halfExtents = XMFLOAT3(
+		fabsf((localMax.x - localMin.x) * scale.x) / 2,
+		fabsf((localMax.y - localMin.y) * scale.y) / 2,
+		fabsf((localMax.z - localMin.z) * scale.z) / 2);
+	body.centerOffset = XMFLOAT3(
+		(localMax.x + localMin.x) * scale.x / 2,
+		(localMax.y + localMin.y) * scale.y / 2,
+		(localMax.z + localMin.z) * scale.z / 2);
+	body.position = transform->GetPosition();
+	body.previousPosition = body.position;
+	bodies.push_back(body);
+}
+
+void PhysicsWorld::AddStatic(Entity* entity)
+{
+	// World box around the mesh bounds
+	BoundingBox box = entity->GetBoundingBox();
+	XMFLOAT3 center = box.Center;
+	XMFLOAT3 extents = box.Extents;
+
+	StaticCollider collider;
+	collider.entity = entity;
+	collider.boundsMin = XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+	collider.boundsMax = XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+	colliders.push_back(collider);
+}
+
+void PhysicsWorld::Remove(Entity* entity)
+{
+	bodies.erase(remove_if(bodies.begin(), bodies.end(),
+		[entity](const Body& body) { return body.entity == entity; }),
+		bodies.end());
+	colliders.erase(remove_if(colliders.begin(), colliders.end(),
+		[entity](const StaticCollider& collider) { return collider.entity == entity; }),
+		colliders.end());
+	traversal.Remove(entity->GetTransform());
+}
+
+size_t PhysicsWorld::GetBodyCount()
+{
+	return bodies.size();
+}
+
+float PhysicsWorld::GetStepTime()
+{
+	return stepTime;
+}
+
+float PhysicsWorld::GetSimulationTime()
+{
+	return simulationTime;
+}
+
+void PhysicsWorld::SetGravity(DirectX::XMFLOAT3 gravity)
+{
+	this->gravity = gravity;
+}
+
+const PortalStraddle* PhysicsWorld::FindStraddle(Entity* entity)
+{
+	return traversal.FindStraddle(entity);
+}
+
+void PhysicsWorld::Update(float deltaTime, const std::vector<Portal*>& portals, const std::function<void(float, float)>& onStep)
+{
+	// Put the transforms back to where the simulation left them, undoing last frame's blend
+	for (Body& body : bodies) {
+		body.entity->GetTransform()->SetPosition(body.position.x, body.position.y, body.position.z);
+	}
+
+	// After a long stall, drop the time that can't be caught up on instead of running ever more steps
+	accumulator = (std::min)(accumulator + deltaTime, stepTime * maxStepsPerUpdate);
+	while (accumulator >= stepTime) {
+		if (onStep) {
+			onStep(stepTime, simulationTime);
+		}
+		Step(portals);
+		accumulator -= stepTime;
+	}
+
+	// Draw the bodies part of the way from the previous step to the latest one
+	float alpha = accumulator / stepTime;
+	for (Body& body : bodies) {
+		XMFLOAT3 blended;
+		XMStoreFloat3(&blended, XMVectorLerp(XMLoadFloat3(&body.previousPosition), XMLoadFloat3(&body.position), alpha));
+		body.entity->GetTransform()->SetPosition(blended.x, blended.y, blended.z);
+	}
+}
+
+void PhysicsWorld::Step(const std::vector<Portal*>& portals)
+{
+	// Open portals, and the collider each one sits on
+	openPortals.clear();
+	portalColliders.clear();
+	for (Portal* portal : portals) {
+		if (portal->GetDestination() == nullptr) {
+			continue;
+		}
+		PortalMath::PortalFrame frame = portal->GetFrame();
+		int onCollider = -1;
+		for (size_t c = 0; c < colliders.size() && onCollider < 0; c++) {
+			const StaticCollider& collider = colliders[c];
+			if (frame.position.x >= collider.boundsMin.x - PHYSICS_PORTAL_SURFACE_MARGIN && frame.position.x <= collider.boundsMax.x + PHYSICS_PORTAL_SURFACE_MARGIN &&
+				frame.position.y >= collider.boundsMin.y - PHYSICS_PORTAL_SURFACE_MARGIN && frame.position.y <= collider.boundsMax.y + PHYSICS_PORTAL_SURFACE_MARGIN &&
+				frame.position.z >= collider.boundsMin.z - PHYSICS_PORTAL_SURFACE_MARGIN && frame.position.z <= collider.boundsMax.z + PHYSICS_PORTAL_SURFACE_MARGIN) {
+				onCollider = (int)c;
+			}
+		}
+		openPortals.push_back(frame);
+		portalColliders.push_back(onCollider);
+	}
+
+	for (Body& body : bodies) {
+		body.previousPosition = body.position;
+		Transform* transform = body.entity->GetTransform();
+		if (body.kinematic) {
+			body.position = transform->GetPosition();
+			continue;
+		}
+
+		// Semi-implicit Euler
+		XMFLOAT3 velocity = body.entity->GetVelocity();
+		XMFLOAT3 position = body.position;
+		XMStoreFloat3(&velocity, XMLoadFloat3(&velocity) + XMLoadFloat3(&gravity) * stepTime);
+
+		float smallest = (std::max)((std::min)(body.halfExtents.x, (std::min)(body.halfExtents.y, body.halfExtents.z)), 0.01f);
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&velocity))) * stepTime;
+		int substeps = (std::min)((int)ceilf(distance / smallest), PHYSICS_MAX_SUBSTEPS);
+		substeps = (std::max)(substeps, 1);
+		float substepTime = stepTime / substeps;
+
+		for (int s = 0; s < substeps; s++) {
+			XMFLOAT3 from = position;
+			XMStoreFloat3(&position, XMLoadFloat3(&position) + XMLoadFloat3(&velocity) * substepTime);
+			for (size_t c = 0; c < colliders.size(); c++) {
+				if (!PassesThroughPortal(body, (int)c, from, position)) {
+					Collide(body, colliders[c], substepTime, position, velocity);
+				}
+			}
+		}
+
+		body.position = position;
+		transform->SetPosition(position.x, position.y, position.z);
+		body.entity->SetVelocity(velocity);
+	}
+
+	// Carry bodies whose center went through a portal this step over to the other side
+	traversal.Update(portals, PHYSICS_MAX_PORTAL_CROSSINGS);
+	for (Body& body : bodies) {
+		XMFLOAT3 position = body.entity->GetTransform()->GetPosition();
+		if (!body.kinematic && (position.x != body.position.x || position.y != body.position.y || position.z != body.position.z)) {
+			// Teleported, so don't blend from one side of the portal to the other
+			body.position = position;
+			body.previousPosition = position;
+		}
+	}
+
+	simulationTime += stepTime;
+}
+
+bool PhysicsWorld::PassesThroughPortal(const Body& body, int collider, const XMFLOAT3& from, const XMFLOAT3& to)
+{
+	XMFLOAT3 start(from.x + body.centerOffset.x, from.y + body.centerOffset.y, from.z + body.centerOffset.z);
+	XMFLOAT3 end(to.x + body.centerOffset.x, to.y + body.centerOffset.y, to.z + body.centerOffset.z);
+	float reach = (std::max)(body.halfExtents.x, (std::max)(body.halfExtents.y, body.halfExtents.z)) + PHYSICS_PORTAL_SURFACE_MARGIN;
+
+	for (size_t p = 0; p < openPortals.size(); p++) {
+		const PortalMath::PortalFrame& frame = openPortals[p];
+		if (portalColliders[p] != collider || !PortalMath::InOpening(frame, end, reach)) {
+			continue;
+		}
+		// Near the opening is enough, unless this move goes through the plane outside the outline
+		float t;
+		bool crossesPlane = PortalMath::SignedDistance(frame, start) >= 0 && PortalMath::SignedDistance(frame, end) < 0;
+		if (!crossesPlane || PortalMath::SweptCrossing(frame, start, end, t)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PhysicsWorld::Collide(const Body& body, const StaticCollider& collider, float deltaTime, XMFLOAT3& position, XMFLOAT3& velocity)
+{
+	XMVECTOR center = XMLoadFloat3(&position) + XMLoadFloat3(&body.centerOffset);
+	XMVECTOR boundsMin = XMLoadFloat3(&collider.boundsMin);
+	XMVECTOR boundsMax = XMLoadFloat3(&collider.boundsMax);
+	XMVECTOR normal;
+	float penetration;
+
+	float radius = (std::max)(body.halfExtents.x, (std::max)(body.halfExtents.y, body.halfExtents.z));
+	XMVECTOR toCenter = center - XMVectorClamp(center, boundsMin, boundsMax);
+	float distSq = XMVectorGetX(XMVector3LengthSq(toCenter));
+	if (body.shape == PHYSICS_SHAPE_SPHERE && distSq > 1e-12f) {
+		// Sphere outside the box: push away from the closest point on it
+		if (distSq >= radius * radius) {
+			return false;
+		}
+		float dist = sqrtf(distSq);
+		normal = toCenter / dist;
+		penetration = radius - dist;
+	}
+	else {
+		// Box, or a sphere whose center is inside the box: push out along the axis with the least overlap
+		XMFLOAT3 half = body.shape == PHYSICS_SHAPE_SPHERE ? XMFLOAT3(radius, radius, radius) : body.halfExtents;
+		XMFLOAT3 offset;
+		XMFLOAT3 overlap;
+		XMStoreFloat3(&offset, center - (boundsMin + boundsMax) * 0.5f);
+		XMStoreFloat3(&overlap, XMLoadFloat3(&half) + (boundsMax - boundsMin) * 0.5f - XMVectorAbs(XMLoadFloat3(&offset)));
+		if (overlap.x <= 0 || overlap.y <= 0 || overlap.z <= 0) {
+			return false;
+		}
+		if (overlap.x <= overlap.y && overlap.x <= overlap.z) {
+			normal = XMVectorSet(offset.x < 0 ? -1.0f : 1.0f, 0, 0, 0);
+			penetration = overlap.x;
+		}
+		else if (overlap.y <= overlap.z) {
+			normal = XMVectorSet(0, offset.y < 0 ? -1.0f : 1.0f, 0, 0);
+			penetration = overlap.y;
+		}
+		else {
+			normal = XMVectorSet(0, 0, offset.z < 0 ? -1.0f : 1.0f, 0);
+			penetration = overlap.z;
+		}
+	}
+
+	XMStoreFloat3(&position, XMLoadFloat3(&position) + normal * penetration);
+
+	// Bounce off the surface, and slide along it with some friction
+	XMVECTOR v = XMLoadFloat3(&velocity);
+	float intoSurface = XMVectorGetX(XMVector3Dot(v, normal));
+	XMVECTOR normalPart = normal * (std::min)(intoSurface, 0.0f);
+	XMVECTOR tangentPart = v - normal * intoSurface;
+	float bounce = intoSurface < -PHYSICS_REST_SPEED ? restitution : 0.0f;
+	v = v - normalPart * (1 + bounce) - tangentPart * (std::min)(friction * deltaTime, 1.0f);
+	XMStoreFloat3(&velocity, v);
+	return true;
+}
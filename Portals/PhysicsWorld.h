@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <DirectXMath.h>
+#include "Entity.h"
+#include "Portal.h"
+#include "PortalTraversal.h"
+
+// Collision shapes for rigid bodies
+#define PHYSICS_SHAPE_SPHERE 0		// Radius is the largest half extent of the scaled mesh bounds
+#define PHYSICS_SHAPE_BOX 1			// The scaled mesh bounds, kept axis aligned (the body's rotation is ignored)
+
+// Fixed timestep rigid body simulation. Game code hands it the variable frame time, and it advances in whole steps of
+// the same length, so the outcome of a run depends only on the inputs and never on the frame rate. Between steps the
+// entities' transforms are set to a blend of the last two steps so motion still looks smooth at any frame rate.
+// Bodies fall under gravity, bounce off static colliders (axis aligned boxes around walls and floors) and pass through
+// portals. A static collider with an open portal on it is ignored by bodies inside the portal's outline.
+class PhysicsWorld {
+public:
+	PhysicsWorld(float stepsPerSecond = 120.0f);
+	~PhysicsWorld();
+
+	// Integrated and collided every step. The entity's velocity is the body's velocity.
+	void AddBody(Entity* entity, int shape);
+	// Moved by game code during the step callback, and interpolated like the other bodies
+	void AddKinematic(Entity* entity);
+	// Never moves. The box is computed once, here.
+	void AddStatic(Entity* entity);
+	void Remove(Entity* entity);
+	size_t GetBodyCount();
+
+	// Run as many whole steps as deltaTime (plus what was left over last frame) covers, then interpolate the
+	// transforms. onStep runs at the start of each step, with the step length and the simulation time, to move
+	// kinematic bodies.
+	void Update(float deltaTime, const std::vector<Portal*>& portals, const std::function<void(float, float)>& onStep);
+	// A single step, with no interpolation. Deterministic for the same bodies, portals and starting state.
+	void Step(const std::vector<Portal*>& portals);
+
+	float GetStepTime();
+	float GetSimulationTime();
+	void SetGravity(DirectX::XMFLOAT3 gravity);
+	// Entities found part way through a portal by the last step
+	const PortalStraddle* FindStraddle(Entity* entity);
+
+private:
+	struct Body {
+		Entity* entity;
+		int shape;
+		bool kinematic;
+		DirectX::XMFLOAT3 halfExtents;		// Of the scaled mesh bounds, also used for the sphere radius
+		DirectX::XMFLOAT3 centerOffset;		// From the transform's position to the center of the mesh bounds
+		DirectX::XMFLOAT3 position;			// At the end of the last step
+		DirectX::XMFLOAT3 previousPosition;	// At the end of the step before, blended with position for drawing
+	};
+
+	struct StaticCollider {
+		Entity* entity;
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+	};
+
+	void AddBody(Entity* entity, int shape, bool kinematic);
+	// Is the body's center moving through an open portal on the collider, so it shouldn't collide with it?
+	bool PassesThroughPortal(const Body& body, int collider, const DirectX::XMFLOAT3& from, const DirectX::XMFLOAT3& to);
+	// Push the body out of the collider and remove the velocity into it, with friction for a contact lasting deltaTime
+	// (the substep). Returns false if they don't touch.
+	bool Collide(const Body& body, const StaticCollider& collider, float deltaTime, DirectX::XMFLOAT3& position, DirectX::XMFLOAT3& velocity);
+
+	std::vector<Body> bodies;
+	std::vector<StaticCollider> colliders;
+	PortalTraversal traversal;
+
+	float stepTime;
+	float accumulator = 0;
+	float simulationTime = 0;
+	int maxStepsPerUpdate = 8;				// Beyond this the simulation slows down rather than falling further behind
+	DirectX::XMFLOAT3 gravity = DirectX::XMFLOAT3(0, -9.8f, 0);
+	float restitution = 0.3f;				// Fraction of the speed into a surface kept after bouncing off it
+	float friction = 2.0f;					// Fraction of the speed along a surface lost per second while touching it
+
+	// Working set, reused between steps
+	std::vector<PortalMath::PortalFrame> openPortals;
+	std::vector<int> portalColliders;		// Collider each open portal sits on, -1 if none
+};
@@ -16,35 +16,17 @@ Portal::~Portal()
 {
 }
 
-void Portal::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition) {
-	materialPtr->PrepareMaterial(&transform, viewMat, projMat, cameraPosition);
-
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, meshPtr->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(meshPtr->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	context->DrawIndexed(
-		meshPtr->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+void Portal::Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition) {
+	materialPtr->PrepareMaterial(commands, &transform, viewMat, projMat, cameraPosition);
+	meshPtr->Draw(commands);
 }
-void Portal::UnbindPSAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition)
+void Portal::UnbindPSAndDraw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition)
 {
 	// Unbind pixel shader
-	SimplePixelShader* shader = this->materialPtr->GetPixelShader();
+	RenderShader* shader = this->materialPtr->GetPixelShader();
 	this->GetMaterial()->SetPixelShader(NULL);
-	context->PSSetShader(NULL, NULL, 0);
-	materialPtr->PrepareMaterial(&transform, viewMat, projMat, cameraPosition);
-
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, meshPtr->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(meshPtr->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
-	context->DrawIndexed(
-		meshPtr->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+	materialPtr->PrepareMaterial(commands, &transform, viewMat, projMat, cameraPosition);
+	meshPtr->Draw(commands);
 
 	// Rebind pixel shader
 	this->GetMaterial()->SetPixelShader(shader);
@@ -62,64 +44,35 @@ Material* Portal::GetMaterial()
 }
 
 // Set the near plane to be mesh with the surface of the portal, while adjusting remaining sides for optimal viewing frustum.
-// http://www.terathon.com/lengyel/Lengyel-Oblique.pdf
-// http://www.terathon.com/code/oblique.html
-// http://perry.cz/articles/ProjectionMatrix.xhtml
-// https://gamedev.net/forums/topic/398719-oblique-frustum-clipping/3644560/
+// See PortalMath::ObliqueProjection for the details.
 DirectX::XMFLOAT4X4 Portal::ClippedProjectionMatrix(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat)
 {
-    Transform* t = this->GetTransform();
-    XMFLOAT3 pos = t->GetPosition();
-    XMVECTOR worldPos = XMLoadFloat3(&pos);
-    XMFLOAT3 rot = t->GetPitchYawRoll();
-
-    // 1. Calculate the World Space Normal of the portal
     // We assume the portal's "forward" face is the Z-axis (0, 0, 1)
-    XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rot.x, rot.y, rot.z);
-    XMVECTOR worldNormal = XMVector3TransformNormal(XMVectorSet(0, 0, 1, 0), rotationMatrix);
-
-    // 2. Transform the Portal Position and Normal into View Space
-    XMMATRIX mViewMat = XMLoadFloat4x4(&viewMat);
-    XMVECTOR viewPos = XMVector3TransformCoord(worldPos, mViewMat);
-    XMVECTOR viewNormal = XMVector3TransformNormal(worldNormal, mViewMat);
-
-    // Normalize to be safe
-    viewNormal = XMVector3Normalize(viewNormal);
-
-    // 3. Construct the Plane Equation in View Space: Ax + By + Cz + w = 0
-    // w is the negative dot product of the normal and a point on the plane
-    float w = -XMVectorGetX(XMVector3Dot(viewNormal, viewPos));
-
-    // Small epsilon to prevent "Z-fighting" or accidental clipping of the portal surface itself
-    w -= 0.01f;
-
-    XMVECTOR xmClipPlane = XMVectorSet(XMVectorGetX(viewNormal), XMVectorGetY(viewNormal), XMVectorGetZ(viewNormal), w);
-
-    // 4. Calculate the "q" vector (the far-corner of the frustum opposite the clipping plane)
-    // This is used to scale the clip plane so it replaces the near plane perfectly.
-    // Note: projMat._31, _32, etc. assumes standard DirectX column-major access.
-    XMVECTOR q = XMVectorSet(
-        (Sign(XMVectorGetX(xmClipPlane)) + projMat._31) / projMat._11,
-        (Sign(XMVectorGetY(xmClipPlane)) + projMat._32) / projMat._22,
-        1.0f,
-        (1.0f + projMat._33) / projMat._43
-    );
-
-    // 5. Scale the clip plane
-    XMVECTOR xmDot = XMVector4Dot(xmClipPlane, q);
-    XMVECTOR scaledPlane = xmClipPlane * (2.0f / XMVectorGetX(xmDot));
-
-    // 6. Replace the third column of the projection matrix with our new plane
-    XMFLOAT4 c;
-    XMStoreFloat4(&c, scaledPlane);
+    return PortalMath::ObliqueProjection(viewMat, projMat, transform.GetPosition(), transform.GetForward());
+}
 
-    XMFLOAT4X4 newProj = projMat;
-    newProj._13 = c.x;
-    newProj._23 = c.y;
-    newProj._33 = c.z;
-    newProj._43 = c.w;
+// Project the portal through the given view and projection, and output the pixel rectangle it covers.
+// Returns false when the portal can't be seen: it is behind the camera, behind the oblique near plane of the
+// portal we are looking through, or facing away from the viewer.
+bool Portal::GetScreenRect(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, float screenWidth, float screenHeight, PortalMath::ScreenRect& outRect)
+{
+    XMFLOAT4X4 worldMat = transform.GetWorldMatrix();
+    XMFLOAT4X4 wvp;
+    XMStoreFloat4x4(&wvp, XMLoadFloat4x4(&worldMat) * XMLoadFloat4x4(&viewMat) * XMLoadFloat4x4(&projMat));
+    return PortalMath::ProjectPortalQuad(wvp, screenWidth, screenHeight, outRect);
+}
 
-    return newProj;
+// Position and axes of the portal for crossing and teleport tests
+PortalMath::PortalFrame Portal::GetFrame()
+{
+    PortalMath::PortalFrame frame;
+    frame.position = transform.GetPosition();
+    frame.right = transform.GetRight();
+    frame.up = transform.GetUp();
+    frame.forward = transform.GetForward();
+    XMFLOAT3 scale = transform.GetScale();
+    frame.halfExtents = XMFLOAT2(scale.x, scale.y);
+    return frame;
 }
 
 // Old, broken version of the oblique clipped projection matrix calculation.
@@ -194,3 +147,30 @@ XMFLOAT3 Portal::GetBorderColor()
 {
 	return borderColor;
 }
+
+void Portal::SetCache(RenderHandle texture, XMFLOAT4X4 viewProj)
+{
+	cacheTexture = texture;
+	cacheViewProj = viewProj;
+	cacheValid = true;
+}
+
+void Portal::InvalidateCache()
+{
+	cacheValid = false;
+}
+
+bool Portal::HasValidCache()
+{
+	return cacheValid;
+}
+
+RenderHandle Portal::GetCache()
+{
+	return cacheTexture;
+}
+
+XMFLOAT4X4 Portal::GetCacheViewProj()
+{
+	return cacheViewProj;
+}
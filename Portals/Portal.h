@@ -2,15 +2,17 @@
 #include <DirectXMath.h>
 #include "Transform.h"
 #include "Mesh.h"
-#include "Camera.h"
 #include "Material.h"
 #include "Entity.h"
+#include "PortalMath.h"
 class Portal{
 public:
     Portal(Mesh* mesh, Material* mat, int id, XMFLOAT3 borderColor);
     ~Portal();
 
     DirectX::XMFLOAT4X4 ClippedProjectionMatrix(DirectX::XMFLOAT4X4 viewMat, DirectX::XMFLOAT4X4 projMat);
+    bool GetScreenRect(DirectX::XMFLOAT4X4 viewMat, DirectX::XMFLOAT4X4 projMat, float screenWidth, float screenHeight, PortalMath::ScreenRect& outRect);
+    PortalMath::PortalFrame GetFrame();
     Portal* GetDestination();
     void SetDestination(Portal* dest);
 
@@ -18,17 +20,30 @@ public:
     Mesh* GetMesh();
     Transform* GetTransform();
     Material* GetMaterial();
-    void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
-    void UnbindPSAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
+    void Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
+    void UnbindPSAndDraw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition);
     float Sign(float num);
     int GetId();
     XMFLOAT3 GetBorderColor();
 
+    // Cached view through this portal, copied from the back buffer at the end of the previous frame. The texture is
+    // the backend's, and viewProj is the camera's when it was copied, so later frames can reproject into it.
+    void SetCache(RenderHandle texture, DirectX::XMFLOAT4X4 viewProj);
+    void InvalidateCache();
+    bool HasValidCache();
+    RenderHandle GetCache();
+    DirectX::XMFLOAT4X4 GetCacheViewProj();
+
 private:
-    Portal* destination;
+    Portal* destination = nullptr;
     Transform transform;
     Mesh* meshPtr;
     Material* materialPtr;
     int id;
     XMFLOAT3 borderColor;
+
+    // Portal cache
+    RenderHandle cacheTexture = nullptr;
+    DirectX::XMFLOAT4X4 cacheViewProj;
+    bool cacheValid = false;
 };
@@ -0,0 +1,258 @@
+#include "PortalMath.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace PortalMath
+{
+    static float Sign(float num)
+    {
+        if (num > 0) return 1;
+        else if (num < 0) return -1;
+        return 0;
+    }
+
+    // Set the near plane to be mesh with the surface of the portal, while adjusting remaining sides for optimal viewing frustum.
+    // http://www.terathon.com/lengyel/Lengyel-Oblique.pdf
+    // http://www.terathon.com/code/oblique.html
+    XMFLOAT4X4 ObliqueProjection(const XMFLOAT4X4& viewMat, const XMFLOAT4X4& projMat,
+        const XMFLOAT3& planePoint, const XMFLOAT3& planeNormal, float planeOffset)
+    {
+        // Transform the plane into view space
+        XMMATRIX mViewMat = XMLoadFloat4x4(&viewMat);
+        XMVECTOR viewPos = XMVector3TransformCoord(XMLoadFloat3(&planePoint), mViewMat);
+        XMVECTOR viewNormal = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&planeNormal), mViewMat));
+
+        // Plane equation in view space: Ax + By + Cz + w = 0, pushed back slightly so the portal surface isn't clipped
+        float w = -XMVectorGetX(XMVector3Dot(viewNormal, viewPos)) - planeOffset;
+        XMVECTOR clipPlane = XMVectorSetW(viewNormal, w);
+
+        // The far corner of the frustum opposite the clip plane, used to scale the plane so it replaces the near plane
+        XMVECTOR q = XMVectorSet(
+            (Sign(XMVectorGetX(clipPlane)) + projMat._31) / projMat._11,
+            (Sign(XMVectorGetY(clipPlane)) + projMat._32) / projMat._22,
+            1.0f,
+            (1.0f + projMat._33) / projMat._43
+        );
+        XMVECTOR scaledPlane = clipPlane * (2.0f / XMVectorGetX(XMVector4Dot(clipPlane, q)));
+
+        // Replace the third column of the projection matrix with the new plane
+        XMFLOAT4 c;
+        XMStoreFloat4(&c, scaledPlane);
+        XMFLOAT4X4 newProj = projMat;
+        newProj._13 = c.x;
+        newProj._23 = c.y;
+        newProj._33 = c.z;
+        newProj._43 = c.w;
+        return newProj;
+    }
+
+    // Into the source portal's local space, turned around to face out the other side, then out of the destination
+    XMFLOAT4X4 SourceToDestination(const XMFLOAT4X4& sourceWorld, const XMFLOAT4X4& destWorld)
+    {
+        XMMATRIX m = XMMatrixInverse(0, XMLoadFloat4x4(&sourceWorld))
+            * XMMatrixRotationY(XM_PI)
+            * XMLoadFloat4x4(&destWorld);
+        XMFLOAT4X4 result;
+        XMStoreFloat4x4(&result, m);
+        return result;
+    }
+
+    // The virtual camera sees the world around the destination as if it were placed around the source,
+    // so the destination side is moved over to the source before applying the real view.
+    XMFLOAT4X4 PortalViewMatrix(const XMFLOAT4X4& viewMat, const XMFLOAT4X4& sourceWorld, const XMFLOAT4X4& destWorld)
+    {
+        XMMATRIX m = XMMatrixInverse(0, XMLoadFloat4x4(&destWorld))
+            * XMMatrixRotationY(XM_PI)
+            * XMLoadFloat4x4(&sourceWorld)
+            * XMLoadFloat4x4(&viewMat);
+        XMFLOAT4X4 result;
+        XMStoreFloat4x4(&result, m);
+        return result;
+    }
+
+    XMFLOAT3 TransformPoint(const XMFLOAT3& point, const XMFLOAT4X4& matrix)
+    {
+        XMFLOAT3 result;
+        XMStoreFloat3(&result, XMVector3TransformCoord(XMLoadFloat3(&point), XMLoadFloat4x4(&matrix)));
+        return result;
+    }
+
+    // Clip a homogeneous polygon against a single clip-space plane (Sutherland-Hodgman).
+    // Plane 0 keeps points in front of the camera (w > epsilon), plane 1 keeps points in front
+    // of the (possibly oblique) near plane (z >= 0). Returns the number of vertices written to out.
+    static int ClipPolygon(const XMFLOAT4* in, int count, XMFLOAT4* out, int plane)
+    {
+        const float epsilon = 0.0001f;
+        int outCount = 0;
+        for (int i = 0; i < count; i++) {
+            const XMFLOAT4& a = in[i];
+            const XMFLOAT4& b = in[(i + 1) % count];
+            float da = plane == 0 ? a.w - epsilon : a.z;
+            float db = plane == 0 ? b.w - epsilon : b.z;
+            if (da >= 0) out[outCount++] = a;
+            // Edge crosses the plane, emit the intersection point
+            if ((da >= 0) != (db >= 0)) {
+                float t = da / (da - db);
+                out[outCount++] = XMFLOAT4(
+                    a.x + (b.x - a.x) * t,
+                    a.y + (b.y - a.y) * t,
+                    a.z + (b.z - a.z) * t,
+                    a.w + (b.w - a.w) * t);
+            }
+        }
+        return outCount;
+    }
+
+    bool ProjectPortalQuad(const XMFLOAT4X4& worldViewProj, float screenWidth, float screenHeight, ScreenRect& outRect)
+    {
+        XMMATRIX wvp = XMLoadFloat4x4(&worldViewProj);
+
+        // The portal mesh lies within the unit square of its local XY plane.
+        // Corners are listed with the same winding as the mesh's triangles.
+        const XMFLOAT2 localCorners[4] = { XMFLOAT2(-1, -1), XMFLOAT2(1, -1), XMFLOAT2(1, 1), XMFLOAT2(-1, 1) };
+        XMFLOAT4 polygon[8];
+        XMFLOAT4 clipped[8];
+        for (int i = 0; i < 4; i++) {
+            XMStoreFloat4(&polygon[i], XMVector4Transform(XMVectorSet(localCorners[i].x, localCorners[i].y, 0, 1), wvp));
+        }
+        int count = ClipPolygon(polygon, 4, clipped, 0);
+        count = ClipPolygon(clipped, count, polygon, 1);
+        if (count < 3) return false;
+
+        // Convert to pixel coordinates and accumulate the bounds and signed area
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+        XMFLOAT2 pixels[8];
+        for (int i = 0; i < count; i++) {
+            pixels[i].x = (polygon[i].x / polygon[i].w * 0.5f + 0.5f) * screenWidth;
+            pixels[i].y = (0.5f - polygon[i].y / polygon[i].w * 0.5f) * screenHeight;
+            minX = (std::min)(minX, pixels[i].x);
+            minY = (std::min)(minY, pixels[i].y);
+            maxX = (std::max)(maxX, pixels[i].x);
+            maxY = (std::max)(maxY, pixels[i].y);
+        }
+        float area = 0;
+        for (int i = 0; i < count; i++) {
+            const XMFLOAT2& a = pixels[i];
+            const XMFLOAT2& b = pixels[(i + 1) % count];
+            area += a.x * b.y - b.x * a.y;
+        }
+        // Front faces are clockwise on screen, which gives a positive area with y pointing down.
+        // Back facing portals never write to the stencil buffer, so there is nothing to draw through them.
+        if (area <= 0) return false;
+
+        outRect.left = (long)std::floor((std::max)(minX, 0.0f));
+        outRect.top = (long)std::floor((std::max)(minY, 0.0f));
+        outRect.right = (long)std::ceil((std::min)(maxX, screenWidth));
+        outRect.bottom = (long)std::ceil((std::min)(maxY, screenHeight));
+        return outRect.left < outRect.right && outRect.top < outRect.bottom;
+    }
+
+    float SignedDistance(const PortalFrame& frame, const XMFLOAT3& point)
+    {
+        XMVECTOR diff = XMLoadFloat3(&point) - XMLoadFloat3(&frame.position);
+        return XMVectorGetX(XMVector3Dot(diff, XMLoadFloat3(&frame.forward)));
+    }
+
+    float PlanarDistance(const PortalFrame& frame, const XMFLOAT3& point)
+    {
+        // Project the offset onto the portal plane's axes, and take the length of that projection
+        XMVECTOR diff = XMLoadFloat3(&point) - XMLoadFloat3(&frame.position);
+        XMVECTOR right = XMLoadFloat3(&frame.right);
+        XMVECTOR up = XMLoadFloat3(&frame.up);
+        XMVECTOR planeProj = right * XMVector3Dot(diff, right) + up * XMVector3Dot(diff, up);
+        return XMVectorGetX(XMVector3Length(planeProj));
+    }
+
+    XMFLOAT4 PortalPlane(const PortalFrame& frame)
+    {
+        XMVECTOR normal = XMLoadFloat3(&frame.forward);
+        float d = -XMVectorGetX(XMVector3Dot(normal, XMLoadFloat3(&frame.position)));
+        return XMFLOAT4(frame.forward.x, frame.forward.y, frame.forward.z, d);
+    }
+
+    XMFLOAT3 TeleportPitchYawRoll(const XMFLOAT3& pitchYawRoll, const XMFLOAT4X4& sourceToDestination, bool upright)
+    {
+        // Rotation part of the portal to portal matrix, without any difference in scale between the portals
+        XMMATRIX m = XMLoadFloat4x4(&sourceToDestination);
+        XMMATRIX portalRot(
+            XMVector3Normalize(m.r[0]),
+            XMVector3Normalize(m.r[1]),
+            XMVector3Normalize(m.r[2]),
+            XMVectorSet(0, 0, 0, 1));
+        if (upright) {
+            XMFLOAT3 forward;
+            XMStoreFloat3(&forward, portalRot.r[2]);
+            return XMFLOAT3(pitchYawRoll.x, pitchYawRoll.y + atan2f(forward.x, forward.z), pitchYawRoll.z);
+        }
+
+        XMFLOAT4X4 r;
+        XMStoreFloat4x4(&r, XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)) * portalRot);
+
+        // Pull the angles back out, undoing DirectXMath's roll, pitch, yaw order
+        float pitch = asinf((std::max)(-1.0f, (std::min)(1.0f, -r._32)));
+        if (r._31 * r._31 + r._33 * r._33 > 1e-12f) {
+            return XMFLOAT3(pitch, atan2f(r._31, r._33), atan2f(r._12, r._22));
+        }
+        // Facing straight up or down, yaw and roll turn about the same axis, so it all goes into yaw
+        return XMFLOAT3(pitch, atan2f(-r._13, r._11), 0);
+    }
+
+    bool SweptCrossing(const PortalFrame& frame, const XMFLOAT3& start, const XMFLOAT3& end, float& outTime)
+    {
+        // Has to start on or in front of the plane and finish behind it
+        float startDist = SignedDistance(frame, start);
+        float endDist = SignedDistance(frame, end);
+        if (startDist < 0 || endDist >= 0) {
+            return false;
+        }
+
+        float t = startDist / (startDist - endDist);
+        XMVECTOR hit = XMVectorLerp(XMLoadFloat3(&start), XMLoadFloat3(&end), t);
+
+        // The portal mesh is a unit circle, so after scaling it's an ellipse in the right/up plane
+        XMVECTOR diff = hit - XMLoadFloat3(&frame.position);
+        float x = XMVectorGetX(XMVector3Dot(diff, XMLoadFloat3(&frame.right))) / frame.halfExtents.x;
+        float y = XMVectorGetX(XMVector3Dot(diff, XMLoadFloat3(&frame.up))) / frame.halfExtents.y;
+        if (x * x + y * y > 1) {
+            return false;
+        }
+
+        outTime = t;
+        return true;
+    }
+
+    bool Straddles(const PortalFrame& frame, const XMFLOAT3& center, const XMFLOAT3& extents)
+    {
+        XMVECTOR diff = XMLoadFloat3(&center) - XMLoadFloat3(&frame.position);
+        XMVECTOR boxExtents = XMLoadFloat3(&extents);
+
+        // The box reaches across the plane, but its center hasn't gone through yet
+        XMVECTOR forward = XMLoadFloat3(&frame.forward);
+        float dist = XMVectorGetX(XMVector3Dot(diff, forward));
+        float reach = XMVectorGetX(XMVector3Dot(boxExtents, XMVectorAbs(forward)));
+        if (dist < 0 || dist >= reach) {
+            return false;
+        }
+
+        // and overlaps the ellipse, grown by the box's reach along each portal axis
+        XMVECTOR right = XMLoadFloat3(&frame.right);
+        XMVECTOR up = XMLoadFloat3(&frame.up);
+        float x = XMVectorGetX(XMVector3Dot(diff, right)) / (frame.halfExtents.x + XMVectorGetX(XMVector3Dot(boxExtents, XMVectorAbs(right))));
+        float y = XMVectorGetX(XMVector3Dot(diff, up)) / (frame.halfExtents.y + XMVectorGetX(XMVector3Dot(boxExtents, XMVectorAbs(up))));
+        return x * x + y * y <= 1;
+    }
+
+    bool InOpening(const PortalFrame& frame, const XMFLOAT3& point, float reach)
+    {
+        if (std::fabs(SignedDistance(frame, point)) > reach) {
+            return false;
+        }
+        XMVECTOR diff = XMLoadFloat3(&point) - XMLoadFloat3(&frame.position);
+        float x = XMVectorGetX(XMVector3Dot(diff, XMLoadFloat3(&frame.right))) / frame.halfExtents.x;
+        float y = XMVectorGetX(XMVector3Dot(diff, XMLoadFloat3(&frame.up))) / frame.halfExtents.y;
+        return x * x + y * y <= 1;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <DirectXMath.h>
+
+// Portal math with no Windows or Direct3D dependencies, only DirectXMath.
+// Matrices use DirectXMath's row vector convention (world = S * R * T).
+namespace PortalMath
+{
+    // Pixel rectangle, laid out like a RECT so it can be copied straight into one
+    struct ScreenRect
+    {
+        long left;
+        long top;
+        long right;
+        long bottom;
+    };
+
+    // Position and unit axes of a portal, used for crossing and teleport tests
+    struct PortalFrame
+    {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT3 right;
+        DirectX::XMFLOAT3 up;
+        DirectX::XMFLOAT3 forward;
+        DirectX::XMFLOAT2 halfExtents;  // Radii of the portal ellipse along right and up
+    };
+
+    // Replace the near plane of projMat with the plane through planePoint facing planeNormal (both in world space)
+    DirectX::XMFLOAT4X4 ObliqueProjection(const DirectX::XMFLOAT4X4& viewMat, const DirectX::XMFLOAT4X4& projMat,
+        const DirectX::XMFLOAT3& planePoint, const DirectX::XMFLOAT3& planeNormal, float planeOffset = 0.01f);
+
+    // Maps points in front of the source portal to the matching points in front of the destination portal
+    DirectX::XMFLOAT4X4 SourceToDestination(const DirectX::XMFLOAT4X4& sourceWorld, const DirectX::XMFLOAT4X4& destWorld);
+    // View matrix of the virtual camera looking out of the destination portal
+    DirectX::XMFLOAT4X4 PortalViewMatrix(const DirectX::XMFLOAT4X4& viewMat, const DirectX::XMFLOAT4X4& sourceWorld, const DirectX::XMFLOAT4X4& destWorld);
+    DirectX::XMFLOAT3 TransformPoint(const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT4X4& matrix);
+
+    // Pixel bounds of the portal quad (local XY in [-1, 1]) after clipping against the camera and the near plane.
+    // Returns false if nothing is visible or the quad faces away from the viewer.
+    bool ProjectPortalQuad(const DirectX::XMFLOAT4X4& worldViewProj, float screenWidth, float screenHeight, ScreenRect& outRect);
+
+    // Distance of point in front of the portal plane (negative behind it)
+    float SignedDistance(const PortalFrame& frame, const DirectX::XMFLOAT3& point);
+    // Distance from the portal center to point, measured along the portal plane
+    float PlanarDistance(const PortalFrame& frame, const DirectX::XMFLOAT3& point);
+    // Plane through the portal facing out of its front, as (normal, -normal . position)
+    DirectX::XMFLOAT4 PortalPlane(const PortalFrame& frame);
+    // Orientation after passing through the portals, given the SourceToDestination matrix.
+    // Upright bodies (the camera) keep their pitch and roll and only pick up the change in yaw.
+    DirectX::XMFLOAT3 TeleportPitchYawRoll(const DirectX::XMFLOAT3& pitchYawRoll, const DirectX::XMFLOAT4X4& sourceToDestination, bool upright);
+
+    // Does the segment from start to end go in through the front of the portal ellipse?
+    // outTime is the fraction of the segment at which it reaches the portal plane.
+    bool SweptCrossing(const PortalFrame& frame, const DirectX::XMFLOAT3& start, const DirectX::XMFLOAT3& end, float& outTime);
+    // Is the box (world axis aligned) part way through the portal, with its center still in front?
+    bool Straddles(const PortalFrame& frame, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+    // Is point inside the portal's outline and within reach of its plane? A body there should pass through
+    // the surface the portal sits on instead of colliding with it.
+    bool InOpening(const PortalFrame& frame, const DirectX::XMFLOAT3& point, float reach);
+}
@@ -14,9 +14,12 @@ cbuffer ExternalData: register(b0)
 	float borderThickness;
 	float totalTime;
 	float portalRippleStrength;
+	int sampleCache;
+	matrix cacheViewProj;
 }
 
 Texture2D SceneCapture : register(t0);
+Texture2D PortalCache : register(t1);
 
 SamplerState BasicSampler : register(s0);
 
@@ -37,6 +40,12 @@ float4 main(VertexToPixel input) : SV_TARGET
 	// Draw border
 	if (squareRoot < lowerBound) {
 		if (drawRecursive == 0) {
+			// Innermost portal: reproject into last frame's view through this portal if we have one
+			if (sampleCache == 1) {
+				float4 cachePos = mul(cacheViewProj, float4(input.worldPosition, 1.0f));
+				float2 cacheUV = cachePos.xy / cachePos.w * float2(0.5f, -0.5f) + 0.5f;
+				return float4(PortalCache.Sample(BasicSampler, cacheUV).rgb, 1.0f);
+			}
 			return float4(0, 0, 0, 1);
 		}
 		// Capture the dimensions of the copy of the back buffer
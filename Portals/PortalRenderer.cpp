@@ -0,0 +1,355 @@
+#include "PortalRenderer.h"
+#include "Profiler.h"
+#include <math.h>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+using namespace DirectX;
+using namespace std;
+
+// The part of a that's also in b. Returns false if they don't overlap.
+static bool IntersectScreenRects(const PortalMath::ScreenRect& a, const PortalMath::ScreenRect& b, PortalMath::ScreenRect& out)
+{
+	out.left = (std::max)(a.left, b.left);
+	out.top = (std::max)(a.top, b.top);
+	out.right = (std::min)(a.right, b.right);
+	out.bottom = (std::min)(a.bottom, b.bottom);
+	return out.left < out.right && out.top < out.bottom;
+}
+
+void PortalRenderer::SetStates(const PortalRenderStates& states)
+{
+	this->states = states;
+}
+
+void PortalRenderer::SetSettings(const PortalRenderSettings& settings)
+{
+	this->settings = settings;
+}
+
+void PortalRenderer::SetScreenSize(unsigned int width, unsigned int height)
+{
+	this->width = width;
+	this->height = height;
+}
+
+// Nothing is sent to the GPU until the commands are executed
+void PortalRenderer::RecordFrame(CommandBuffer& commands, const PortalScene& scene, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat,
+	XMFLOAT3 cameraPosition, int recursion)
+{
+	this->scene = &scene;
+
+	// Draw Portals, starting with the whole screen as the visible area
+	PortalMath::ScreenRect screenRect = { 0, 0, (long)width, (long)height };
+	GatherDrawItems();
+	if (settings.parallelRecording) {
+		SceneView cameraView = { viewMat, projMat, cameraPosition, GetDeviceRect(screenRect) };
+		plannedViews.clear();
+		PlanPortalViews(cameraView, recursion, 0, screenRect);
+		RecordDrawLists();
+	}
+	commands.SetRasterizer(states.scissorRasterizer);
+	DrawPortals(commands, viewMat, projMat, cameraPosition, recursion, 0, screenRect);
+
+	this->scene = nullptr;
+}
+
+// Draw anything that is a non-portal.
+void PortalRenderer::DrawNonPortals(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition,
+	const PortalMath::ScreenRect& scissorRect)
+{
+	PROFILE_ZONE("DrawNonPortals");
+
+	// Views are drawn in the order they were planned, so the next recorded list is this view's
+	if (settings.parallelRecording && nextDrawList < plannedViews.size()) {
+		drawLists[nextDrawList++].Submit(commands, scene->lights, scene->ambientColor);
+		return;
+	}
+
+	// Otherwise record this view's list now, on this thread
+	SceneView view = { viewMat, projMat, cameraPosition, GetDeviceRect(scissorRect) };
+	serialDrawList.Record(view, drawScene, settings.instancing);
+	serialDrawList.Submit(commands, scene->lights, scene->ambientColor);
+}
+
+// Draw the portals by calculating the virtual cameras view and clipped projection matrix, and using the stencil buffer.
+// scissorRect is the screen area of the portal opening we are currently looking through. Portals that don't overlap it
+// are skipped entirely, along with everything that would have been drawn through them.
+void PortalRenderer::DrawPortals(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat, XMFLOAT3 cameraPosition,
+	int maxRecursion, int recursionLevel, const PortalMath::ScreenRect& scissorRect)
+{
+	PROFILE_ZONE_ARG("DrawPortals", "level", recursionLevel);
+	commands.SetScissor(scissorRect.left, scissorRect.top, scissorRect.right, scissorRect.bottom);
+
+	for (const PortalDrawInfo& info : scene->portals) {
+		Portal* portal = info.portal;
+		PROFILE_ZONE_ARG("Portal", "id", portal->GetId());
+
+		// No destination portal set, exit early!
+		if (portal->GetDestination() == nullptr) {
+			continue;
+		}
+
+		// Find the part of the screen this portal covers within the current opening, and the view through it
+		SceneView view = { viewMat, projMat, cameraPosition, GetDeviceRect(scissorRect) };
+		SceneView portalView;
+		PortalMath::ScreenRect portalRect;
+		if (!GetPortalView(portal, view, scissorRect, portalRect, portalView)) {
+			continue;
+		}
+		XMFLOAT4X4 viewDest = portalView.view;
+		XMFLOAT4X4 newProj = portalView.projection;
+		XMFLOAT3 relPos = portalView.cameraPosition;
+
+		// Set Depth Stencil State and Draw portal to stencil buffer.
+		// This isn't actually drawing the portal, but it is incrementing the stencil buffer values in the area of the screen where the portal is.
+		commands.BeginZone("GPU stencil mark", "level", recursionLevel);
+		commands.SetStencilRef(states.stencilWriteMask, recursionLevel);
+		DrawPortalStencil(commands, info, viewMat, projMat, cameraPosition);
+		commands.EndZone();
+
+		// Base case: finish with the inner portal fill
+		if (IsInnermostPortal(maxRecursion, recursionLevel, portalRect)) {
+			commands.BeginZone("GPU inner scene", "level", recursionLevel + 1);
+			// Only rasterize inside this portal's opening
+			commands.SetScissor(portalRect.left, portalRect.top, portalRect.right, portalRect.bottom);
+			// Set depth stencil state,
+			commands.SetStencilRef(states.innerPortalMask, recursionLevel + 1);
+			// Clear the depth buffer
+			commands.ClearDepth(states.depthStencilView, 1.0f);
+			// Draw world constrained to the inner portal
+			DrawNonPortals(commands, viewDest, newProj, relPos, portalRect);
+
+			// Draw inner most portal outline, filled with last frame's view through it when the cache is valid
+			RenderShader* ps = portal->GetMaterial()->GetPixelShader();
+			bool sampleCache = settings.cachedPortals && portal->HasValidCache();
+			ps->SetInt("drawRecursive", 0);
+			ps->SetInt("sampleCache", sampleCache ? 1 : 0);
+			if (sampleCache) {
+				commands.SetTexture(ps, "PortalCache", portal->GetCache());
+				ps->SetMatrix4x4("cacheViewProj", portal->GetCacheViewProj());
+			}
+			ps->SetFloat("scale", info.scale);
+			ps->SetFloat3("borderColor", portal->GetBorderColor());
+			portal->Draw(commands, viewDest, newProj, relPos);
+			commands.EndZone();
+		}
+		// Recursive case:
+		else {
+			// Draw portals recursively
+			DrawPortals(commands, viewDest, newProj, relPos, maxRecursion, recursionLevel + 1, portalRect);
+		}
+		// Restore this level's scissor rect
+		commands.SetScissor(scissorRect.left, scissorRect.top, scissorRect.right, scissorRect.bottom);
+
+		// Set depth stencil state
+		commands.SetStencilRef(states.undoStencilWriteMask, recursionLevel + 1);
+		// Clear the depth buffer
+		commands.ClearDepth(states.depthStencilView, 1.0f);
+		// Draw portal into stencil buffer. The undoStencilWriteMask decrements the stencil values where the portal is
+		// eventually returning to a buffer full of zeroes.
+		DrawPortalStencil(commands, info, viewMat, projMat, cameraPosition);
+	}
+
+	// Clear the depth buffer
+	commands.ClearDepth(states.depthStencilView, 1.0f);
+
+	// Set depth stencil state
+	commands.SetStencilRef(states.portalDepthWrite, 0);
+
+	// Draw each portal (a plane) into the depth buffer
+	for (const PortalDrawInfo& info : scene->portals) {
+		DrawPortalStencil(commands, info, viewMat, projMat, cameraPosition);
+	}
+
+	// Only draw where stencil value >= recursion level
+	// This prevents drawing outside of outside of this level
+	commands.BeginZone("GPU scene", "level", recursionLevel);
+	commands.SetStencilRef(states.gEqualRecursionStencilMask, recursionLevel);
+	DrawNonPortals(commands, viewMat, projMat, cameraPosition, scissorRect);
+	commands.EndZone();
+
+	// Copy contents from the back buffer for sampling within the PortalPS.
+	commands.BeginZone("GPU back buffer copy", "level", recursionLevel);
+	commands.CopyResource(states.screenCaptureTexture, states.backBuffer);
+	commands.EndZone();
+
+	// Drawing here will do two things:
+	//    a. Draw the colored portal outine
+	//    b. Draw the ripple effect to the portals surface by sampling what we copied from the back buffer
+	commands.BeginZone("GPU portal border", "level", recursionLevel);
+	commands.SetStencilRef(states.portalBorderMask, recursionLevel);
+	commands.SetRasterizer(states.portalRasterizer); // Nudges portal closer to camera to avoid depth test fighting
+	for (const PortalDrawInfo& info : scene->portals) {
+		Portal* portal = info.portal;
+		RenderShader* ps = portal->GetMaterial()->GetPixelShader();
+		commands.SetTexture(ps, "SceneCapture", states.screenCaptureView);
+		ps->SetInt("drawRecursive", 1);
+		ps->SetInt("recursionLevel", recursionLevel);
+		ps->SetFloat("scale", info.scale);
+		ps->SetFloat3("borderColor", portal->GetBorderColor());
+		ps->SetFloat("portalRippleStrength", info.rippleStrength);
+
+		portal->Draw(commands, viewMat, projMat, cameraPosition);
+	}
+	commands.SetRasterizer(states.scissorRasterizer); // Back to the state the frame is drawn with
+	commands.EndZone();
+}
+
+// The portal's opening is scaled by its tween while it's drawn without its pixel shader, then put back
+void PortalRenderer::DrawPortalStencil(CommandBuffer& commands, const PortalDrawInfo& info, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat,
+	XMFLOAT3 cameraPosition)
+{
+	Transform* transform = info.portal->GetTransform();
+	XMFLOAT3 originalScale = transform->GetScale();
+	float opening = sinf(info.scale * XM_PIDIV2);
+	transform->SetScale(originalScale.x * opening, originalScale.y * opening, originalScale.z);
+	info.portal->UnbindPSAndDraw(commands, viewMat, projMat, cameraPosition);
+	transform->SetScale(originalScale.x, originalScale.y, originalScale.z);
+}
+
+// The part of the screen a portal covers within the current opening (scissorRect), and the view through it.
+// Returns false if it's off screen, facing away, or outside the parent portal, so there is nothing to see through it.
+bool PortalRenderer::GetPortalView(Portal* portal, const SceneView& view, const PortalMath::ScreenRect& scissorRect,
+	PortalMath::ScreenRect& portalRect, SceneView& portalView)
+{
+	PortalMath::ScreenRect rect;
+	if (!portal->GetScreenRect(view.view, view.projection, (float)width, (float)height, rect)) {
+		return false;
+	}
+	if (!IntersectScreenRects(rect, scissorRect, portalRect)) {
+		return false;
+	}
+
+	// Calculate the view from the perspective of the out portal
+	XMFLOAT4X4 destinationWorldMatrix = portal->GetDestination()->GetTransform()->GetWorldMatrix();
+	XMFLOAT4X4 currentWorldMatrix = portal->GetTransform()->GetWorldMatrix();
+	portalView.view = PortalMath::PortalViewMatrix(view.view, currentWorldMatrix, destinationWorldMatrix);
+
+	// Calculate Oblique Clipped Projection Matrix.
+	portalView.projection = portal->GetDestination()->ClippedProjectionMatrix(portalView.view, view.projection);
+
+	// Calculate new camera position, starting from this level's (possibly virtual) camera
+	portalView.cameraPosition = PortalMath::TransformPoint(view.cameraPosition, PortalMath::SourceToDestination(currentWorldMatrix, destinationWorldMatrix));
+	portalView.screenRect = GetDeviceRect(portalRect);
+	return true;
+}
+
+// A rectangle of pixels in normalized device coordinates, where y points up
+XMFLOAT4 PortalRenderer::GetDeviceRect(const PortalMath::ScreenRect& rect)
+{
+	return XMFLOAT4(
+		2.0f * rect.left / width - 1.0f,
+		1.0f - 2.0f * rect.top / height,
+		2.0f * rect.right / width - 1.0f,
+		1.0f - 2.0f * rect.bottom / height);
+}
+
+// Either the recursion limit was hit, or the nested portal is too small on screen for another level to be worth drawing
+bool PortalRenderer::IsInnermostPortal(int maxRecursion, int recursionLevel, const PortalMath::ScreenRect& portalRect)
+{
+	float portalArea = (float)(portalRect.right - portalRect.left) * (float)(portalRect.bottom - portalRect.top);
+	return recursionLevel >= maxRecursion || (settings.adaptiveRecursion && portalArea < settings.minPortalPixelArea);
+}
+
+// Walk the portals exactly as DrawPortals will, collecting the view of every DrawNonPortals call in the same order
+void PortalRenderer::PlanPortalViews(const SceneView& view, int maxRecursion, int recursionLevel, const PortalMath::ScreenRect& scissorRect)
+{
+	for (const PortalDrawInfo& info : scene->portals) {
+		Portal* portal = info.portal;
+		if (portal->GetDestination() == nullptr) {
+			continue;
+		}
+
+		SceneView portalView;
+		PortalMath::ScreenRect portalRect;
+		if (!GetPortalView(portal, view, scissorRect, portalRect, portalView)) {
+			continue;
+		}
+		if (IsInnermostPortal(maxRecursion, recursionLevel, portalRect)) {
+			plannedViews.push_back(portalView);
+		}
+		else {
+			PlanPortalViews(portalView, maxRecursion, recursionLevel + 1, portalRect);
+		}
+	}
+	plannedViews.push_back(view);
+}
+
+// Everything DrawNonPortals draws this frame, with the matrices and bounds read up front so recording only ever reads
+void PortalRenderer::GatherDrawItems()
+{
+	drawScene.items.clear();
+	drawScene.boxes.clear();
+	drawScene.occluders.clear();
+	drawScene.occluderTriangles.clear();
+	for (Entity* entity : scene->entities) {
+		// Skip drawing walls
+		if (!settings.drawWalls && (entity->GetTags() & ENTITY_TAG_WALL)) {
+			continue;
+		}
+		DrawItem item;
+		item.entity = entity;
+		item.world = entity->GetTransform()->GetWorldMatrix();
+		item.worldInverseTranspose = entity->GetTransform()->GetWorldInverseTranspose();
+		item.straddle = scene->physicsWorld != nullptr ? scene->physicsWorld->FindStraddle(entity) : nullptr;
+		item.bounds = (unsigned int)drawScene.boxes.size();
+		drawScene.boxes.push_back(entity->GetBoundingBox());
+		if (item.straddle != nullptr) {
+			// The copy coming out of the exit portal
+			BoundingBox exitBox;
+			drawScene.boxes.back().Transform(exitBox, XMLoadFloat4x4(&item.straddle->sourceToDestination));
+			drawScene.boxes.push_back(exitBox);
+		}
+		else if (settings.occlusionCulling && (entity->GetTags() & ENTITY_TAG_OCCLUDER)) {
+			// Every view rasterizes the same world space triangles
+			const vector<Vertex>& vertices = entity->GetMesh()->GetVertices();
+			const vector<unsigned int>& indices = entity->GetMesh()->GetIndices();
+			Occluder occluder;
+			occluder.bounds = item.bounds;
+			occluder.firstTriangle = (unsigned int)(drawScene.occluderTriangles.size() / 3);
+			occluder.triangleCount = (unsigned int)(indices.size() / 3);
+			XMMATRIX world = XMLoadFloat4x4(&item.world);
+			for (unsigned int index : indices) {
+				XMFLOAT3 point;
+				XMStoreFloat3(&point, XMVector3TransformCoord(XMLoadFloat3(&vertices[index].Position), world));
+				drawScene.occluderTriangles.push_back(point);
+			}
+			drawScene.occluders.push_back(occluder);
+		}
+		drawScene.items.push_back(item);
+	}
+	// Every view culls against the same boxes, so they're packed for the wide tests once
+	FrustumCulling::BuildBlocks(drawScene.boxes.data(), drawScene.boxes.size(), drawScene.bounds);
+}
+
+// Record a draw list for every planned view, spread over the available cores
+void PortalRenderer::RecordDrawLists()
+{
+	PROFILE_ZONE("RecordDrawLists");
+
+	if (drawLists.size() < plannedViews.size()) {
+		drawLists.resize(plannedViews.size());
+	}
+	nextDrawList = 0;
+
+	// Each worker takes every workerCount'th view, so the lists come out the same however many threads there are
+	size_t viewCount = plannedViews.size();
+	size_t workerCount = (std::max)((size_t)1, (std::min)((size_t)std::thread::hardware_concurrency(), viewCount));
+	vector<std::future<void>> workers;
+	for (size_t worker = 1; worker < workerCount; worker++) {
+		workers.push_back(std::async(std::launch::async, [this, worker, workerCount, viewCount]() {
+			for (size_t i = worker; i < viewCount; i += workerCount) {
+				drawLists[i].Record(plannedViews[i], drawScene, settings.instancing);
+			}
+		}));
+	}
+	// The main thread does its share rather than waiting
+	for (size_t i = 0; i < viewCount; i += workerCount) {
+		drawLists[i].Record(plannedViews[i], drawScene, settings.instancing);
+	}
+	for (auto& worker : workers) {
+		worker.get();
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "DrawList.h"
+#include "Entity.h"
+#include "Light.h"
+#include "PhysicsWorld.h"
+#include "Portal.h"
+#include "PortalMath.h"
+#include "RenderCommands.h"
+
+// The backend's states and targets a portal frame is drawn with. They're only passed along to the commands, so any
+// backend's handles work, and a NullRenderBackend is happy with anything at all.
+struct PortalRenderStates {
+	RenderHandle stencilWriteMask;				// Increments the stencil where a portal is
+	RenderHandle innerPortalMask;				// Draws the innermost view where the stencil matches
+	RenderHandle undoStencilWriteMask;			// Decrements the stencil where a portal is
+	RenderHandle portalDepthWrite;				// Portals into the depth buffer only
+	RenderHandle portalBorderMask;
+	RenderHandle gEqualRecursionStencilMask;	// Draws where the stencil is at least the recursion level
+	RenderHandle scissorRasterizer;				// The state the frame is drawn with
+	RenderHandle portalRasterizer;				// Nudges portals closer to the camera to avoid depth fighting
+	RenderHandle depthStencilView;
+	RenderHandle backBuffer;
+	RenderHandle screenCaptureTexture;			// The back buffer is copied here for the portals to sample
+	RenderHandle screenCaptureView;
+};
+
+// A portal as it's drawn this frame
+struct PortalDrawInfo {
+	Portal* portal;
+	float scale;			// Grows from 0 to 1 as a newly placed portal opens
+	float rippleStrength;
+};
+
+// Everything a frame is drawn from. Only read while recording.
+struct PortalScene {
+	std::vector<Entity*> entities;
+	std::vector<PortalDrawInfo> portals;	// In the order they're drawn
+	PhysicsWorld* physicsWorld;				// Bodies straddling a portal are drawn on both sides of it. Can be null.
+	std::vector<Light> lights;
+	DirectX::XMFLOAT3 ambientColor;
+};
+
+// The switches the game flips at runtime
+struct PortalRenderSettings {
+	bool parallelRecording = true;		// Record every view's draw list up front on worker threads
+	bool instancing = true;				// Draw lists batch copies of a mesh and material into instanced draws
+	bool occlusionCulling = true;		// Occluder entities hide what's behind them before it's drawn
+	bool drawWalls = true;				// Entities tagged ENTITY_TAG_WALL are skipped when off
+	bool adaptiveRecursion = true;		// Nested portals too small on screen stop recursing
+	float minPortalPixelArea = 256.0f;
+	bool cachedPortals = false;			// The innermost portals sample their cache when it's valid
+};
+
+// Records a whole frame, from the camera through every level of portals, into a command buffer. Each level marks the
+// portals it can see into the stencil buffer, recurses into the view through them with the scissor narrowed to their
+// opening, then draws its own scene where the stencil allows and the portal borders over it.
+// Nothing here touches a device, so a frame can be recorded and replayed into a NullRenderBackend anywhere.
+class PortalRenderer {
+public:
+	void SetStates(const PortalRenderStates& states);
+	void SetSettings(const PortalRenderSettings& settings);
+	void SetScreenSize(unsigned int width, unsigned int height);
+
+	// Record everything drawn this frame, through up to recursion levels of portals
+	void RecordFrame(CommandBuffer& commands, const PortalScene& scene, DirectX::XMFLOAT4X4 viewMat,
+		DirectX::XMFLOAT4X4 projMat, DirectX::XMFLOAT3 cameraPosition, int recursion);
+
+private:
+	// scissorRect is the opening the view is seen through, which nothing outside of is drawn
+	void DrawNonPortals(CommandBuffer& commands, DirectX::XMFLOAT4X4 viewMat, DirectX::XMFLOAT4X4 projMat,
+		DirectX::XMFLOAT3 cameraPosition, const PortalMath::ScreenRect& scissorRect);
+	void DrawPortals(CommandBuffer& commands, DirectX::XMFLOAT4X4 viewMat, DirectX::XMFLOAT4X4 projMat,
+		DirectX::XMFLOAT3 cameraPosition, int maxRecursion, int recursionLevel, const PortalMath::ScreenRect& scissorRect);
+	// Marks or unmarks a portal in the stencil buffer at its current opening size
+	void DrawPortalStencil(CommandBuffer& commands, const PortalDrawInfo& info, DirectX::XMFLOAT4X4 viewMat,
+		DirectX::XMFLOAT4X4 projMat, DirectX::XMFLOAT3 cameraPosition);
+	bool GetPortalView(Portal* portal, const SceneView& view, const PortalMath::ScreenRect& scissorRect,
+		PortalMath::ScreenRect& portalRect, SceneView& portalView);
+	DirectX::XMFLOAT4 GetDeviceRect(const PortalMath::ScreenRect& rect);
+	bool IsInnermostPortal(int maxRecursion, int recursionLevel, const PortalMath::ScreenRect& portalRect);
+	void PlanPortalViews(const SceneView& view, int maxRecursion, int recursionLevel, const PortalMath::ScreenRect& scissorRect);
+	void GatherDrawItems();
+	void RecordDrawLists();
+
+	PortalRenderStates states = {};
+	PortalRenderSettings settings;
+	unsigned int width = 1;
+	unsigned int height = 1;
+	const PortalScene* scene = nullptr;		// While a frame is being recorded
+
+	// Parallel recording: every view DrawPortals will draw the scene from is worked out before drawing starts, the
+	// draw list for each is recorded on worker threads, and DrawNonPortals replays them in the same order
+	std::vector<SceneView> plannedViews;	// In the order DrawPortals draws them
+	DrawScene drawScene;					// Gathered once per frame for every list
+	std::vector<DrawList> drawLists;		// One per planned view
+	size_t nextDrawList = 0;
+	DrawList serialDrawList;				// Recorded view by view while drawing, when parallel recording is off
+};
@@ -0,0 +1,254 @@
+#include "PortalTraversal.h"
+#include <algorithm>
+#include <float.h>
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+// Padding on every box in the broadphase, so bodies resting right against a portal still pair with it
+#define PORTAL_TRAVERSAL_MARGIN 0.01f
+
+static bool Overlaps(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB)
+{
+	return minA.x <= maxB.x && maxA.x >= minB.x &&
+		minA.y <= maxB.y && maxA.y >= minB.y &&
+		minA.z <= maxB.z && maxA.z >= minB.z;
+}
+
+PortalTraversal::PortalTraversal()
+{
+}
+
+PortalTraversal::~PortalTraversal()
+{
+}
+
+void PortalTraversal::Add(Entity* entity)
+{
+	travellers.push_back({ entity->GetTransform(), entity, entity->GetTransform()->GetPosition(), false });
+}
+
+void PortalTraversal::Add(Transform* transform, bool upright)
+{
+	travellers.push_back({ transform, nullptr, transform->GetPosition(), upright });
+}
+
+void PortalTraversal::Remove(Transform* transform)
+{
+	travellers.erase(remove_if(travellers.begin(), travellers.end(),
+		[transform](const PortalTraveller& traveller) { return traveller.transform == transform; }),
+		travellers.end());
+}
+
+size_t PortalTraversal::GetCount()
+{
+	return travellers.size();
+}
+
+const std::vector<PortalStraddle>& PortalTraversal::GetStraddles()
+{
+	return straddles;
+}
+
+const PortalStraddle* PortalTraversal::FindStraddle(Entity* entity)
+{
+	for (const PortalStraddle& straddle : straddles) {
+		if (straddle.entity == entity) {
+			return &straddle;
+		}
+	}
+	return nullptr;
+}
+
+int PortalTraversal::Update(const std::vector<Portal*>& portals, int maxCrossings)
+{
+	straddles.clear();
+
+	// Only portals with a destination can be walked through
+	openPortals.clear();
+	sources.clear();
+	destinations.clear();
+	portalMatrices.clear();
+	portalBounds.clear();
+	for (Portal* portal : portals) {
+		if (portal->GetDestination() == nullptr) {
+			continue;
+		}
+		PortalMath::PortalFrame frame = portal->GetFrame();
+		openPortals.push_back(portal);
+		sources.push_back(frame);
+		destinations.push_back(portal->GetDestination()->GetFrame());
+		portalMatrices.push_back(PortalMath::SourceToDestination(
+			portal->GetTransform()->GetWorldMatrix(), portal->GetDestination()->GetTransform()->GetWorldMatrix()));
+
+		// Box around the ellipse. Along each world axis it reaches sqrt((right * width)^2 + (up * height)^2).
+		float w = frame.halfExtents.x;
+		float h = frame.halfExtents.y;
+		XMFLOAT3 extents(
+			sqrtf(frame.right.x * frame.right.x * w * w + frame.up.x * frame.up.x * h * h) + PORTAL_TRAVERSAL_MARGIN,
+			sqrtf(frame.right.y * frame.right.y * w * w + frame.up.y * frame.up.y * h * h) + PORTAL_TRAVERSAL_MARGIN,
+			sqrtf(frame.right.z * frame.right.z * w * w + frame.up.z * frame.up.z * h * h) + PORTAL_TRAVERSAL_MARGIN);
+		Bounds bounds;
+		XMStoreFloat3(&bounds.boundsMin, XMLoadFloat3(&frame.position) - XMLoadFloat3(&extents));
+		XMStoreFloat3(&bounds.boundsMax, XMLoadFloat3(&frame.position) + XMLoadFloat3(&extents));
+		portalBounds.push_back(bounds);
+	}
+
+	// Broadphase: the box each traveller swept through since the last update, grown by the entity's own size
+	size_t count = travellers.size();
+	ends.resize(count);
+	bodyBounds.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		PortalTraveller& traveller = travellers[i];
+		ends[i] = traveller.transform->GetPosition();
+
+		XMVECTOR extents = XMVectorReplicate(PORTAL_TRAVERSAL_MARGIN);
+		if (traveller.entity != nullptr) {
+			BoundingBox box = traveller.entity->GetBoundingBox();
+			extents += XMLoadFloat3(&box.Extents);
+		}
+		XMVECTOR start = XMLoadFloat3(&traveller.previousPosition);
+		XMVECTOR end = XMLoadFloat3(&ends[i]);
+		XMStoreFloat3(&bodyBounds[i].boundsMin, XMVectorMin(start, end) - extents);
+		XMStoreFloat3(&bodyBounds[i].boundsMax, XMVectorMax(start, end) + extents);
+	}
+	FindOverlaps();
+
+	// Narrow phase: the earliest portal each traveller's center went through
+	vector<pair<int, float>> crossings(count, make_pair(-1, FLT_MAX));
+	for (const auto& overlap : overlaps) {
+		float t;
+		int i = overlap.first;
+		if (PortalMath::SweptCrossing(sources[overlap.second], travellers[i].previousPosition, ends[i], t) &&
+			t < crossings[i].second) {
+			crossings[i] = make_pair(overlap.second, t);
+		}
+	}
+
+	int teleported = 0;
+	for (size_t i = 0; i < count; i++) {
+		PortalTraveller& traveller = travellers[i];
+		XMFLOAT3 start = traveller.previousPosition;
+		int portal = crossings[i].first;
+		float time = crossings[i].second;
+		if (portal >= 0) {
+			for (int pass = 0; portal >= 0 && pass < maxCrossings; pass++) {
+				Teleport(traveller, portal, time, start, ends[i]);
+
+				// Coming out of one portal can lead straight into another. That's rare enough to just check the
+				// rest of the motion against every portal.
+				portal = -1;
+				time = FLT_MAX;
+				for (size_t p = 0; p < sources.size(); p++) {
+					float t;
+					if (PortalMath::SweptCrossing(sources[p], start, ends[i], t) && t < time) {
+						portal = (int)p;
+						time = t;
+					}
+				}
+			}
+			traveller.transform->SetPosition(ends[i].x, ends[i].y, ends[i].z);
+			teleported++;
+		}
+		traveller.previousPosition = ends[i];
+	}
+
+	// Entities part way through a portal get drawn on both sides. Same broadphase, with the boxes where they are now.
+	for (size_t i = 0; i < count; i++) {
+		if (travellers[i].entity == nullptr) {
+			bodyBounds[i].boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			bodyBounds[i].boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			continue;
+		}
+		BoundingBox box = travellers[i].entity->GetBoundingBox();
+		XMStoreFloat3(&bodyBounds[i].boundsMin, XMLoadFloat3(&box.Center) - XMLoadFloat3(&box.Extents));
+		XMStoreFloat3(&bodyBounds[i].boundsMax, XMLoadFloat3(&box.Center) + XMLoadFloat3(&box.Extents));
+	}
+	FindOverlaps();
+
+	for (const auto& overlap : overlaps) {
+		Entity* entity = travellers[overlap.first].entity;
+		int p = overlap.second;
+		BoundingBox box = entity->GetBoundingBox();
+		if (FindStraddle(entity) == nullptr && PortalMath::Straddles(sources[p], box.Center, box.Extents)) {
+			straddles.push_back({ entity, PortalMath::PortalPlane(sources[p]), PortalMath::PortalPlane(destinations[p]), portalMatrices[p] });
+		}
+	}
+
+	return teleported;
+}
+
+void PortalTraversal::FindOverlaps()
+{
+	overlaps.clear();
+
+	bodyOrder.resize(bodyBounds.size());
+	for (size_t i = 0; i < bodyOrder.size(); i++) {
+		bodyOrder[i] = (int)i;
+	}
+	portalOrder.resize(portalBounds.size());
+	for (size_t i = 0; i < portalOrder.size(); i++) {
+		portalOrder[i] = (int)i;
+	}
+	sort(bodyOrder.begin(), bodyOrder.end(),
+		[this](int a, int b) { return bodyBounds[a].boundsMin.x < bodyBounds[b].boundsMin.x; });
+	sort(portalOrder.begin(), portalOrder.end(),
+		[this](int a, int b) { return portalBounds[a].boundsMin.x < portalBounds[b].boundsMin.x; });
+
+	// Walk both lists in order of min x. Each box that starts is tested against the boxes of the other kind that
+	// haven't ended yet, and boxes are dropped from the active lists once the sweep passes their max x.
+	activeBodies.clear();
+	activePortals.clear();
+	size_t b = 0;
+	size_t p = 0;
+	while (b < bodyOrder.size() || p < portalOrder.size()) {
+		bool nextIsBody = p == portalOrder.size() ||
+			(b < bodyOrder.size() && bodyBounds[bodyOrder[b]].boundsMin.x <= portalBounds[portalOrder[p]].boundsMin.x);
+		if (nextIsBody) {
+			int body = bodyOrder[b++];
+			const Bounds& bounds = bodyBounds[body];
+			activePortals.erase(remove_if(activePortals.begin(), activePortals.end(),
+				[&](int portal) { return portalBounds[portal].boundsMax.x < bounds.boundsMin.x; }),
+				activePortals.end());
+			for (int portal : activePortals) {
+				if (Overlaps(bounds.boundsMin, bounds.boundsMax, portalBounds[portal].boundsMin, portalBounds[portal].boundsMax)) {
+					overlaps.push_back(make_pair(body, portal));
+				}
+			}
+			activeBodies.push_back(body);
+		}
+		else {
+			int portal = portalOrder[p++];
+			const Bounds& bounds = portalBounds[portal];
+			activeBodies.erase(remove_if(activeBodies.begin(), activeBodies.end(),
+				[&](int body) { return bodyBounds[body].boundsMax.x < bounds.boundsMin.x; }),
+				activeBodies.end());
+			for (int body : activeBodies) {
+				if (Overlaps(bodyBounds[body].boundsMin, bodyBounds[body].boundsMax, bounds.boundsMin, bounds.boundsMax)) {
+					overlaps.push_back(make_pair(body, portal));
+				}
+			}
+			activePortals.push_back(portal);
+		}
+	}
+}
+
+void PortalTraversal::Teleport(PortalTraveller& traveller, int portal, float time, XMFLOAT3& start, XMFLOAT3& end)
+{
+	// Carry the crossing point and the end of the motion over, so the rest of the motion continues out of the destination
+	XMMATRIX m = XMLoadFloat4x4(&portalMatrices[portal]);
+	XMVECTOR hit = XMVectorLerp(XMLoadFloat3(&start), XMLoadFloat3(&end), time);
+	XMStoreFloat3(&start, XMVector3TransformCoord(hit, m));
+	XMStoreFloat3(&end, XMVector3TransformCoord(XMLoadFloat3(&end), m));
+
+	Transform* transform = traveller.transform;
+	XMFLOAT3 rot = PortalMath::TeleportPitchYawRoll(transform->GetPitchYawRoll(), portalMatrices[portal], traveller.upright);
+	transform->SetPitchYawRoll(rot.x, rot.y, rot.z);
+
+	if (traveller.entity != nullptr) {
+		XMFLOAT3 velocity = traveller.entity->GetVelocity();
+		XMStoreFloat3(&velocity, XMVector3TransformNormal(XMLoadFloat3(&velocity), m));
+		traveller.entity->SetVelocity(velocity);
+	}
+}
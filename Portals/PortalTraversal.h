@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "Entity.h"
+#include "Portal.h"
+
+// Anything that can pass through portals
+struct PortalTraveller {
+	Transform* transform;
+	Entity* entity;						// Null for bodies that are never drawn, like the camera
+	DirectX::XMFLOAT3 previousPosition;	// Where it was at the end of the last update
+	bool upright;						// Only turns about the vertical axis (the camera), instead of taking the full portal rotation
+};
+
+// An entity part way through a portal. It's drawn once on each side, each copy clipped to the front of its portal.
+struct PortalStraddle {
+	Entity* entity;
+	DirectX::XMFLOAT4 sourcePlane;
+	DirectX::XMFLOAT4 destinationPlane;
+	DirectX::XMFLOAT4X4 sourceToDestination;	// Moves the entity to where its copy is drawn
+};
+
+// Moves bodies through portals. Position, orientation and velocity all go through the same portal to portal matrix
+// the renderer uses for the view through a portal, so portals at any angle work.
+// Each update sorts the bodies' swept boxes and the portal boxes along x and sweeps them, so only pairs that
+// actually overlap are tested exactly, rather than every body against every portal.
+class PortalTraversal {
+public:
+	PortalTraversal();
+	~PortalTraversal();
+
+	// Entities also get their velocity carried through, and are drawn on both sides while straddling a portal
+	void Add(Entity* entity);
+	void Add(Transform* transform, bool upright);
+	void Remove(Transform* transform);
+	size_t GetCount();
+
+	// Sweep every traveller from where it was at the last update to where it is now, teleporting the ones that went
+	// in through a portal with a destination. Returns how many were teleported.
+	int Update(const std::vector<Portal*>& portals, int maxCrossings);
+
+	// Entities found part way through a portal by the last update
+	const std::vector<PortalStraddle>& GetStraddles();
+	const PortalStraddle* FindStraddle(Entity* entity);
+
+private:
+	struct Bounds {
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+	};
+
+	// Every (body, portal) pair whose boxes overlap, found by sorting both lists on min x and sweeping
+	void FindOverlaps();
+	void Teleport(PortalTraveller& traveller, int portal, float time, DirectX::XMFLOAT3& start, DirectX::XMFLOAT3& end);
+
+	std::vector<PortalTraveller> travellers;
+	std::vector<PortalStraddle> straddles;
+
+	// Working set, reused between updates
+	std::vector<Portal*> openPortals;
+	std::vector<PortalMath::PortalFrame> sources;
+	std::vector<PortalMath::PortalFrame> destinations;
+	std::vector<DirectX::XMFLOAT4X4> portalMatrices;
+	std::vector<Bounds> portalBounds;
+	std::vector<Bounds> bodyBounds;
+	std::vector<DirectX::XMFLOAT3> ends;
+	std::vector<int> bodyOrder;
+	std::vector<int> portalOrder;
+	std::vector<int> activeBodies;
+	std::vector<int> activePortals;
+	std::vector<std::pair<int, int>> overlaps;
+};
@@ -0,0 +1,350 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+// Written only by its thread and read only by EndFrame. The writer publishes each event by bumping written after
+// storing it, so the reader never sees a half written one unless the writer has lapped it, which it checks for.
+struct ProfileRing {
+	ProfileEvent events[PROFILER_RING_SIZE];
+	atomic<unsigned long long> written{ 0 };
+	unsigned long long read = 0;
+	int thread;		// Index in the trace
+};
+
+// A zone's identity, name and argument both
+typedef tuple<const char*, const char*, int> ProfileZoneKey;
+
+struct ProfileZoneHistory {
+	double frameTime = 0;	// Milliseconds so far this frame
+	int frameCalls = 0;
+	vector<double> times;	// Milliseconds per frame, a ring of PROFILER_HISTORY_FRAMES
+	vector<int> calls;
+	size_t next = 0;
+};
+
+struct ProfileTraceEvent {
+	ProfileEvent event;
+	int thread;
+};
+
+struct ProfileTraceCounter {
+	long long time;
+	long long values[PROFILER_COUNTER_COUNT];
+};
+
+// Threads come and go, and std::async in particular can start new ones every frame, so a thread's ring goes back to
+// be reused when it exits rather than being lost. Anything still in it gets drained by the next EndFrame as usual.
+struct ProfileRingOwner {
+	ProfileRing* ring = nullptr;
+	~ProfileRingOwner();
+};
+
+static atomic<bool> profilerEnabled{ true };
+static atomic<long long> counters[PROFILER_COUNTER_COUNT];
+
+// Everything below belongs to EndFrame and the summary, except that threads take the mutex once to get a ring
+static mutex ringMutex;
+static vector<unique_ptr<ProfileRing>> rings;
+static vector<ProfileRing*> freeRings;
+static thread_local ProfileRingOwner ringOwner;
+static ProfileRing* gpuRing = nullptr;	// Never handed to a thread
+
+static map<ProfileZoneKey, ProfileZoneHistory> zones;
+static vector<long long> counterHistory[PROFILER_COUNTER_COUNT];
+static size_t counterNext = 0;
+static int mainThread = -1;
+
+static string tracePath;
+static int traceFramesLeft = 0;
+static vector<ProfileTraceEvent> traceEvents;
+static vector<ProfileTraceCounter> traceCounters;
+
+static const char* counterNames[PROFILER_COUNTER_COUNT] = { "draw calls", "state changes", "constant bytes", "depth clears" };
+
+ProfileRingOwner::~ProfileRingOwner()
+{
+	if (ring != nullptr) {
+		lock_guard<mutex> lock(ringMutex);
+		freeRings.push_back(ring);
+	}
+}
+
+// Call with ringMutex held
+static ProfileRing* NewRing()
+{
+	rings.emplace_back(new ProfileRing());
+	rings.back()->thread = (int)rings.size() - 1;
+	return rings.back().get();
+}
+
+static ProfileRing* GetRing()
+{
+	if (ringOwner.ring == nullptr) {
+		lock_guard<mutex> lock(ringMutex);
+		if (!freeRings.empty()) {
+			ringOwner.ring = freeRings.back();
+			freeRings.pop_back();
+		}
+		else {
+			ringOwner.ring = NewRing();
+		}
+	}
+	return ringOwner.ring;
+}
+
+static void Push(ProfileRing* ring, const ProfileEvent& event)
+{
+	unsigned long long index = ring->written.load(memory_order_relaxed);
+	ring->events[index & (PROFILER_RING_SIZE - 1)] = event;
+	ring->written.store(index + 1, memory_order_release);
+}
+
+static double TicksToMilliseconds(long long ticks)
+{
+	return ticks * 1000.0 * chrono::steady_clock::period::num / chrono::steady_clock::period::den;
+}
+
+static double TicksToMicroseconds(long long ticks)
+{
+	return TicksToMilliseconds(ticks) * 1000.0;
+}
+
+// Nearest rank percentile
+template <typename T>
+static T Percentile(vector<T> values, double percentile)
+{
+	if (values.empty()) {
+		return T();
+	}
+	size_t rank = (std::min)(values.size() - 1, (size_t)(percentile / 100.0 * values.size()));
+	nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	profilerEnabled.store(enabled, memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return profilerEnabled.load(memory_order_relaxed);
+}
+
+long long Profiler::GetTicks()
+{
+	return chrono::steady_clock::now().time_since_epoch().count();
+}
+
+long long Profiler::GetTicksPerSecond()
+{
+	return chrono::steady_clock::period::den / chrono::steady_clock::period::num;
+}
+
+void Profiler::Record(const ProfileEvent& event)
+{
+	Push(GetRing(), event);
+}
+
+void Profiler::RecordGpu(const ProfileEvent& event)
+{
+	if (gpuRing == nullptr) {
+		lock_guard<mutex> lock(ringMutex);
+		gpuRing = NewRing();
+	}
+	Push(gpuRing, event);
+}
+
+void Profiler::AddCounter(int counter, long long value)
+{
+	if (IsEnabled()) {
+		counters[counter].fetch_add(value, memory_order_relaxed);
+	}
+}
+
+void Profiler::EndFrame()
+{
+	mainThread = GetRing()->thread;
+
+	// Move every new event out of the rings
+	static vector<ProfileEvent> events;
+	static vector<int> eventThreads;
+	events.clear();
+	eventThreads.clear();
+	{
+		lock_guard<mutex> lock(ringMutex);
+		for (const unique_ptr<ProfileRing>& ring : rings) {
+			unsigned long long end = ring->written.load(memory_order_acquire);
+			unsigned long long start = (std::max)(ring->read, end > PROFILER_RING_SIZE ? end - PROFILER_RING_SIZE : 0);
+			size_t first = events.size();
+			for (unsigned long long i = start; i < end; i++) {
+				events.push_back(ring->events[i & (PROFILER_RING_SIZE - 1)]);
+				eventThreads.push_back(ring->thread);
+			}
+			// Whatever the writer lapped while this was copying is torn, so it's dropped
+			unsigned long long after = ring->written.load(memory_order_acquire);
+			unsigned long long overwritten = after > PROFILER_RING_SIZE ? after - PROFILER_RING_SIZE : 0;
+			if (overwritten > start) {
+				size_t torn = (size_t)((std::min)(overwritten, end) - start);
+				events.erase(events.begin() + first, events.begin() + first + torn);
+				eventThreads.erase(eventThreads.begin() + first, eventThreads.begin() + first + torn);
+			}
+			ring->read = end;
+		}
+	}
+
+	for (size_t i = 0; i < events.size(); i++) {
+		const ProfileEvent& event = events[i];
+		ProfileZoneHistory& zone = zones[ProfileZoneKey(event.name, event.argName, event.arg)];
+		zone.frameTime += TicksToMilliseconds(event.end - event.start);
+		zone.frameCalls++;
+	}
+	for (auto& pair : zones) {
+		ProfileZoneHistory& zone = pair.second;
+		if (zone.frameCalls == 0) {
+			continue;
+		}
+		if (zone.times.size() < PROFILER_HISTORY_FRAMES) {
+			zone.times.push_back(zone.frameTime);
+			zone.calls.push_back(zone.frameCalls);
+		}
+		else {
+			zone.times[zone.next] = zone.frameTime;
+			zone.calls[zone.next] = zone.frameCalls;
+		}
+		zone.next = (zone.next + 1) % PROFILER_HISTORY_FRAMES;
+		zone.frameTime = 0;
+		zone.frameCalls = 0;
+	}
+
+	ProfileTraceCounter frameCounters;
+	frameCounters.time = GetTicks();
+	for (int i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+		frameCounters.values[i] = counters[i].exchange(0, memory_order_relaxed);
+		if (counterHistory[i].size() < PROFILER_HISTORY_FRAMES) {
+			counterHistory[i].push_back(frameCounters.values[i]);
+		}
+		else {
+			counterHistory[i][counterNext] = frameCounters.values[i];
+		}
+	}
+	counterNext = (counterNext + 1) % PROFILER_HISTORY_FRAMES;
+
+	if (traceFramesLeft <= 0) {
+		return;
+	}
+	for (size_t i = 0; i < events.size(); i++) {
+		traceEvents.push_back({ events[i], eventThreads[i] });
+	}
+	traceCounters.push_back(frameCounters);
+	if (--traceFramesLeft > 0) {
+		return;
+	}
+
+	// Chrome's trace event format: a complete event per zone, a counter event per frame and a name per thread
+	FILE* file = fopen(tracePath.c_str(), "w");
+	if (file == nullptr) {
+		printf("Couldn't write the trace to %s\n", tracePath.c_str());
+	}
+	else {
+		long long base = traceEvents.empty() ? 0 : traceEvents[0].event.start;
+		for (const ProfileTraceEvent& trace : traceEvents) {
+			base = (std::min)(base, trace.event.start);
+		}
+		fprintf(file, "{\"traceEvents\":[\n");
+		for (size_t i = 0; i < rings.size(); i++) {
+			fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s %d\"}},\n", (int)i,
+				rings[i].get() == gpuRing ? "GPU" : (int)i == mainThread ? "Main" : "Worker", (int)i);
+		}
+		for (const ProfileTraceEvent& trace : traceEvents) {
+			const ProfileEvent& event = trace.event;
+			fprintf(file, "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f", trace.thread, event.name,
+				TicksToMicroseconds(event.start - base), TicksToMicroseconds(event.end - event.start));
+			if (event.argName != nullptr) {
+				fprintf(file, ",\"args\":{\"%s\":%d}", event.argName, event.arg);
+			}
+			fprintf(file, "},\n");
+		}
+		for (const ProfileTraceCounter& counter : traceCounters) {
+			for (int i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+				fprintf(file, "{\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"args\":{\"value\":%lld}},\n", mainThread,
+					counterNames[i], TicksToMicroseconds(counter.time - base), counter.values[i]);
+			}
+		}
+		// Closes the list without a trailing comma
+		fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Portals\"}}\n]}\n");
+		fclose(file);
+		printf("Wrote %d zones over %d frames to %s\n", (int)traceEvents.size(), (int)traceCounters.size(), tracePath.c_str());
+	}
+	traceEvents.clear();
+	traceCounters.clear();
+}
+
+void Profiler::CaptureTrace(const std::string& path, int frames)
+{
+	tracePath = path;
+	traceFramesLeft = frames;
+	traceEvents.clear();
+	traceCounters.clear();
+}
+
+void Profiler::PrintSummary()
+{
+	// The map is keyed by where the names are, so it's sorted by name here
+	vector<pair<string, const ProfileZoneHistory*>> sorted;
+	for (const auto& pair : zones) {
+		char label[64];
+		if (get<1>(pair.first) != nullptr) {
+			snprintf(label, sizeof(label), "%s (%s %d)", get<0>(pair.first), get<1>(pair.first), get<2>(pair.first));
+		}
+		else {
+			snprintf(label, sizeof(label), "%s", get<0>(pair.first));
+		}
+		sorted.emplace_back(label, &pair.second);
+	}
+	sort(sorted.begin(), sorted.end());
+
+	printf("%-28s %8s %8s %8s %8s\n", "Zone (ms per frame)", "p50", "p95", "p99", "calls");
+	for (const auto& entry : sorted) {
+		const ProfileZoneHistory& zone = *entry.second;
+		if (zone.times.empty()) {
+			continue;
+		}
+		const char* label = entry.first.c_str();
+		printf("%-28s %8.3f %8.3f %8.3f %8d\n", label, Percentile(zone.times, 50), Percentile(zone.times, 95),
+			Percentile(zone.times, 99), Percentile(zone.calls, 50));
+	}
+	printf("%-28s %8s %8s %8s\n", "Counter (per frame)", "p50", "p95", "p99");
+	for (int i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+		printf("%-28s %8lld %8lld %8lld\n", counterNames[i], Percentile(counterHistory[i], 50), Percentile(counterHistory[i], 95),
+			Percentile(counterHistory[i], 99));
+	}
+}
+
+ProfileZone::ProfileZone(const char* name, const char* argName, int arg)
+{
+	active = Profiler::IsEnabled();
+	if (active) {
+		event.name = name;
+		event.argName = argName;
+		event.arg = arg;
+		event.start = Profiler::GetTicks();
+	}
+}
+
+ProfileZone::~ProfileZone()
+{
+	if (active) {
+		event.end = Profiler::GetTicks();
+		Profiler::Record(event);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+
+// Set to 0 to compile every zone and counter out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_RING_SIZE 16384		// Zones a thread can record between EndFrame calls before the oldest are lost. A power of 2.
+#define PROFILER_HISTORY_FRAMES 256		// Frames kept for the summary's percentiles
+
+// Counters, summed over each frame
+#define PROFILER_COUNTER_DRAW_CALLS 0
+#define PROFILER_COUNTER_STATE_CHANGES 1		// Pipeline, depth stencil, rasterizer, scissor, texture, sampler and buffer bindings
+#define PROFILER_COUNTER_CONSTANT_BYTES 2		// Uploaded to constant buffers
+#define PROFILER_COUNTER_DEPTH_CLEARS 3
+#define PROFILER_COUNTER_COUNT 4
+
+// One zone as recorded by a thread
+struct ProfileEvent {
+	const char* name;		// Must live as long as the program, which in practice means a string literal
+	const char* argName;	// Null when the zone has no argument
+	int arg;				// Tells apart zones with the same name, like the recursion level of DrawPortals
+	long long start;		// Profiler::GetTicks()
+	long long end;
+};
+
+// CPU profiler built from scoped zones and per-frame counters. Every thread records its zones into a ring buffer that
+// only it writes and only EndFrame reads, so recording never takes a lock: a zone is two clock reads and a store, cheap
+// enough to leave on. Counters are atomics.
+// EndFrame moves each frame's zones out of the rings into a history of time per frame for every zone, which
+// PrintSummary reports as percentiles, and into a trace while one is being captured. Traces are written in the Chrome
+// trace event format, for chrome://tracing or Perfetto.
+// GPU zones come in through RecordGpu, a few frames late, and are reported alongside the CPU's on a track of their own.
+class Profiler {
+public:
+	Profiler() = delete;
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// Call once per frame, on the main thread, once the frame is done
+	static void EndFrame();
+	static void AddCounter(int counter, long long value);
+
+	// Capture the next frames frames into a trace, then write it to path
+	static void CaptureTrace(const std::string& path, int frames);
+	// Print p50, p95 and p99 of every zone's time per frame and every counter over the recent frames
+	static void PrintSummary();
+
+	static long long GetTicks();
+	static long long GetTicksPerSecond();
+	static void Record(const ProfileEvent& event);
+	// A zone timed on the GPU, already converted to CPU ticks. Call from the main thread.
+	static void RecordGpu(const ProfileEvent& event);
+};
+
+// Times its own lifetime as a zone
+class ProfileZone {
+public:
+	ProfileZone(const char* name, const char* argName = nullptr, int arg = 0);
+	~ProfileZone();
+
+private:
+	ProfileEvent event;
+	bool active;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_ZONE_ARG(name, argName, arg) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name, argName, arg)
+#define PROFILE_COUNTER(counter, value) Profiler::AddCounter(counter, value)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_ARG(name, argName, arg)
+#define PROFILE_COUNTER(counter, value)
+#endif
@@ -0,0 +1,202 @@
+#include "RayTriangle.h"
+#include <float.h>
+
+using namespace DirectX;
+using namespace std;
+
+// Rays closer to parallel with the triangle than this are treated as misses
+#define RAY_TRIANGLE_EPSILON 1e-8f
+
+bool RayTriangle::Intersect(
+	const XMFLOAT3& origin, const XMFLOAT3& direction,
+	const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2,
+	float minDistance, float maxDistance, float& outDistance, float& outU, float& outV)
+{
+	XMFLOAT3 edge1 = XMFLOAT3(v1.x - v0.x, v1.y - v0.y, v1.z - v0.z);
+	XMFLOAT3 edge2 = XMFLOAT3(v2.x - v0.x, v2.y - v0.y, v2.z - v0.z);
+	XMFLOAT3 pvec = XMFLOAT3(
+		direction.y * edge2.z - direction.z * edge2.y,
+		direction.z * edge2.x - direction.x * edge2.z,
+		direction.x * edge2.y - direction.y * edge2.x);
+	float det = edge1.x * pvec.x + edge1.y * pvec.y + edge1.z * pvec.z;
+
+	// If determinant is near zero, ray is parallel to triangle
+	if (det > -RAY_TRIANGLE_EPSILON && det < RAY_TRIANGLE_EPSILON) return false;
+	float invDet = 1.0f / det;
+
+	XMFLOAT3 tvec = XMFLOAT3(origin.x - v0.x, origin.y - v0.y, origin.z - v0.z);
+	float u = (tvec.x * pvec.x + tvec.y * pvec.y + tvec.z * pvec.z) * invDet;
+	if (u < 0.0f || u > 1.0f) return false;
+
+	XMFLOAT3 qvec = XMFLOAT3(
+		tvec.y * edge1.z - tvec.z * edge1.y,
+		tvec.z * edge1.x - tvec.x * edge1.z,
+		tvec.x * edge1.y - tvec.y * edge1.x);
+	float v = (direction.x * qvec.x + direction.y * qvec.y + direction.z * qvec.z) * invDet;
+	if (v < 0.0f || u + v > 1.0f) return false;
+
+	float t = (edge2.x * qvec.x + edge2.y * qvec.y + edge2.z * qvec.z) * invDet;
+	if (t <= minDistance || t >= maxDistance) return false;
+
+	outDistance = t;
+	outU = u;
+	outV = v;
+	return true;
+}
+
+void RayTriangle::BuildBlocks(const XMFLOAT3* positions, size_t triangleCount, vector<TriangleBlock4>& outBlocks)
+{
+	outBlocks.resize((triangleCount + 3) / 4);
+	for (size_t i = 0; i < outBlocks.size(); i++) {
+		size_t count = triangleCount - i * 4 < 4 ? triangleCount - i * 4 : 4;
+		BuildBlock(positions + i * 12, count, outBlocks[i]);
+	}
+}
+
+void RayTriangle::BuildBlock(const XMFLOAT3* positions, size_t triangleCount, TriangleBlock4& outBlock)
+{
+	float* lanes[9] = {
+		&outBlock.v0x.x, &outBlock.v0y.x, &outBlock.v0z.x,
+		&outBlock.e1x.x, &outBlock.e1y.x, &outBlock.e1z.x,
+		&outBlock.e2x.x, &outBlock.e2y.x, &outBlock.e2z.x };
+	for (int lane = 0; lane < 4; lane++) {
+		XMFLOAT3 v0 = XMFLOAT3(0, 0, 0), v1 = v0, v2 = v0;
+		if ((size_t)lane < triangleCount) {
+			v0 = positions[lane * 3];
+			v1 = positions[lane * 3 + 1];
+			v2 = positions[lane * 3 + 2];
+		}
+		float values[9] = {
+			v0.x, v0.y, v0.z,
+			v1.x - v0.x, v1.y - v0.y, v1.z - v0.z,
+			v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
+		for (int i = 0; i < 9; i++) {
+			lanes[i][lane] = values[i];
+		}
+	}
+}
+
+// The shared part of the block tests. Returns the lanes that hit as a mask, and their t, u and v.
+static inline XMVECTOR XM_CALLCONV IntersectBlock4(const TriangleBlock4& block,
+	const XMFLOAT3& origin, const XMFLOAT3& direction, float minDistance, float maxDistance,
+	XMVECTOR& outT, XMVECTOR& outU, XMVECTOR& outV)
+{
+	XMVECTOR dx = XMVectorReplicate(direction.x);
+	XMVECTOR dy = XMVectorReplicate(direction.y);
+	XMVECTOR dz = XMVectorReplicate(direction.z);
+	XMVECTOR e1x = XMLoadFloat4(&block.e1x), e1y = XMLoadFloat4(&block.e1y), e1z = XMLoadFloat4(&block.e1z);
+	XMVECTOR e2x = XMLoadFloat4(&block.e2x), e2y = XMLoadFloat4(&block.e2y), e2z = XMLoadFloat4(&block.e2z);
+
+	// pvec = direction x edge2
+	XMVECTOR px = dy * e2z - dz * e2y;
+	XMVECTOR py = dz * e2x - dx * e2z;
+	XMVECTOR pz = dx * e2y - dy * e2x;
+	XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+	XMVECTOR invDet = XMVectorReciprocal(det);
+
+	// tvec = origin - v0
+	XMVECTOR tx = XMVectorReplicate(origin.x) - XMLoadFloat4(&block.v0x);
+	XMVECTOR ty = XMVectorReplicate(origin.y) - XMLoadFloat4(&block.v0y);
+	XMVECTOR tz = XMVectorReplicate(origin.z) - XMLoadFloat4(&block.v0z);
+	XMVECTOR u = (tx * px + ty * py + tz * pz) * invDet;
+
+	// qvec = tvec x edge1
+	XMVECTOR qx = ty * e1z - tz * e1y;
+	XMVECTOR qy = tz * e1x - tx * e1z;
+	XMVECTOR qz = tx * e1y - ty * e1x;
+	XMVECTOR v = (dx * qx + dy * qy + dz * qz) * invDet;
+	XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+	// Every comparison involving the NaNs from parallel or empty lanes is false, so those lanes drop out too
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR mask = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(RAY_TRIANGLE_EPSILON));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+	mask = XMVectorAndInt(mask, XMVectorLessOrEqual(u + v, one));
+	mask = XMVectorAndInt(mask, XMVectorGreater(t, XMVectorReplicate(minDistance)));
+	mask = XMVectorAndInt(mask, XMVectorLess(t, XMVectorReplicate(maxDistance)));
+
+	outT = t;
+	outU = u;
+	outV = v;
+	return mask;
+}
+
+int RayTriangle::IntersectBlock(const TriangleBlock4& block,
+	const XMFLOAT3& origin, const XMFLOAT3& direction,
+	float minDistance, float maxDistance, float& outDistance, float& outU, float& outV)
+{
+	XMVECTOR t, u, v;
+	XMVECTOR mask = IntersectBlock4(block, origin, direction, minDistance, maxDistance, t, u, v);
+	if (XMComparisonAllTrue(XMVector4EqualIntR(mask, XMVectorFalseInt())))
+		return -1;
+
+	// Pick the closest of the lanes that hit
+	XMFLOAT4 distances, us, vs;
+	XMStoreFloat4(&distances, XMVectorSelect(XMVectorReplicate(FLT_MAX), t, mask));
+	XMStoreFloat4(&us, u);
+	XMStoreFloat4(&vs, v);
+	const float* d = &distances.x;
+	int closest = 0;
+	for (int lane = 1; lane < 4; lane++) {
+		if (d[lane] < d[closest])
+			closest = lane;
+	}
+	outDistance = d[closest];
+	outU = (&us.x)[closest];
+	outV = (&vs.x)[closest];
+	return closest;
+}
+
+bool RayTriangle::IntersectBlockAny(const TriangleBlock4& block,
+	const XMFLOAT3& origin, const XMFLOAT3& direction, float minDistance, float maxDistance)
+{
+	XMVECTOR t, u, v;
+	XMVECTOR mask = IntersectBlock4(block, origin, direction, minDistance, maxDistance, t, u, v);
+	return !XMComparisonAllTrue(XMVector4EqualIntR(mask, XMVectorFalseInt()));
+}
+
+int RayTriangle::IntersectPacket(const RayPacket4& rays,
+	const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2,
+	float minDistance, XMFLOAT4& inOutDistance, XMFLOAT4& outU, XMFLOAT4& outV)
+{
+	// The triangle is the same for every lane, the rays differ
+	XMVECTOR e1x = XMVectorReplicate(v1.x - v0.x), e1y = XMVectorReplicate(v1.y - v0.y), e1z = XMVectorReplicate(v1.z - v0.z);
+	XMVECTOR e2x = XMVectorReplicate(v2.x - v0.x), e2y = XMVectorReplicate(v2.y - v0.y), e2z = XMVectorReplicate(v2.z - v0.z);
+	XMVECTOR dx = XMLoadFloat4(&rays.dx), dy = XMLoadFloat4(&rays.dy), dz = XMLoadFloat4(&rays.dz);
+
+	XMVECTOR px = dy * e2z - dz * e2y;
+	XMVECTOR py = dz * e2x - dx * e2z;
+	XMVECTOR pz = dx * e2y - dy * e2x;
+	XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+	XMVECTOR invDet = XMVectorReciprocal(det);
+
+	XMVECTOR tx = XMLoadFloat4(&rays.ox) - XMVectorReplicate(v0.x);
+	XMVECTOR ty = XMLoadFloat4(&rays.oy) - XMVectorReplicate(v0.y);
+	XMVECTOR tz = XMLoadFloat4(&rays.oz) - XMVectorReplicate(v0.z);
+	XMVECTOR u = (tx * px + ty * py + tz * pz) * invDet;
+
+	XMVECTOR qx = ty * e1z - tz * e1y;
+	XMVECTOR qy = tz * e1x - tx * e1z;
+	XMVECTOR qz = tx * e1y - ty * e1x;
+	XMVECTOR v = (dx * qx + dy * qy + dz * qz) * invDet;
+	XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR closest = XMLoadFloat4(&inOutDistance);
+	XMVECTOR mask = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(RAY_TRIANGLE_EPSILON));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+	mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+	mask = XMVectorAndInt(mask, XMVectorLessOrEqual(u + v, XMVectorSplatOne()));
+	mask = XMVectorAndInt(mask, XMVectorGreater(t, XMVectorReplicate(minDistance)));
+	mask = XMVectorAndInt(mask, XMVectorLess(t, closest));
+
+	XMStoreFloat4(&inOutDistance, XMVectorSelect(closest, t, mask));
+	XMStoreFloat4(&outU, XMVectorSelect(XMLoadFloat4(&outU), u, mask));
+	XMStoreFloat4(&outV, XMVectorSelect(XMLoadFloat4(&outV), v, mask));
+
+	XMFLOAT4 lanes;
+	XMStoreFloat4(&lanes, XMVectorSelect(zero, XMVectorSplatOne(), mask));
+	return (lanes.x != 0 ? 1 : 0) | (lanes.y != 0 ? 2 : 0) | (lanes.z != 0 ? 4 : 0) | (lanes.w != 0 ? 8 : 0);
+}
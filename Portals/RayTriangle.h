@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+
+// Four triangles in structure-of-arrays form: each XMFLOAT4 holds the same component of four triangles.
+// Edges are stored instead of the other two corners since that's what the intersection test needs.
+// Unused lanes have zero edges, which never report a hit.
+struct TriangleBlock4 {
+	DirectX::XMFLOAT4 v0x, v0y, v0z;
+	DirectX::XMFLOAT4 e1x, e1y, e1z;
+	DirectX::XMFLOAT4 e2x, e2y, e2z;
+};
+
+// Four rays in structure-of-arrays form, for testing a bundle of nearby rays against the same triangle
+struct RayPacket4 {
+	DirectX::XMFLOAT4 ox, oy, oz;
+	DirectX::XMFLOAT4 dx, dy, dz;
+};
+
+// Moller-Trumbore ray-triangle tests. Triangles are two sided, and hits count only for distances in
+// (minDistance, maxDistance), measured in units of the ray direction's length.
+// The wide versions use DirectXMath vectors, so they run on SSE/NEON, or plain floats with _XM_NO_INTRINSICS_.
+class RayTriangle {
+public:
+	RayTriangle() = delete;
+
+	// One ray against one triangle, the reference for the wide versions
+	static bool Intersect(
+		const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction,
+		const DirectX::XMFLOAT3& v0, const DirectX::XMFLOAT3& v1, const DirectX::XMFLOAT3& v2,
+		float minDistance, float maxDistance, float& outDistance, float& outU, float& outV);
+
+	// Pack triangles (three corners each) into blocks of four. The last block is padded with empty lanes.
+	static void BuildBlocks(const DirectX::XMFLOAT3* positions, size_t triangleCount, std::vector<TriangleBlock4>& outBlocks);
+	static void BuildBlock(const DirectX::XMFLOAT3* positions, size_t triangleCount, TriangleBlock4& outBlock);
+
+	// One ray against four triangles. Returns the lane of the closest hit, or -1 if none of them were hit.
+	static int IntersectBlock(const TriangleBlock4& block,
+		const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction,
+		float minDistance, float maxDistance, float& outDistance, float& outU, float& outV);
+	// True if the ray hits any of the four triangles
+	static bool IntersectBlockAny(const TriangleBlock4& block,
+		const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float minDistance, float maxDistance);
+
+	// Four rays against one triangle. Lanes closer than their current distance are updated in place.
+	// Returns a bit mask of the lanes that were updated.
+	static int IntersectPacket(const RayPacket4& rays,
+		const DirectX::XMFLOAT3& v0, const DirectX::XMFLOAT3& v1, const DirectX::XMFLOAT3& v2,
+		float minDistance, DirectX::XMFLOAT4& inOutDistance, DirectX::XMFLOAT4& outU, DirectX::XMFLOAT4& outV);
+};
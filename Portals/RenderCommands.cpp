@@ -0,0 +1,280 @@
+#include "RenderCommands.h"
+#include "RenderShader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+void CommandBuffer::Reset()
+{
+	commands.clear();
+	constantData.clear();
+	instanceData.clear();
+}
+
+RenderCommand& CommandBuffer::Add(int type)
+{
+	commands.emplace_back();
+	RenderCommand& command = commands.back();
+	memset(&command, 0, sizeof(RenderCommand));
+	command.type = type;
+	return command;
+}
+
+void CommandBuffer::SetPipeline(RenderHandle vertexShader, RenderHandle pixelShader)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_PIPELINE);
+	command.pipeline.vertexShader = vertexShader;
+	command.pipeline.pixelShader = pixelShader;
+}
+
+void CommandBuffer::SetStencilRef(RenderHandle depthStencilState, unsigned int reference)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_STENCIL_REF);
+	command.stencil.state = depthStencilState;
+	command.stencil.reference = reference;
+}
+
+void CommandBuffer::SetRasterizer(RenderHandle rasterizerState)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_RASTERIZER);
+	command.rasterizer.state = rasterizerState;
+}
+
+void CommandBuffer::SetScissor(int left, int top, int right, int bottom)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_SCISSOR);
+	command.scissor.left = left;
+	command.scissor.top = top;
+	command.scissor.right = right;
+	command.scissor.bottom = bottom;
+}
+
+void CommandBuffer::SetConstants(RenderHandle shader, unsigned int bufferIndex, const void* data, unsigned int size)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_CONSTANTS);
+	command.constants.shader = shader;
+	command.constants.bufferIndex = bufferIndex;
+	command.constants.dataOffset = (unsigned int)constantData.size();
+	command.constants.size = size;
+	constantData.insert(constantData.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+}
+
+void CommandBuffer::SetTexture(unsigned int slot, RenderHandle texture)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_TEXTURE);
+	command.texture.slot = slot;
+	command.texture.resource = texture;
+}
+
+void CommandBuffer::SetSampler(unsigned int slot, RenderHandle sampler)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_SAMPLER);
+	command.texture.slot = slot;
+	command.texture.resource = sampler;
+}
+
+void CommandBuffer::SetConstants(RenderShader* shader)
+{
+	for (unsigned int i = 0; i < shader->GetBufferCount(); i++) {
+		SetConstants(shader, i);
+	}
+}
+
+void CommandBuffer::SetConstants(RenderShader* shader, unsigned int bufferIndex)
+{
+	SetConstants(shader, bufferIndex, shader->GetBufferData(bufferIndex), shader->GetBufferSize(bufferIndex));
+}
+
+bool CommandBuffer::SetTexture(RenderShader* shader, const char* name, RenderHandle texture)
+{
+	int slot = shader->GetTextureSlot(name);
+	if (slot < 0) {
+		return false;
+	}
+	SetTexture((unsigned int)slot, texture);
+	return true;
+}
+
+bool CommandBuffer::SetSampler(RenderShader* shader, const char* name, RenderHandle sampler)
+{
+	int slot = shader->GetSamplerSlot(name);
+	if (slot < 0) {
+		return false;
+	}
+	SetSampler((unsigned int)slot, sampler);
+	return true;
+}
+
+void CommandBuffer::DrawIndexed(RenderHandle vertexBuffer, RenderHandle indexBuffer, unsigned int stride, unsigned int indexCount)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_DRAW_INDEXED);
+	command.draw.vertexBuffer = vertexBuffer;
+	command.draw.indexBuffer = indexBuffer;
+	command.draw.stride = stride;
+	command.draw.indexCount = indexCount;
+}
+
+void CommandBuffer::DrawIndexedInstanced(RenderHandle vertexBuffer, RenderHandle indexBuffer, unsigned int stride, unsigned int indexCount,
+	const void* instances, unsigned int instanceSize, unsigned int instanceCount)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_DRAW_INDEXED_INSTANCED);
+	command.draw.vertexBuffer = vertexBuffer;
+	command.draw.indexBuffer = indexBuffer;
+	command.draw.stride = stride;
+	command.draw.indexCount = indexCount;
+	command.draw.instanceCount = instanceCount;
+	command.draw.instanceSize = instanceSize;
+	command.draw.instanceOffset = (unsigned int)instanceData.size();
+	instanceData.insert(instanceData.end(), (const unsigned char*)instances, (const unsigned char*)instances + instanceSize * instanceCount);
+}
+
+void CommandBuffer::ClearDepth(RenderHandle depthStencilView, float depth)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_CLEAR_DEPTH);
+	command.clearDepth.depthStencilView = depthStencilView;
+	command.clearDepth.depth = depth;
+}
+
+void CommandBuffer::CopyResource(RenderHandle destination, RenderHandle source)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_COPY_RESOURCE);
+	command.copy.destination = destination;
+	command.copy.source = source;
+}
+
+void CommandBuffer::BeginZone(const char* name, const char* argName, int arg)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_BEGIN_ZONE);
+	command.zone.name = name;
+	command.zone.argName = argName;
+	command.zone.arg = arg;
+}
+
+void CommandBuffer::EndZone()
+{
+	Add(RENDER_COMMAND_END_ZONE);
+}
+
+const std::vector<RenderCommand>& CommandBuffer::GetCommands() const
+{
+	return commands;
+}
+
+const unsigned char* CommandBuffer::GetConstantData(const RenderCommand& command) const
+{
+	return constantData.data() + command.constants.dataOffset;
+}
+
+size_t CommandBuffer::GetConstantDataSize() const
+{
+	return constantData.size();
+}
+
+const std::vector<unsigned char>& CommandBuffer::GetInstanceData() const
+{
+	return instanceData;
+}
+
+NullRenderBackend::NullRenderBackend()
+{
+	ResetCounts();
+}
+
+NullRenderBackend::~NullRenderBackend()
+{
+}
+
+void NullRenderBackend::Execute(const CommandBuffer& commands)
+{
+	auto start = chrono::high_resolution_clock::now();
+	for (const RenderCommand& command : commands.GetCommands()) {
+		commandCounts[command.type]++;
+		switch (command.type) {
+		case RENDER_COMMAND_SET_CONSTANTS:
+			constantBytes += command.constants.size;
+			break;
+		case RENDER_COMMAND_DRAW_INDEXED:
+			indexCount += command.draw.indexCount;
+			break;
+		case RENDER_COMMAND_DRAW_INDEXED_INSTANCED:
+			indexCount += (size_t)command.draw.indexCount * command.draw.instanceCount;
+			instanceCount += command.draw.instanceCount;
+			break;
+		}
+	}
+	executeSeconds += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	executeCount++;
+}
+
+RenderHandle NullRenderBackend::CreateVertexBuffer(const void* data, unsigned int size)
+{
+	buffers.emplace_back(new vector<unsigned char>((const unsigned char*)data, (const unsigned char*)data + size));
+	return buffers.back().get();
+}
+
+RenderHandle NullRenderBackend::CreateIndexBuffer(const unsigned int* indices, unsigned int count)
+{
+	return CreateVertexBuffer(indices, count * sizeof(unsigned int));
+}
+
+void NullRenderBackend::DestroyBuffer(RenderHandle buffer)
+{
+	buffers.erase(remove_if(buffers.begin(), buffers.end(),
+		[buffer](const unique_ptr<vector<unsigned char>>& copy) { return copy.get() == buffer; }), buffers.end());
+}
+
+size_t NullRenderBackend::GetBufferCount()
+{
+	return buffers.size();
+}
+
+void NullRenderBackend::ResetCounts()
+{
+	executeCount = 0;
+	memset(commandCounts, 0, sizeof(commandCounts));
+	constantBytes = 0;
+	indexCount = 0;
+	instanceCount = 0;
+	executeSeconds = 0;
+}
+
+int NullRenderBackend::GetExecuteCount()
+{
+	return executeCount;
+}
+
+size_t NullRenderBackend::GetCommandCount()
+{
+	size_t total = 0;
+	for (int i = 0; i < RENDER_COMMAND_TYPE_COUNT; i++) {
+		total += commandCounts[i];
+	}
+	return total;
+}
+
+size_t NullRenderBackend::GetCommandCount(int type)
+{
+	return commandCounts[type];
+}
+
+size_t NullRenderBackend::GetConstantBytes()
+{
+	return constantBytes;
+}
+
+size_t NullRenderBackend::GetIndexCount()
+{
+	return indexCount;
+}
+
+size_t NullRenderBackend::GetInstanceCount()
+{
+	return instanceCount;
+}
+
+double NullRenderBackend::GetExecuteSeconds()
+{
+	return executeSeconds;
+}
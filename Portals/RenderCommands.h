@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Render command types. Commands are recorded into a CommandBuffer and later replayed by a RenderBackend.
+#define RENDER_COMMAND_SET_PIPELINE 0		// Vertex and pixel shader. Without a pixel shader only depth and stencil are drawn.
+#define RENDER_COMMAND_SET_STENCIL_REF 1	// Depth stencil state and the stencil reference value it's used with
+#define RENDER_COMMAND_SET_RASTERIZER 2
+#define RENDER_COMMAND_SET_SCISSOR 3
+#define RENDER_COMMAND_SET_CONSTANTS 4		// Replace the contents of one of a shader's constant buffers
+#define RENDER_COMMAND_SET_TEXTURE 5		// Pixel shader texture slot
+#define RENDER_COMMAND_SET_SAMPLER 6		// Pixel shader sampler slot
+#define RENDER_COMMAND_DRAW_INDEXED 7
+#define RENDER_COMMAND_CLEAR_DEPTH 8
+#define RENDER_COMMAND_COPY_RESOURCE 9
+#define RENDER_COMMAND_DRAW_INDEXED_INSTANCED 10	// Once per instance, each with its own block of instance data
+#define RENDER_COMMAND_BEGIN_ZONE 11	// Start of a named span of commands, for a backend that can time them. Zones nest.
+#define RENDER_COMMAND_END_ZONE 12		// End of the innermost open zone
+#define RENDER_COMMAND_TYPE_COUNT 13
+
+// A shader, state, buffer or texture belonging to the backend. The command buffer only passes it along, and never
+// looks at what it points to. Null means the backend's default. Shaders are always the backend's RenderShaders.
+typedef const void* RenderHandle;
+
+class RenderShader;
+
+// One command. Plain data, so a buffer of them can be copied, sorted or replayed anywhere.
+struct RenderCommand {
+	int type;
+	union {
+		struct { RenderHandle vertexShader; RenderHandle pixelShader; } pipeline;
+		struct { RenderHandle state; unsigned int reference; } stencil;
+		struct { RenderHandle state; } rasterizer;
+		struct { int left; int top; int right; int bottom; } scissor;
+		struct { RenderHandle shader; unsigned int bufferIndex; unsigned int dataOffset; unsigned int size; } constants;
+		struct { unsigned int slot; RenderHandle resource; } texture;	// Also used by samplers
+		struct { RenderHandle vertexBuffer; RenderHandle indexBuffer; unsigned int stride; unsigned int indexCount;
+			unsigned int instanceCount; unsigned int instanceSize; unsigned int instanceOffset; } draw;	// Instances are instanced draws only
+		struct { RenderHandle depthStencilView; float depth; } clearDepth;
+		struct { RenderHandle destination; RenderHandle source; } copy;
+		struct { const char* name; const char* argName; int arg; } zone;	// Same meaning as in a ProfileEvent
+	};
+};
+
+// A frame's worth of rendering, recorded without touching the graphics API. Constant buffer contents are copied into
+// the buffer when they're recorded, so callers can reuse their own copies straight away. Instance data is copied the
+// same way, into one block for the whole frame that a backend can upload in one go.
+class CommandBuffer {
+public:
+	void Reset();
+
+	void SetPipeline(RenderHandle vertexShader, RenderHandle pixelShader);
+	void SetStencilRef(RenderHandle depthStencilState, unsigned int reference);
+	void SetRasterizer(RenderHandle rasterizerState);
+	void SetScissor(int left, int top, int right, int bottom);
+	void SetConstants(RenderHandle shader, unsigned int bufferIndex, const void* data, unsigned int size);
+	void SetTexture(unsigned int slot, RenderHandle texture);
+	void SetSampler(unsigned int slot, RenderHandle sampler);
+	// Record every constant buffer of a shader, as currently set on its CPU side copy
+	void SetConstants(RenderShader* shader);
+	void SetConstants(RenderShader* shader, unsigned int bufferIndex);
+	// Record a texture or sampler by its name in the shader. Returns false if the shader doesn't use it.
+	bool SetTexture(RenderShader* shader, const char* name, RenderHandle texture);
+	bool SetSampler(RenderShader* shader, const char* name, RenderHandle sampler);
+	void DrawIndexed(RenderHandle vertexBuffer, RenderHandle indexBuffer, unsigned int stride, unsigned int indexCount);
+	void DrawIndexedInstanced(RenderHandle vertexBuffer, RenderHandle indexBuffer, unsigned int stride, unsigned int indexCount,
+		const void* instances, unsigned int instanceSize, unsigned int instanceCount);
+	void ClearDepth(RenderHandle depthStencilView, float depth);
+	void CopyResource(RenderHandle destination, RenderHandle source);
+	// The name strings have to outlive the buffer, so use literals
+	void BeginZone(const char* name, const char* argName = nullptr, int arg = 0);
+	void EndZone();
+
+	const std::vector<RenderCommand>& GetCommands() const;
+	// The constants recorded by a RENDER_COMMAND_SET_CONSTANTS command
+	const unsigned char* GetConstantData(const RenderCommand& command) const;
+	size_t GetConstantDataSize() const;
+	// Every instance recorded this frame. A command's instances start instanceOffset bytes in.
+	const std::vector<unsigned char>& GetInstanceData() const;
+
+private:
+	RenderCommand& Add(int type);
+
+	std::vector<RenderCommand> commands;
+	std::vector<unsigned char> constantData;
+	std::vector<unsigned char> instanceData;
+};
+
+// Something that can replay a command buffer, and that owns the buffers its draws read
+class RenderBackend {
+public:
+	virtual ~RenderBackend() {}
+	virtual void Execute(const CommandBuffer& commands) = 0;
+
+	// Buffers whose contents never change once they're made. They stay until destroyed, or the backend is.
+	virtual RenderHandle CreateVertexBuffer(const void* data, unsigned int size) = 0;
+	virtual RenderHandle CreateIndexBuffer(const unsigned int* indices, unsigned int count) = 0;
+	virtual void DestroyBuffer(RenderHandle buffer) = 0;
+};
+
+// Replays nothing: counts the commands by type and times how long walking them takes. Lets the CPU side of a frame
+// be measured without a GPU, or with the GPU's share taken out. Buffers are kept as copies in memory.
+class NullRenderBackend : public RenderBackend {
+public:
+	NullRenderBackend();
+	~NullRenderBackend();
+
+	void Execute(const CommandBuffer& commands) override;
+	RenderHandle CreateVertexBuffer(const void* data, unsigned int size) override;
+	RenderHandle CreateIndexBuffer(const unsigned int* indices, unsigned int count) override;
+	void DestroyBuffer(RenderHandle buffer) override;
+	size_t GetBufferCount();
+
+	// Totals over every Execute since the last reset
+	void ResetCounts();
+	int GetExecuteCount();
+	size_t GetCommandCount();
+	size_t GetCommandCount(int type);
+	size_t GetConstantBytes();
+	size_t GetIndexCount();		// Counting every instance
+	size_t GetInstanceCount();
+	double GetExecuteSeconds();
+
+private:
+	int executeCount;
+	size_t commandCounts[RENDER_COMMAND_TYPE_COUNT];
+	size_t constantBytes;
+	size_t indexCount;
+	size_t instanceCount;
+	double executeSeconds;
+	std::vector<std::unique_ptr<std::vector<unsigned char>>> buffers;
+};
@@ -0,0 +1,28 @@
+#include "RenderShader.h"
+
+using namespace DirectX;
+
+bool RenderShader::SetInt(const char* name, int data)
+{
+	return SetData(name, &data, sizeof(int));
+}
+
+bool RenderShader::SetFloat(const char* name, float data)
+{
+	return SetData(name, &data, sizeof(float));
+}
+
+bool RenderShader::SetFloat3(const char* name, const XMFLOAT3& data)
+{
+	return SetData(name, &data, sizeof(XMFLOAT3));
+}
+
+bool RenderShader::SetFloat4(const char* name, const XMFLOAT4& data)
+{
+	return SetData(name, &data, sizeof(XMFLOAT4));
+}
+
+bool RenderShader::SetMatrix4x4(const char* name, const XMFLOAT4X4& data)
+{
+	return SetData(name, &data, sizeof(XMFLOAT4X4));
+}
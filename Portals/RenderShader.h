@@ -0,0 +1,38 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Where a shader variable lives in the shader's constant buffers
+struct RenderShaderVariable {
+	unsigned int buffer;	// Index of the constant buffer holding it
+	unsigned int offset;	// In bytes, from the start of the buffer
+	unsigned int size;
+};
+
+// A compiled shader as seen by the code that records commands. Each constant buffer has a CPU side copy: variables
+// are set in it by name, then CommandBuffer::SetConstants records it. Textures and samplers are looked up by name for
+// the slot they're bound to. A backend wraps its own shader objects in this, and gets them back as pipeline and
+// constants handles.
+class RenderShader {
+public:
+	virtual ~RenderShader() {}
+
+	virtual unsigned int GetBufferCount() = 0;
+	virtual unsigned int GetBufferSize(unsigned int index) = 0;
+	// The CPU side copy of a constant buffer, as its variables were last set
+	virtual const void* GetBufferData(unsigned int index) = 0;
+	// Returns false if the shader has no variable by that name
+	virtual bool GetVariable(const char* name, RenderShaderVariable& outVariable) = 0;
+	// Copy data over a variable in the CPU side copy. Returns false if there's no such variable, or the data is bigger
+	// than it is. Less than the whole variable can be set, like part of an array.
+	virtual bool SetData(const char* name, const void* data, unsigned int size) = 0;
+	// Slot a texture or sampler is bound to, or -1 if the shader doesn't use it
+	virtual int GetTextureSlot(const char* name) = 0;
+	virtual int GetSamplerSlot(const char* name) = 0;
+
+	bool SetInt(const char* name, int data);
+	bool SetFloat(const char* name, float data);
+	bool SetFloat3(const char* name, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const char* name, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4& data);
+};
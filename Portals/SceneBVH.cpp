@@ -0,0 +1,393 @@
+#include "SceneBVH.h"
+#include <algorithm>
+#include <float.h>
+
+using namespace DirectX;
+using namespace std;
+
+// How far leaf boxes are enlarged on every side, in world units
+#define SCENE_BVH_MARGIN 0.1f
+// Deepest traversal stack, far beyond the height of a balanced tree with millions of entities
+#define SCENE_BVH_STACK_SIZE 256
+
+static XMFLOAT3 Min3(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return XMFLOAT3((std::min)(a.x, b.x), (std::min)(a.y, b.y), (std::min)(a.z, b.z));
+}
+
+static XMFLOAT3 Max3(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return XMFLOAT3((std::max)(a.x, b.x), (std::max)(a.y, b.y), (std::max)(a.z, b.z));
+}
+
+static float HalfArea(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	float x = boundsMax.x - boundsMin.x;
+	float y = boundsMax.y - boundsMin.y;
+	float z = boundsMax.z - boundsMin.z;
+	return x * y + y * z + z * x;
+}
+
+// Slab test against the segment (0, maxDistance]. Returns the entry distance, or FLT_MAX on a miss.
+static float IntersectBounds(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax,
+	const XMFLOAT3& origin, const XMFLOAT3& invDirection, float maxDistance)
+{
+	float tx1 = (boundsMin.x - origin.x) * invDirection.x, tx2 = (boundsMax.x - origin.x) * invDirection.x;
+	float tmin = (std::min)(tx1, tx2), tmax = (std::max)(tx1, tx2);
+	float ty1 = (boundsMin.y - origin.y) * invDirection.y, ty2 = (boundsMax.y - origin.y) * invDirection.y;
+	tmin = (std::max)(tmin, (std::min)(ty1, ty2)), tmax = (std::min)(tmax, (std::max)(ty1, ty2));
+	float tz1 = (boundsMin.z - origin.z) * invDirection.z, tz2 = (boundsMax.z - origin.z) * invDirection.z;
+	tmin = (std::max)(tmin, (std::min)(tz1, tz2)), tmax = (std::min)(tmax, (std::max)(tz1, tz2));
+	if (tmax >= tmin && tmin < maxDistance && tmax > 0)
+		return tmin;
+	return FLT_MAX;
+}
+
+SceneBVH::SceneBVH()
+{
+}
+
+SceneBVH::~SceneBVH()
+{
+}
+
+void SceneBVH::Insert(Entity* entity)
+{
+	int leaf = AllocateNode();
+	nodes[leaf].entity = entity;
+	nodes[leaf].tags = entity->GetTags();
+	SetLeafBounds(leaf, entity);
+	InsertLeaf(leaf);
+
+	Proxy proxy;
+	proxy.entity = entity;
+	proxy.leaf = leaf;
+	proxy.boundsVersion = entity->GetBoundsVersion();
+	proxies.push_back(proxy);
+}
+
+void SceneBVH::Remove(Entity* entity)
+{
+	for (size_t i = 0; i < proxies.size(); i++) {
+		if (proxies[i].entity == entity) {
+			RemoveLeaf(proxies[i].leaf);
+			FreeNode(proxies[i].leaf);
+			proxies[i] = proxies.back();
+			proxies.pop_back();
+			return;
+		}
+	}
+}
+
+void SceneBVH::Update()
+{
+	for (Proxy& proxy : proxies) {
+		// Recomputes the box if the transform changed, and bumps the version if it did
+		BoundingBox box = proxy.entity->GetBoundingBox();
+		unsigned int tags = proxy.entity->GetTags();
+		if (proxy.boundsVersion == proxy.entity->GetBoundsVersion() && nodes[proxy.leaf].tags == tags)
+			continue;
+		proxy.boundsVersion = proxy.entity->GetBoundsVersion();
+
+		// Still inside the enlarged box, so the tree doesn't need to change
+		Node& leaf = nodes[proxy.leaf];
+		XMFLOAT3 boxMin = XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z);
+		XMFLOAT3 boxMax = XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z);
+		if (leaf.tags == tags &&
+			boxMin.x >= leaf.boundsMin.x && boxMin.y >= leaf.boundsMin.y && boxMin.z >= leaf.boundsMin.z &&
+			boxMax.x <= leaf.boundsMax.x && boxMax.y <= leaf.boundsMax.y && boxMax.z <= leaf.boundsMax.z)
+			continue;
+
+		RemoveLeaf(proxy.leaf);
+		nodes[proxy.leaf].tags = tags;
+		SetLeafBounds(proxy.leaf, proxy.entity);
+		InsertLeaf(proxy.leaf);
+	}
+}
+
+bool SceneBVH::RaycastScene(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, unsigned int tagMask, SceneRayHit& outHit)
+{
+	if (root < 0)
+		return false;
+
+	XMFLOAT3 invDirection = XMFLOAT3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	XMFLOAT3 end = XMFLOAT3(origin.x + direction.x, origin.y + direction.y, origin.z + direction.z);
+	float closest = maxDistance;
+	bool hit = false;
+
+	// Nodes waiting to be visited, with the distance where the ray enters them
+	int stack[SCENE_BVH_STACK_SIZE];
+	float stackDistance[SCENE_BVH_STACK_SIZE];
+	int stackSize = 0;
+	if ((nodes[root].tags & tagMask) == 0)
+		return false;
+	stack[0] = root;
+	stackDistance[0] = IntersectBounds(nodes[root].boundsMin, nodes[root].boundsMax, origin, invDirection, closest);
+	stackSize = stackDistance[0] == FLT_MAX ? 0 : 1;
+	while (stackSize > 0) {
+		stackSize--;
+		if (stackDistance[stackSize] >= closest)
+			continue;
+		const Node& node = nodes[stack[stackSize]];
+
+		if (node.child1 >= 0) {
+			// Push the farther child first, so the nearer one is visited first and can shorten the ray
+			int children[2] = { node.child1, node.child2 };
+			float distances[2];
+			for (int i = 0; i < 2; i++) {
+				const Node& child = nodes[children[i]];
+				distances[i] = (child.tags & tagMask) == 0 ? FLT_MAX :
+					IntersectBounds(child.boundsMin, child.boundsMax, origin, invDirection, closest);
+			}
+			int nearChild = distances[0] <= distances[1] ? 0 : 1;
+			for (int i = 1; i >= 0; i--) {
+				int child = i == 0 ? nearChild : 1 - nearChild;
+				if (distances[child] != FLT_MAX && stackSize < SCENE_BVH_STACK_SIZE) {
+					stack[stackSize] = children[child];
+					stackDistance[stackSize] = distances[child];
+					stackSize++;
+				}
+			}
+			continue;
+		}
+
+		// Move the ray into the entity's local space. Distances along it stay the same, since the transform is affine.
+		Entity* entity = node.entity;
+		XMFLOAT3 points[2] = { origin, end };
+		entity->GetTransform()->InverseTransformPoints(points, points, 2);
+		XMFLOAT3 localDirection = XMFLOAT3(points[1].x - points[0].x, points[1].y - points[0].y, points[1].z - points[0].z);
+
+		RayHit meshHit;
+		if (!entity->GetMesh()->GetBVH().Raycast(points[0], localDirection, closest, meshHit))
+			continue;
+		closest = meshHit.distance;
+		hit = true;
+		outHit.entity = entity;
+		outHit.triangle = meshHit.triangle;
+		outHit.distance = meshHit.distance;
+
+		// Interpolate the vertex normals with the barycentrics of the hit
+		const vector<Vertex>& vertices = entity->GetMesh()->GetVertices();
+		const vector<unsigned int>& indices = entity->GetMesh()->GetIndices();
+		float w = 1.0f - meshHit.u - meshHit.v;
+		XMVECTOR normal =
+			XMLoadFloat3(&vertices[indices[meshHit.triangle * 3]].Normal) * w +
+			XMLoadFloat3(&vertices[indices[meshHit.triangle * 3 + 1]].Normal) * meshHit.u +
+			XMLoadFloat3(&vertices[indices[meshHit.triangle * 3 + 2]].Normal) * meshHit.v;
+		XMFLOAT4X4 worldInvTranspose = entity->GetTransform()->GetWorldInverseTranspose();
+		XMStoreFloat3(&outHit.normal, XMVector3Normalize(XMVector3TransformNormal(normal, XMLoadFloat4x4(&worldInvTranspose))));
+	}
+
+	if (hit) {
+		outHit.point = XMFLOAT3(
+			origin.x + direction.x * closest,
+			origin.y + direction.y * closest,
+			origin.z + direction.z * closest);
+	}
+	return hit;
+}
+
+size_t SceneBVH::GetEntityCount()
+{
+	return proxies.size();
+}
+
+int SceneBVH::GetHeight()
+{
+	return root < 0 ? 0 : nodes[root].height;
+}
+
+int SceneBVH::AllocateNode()
+{
+	int index;
+	if (freeList >= 0) {
+		index = freeList;
+		freeList = nodes[index].parent;
+	}
+	else {
+		index = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+	Node& node = nodes[index];
+	node.parent = -1;
+	node.child1 = -1;
+	node.child2 = -1;
+	node.height = 0;
+	node.tags = 0;
+	node.entity = nullptr;
+	return index;
+}
+
+void SceneBVH::FreeNode(int index)
+{
+	nodes[index].parent = freeList;
+	nodes[index].height = -1;
+	freeList = index;
+}
+
+void SceneBVH::SetLeafBounds(int leaf, Entity* entity)
+{
+	BoundingBox box = entity->GetBoundingBox();
+	float margin = SCENE_BVH_MARGIN;
+	nodes[leaf].boundsMin = XMFLOAT3(
+		box.Center.x - box.Extents.x - margin,
+		box.Center.y - box.Extents.y - margin,
+		box.Center.z - box.Extents.z - margin);
+	nodes[leaf].boundsMax = XMFLOAT3(
+		box.Center.x + box.Extents.x + margin,
+		box.Center.y + box.Extents.y + margin,
+		box.Center.z + box.Extents.z + margin);
+}
+
+void SceneBVH::Refit(int index)
+{
+	Node& node = nodes[index];
+	const Node& child1 = nodes[node.child1];
+	const Node& child2 = nodes[node.child2];
+	node.boundsMin = Min3(child1.boundsMin, child2.boundsMin);
+	node.boundsMax = Max3(child1.boundsMax, child2.boundsMax);
+	node.height = 1 + (std::max)(child1.height, child2.height);
+	node.tags = child1.tags | child2.tags;
+}
+
+void SceneBVH::InsertLeaf(int leaf)
+{
+	if (root < 0) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	// Walk down to the sibling that grows the total surface area the least
+	XMFLOAT3 leafMin = nodes[leaf].boundsMin;
+	XMFLOAT3 leafMax = nodes[leaf].boundsMax;
+	int index = root;
+	while (nodes[index].child1 >= 0) {
+		const Node& node = nodes[index];
+		float area = HalfArea(node.boundsMin, node.boundsMax);
+		float combinedArea = HalfArea(Min3(node.boundsMin, leafMin), Max3(node.boundsMax, leafMax));
+
+		// Cost of making a new parent for this node and the leaf, and the cost every level below pays for growing
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		int children[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; i++) {
+			const Node& child = nodes[children[i]];
+			float grown = HalfArea(Min3(child.boundsMin, leafMin), Max3(child.boundsMax, leafMax));
+			childCost[i] = child.child1 < 0 ? grown + inheritanceCost : grown - HalfArea(child.boundsMin, child.boundsMax) + inheritanceCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	// Replace the sibling with a new parent holding both
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+	if (oldParent >= 0) {
+		if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	}
+	else {
+		root = newParent;
+	}
+
+	// Fix the boxes, heights and tags back up to the root
+	index = newParent;
+	while (index >= 0) {
+		index = Balance(index);
+		Refit(index);
+		index = nodes[index].parent;
+	}
+}
+
+void SceneBVH::RemoveLeaf(int leaf)
+{
+	if (leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	// The sibling takes the parent's place
+	if (grandParent >= 0) {
+		if (nodes[grandParent].child1 == parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+
+		int index = grandParent;
+		while (index >= 0) {
+			index = Balance(index);
+			Refit(index);
+			index = nodes[index].parent;
+		}
+	}
+	else {
+		root = sibling;
+		nodes[sibling].parent = -1;
+		FreeNode(parent);
+	}
+}
+
+// If one child of a is two levels taller than the other, rotate its taller grandchild into the shorter side.
+// Returns the index of the node now in a's place.
+int SceneBVH::Balance(int a)
+{
+	if (nodes[a].child1 < 0 || nodes[a].height < 2)
+		return a;
+
+	int b = nodes[a].child1;
+	int c = nodes[a].child2;
+	int balance = nodes[c].height - nodes[b].height;
+	if (balance >= -1 && balance <= 1)
+		return a;
+
+	// up is the taller child, which takes a's place. a keeps the shorter child and gets one of up's children.
+	int up = balance > 1 ? c : b;
+	int f = nodes[up].child1;
+	int g = nodes[up].child2;
+
+	nodes[up].child1 = a;
+	nodes[up].parent = nodes[a].parent;
+	nodes[a].parent = up;
+	if (nodes[up].parent >= 0) {
+		if (nodes[nodes[up].parent].child1 == a)
+			nodes[nodes[up].parent].child1 = up;
+		else
+			nodes[nodes[up].parent].child2 = up;
+	}
+	else {
+		root = up;
+	}
+
+	// up keeps its taller child, a takes the other
+	int keep = nodes[f].height > nodes[g].height ? f : g;
+	int give = keep == f ? g : f;
+	nodes[up].child2 = keep;
+	if (up == c)
+		nodes[a].child2 = give;
+	else
+		nodes[a].child1 = give;
+	nodes[give].parent = a;
+
+	Refit(a);
+	Refit(up);
+	return up;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "Entity.h"
+
+// Result of a ray cast against the whole scene, in world space
+struct SceneRayHit {
+	Entity* entity;
+	unsigned int triangle;		// Index of the hit triangle in the entity mesh's index buffer (first index / 3)
+	float distance;				// Along the ray direction, in units of its length
+	DirectX::XMFLOAT3 point;
+	DirectX::XMFLOAT3 normal;	// Vertex normals interpolated at the hit point, normalized
+};
+
+// Dynamic AABB tree over the world bounds of the entities in the scene. Leaves hold slightly enlarged boxes, so an
+// entity that moves a little doesn't change the tree at all, and one that leaves its box is removed and reinserted.
+// Inserts pick the sibling with the lowest surface area cost and the tree is kept balanced with rotations, so ray
+// casts touch roughly log(n) entities no matter how large the level gets.
+class SceneBVH {
+public:
+	SceneBVH();
+	~SceneBVH();
+
+	void Insert(Entity* entity);
+	void Remove(Entity* entity);
+	// Refit the leaves of entities whose bounds changed since the last update
+	void Update();
+
+	// Closest hit along origin + direction * t for t in (0, maxDistance], against the exact triangles of every
+	// entity with at least one of the tags in tagMask.
+	bool RaycastScene(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, unsigned int tagMask, SceneRayHit& outHit);
+
+	size_t GetEntityCount();
+	int GetHeight();
+
+private:
+	// Leaves have child1 == -1. Interior nodes hold the union of their children's boxes and tags.
+	struct Node {
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		int parent;
+		int child1;
+		int child2;
+		int height;			// 0 for leaves, -1 for free nodes
+		unsigned int tags;
+		Entity* entity;
+	};
+
+	struct Proxy {
+		Entity* entity;
+		int leaf;
+		unsigned int boundsVersion;
+	};
+
+	int AllocateNode();
+	void FreeNode(int index);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int index);
+	void Refit(int index);
+	void SetLeafBounds(int leaf, Entity* entity);
+
+	std::vector<Node> nodes;
+	std::vector<Proxy> proxies;
+	int root = -1;
+	int freeList = -1;		// Free nodes are chained through their parent index
+};
@@ -34,6 +34,44 @@ struct VertexShaderInput
 	float2 uv			: TEXCOORD;
 };
 
+// Compressed version of the above, matching PackedVertex in Vertex.h.
+// The input layout converts each member to floats before the shader sees them.
+struct PackedVertexShaderInput
+{
+	float4 position		: POSITION;     // unorm16, XYZ relative to the mesh's bounding box
+	float2 normal		: NORMAL;       // snorm16, octahedral encoded
+	float2 tangent		: TANGENT;      // snorm16, octahedral encoded
+	float2 uv			: TEXCOORD;     // half floats
+};
+
+// Per-instance data for the instanced vertex shaders, matching InstanceData in Vertex.h.
+// Comes from the second vertex buffer, which advances once per instance instead of once per vertex.
+struct InstanceInput
+{
+	float4 world0				: WORLD_PER_INSTANCE0;	// Rows of the world matrix
+	float4 world1				: WORLD_PER_INSTANCE1;
+	float4 world2				: WORLD_PER_INSTANCE2;
+	float4 world3				: WORLD_PER_INSTANCE3;
+	float4 inverseTranspose0	: INVERSE_TRANSPOSE_PER_INSTANCE0;	// Rows of the world inverse transpose
+	float4 inverseTranspose1	: INVERSE_TRANSPOSE_PER_INSTANCE1;
+	float4 inverseTranspose2	: INVERSE_TRANSPOSE_PER_INSTANCE2;
+	float4 inverseTranspose3	: INVERSE_TRANSPOSE_PER_INSTANCE3;
+	float4 clipPlane			: CLIP_PLANE_PER_INSTANCE;	// World space, (0, 0, 0, 1) keeps everything
+};
+
+// Rebuild a matrix from the rows of an XMFLOAT4X4, so it matches the same matrix read from a constant buffer
+matrix InstanceMatrix(float4 row0, float4 row1, float4 row2, float4 row3) {
+	return transpose(float4x4(row0, row1, row2, row3));
+}
+
+// Unfold an octahedral encoded unit vector
+float3 DecodeOctahedral(float2 encoded) {
+	float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0 ? -t : t;
+	return normalize(n);
+}
+
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
 // - At a minimum, we need a piece of data defined tagged as SV_POSITION
@@ -47,6 +85,7 @@ struct VertexToPixel
 	float2 uv				: TEXCOORD;
 	float3 worldPosition	: POSITION;
 	float3 screenPosition	: SCREENPOSITION;
+	float clipDistance		: SV_ClipDistance0;	// Negative on the far side of the clip plane, which is cut away
 };
 struct VertexToPixel_Sky
 {
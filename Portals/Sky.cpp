@@ -1,8 +1,8 @@
 #include "Sky.h"
 
 Sky::Sky(const wchar_t* cubemapDDSFile, 
-	SimpleVertexShader* vs, 
-	SimplePixelShader* ps, 
+	RenderShader* vs, 
+	RenderShader* ps, 
 	Mesh* mesh, 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, 
 	Microsoft::WRL::ComPtr<ID3D11Device> device,
@@ -33,28 +33,27 @@ Sky::Sky(const wchar_t* cubemapDDSFile,
 	DirectX::CreateDDSTextureFromFile(device.Get(), cubemapDDSFile, 0, cubeMapSRV.GetAddressOf());
 }
 
-void Sky::Draw(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat)
+void Sky::Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat)
 {
 	// Change to the rasterizer and depth stencil state for drawing the sky.
-	context->RSSetState(rasterizerState.Get());
-	context->OMSetDepthStencilState(depthState.Get(), 0);
+	commands.SetRasterizer(rasterizerState.Get());
+	commands.SetStencilRef(depthState.Get(), 0);
 	// Set the sky shaders.
-	vertexShader->SetShader();
-	pixelShader->SetShader();
+	commands.SetPipeline(vertexShader, pixelShader);
 
 	// Give them proper data
 	vertexShader->SetMatrix4x4("view", viewMat);
 	vertexShader->SetMatrix4x4("projection", viewMat);
-	vertexShader->CopyAllBufferData();
+	commands.SetConstants(vertexShader);
 
 	// Send the proper resources to the pixel shader
-	pixelShader->SetShaderResourceView("SkyTexture", cubeMapSRV);
-	pixelShader->SetSamplerState("BasicSampler", samplerOptions);
+	commands.SetTexture(pixelShader, "SkyTexture", cubeMapSRV.Get());
+	commands.SetSampler(pixelShader, "BasicSampler", samplerOptions.Get());
 
 	// Draw the sky box.
-	skyMesh->Draw();
+	skyMesh->Draw(commands);
 
 	// Reset my rasterizer state to the default
-	context->RSSetState(0); // Null (or 0) puts back the defaults
-	context->OMSetDepthStencilState(0, 0);
+	commands.SetRasterizer(nullptr); // Null puts back the defaults
+	commands.SetStencilRef(nullptr, 0);
 }
@@ -1,23 +1,24 @@
 #pragma once
 
+#include <d3d11.h>
 #include <wrl/client.h>
 #include <DDSTextureLoader.h>
 #include "Mesh.h"
-#include "SimpleShader.h"
+#include "RenderShader.h"
 #include "Camera.h"
 using namespace DirectX;
 class Sky
 {
 public:
 	Sky(const wchar_t* cubemapDDSFile,
-		SimpleVertexShader* vs,
-		SimplePixelShader* ps,
+		RenderShader* vs,
+		RenderShader* ps,
 		Mesh* mesh,
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState,
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
 	);
-	void Draw(XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat);
+	void Draw(CommandBuffer& commands, XMFLOAT4X4 viewMat, XMFLOAT4X4 projMat);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
@@ -27,6 +28,6 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthState;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
 	Mesh* skyMesh;
-	SimplePixelShader* pixelShader;
-	SimpleVertexShader* vertexShader;
+	RenderShader* pixelShader;
+	RenderShader* vertexShader;
 };
@@ -13,9 +13,16 @@ Transform::Transform()
 
     XMMATRIX ident = XMMatrixIdentity();
     XMStoreFloat4x4(&worldMatrix, ident);
+    XMStoreFloat4x4(&worldInverseMatrix, ident);
     XMStoreFloat4x4(&worldInverseTransposeMatrix, ident);
 
+    rotationQuaternion = XMFLOAT4(0, 0, 0, 1);
+    basisRight = rightVector;
+    basisUp = upVector;
+    basisForward = forwardVector;
+
     matricesDirty = false;
+    rotationDirty = false;
 }
 
 Transform::~Transform()
@@ -59,13 +66,9 @@ DirectX::XMFLOAT4X4 Transform::GetWorldInverseTranspose()
 
 DirectX::XMFLOAT3 Transform::GetUp()
 {
-    // Take the world up vector (0, 1, 0) and rotate it by
-    // our orientation values.
-    XMVECTOR localUp = XMVector3Rotate(
-        XMVectorSet(0, 1, 0, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))
-    );
-    XMStoreFloat3(&upVector, localUp);
+    // The world up vector (0, 1, 0) rotated by our orientation values.
+    UpdateRotation();
+    upVector = basisUp;
     return upVector;
 }
 
@@ -73,13 +76,9 @@ DirectX::XMFLOAT3 Transform::GetRight()
 {
     if(!rotated)
         return rightVector;
-    // Take the world right vector (1, 0, 0) and rotate it by
-    // our orientation values.
-    XMVECTOR localRight = XMVector3Rotate(
-        XMVectorSet(1, 0, 0, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))
-    );
-    XMStoreFloat3(&rightVector, localRight);
+    // The world right vector (1, 0, 0) rotated by our orientation values.
+    UpdateRotation();
+    rightVector = basisRight;
     return rightVector;
 }
 
@@ -87,13 +86,9 @@ DirectX::XMFLOAT3 Transform::GetForward()
 {
     if(!rotated)
         return forwardVector;
-    // Take the world forward vector (0, 0, 1) and rotate it by
-    // our orientation values.
-    XMVECTOR localForward = XMVector3Rotate(
-        XMVectorSet(0, 0, 1, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))
-    );
-    XMStoreFloat3(&forwardVector, localForward);
+    // The world forward vector (0, 0, 1) rotated by our orientation values.
+    UpdateRotation();
+    forwardVector = basisForward;
     return forwardVector;
 }
 
@@ -110,6 +105,7 @@ void Transform::SetPitchYawRoll(float pitch, float yaw, float roll)
     pitchYawRoll = XMFLOAT3(pitch, yaw, roll);
 
     matricesDirty = true;
+    rotationDirty = true;
     boundsDirty = true;
     rotated = true;
 }
@@ -134,13 +130,19 @@ void Transform::MoveAbsolute(float x, float y, float z)
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-    XMVECTOR rotatedVector = XMVector3Rotate(
-        XMVectorSet(x, y, z, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
+    // Rotating the offset is just a sum of the basis vectors
+    UpdateRotation();
+    XMVECTOR rotatedVector =
+        XMLoadFloat3(&basisRight) * x +
+        XMLoadFloat3(&basisUp) * y +
+        XMLoadFloat3(&basisForward) * z;
 
     XMStoreFloat3(
         &position,
         XMLoadFloat3(&position) + rotatedVector);
+
+    matricesDirty = true;
+    boundsDirty = true;
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
@@ -150,6 +152,7 @@ void Transform::Rotate(float pitch, float yaw, float roll)
     pitchYawRoll.z += roll;
 
     matricesDirty = true;
+    rotationDirty = true;
     boundsDirty = true;
     rotated = true;
 }
@@ -185,44 +188,37 @@ void Transform::SetForward(XMFLOAT3 forward)
 // Convert from local space to world space.
 DirectX::XMFLOAT3 Transform::TransformPoint(DirectX::XMFLOAT3 point)
 {
-    XMMATRIX rotMatrix = XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z));
-    XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
+    UpdateMatrices();
+
     XMFLOAT3 newPos;
-    XMStoreFloat3(
-        &newPos, 
-        XMVector4Transform(
-            XMVector4Transform(
-                XMVectorSet(point.x, point.y, point.z, 0), 
-                scaleMatrix), 
-            rotMatrix) 
-        + XMVectorSet(position.x, position.y, position.z, 0)
-    );
+    XMStoreFloat3(&newPos, XMVector3TransformCoord(XMLoadFloat3(&point), XMLoadFloat4x4(&worldMatrix)));
     return newPos;
 }
 
 // Convert from world space to local space.
 DirectX::XMFLOAT3 Transform::InverseTransformPoint(DirectX::XMFLOAT3 point)
 {
-    XMVECTOR pointV = XMLoadFloat3(&point);
-    XMVECTOR positionV = XMLoadFloat3(&position);
-    XMVECTOR sub = XMVectorSubtract(pointV, positionV);
-    XMMATRIX inverseRotationMatrix = XMMatrixRotationQuaternion(XMQuaternionInverse(XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z)));
-    XMMATRIX scaleMatrix = XMMatrixScaling(1 / scale.x, 1 / scale.y, 1 / scale.z);
+    UpdateMatrices();
 
     XMFLOAT3 retVal;
-    XMStoreFloat3(
-        &retVal,
-        XMVector4Transform(
-            XMVector4Transform(
-                sub,
-                inverseRotationMatrix
-            ),
-            scaleMatrix
-        )
-    );
+    XMStoreFloat3(&retVal, XMVector3TransformCoord(XMLoadFloat3(&point), XMLoadFloat4x4(&worldInverseMatrix)));
     return retVal;
 }
 
+void Transform::TransformPoints(const DirectX::XMFLOAT3* in, DirectX::XMFLOAT3* out, size_t count)
+{
+    UpdateMatrices();
+
+    XMVector3TransformCoordStream(out, sizeof(XMFLOAT3), in, sizeof(XMFLOAT3), count, XMLoadFloat4x4(&worldMatrix));
+}
+
+void Transform::InverseTransformPoints(const DirectX::XMFLOAT3* in, DirectX::XMFLOAT3* out, size_t count)
+{
+    UpdateMatrices();
+
+    XMVector3TransformCoordStream(out, sizeof(XMFLOAT3), in, sizeof(XMFLOAT3), count, XMLoadFloat4x4(&worldInverseMatrix));
+}
+
 void Transform::UpdateMatrices()
 {
     // Do we actually need to update anything?
@@ -231,8 +227,9 @@ void Transform::UpdateMatrices()
 
     // Actually update the matrices by creating the
     // individual transformation matrices and combining
+    UpdateRotation();
     XMMATRIX transMat = XMMatrixTranslation(position.x, position.y, position.z);
-    XMMATRIX rotMat = XMMatrixRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+    XMMATRIX rotMat = XMMatrixRotationQuaternion(XMLoadFloat4(&rotationQuaternion));
     XMMATRIX scaleMat = XMMatrixScaling(scale.x, scale.y, scale.z);
 
     // Combine into a single matrix that represents all transformations
@@ -240,12 +237,34 @@ void Transform::UpdateMatrices()
     XMMATRIX worldMat = scaleMat * rotMat * transMat; // S-R-T
     XMStoreFloat4x4(&worldMatrix, worldMat);
 
-    // While we're at it, might as well create the inverse transpose matrix, too
-    XMStoreFloat4x4(
-        &worldInverseTransposeMatrix,
-        XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
+    // The inverse undoes each step in reverse order, and the rotation's inverse is its transpose,
+    // so there's no need for a general inverse.
+    XMMATRIX invMat =
+        XMMatrixTranslation(-position.x, -position.y, -position.z) *
+        XMMatrixTranspose(rotMat) *
+        XMMatrixScaling(1 / scale.x, 1 / scale.y, 1 / scale.z);
+    XMStoreFloat4x4(&worldInverseMatrix, invMat);
 
+    // While we're at it, might as well create the inverse transpose matrix, too
+    XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixTranspose(invMat));
 
     // We're clean again
     matricesDirty = false;
 }
+
+void Transform::UpdateRotation()
+{
+    if (!rotationDirty)
+        return;
+
+    XMVECTOR quat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+    XMStoreFloat4(&rotationQuaternion, quat);
+
+    // The rows of the rotation matrix are the local axes in world space
+    XMMATRIX rotMat = XMMatrixRotationQuaternion(quat);
+    XMStoreFloat3(&basisRight, rotMat.r[0]);
+    XMStoreFloat3(&basisUp, rotMat.r[1]);
+    XMStoreFloat3(&basisForward, rotMat.r[2]);
+
+    rotationDirty = false;
+}
@@ -2,6 +2,9 @@
 #include <DirectXMath.h>
 class Transform
 {
+    // Batch updates read the raw data and write the matrices back directly
+    friend class TransformSystem;
+
 public:
     Transform();
     ~Transform();
@@ -34,6 +37,9 @@ public:
 
     DirectX::XMFLOAT3 TransformPoint(DirectX::XMFLOAT3 point);
     DirectX::XMFLOAT3 InverseTransformPoint(DirectX::XMFLOAT3 point);
+    // Batch versions for many points at once (box corners, ray end points). in and out may be the same array.
+    void TransformPoints(const DirectX::XMFLOAT3* in, DirectX::XMFLOAT3* out, size_t count);
+    void InverseTransformPoints(const DirectX::XMFLOAT3* in, DirectX::XMFLOAT3* out, size_t count);
     // Used to track if the Transform has changed and the Entity needs to update its bounding box.
     bool boundsDirty = false;
 
@@ -50,10 +56,19 @@ private:
     // Matrices
     bool matricesDirty;
     DirectX::XMFLOAT4X4 worldMatrix;
+    DirectX::XMFLOAT4X4 worldInverseMatrix;
     DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
 
+    // Orientation, rebuilt from pitchYawRoll only when it changes
+    bool rotationDirty;
+    DirectX::XMFLOAT4 rotationQuaternion;
+    DirectX::XMFLOAT3 basisRight;
+    DirectX::XMFLOAT3 basisUp;
+    DirectX::XMFLOAT3 basisForward;
+
     bool rotated;
 
-    // Helper for updating matrices
+    // Helpers for updating matrices and the orientation
     void UpdateMatrices();
+    void UpdateRotation();
 };
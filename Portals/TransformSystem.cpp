@@ -0,0 +1,143 @@
+#include "TransformSystem.h"
+#include <algorithm>
+using namespace DirectX;
+
+TransformSystem::TransformSystem()
+{
+}
+
+TransformSystem::~TransformSystem()
+{
+}
+
+void TransformSystem::Add(Transform* transform)
+{
+    transforms.push_back(transform);
+}
+
+void TransformSystem::Remove(Transform* transform)
+{
+    transforms.erase(std::remove(transforms.begin(), transforms.end(), transform), transforms.end());
+}
+
+size_t TransformSystem::GetCount()
+{
+    return transforms.size();
+}
+
+void TransformSystem::UpdateMatrices()
+{
+    dirty.clear();
+    for (Transform* transform : transforms) {
+        if (transform->matricesDirty) {
+            dirty.push_back(transform);
+        }
+    }
+    if (dirty.empty())
+        return;
+
+    // Padded to a whole number of SIMD iterations. The padding lanes are identity transforms.
+    size_t count = dirty.size();
+    size_t padded = (count + 3) & ~(size_t)3;
+    positionX.assign(padded, 0.0f);
+    positionY.assign(padded, 0.0f);
+    positionZ.assign(padded, 0.0f);
+    pitch.assign(padded, 0.0f);
+    yaw.assign(padded, 0.0f);
+    roll.assign(padded, 0.0f);
+    scaleX.assign(padded, 1.0f);
+    scaleY.assign(padded, 1.0f);
+    scaleZ.assign(padded, 1.0f);
+    worldMatrices.resize(padded);
+    worldInverseTransposeMatrices.resize(padded);
+
+    for (size_t i = 0; i < count; i++) {
+        Transform* t = dirty[i];
+        positionX[i] = t->position.x;
+        positionY[i] = t->position.y;
+        positionZ[i] = t->position.z;
+        pitch[i] = t->pitchYawRoll.x;
+        yaw[i] = t->pitchYawRoll.y;
+        roll[i] = t->pitchYawRoll.z;
+        scaleX[i] = t->scale.x;
+        scaleY[i] = t->scale.y;
+        scaleZ[i] = t->scale.z;
+    }
+
+    ComputeMatrices(
+        &positionX[0], &positionY[0], &positionZ[0],
+        &pitch[0], &yaw[0], &roll[0],
+        &scaleX[0], &scaleY[0], &scaleZ[0],
+        count, &worldMatrices[0], &worldInverseTransposeMatrices[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        Transform* t = dirty[i];
+        t->worldMatrix = worldMatrices[i];
+        t->worldInverseTransposeMatrix = worldInverseTransposeMatrices[i];
+        XMStoreFloat4x4(&t->worldInverseMatrix, XMMatrixTranspose(XMLoadFloat4x4(&worldInverseTransposeMatrices[i])));
+        t->matricesDirty = false;
+    }
+}
+
+void TransformSystem::ComputeMatrices(
+    const float* positionX, const float* positionY, const float* positionZ,
+    const float* pitch, const float* yaw, const float* roll,
+    const float* scaleX, const float* scaleY, const float* scaleZ,
+    size_t count,
+    XMFLOAT4X4* worldMatrices,
+    XMFLOAT4X4* worldInverseTransposeMatrices)
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+
+    // Every XMVECTOR below holds the same value for four different transforms
+    for (size_t i = 0; i < count; i += 4) {
+        XMVECTOR px = XMLoadFloat4((const XMFLOAT4*)&positionX[i]);
+        XMVECTOR py = XMLoadFloat4((const XMFLOAT4*)&positionY[i]);
+        XMVECTOR pz = XMLoadFloat4((const XMFLOAT4*)&positionZ[i]);
+        XMVECTOR sx = XMLoadFloat4((const XMFLOAT4*)&scaleX[i]);
+        XMVECTOR sy = XMLoadFloat4((const XMFLOAT4*)&scaleY[i]);
+        XMVECTOR sz = XMLoadFloat4((const XMFLOAT4*)&scaleZ[i]);
+
+        XMVECTOR sinP, cosP, sinY, cosY, sinR, cosR;
+        XMVectorSinCos(&sinP, &cosP, XMLoadFloat4((const XMFLOAT4*)&pitch[i]));
+        XMVectorSinCos(&sinY, &cosY, XMLoadFloat4((const XMFLOAT4*)&yaw[i]));
+        XMVectorSinCos(&sinR, &cosR, XMLoadFloat4((const XMFLOAT4*)&roll[i]));
+
+        // Same rotation as XMMatrixRotationRollPitchYaw (roll, then pitch, then yaw)
+        XMVECTOR r00 = cosR * cosY + sinR * sinP * sinY;
+        XMVECTOR r01 = sinR * cosP;
+        XMVECTOR r02 = sinR * sinP * cosY - cosR * sinY;
+        XMVECTOR r10 = cosR * sinP * sinY - sinR * cosY;
+        XMVECTOR r11 = cosR * cosP;
+        XMVECTOR r12 = sinR * sinY + cosR * sinP * cosY;
+        XMVECTOR r20 = cosP * sinY;
+        XMVECTOR r21 = -sinP;
+        XMVECTOR r22 = cosP * cosY;
+
+        // World = S * R * T: scale each rotation row, translation in the last row
+        XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(r00 * sx, r01 * sx, r02 * sx, zero));
+        XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(r10 * sy, r11 * sy, r12 * sy, zero));
+        XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(r20 * sz, r21 * sz, r22 * sz, zero));
+        XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(px, py, pz, one));
+
+        // Inverse transpose = S^-1 * R, with the last column undoing the translation
+        XMVECTOR isx = XMVectorReciprocal(sx);
+        XMVECTOR isy = XMVectorReciprocal(sy);
+        XMVECTOR isz = XMVectorReciprocal(sz);
+        XMVECTOR t0 = -(r00 * px + r01 * py + r02 * pz) * isx;
+        XMVECTOR t1 = -(r10 * px + r11 * py + r12 * pz) * isy;
+        XMVECTOR t2 = -(r20 * px + r21 * py + r22 * pz) * isz;
+        XMMATRIX invRow0 = XMMatrixTranspose(XMMATRIX(r00 * isx, r01 * isx, r02 * isx, t0));
+        XMMATRIX invRow1 = XMMatrixTranspose(XMMATRIX(r10 * isy, r11 * isy, r12 * isy, t1));
+        XMMATRIX invRow2 = XMMatrixTranspose(XMMATRIX(r20 * isz, r21 * isz, r22 * isz, t2));
+        XMVECTOR invRow3 = XMVectorSet(0, 0, 0, 1);
+
+        // After the transposes, r[k] of each rowN is row N of transform i + k
+        size_t lanes = count - i < 4 ? count - i : 4;
+        for (size_t k = 0; k < lanes; k++) {
+            XMStoreFloat4x4(&worldMatrices[i + k], XMMATRIX(row0.r[k], row1.r[k], row2.r[k], row3.r[k]));
+            XMStoreFloat4x4(&worldInverseTransposeMatrices[i + k], XMMATRIX(invRow0.r[k], invRow1.r[k], invRow2.r[k], invRow3));
+        }
+    }
+}
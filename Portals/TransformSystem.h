@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include "Transform.h"
+
+// Updates the matrices of many Transforms at once. Each update gathers the dirty transforms into
+// structure-of-arrays form, builds four matrices per iteration with SIMD, and writes them back.
+// Transforms that aren't registered, or change after the update, still update themselves lazily.
+class TransformSystem
+{
+public:
+    TransformSystem();
+    ~TransformSystem();
+
+    void Add(Transform* transform);
+    void Remove(Transform* transform);
+    size_t GetCount();
+
+    // Recompute the world and world inverse transpose matrices of every dirty registered transform
+    void UpdateMatrices();
+
+    // The batch kernel on its own. Each input array holds count values, and must be readable up to
+    // count rounded up to a multiple of 4.
+    static void ComputeMatrices(
+        const float* positionX, const float* positionY, const float* positionZ,
+        const float* pitch, const float* yaw, const float* roll,
+        const float* scaleX, const float* scaleY, const float* scaleZ,
+        size_t count,
+        DirectX::XMFLOAT4X4* worldMatrices,
+        DirectX::XMFLOAT4X4* worldInverseTransposeMatrices);
+
+private:
+    std::vector<Transform*> transforms;
+    std::vector<Transform*> dirty;
+
+    // Structure-of-arrays working set, reused between updates
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> pitch, yaw, roll;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+    std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+};
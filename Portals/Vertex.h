@@ -2,6 +2,10 @@
 
 #include <DirectXMath.h>
 
+// Vertex layouts a Mesh can upload to the GPU
+#define VERTEX_FORMAT_FULL 0	// Vertex, 44 bytes
+#define VERTEX_FORMAT_PACKED 1	// PackedVertex, 20 bytes
+
 // --------------------------------------------------------
 // A custom vertex definition
 //
@@ -13,4 +17,31 @@ struct Vertex
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT3 Tangent;
 	DirectX::XMFLOAT2 UV;
+};
+
+// --------------------------------------------------------
+// A compressed Vertex for the GPU, decoded by PackedVertexShader.
+// See VertexPacking for the encoding.
+//  - Position: unorm16 relative to the mesh's bounding box
+//  - Normal/Tangent: octahedral encoded snorm16 pairs
+//  - UV: half floats
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];	// XYZ, W is padding since there is no 3 component 16 bit format
+	short Normal[2];
+	short Tangent[2];
+	unsigned short UV[2];
+};
+
+// --------------------------------------------------------
+// Per-instance data for InstancedVertexShader and
+// PackedInstancedVertexShader, streamed into the second
+// vertex buffer. Matches InstanceInput in ShaderIncludes.hlsli.
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+	DirectX::XMFLOAT4 ClipPlane;
 };
\ No newline at end of file
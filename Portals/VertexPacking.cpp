@@ -0,0 +1,185 @@
+#include "VertexPacking.h"
+#include <math.h>
+#include <string.h>
+
+using namespace DirectX;
+
+
+static inline float Clamp(float value, float low, float high) {
+	return value < low ? low : (value > high ? high : value);
+}
+
+// Sign that treats zero as positive, like the shader's (n >= 0) test
+static inline float SignNotZero(float value) {
+	return value >= 0 ? 1.0f : -1.0f;
+}
+
+// Map a coordinate into the bounds' [0, 1] range. Flat axes all map to 0.
+static inline unsigned short QuantizeUnorm16(float value, float low, float high) {
+	float range = high - low;
+	float t = range > 0 ? (value - low) / range : 0.0f;
+	return (unsigned short)(Clamp(t, 0, 1) * 65535.0f + 0.5f);
+}
+
+static inline float DequantizeUnorm16(unsigned short value, float low, float high) {
+	return low + (value / 65535.0f) * (high - low);
+}
+
+// atan2 of the cross and dot products stays accurate for tiny angles, unlike acos of the dot product
+static inline float AngleBetween(XMFLOAT3 a, XMFLOAT3 b) {
+	float cx = a.y * b.z - a.z * b.y;
+	float cy = a.z * b.x - a.x * b.z;
+	float cz = a.x * b.y - a.y * b.x;
+	float dot = a.x * b.x + a.y * b.y + a.z * b.z;
+	return atan2f(sqrtf(cx * cx + cy * cy + cz * cz), dot) * 180.0f / XM_PI;
+}
+
+PackedVertex VertexPacking::Pack(const Vertex& vertex, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	PackedVertex packed;
+	packed.Position[0] = QuantizeUnorm16(vertex.Position.x, boundsMin.x, boundsMax.x);
+	packed.Position[1] = QuantizeUnorm16(vertex.Position.y, boundsMin.y, boundsMax.y);
+	packed.Position[2] = QuantizeUnorm16(vertex.Position.z, boundsMin.z, boundsMax.z);
+	packed.Position[3] = 0;
+	EncodeOctahedral(vertex.Normal, packed.Normal);
+	EncodeOctahedral(vertex.Tangent, packed.Tangent);
+	packed.UV[0] = FloatToHalf(vertex.UV.x);
+	packed.UV[1] = FloatToHalf(vertex.UV.y);
+	return packed;
+}
+
+Vertex VertexPacking::Unpack(const PackedVertex& packed, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	Vertex vertex;
+	vertex.Position = XMFLOAT3(
+		DequantizeUnorm16(packed.Position[0], boundsMin.x, boundsMax.x),
+		DequantizeUnorm16(packed.Position[1], boundsMin.y, boundsMax.y),
+		DequantizeUnorm16(packed.Position[2], boundsMin.z, boundsMax.z));
+	vertex.Normal = DecodeOctahedral(packed.Normal);
+	vertex.Tangent = DecodeOctahedral(packed.Tangent);
+	vertex.UV = XMFLOAT2(HalfToFloat(packed.UV[0]), HalfToFloat(packed.UV[1]));
+	return vertex;
+}
+
+VertexPackingError VertexPacking::MeasureError(const Vertex* vertices, size_t count, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	VertexPackingError error = {};
+	for (size_t i = 0; i < count; i++) {
+		const Vertex& original = vertices[i];
+		Vertex decoded = Unpack(Pack(original, boundsMin, boundsMax), boundsMin, boundsMax);
+
+		float dx = decoded.Position.x - original.Position.x;
+		float dy = decoded.Position.y - original.Position.y;
+		float dz = decoded.Position.z - original.Position.z;
+		float positionError = sqrtf(dx * dx + dy * dy + dz * dz);
+		float uvError = fmaxf(fabsf(decoded.UV.x - original.UV.x), fabsf(decoded.UV.y - original.UV.y));
+
+		error.position = fmaxf(error.position, positionError);
+		error.normal = fmaxf(error.normal, AngleBetween(decoded.Normal, original.Normal));
+		error.tangent = fmaxf(error.tangent, AngleBetween(decoded.Tangent, original.Tangent));
+		error.uv = fmaxf(error.uv, uvError);
+	}
+	return error;
+}
+
+void VertexPacking::EncodeOctahedral(XMFLOAT3 direction, short out[2])
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1
+	float sum = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (sum == 0) {
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+	float x = direction.x / sum;
+	float y = direction.y / sum;
+
+	// Fold the lower half over the diagonals
+	if (direction.z < 0) {
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+	out[0] = (short)floorf(Clamp(x, -1, 1) * 32767.0f + 0.5f);
+	out[1] = (short)floorf(Clamp(y, -1, 1) * 32767.0f + 0.5f);
+}
+
+XMFLOAT3 VertexPacking::DecodeOctahedral(const short in[2])
+{
+	// Same conversion as DXGI_FORMAT_R16G16_SNORM, where -32768 and -32767 are both -1
+	float x = fmaxf(in[0] / 32767.0f, -1.0f);
+	float y = fmaxf(in[1] / 32767.0f, -1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half
+	float t = fmaxf(-z, 0.0f);
+	x += x >= 0 ? -t : t;
+	y += y >= 0 ? -t : t;
+
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+// IEEE 754 single to half precision, rounding to nearest even
+unsigned short VertexPacking::FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xFF);
+	unsigned int mantissa = bits & 0x7FFFFF;
+
+	// Infinity and NaN
+	if (exponent == 0xFF)
+		return (unsigned short)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+	int halfExponent = exponent - 127 + 15;
+	// Too large, becomes infinity
+	if (halfExponent >= 31)
+		return (unsigned short)(sign | 0x7C00);
+
+	// Too small for a normal half, becomes a subnormal or zero
+	if (halfExponent <= 0) {
+		if (halfExponent < -10)
+			return (unsigned short)sign;
+		mantissa |= 0x800000;
+		int shift = 14 - halfExponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int remainder = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return (unsigned short)(sign | half);
+	}
+
+	// Rounding up can carry into the exponent, which is still the correctly rounded result
+	unsigned int half = ((unsigned int)halfExponent << 10) | (mantissa >> 13);
+	unsigned int remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return (unsigned short)(sign | half);
+}
+
+float VertexPacking::HalfToFloat(unsigned short half)
+{
+	unsigned int sign = (unsigned int)(half & 0x8000) << 16;
+	unsigned int exponent = (half >> 10) & 0x1F;
+	unsigned int mantissa = half & 0x3FF;
+
+	unsigned int bits;
+	if (exponent == 0) {
+		// Zero or subnormal
+		float value = ldexpf((float)mantissa, -24);
+		return sign ? -value : value;
+	}
+	else if (exponent == 31) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else {
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
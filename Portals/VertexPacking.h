@@ -0,0 +1,29 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// Largest difference between a set of vertices and their packed and unpacked copies
+struct VertexPackingError {
+	float position;		// Distance in local units
+	float normal;		// Angle in degrees
+	float tangent;		// Angle in degrees
+	float uv;			// Absolute difference in either coordinate
+};
+
+// Converts between Vertex and PackedVertex. Decoding mirrors what the GPU and PackedVertexShader do.
+class VertexPacking {
+public:
+	VertexPacking() = delete;
+
+	static PackedVertex Pack(const Vertex& vertex, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+	static Vertex Unpack(const PackedVertex& packed, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+	// Round trip every vertex and report the worst error of each attribute
+	static VertexPackingError MeasureError(const Vertex* vertices, size_t count, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+
+	// Unit vector to a point on the octahedron folded into [-1, 1]^2, stored as snorm16
+	static void EncodeOctahedral(DirectX::XMFLOAT3 direction, short out[2]);
+	static DirectX::XMFLOAT3 DecodeOctahedral(const short in[2]);
+	static unsigned short FloatToHalf(float value);
+	static float HalfToFloat(unsigned short half);
+};
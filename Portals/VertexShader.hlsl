@@ -1,12 +1,19 @@
 #include "ShaderIncludes.hlsli"
 
 // Constant buffer used to allocate a chunk of memory on the GPU side accessable by shaders.
+// Changes with every draw.
 cbuffer ExternalData : register(b0) 
 { 
 	matrix world; 
+	matrix worldInverseTranspose;
+	float4 clipPlane;			// World space, (0, 0, 0, 1) keeps everything
+}
+
+// Only changes when the camera (or the portal it's looking through) does
+cbuffer PerView : register(b1)
+{
 	matrix view;
 	matrix projection;
-	matrix worldInverseTranspose;
 }
 
 // --------------------------------------------------------
@@ -29,6 +36,7 @@ VertexToPixel main( VertexShaderInput input )
 	output.uv = input.uv;
 	output.screenPosition = input.position;
 	output.worldPosition = mul(world, float4(input.position, 1)).xyz;
+	output.clipDistance = dot(float4(output.worldPosition, 1), clipPlane);
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
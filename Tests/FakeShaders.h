@@ -0,0 +1,103 @@
+#pragma once
+
+#include "RenderShader.h"
+#include "Light.h"
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// A shader with hand made constant buffers, laid out the way the reflected HLSL ones are
+class FakeShader : public RenderShader {
+public:
+	void AddBuffer(unsigned int size) { buffers.push_back(std::vector<unsigned char>(size, 0)); }
+	void AddVariable(const char* name, unsigned int buffer, unsigned int offset, unsigned int size) { variables[name] = { buffer, offset, size }; }
+	void AddTexture(const char* name, int slot) { textures[name] = slot; }
+	void AddSampler(const char* name, int slot) { samplers[name] = slot; }
+
+	unsigned int GetBufferCount() override { return (unsigned int)buffers.size(); }
+	unsigned int GetBufferSize(unsigned int index) override { return (unsigned int)buffers[index].size(); }
+	const void* GetBufferData(unsigned int index) override { return buffers[index].data(); }
+
+	bool GetVariable(const char* name, RenderShaderVariable& outVariable) override
+	{
+		auto found = variables.find(name);
+		if (found == variables.end()) return false;
+		outVariable = found->second;
+		return true;
+	}
+
+	bool SetData(const char* name, const void* data, unsigned int size) override
+	{
+		RenderShaderVariable variable;
+		if (!GetVariable(name, variable) || size > variable.size) return false;
+		memcpy(&buffers[variable.buffer][variable.offset], data, size);
+		return true;
+	}
+
+	int GetTextureSlot(const char* name) override { return textures.count(name) ? textures[name] : -1; }
+	int GetSamplerSlot(const char* name) override { return samplers.count(name) ? samplers[name] : -1; }
+
+private:
+	std::vector<std::vector<unsigned char>> buffers;
+	std::map<std::string, RenderShaderVariable> variables;
+	std::map<std::string, int> textures;
+	std::map<std::string, int> samplers;
+};
+
+// VertexShader.hlsl, InstancedVertexShader.hlsl, LightingPS.hlsl and PortalPS.hlsl
+struct FakeShaders {
+	FakeShader vertex;
+	FakeShader instanced;
+	FakeShader lighting;
+	FakeShader portal;
+
+	FakeShaders()
+	{
+		vertex.AddBuffer(144);
+		vertex.AddVariable("world", 0, 0, 64);
+		vertex.AddVariable("worldInverseTranspose", 0, 64, 64);
+		vertex.AddVariable("clipPlane", 0, 128, 16);
+		vertex.AddBuffer(128);
+		vertex.AddVariable("view", 1, 0, 64);
+		vertex.AddVariable("projection", 1, 64, 64);
+
+		instanced.AddBuffer(128);
+		instanced.AddVariable("view", 0, 0, 64);
+		instanced.AddVariable("projection", 0, 64, 64);
+
+		lighting.AddBuffer(32);
+		lighting.AddVariable("colorTint", 0, 0, 16);
+		lighting.AddVariable("roughness", 0, 16, 4);
+		lighting.AddVariable("hasSpecular", 0, 20, 4);
+		lighting.AddVariable("hasNormal", 0, 24, 4);
+		lighting.AddBuffer(32 + 5 * sizeof(Light));
+		lighting.AddVariable("cameraPosition", 1, 0, 12);
+		lighting.AddVariable("ambientColor", 1, 16, 12);
+		lighting.AddVariable("lights", 1, 32, 5 * sizeof(Light));
+		lighting.AddTexture("Albedo", 0);
+		lighting.AddTexture("NormalMap", 1);
+		lighting.AddTexture("RoughnessMap", 2);
+		lighting.AddTexture("MetalnessMap", 3);
+		lighting.AddSampler("BasicSampler", 0);
+
+		unsigned int portalConstants = 32 + 5 * sizeof(Light);
+		portal.AddBuffer(portalConstants + 112);
+		portal.AddVariable("cameraPosition", 0, 0, 12);
+		portal.AddVariable("roughness", 0, 12, 4);
+		portal.AddVariable("ambientColor", 0, 16, 12);
+		portal.AddVariable("lights", 0, 32, 5 * sizeof(Light));
+		portal.AddVariable("drawRecursive", 0, portalConstants, 4);
+		portal.AddVariable("recursionLevel", 0, portalConstants + 4, 4);
+		portal.AddVariable("scale", 0, portalConstants + 8, 4);
+		portal.AddVariable("borderColor", 0, portalConstants + 16, 12);
+		portal.AddVariable("borderThickness", 0, portalConstants + 28, 4);
+		portal.AddVariable("totalTime", 0, portalConstants + 32, 4);
+		portal.AddVariable("portalRippleStrength", 0, portalConstants + 36, 4);
+		portal.AddVariable("sampleCache", 0, portalConstants + 40, 4);
+		portal.AddVariable("cacheViewProj", 0, portalConstants + 48, 64);
+		portal.AddTexture("SceneCapture", 0);
+		portal.AddTexture("PortalCache", 1);
+		portal.AddSampler("BasicSampler", 0);
+	}
+};
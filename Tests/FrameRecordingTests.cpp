@@ -0,0 +1,360 @@
+#include "Test.h"
+#include "FakeShaders.h"
+#include "PortalRoom.h"
+#include "DrawList.h"
+#include "Portal.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace DirectX;
+using namespace std;
+
+// Stand ins for the backend's textures and samplers, which the command buffer only passes along
+static const char albedoTexture = 0;
+static const char normalTexture = 0;
+static const char sampler = 0;
+
+// A unit quad facing -z, and a single triangle
+static Mesh* MakeQuad(RenderBackend* backend)
+{
+	Vertex vertices[4] = {};
+	vertices[0].Position = XMFLOAT3(-0.5f, -0.5f, 0);
+	vertices[1].Position = XMFLOAT3(-0.5f, 0.5f, 0);
+	vertices[2].Position = XMFLOAT3(0.5f, 0.5f, 0);
+	vertices[3].Position = XMFLOAT3(0.5f, -0.5f, 0);
+	for (Vertex& vertex : vertices) {
+		vertex.Normal = XMFLOAT3(0, 0, -1);
+		vertex.UV = XMFLOAT2(vertex.Position.x + 0.5f, 0.5f - vertex.Position.y);
+	}
+	unsigned int indices[6] = { 0, 1, 2, 0, 2, 3 };
+	return new Mesh(vertices, 4, indices, 6, backend);
+}
+
+static Mesh* MakeTriangle(RenderBackend* backend)
+{
+	Vertex vertices[3] = {};
+	vertices[0].Position = XMFLOAT3(-0.5f, -0.5f, 0);
+	vertices[1].Position = XMFLOAT3(0, 0.5f, 0);
+	vertices[2].Position = XMFLOAT3(0.5f, -0.5f, 0);
+	vertices[1].UV = XMFLOAT2(0.5f, 0);
+	vertices[2].UV = XMFLOAT2(1, 1);
+	for (Vertex& vertex : vertices) {
+		vertex.Normal = XMFLOAT3(0, 0, -1);
+	}
+	unsigned int indices[3] = { 0, 1, 2 };
+	return new Mesh(vertices, 3, indices, 3, backend);
+}
+
+// Looking down +z from 10 units back, at the whole screen
+static SceneView MakeView()
+{
+	SceneView view;
+	XMStoreFloat4x4(&view.view, XMMatrixLookAtLH(XMVectorSet(0, 0, -10, 1), XMVectorZero(), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&view.projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+	view.cameraPosition = XMFLOAT3(0, 0, -10);
+	view.screenRect = XMFLOAT4(-1, 1, 1, -1);
+	return view;
+}
+
+// What Game::GatherDrawItems collects, minus the portals and occluders
+static void GatherScene(const vector<Entity*>& entities, DrawScene& scene)
+{
+	for (Entity* entity : entities) {
+		DrawItem item;
+		item.entity = entity;
+		item.world = entity->GetTransform()->GetWorldMatrix();
+		item.worldInverseTranspose = entity->GetTransform()->GetWorldInverseTranspose();
+		item.straddle = nullptr;
+		item.bounds = (unsigned int)scene.boxes.size();
+		scene.boxes.push_back(entity->GetBoundingBox());
+		scene.items.push_back(item);
+	}
+	FrustumCulling::BuildBlocks(scene.boxes.data(), scene.boxes.size(), scene.bounds);
+}
+
+static vector<const RenderCommand*> FindCommands(const CommandBuffer& commands, int type)
+{
+	vector<const RenderCommand*> found;
+	for (const RenderCommand& command : commands.GetCommands()) {
+		if (command.type == type) {
+			found.push_back(&command);
+		}
+	}
+	return found;
+}
+
+// The constants recorded for one of a shader's buffers, or null if there weren't any
+static const unsigned char* FindConstants(const CommandBuffer& commands, RenderShader* shader, unsigned int buffer)
+{
+	for (const RenderCommand* command : FindCommands(commands, RENDER_COMMAND_SET_CONSTANTS)) {
+		if (command->constants.shader == shader && command->constants.bufferIndex == buffer) {
+			return commands.GetConstantData(*command);
+		}
+	}
+	return nullptr;
+}
+
+static bool SameBytes(const unsigned char* recorded, const void* expected, size_t size)
+{
+	return recorded != nullptr && memcmp(recorded, expected, size) == 0;
+}
+
+// Three quads sharing a material, which instance into one draw, and a triangle with a material of its own.
+// Everything recorded has to come from the shaders' own layouts and the scene, with no device involved.
+TEST(DrawListRecordsBatchesThroughTheShaderLayouts)
+{
+	NullRenderBackend backend;
+	FakeShaders shaders;
+	Mesh* quad = MakeQuad(&backend);
+	Mesh* triangle = MakeTriangle(&backend);
+	CHECK(backend.GetBufferCount() == 4);
+
+	Material textured(XMFLOAT4(1, 1, 1, 1), &shaders.lighting, &shaders.vertex, 0.5f);
+	textured.SetInstancedVertexShaders(&shaders.instanced, nullptr);
+	textured.AddTexture("Albedo", &albedoTexture);
+	textured.AddTexture("NormalMap", &normalTexture);
+	textured.AddSampler("BasicSampler", &sampler);
+	Material tinted(XMFLOAT4(1, 0, 0, 1), &shaders.lighting, &shaders.vertex, 0.25f);
+
+	vector<Entity*> entities;
+	for (int i = 0; i < 3; i++) {
+		entities.push_back(new Entity(quad, &textured));
+		entities.back()->GetTransform()->SetPosition((float)i - 1, 0, (float)(2 - i) * 2);
+	}
+	entities.push_back(new Entity(triangle, &tinted));
+	entities.back()->GetTransform()->SetPosition(0, 2, 1);
+	DrawScene scene;
+	GatherScene(entities, scene);
+
+	vector<Light> lights(2);
+	lights[0].Type = LIGHT_TYPE_DIRECTIONAL;
+	lights[0].Direction = XMFLOAT3(0, -1, 0);
+	lights[1].Type = LIGHT_TYPE_POINT;
+	lights[1].Position = XMFLOAT3(1, 2, 3);
+	XMFLOAT3 ambient(0.1f, 0.2f, 0.3f);
+	SceneView view = MakeView();
+
+	for (int instancing = 0; instancing < 2; instancing++) {
+		DrawList list;
+		list.Record(view, scene, instancing != 0);
+		CHECK(list.GetDrawCount() == 4);
+		CommandBuffer commands;
+		list.Submit(commands, lights, ambient);
+		backend.ResetCounts();
+		backend.Execute(commands);
+
+		// Both materials share a pixel shader, so its per-view constants are only recorded once
+		CHECK(SameBytes(FindConstants(commands, &shaders.lighting, 1), &view.cameraPosition, sizeof(XMFLOAT3)));
+		CHECK(SameBytes(FindConstants(commands, &shaders.lighting, 1) + 16, &ambient, sizeof(XMFLOAT3)));
+		CHECK(SameBytes(FindConstants(commands, &shaders.lighting, 1) + 32, lights.data(), sizeof(Light) * 2));
+		CHECK(backend.GetIndexCount() == 3 * 6 + 3);
+
+		// Each material's surface constants and textures, once each
+		size_t materialConstants = 0;
+		for (const RenderCommand* command : FindCommands(commands, RENDER_COMMAND_SET_CONSTANTS)) {
+			if (command->constants.shader == (RenderShader*)&shaders.lighting && command->constants.bufferIndex == 0) {
+				const XMFLOAT4* tint = (const XMFLOAT4*)commands.GetConstantData(*command);
+				CHECK(tint->x == 1 && (tint->y == 1 || tint->y == 0));
+				materialConstants++;
+			}
+		}
+		CHECK(materialConstants == 2);
+		vector<const RenderCommand*> textures = FindCommands(commands, RENDER_COMMAND_SET_TEXTURE);
+		CHECK(textures.size() == 2);
+		for (const RenderCommand* texture : textures) {
+			CHECK((texture->texture.slot == 0 && texture->texture.resource == &albedoTexture) ||
+				(texture->texture.slot == 1 && texture->texture.resource == &normalTexture));
+		}
+		vector<const RenderCommand*> samplers = FindCommands(commands, RENDER_COMMAND_SET_SAMPLER);
+		CHECK(samplers.size() == 1 && samplers[0]->texture.slot == 0 && samplers[0]->texture.resource == &sampler);
+
+		// The triangle is always drawn on its own, with its world matrix in the per-draw buffer
+		vector<const RenderCommand*> draws = FindCommands(commands, RENDER_COMMAND_DRAW_INDEXED);
+		vector<const RenderCommand*> instancedDraws = FindCommands(commands, RENDER_COMMAND_DRAW_INDEXED_INSTANCED);
+		const RenderCommand* triangleDraw = nullptr;
+		for (const RenderCommand* draw : draws) {
+			CHECK(draw->draw.stride == sizeof(Vertex));
+			if (draw->draw.vertexBuffer == triangle->GetVertexBuffer()) {
+				CHECK(draw->draw.indexBuffer == triangle->GetIndexBuffer() && draw->draw.indexCount == 3);
+				triangleDraw = draw;
+			}
+		}
+		CHECK(triangleDraw != nullptr);
+
+		if (instancing) {
+			// The quads became one instanced draw, front to back, through the instanced shader
+			CHECK(draws.size() == 1 && instancedDraws.size() == 1);
+			CHECK(backend.GetInstanceCount() == 3);
+			if (instancedDraws.size() == 1) {
+				const RenderCommand* draw = instancedDraws[0];
+				CHECK(draw->draw.vertexBuffer == quad->GetVertexBuffer() && draw->draw.indexCount == 6);
+				CHECK(draw->draw.instanceCount == 3 && draw->draw.instanceSize == sizeof(InstanceData));
+				const InstanceData* instances = (const InstanceData*)&commands.GetInstanceData()[draw->draw.instanceOffset];
+				for (int i = 0; i < 3; i++) {
+					XMFLOAT4X4 world = entities[2 - i]->GetTransform()->GetWorldMatrix();
+					CHECK(memcmp(&instances[i].World, &world, sizeof(world)) == 0);
+					CHECK(instances[i].ClipPlane.w == 1);
+				}
+			}
+			vector<const RenderCommand*> pipelines = FindCommands(commands, RENDER_COMMAND_SET_PIPELINE);
+			CHECK(pipelines.size() == 2);
+			bool instancedPipeline = false;
+			for (const RenderCommand* pipeline : pipelines) {
+				CHECK(pipeline->pipeline.pixelShader == (RenderShader*)&shaders.lighting);
+				instancedPipeline |= pipeline->pipeline.vertexShader == (RenderShader*)&shaders.instanced;
+			}
+			CHECK(instancedPipeline);
+			CHECK(SameBytes(FindConstants(commands, &shaders.instanced, 0), &view.view, sizeof(XMFLOAT4X4)));
+		}
+		else {
+			// Every draw goes through the one vertex shader, bound once
+			CHECK(draws.size() == 4 && instancedDraws.empty());
+			CHECK(backend.GetCommandCount(RENDER_COMMAND_SET_PIPELINE) == 1);
+			CHECK(SameBytes(FindConstants(commands, &shaders.vertex, 1), &view.view, sizeof(XMFLOAT4X4)));
+			CHECK(SameBytes(FindConstants(commands, &shaders.vertex, 1) + 64, &view.projection, sizeof(XMFLOAT4X4)));
+		}
+
+		// The per-draw constants right before the triangle's draw are its own
+		const RenderCommand* lastWorld = nullptr;
+		for (const RenderCommand& command : commands.GetCommands()) {
+			if (&command == triangleDraw) break;
+			if (command.type == RENDER_COMMAND_SET_CONSTANTS && command.constants.shader == (RenderShader*)&shaders.vertex &&
+				command.constants.bufferIndex == 0) {
+				lastWorld = &command;
+			}
+		}
+		XMFLOAT4X4 triangleWorld = entities[3]->GetTransform()->GetWorldMatrix();
+		CHECK(lastWorld != nullptr && lastWorld->constants.size == 144);
+		CHECK(lastWorld != nullptr && SameBytes(commands.GetConstantData(*lastWorld), &triangleWorld, sizeof(XMFLOAT4X4)));
+	}
+
+	for (Entity* entity : entities) {
+		delete entity;
+	}
+	delete quad;
+	delete triangle;
+	CHECK(backend.GetBufferCount() == 0);
+}
+
+// A single entity drawn straight into the command buffer records its whole pipeline, and a portal drawn into the
+// stencil buffer records none of its pixel shader
+TEST(EntityAndPortalDrawsRecordTheirMaterial)
+{
+	NullRenderBackend backend;
+	FakeShaders shaders;
+	Mesh* quad = MakeQuad(&backend);
+	Material material(XMFLOAT4(0.5f, 0.5f, 1, 1), &shaders.lighting, &shaders.vertex, 0.0f);
+	material.AddTexture("Albedo", &albedoTexture);
+	material.AddTexture("Unused", &normalTexture);
+	material.AddSampler("BasicSampler", &sampler);
+	Entity entity(quad, &material);
+	entity.GetTransform()->SetPosition(1, 2, 3);
+	SceneView view = MakeView();
+
+	CommandBuffer commands;
+	entity.Draw(commands, view.view, view.projection, view.cameraPosition);
+	backend.Execute(commands);
+	const vector<RenderCommand>& recorded = commands.GetCommands();
+	CHECK(recorded.size() > 0 && recorded[0].type == RENDER_COMMAND_SET_PIPELINE);
+	CHECK(recorded[0].pipeline.vertexShader == (RenderShader*)&shaders.vertex);
+	CHECK(recorded[0].pipeline.pixelShader == (RenderShader*)&shaders.lighting);
+	CHECK(recorded.back().type == RENDER_COMMAND_DRAW_INDEXED && recorded.back().draw.indexCount == 6);
+
+	// Every buffer of both shaders, as the material left them
+	CHECK(backend.GetCommandCount(RENDER_COMMAND_SET_CONSTANTS) == 4);
+	CHECK(backend.GetConstantBytes() == 144 + 128 + 32 + 32 + 5 * sizeof(Light));
+	XMFLOAT4X4 world = entity.GetTransform()->GetWorldMatrix();
+	XMFLOAT4 noClip(0, 0, 0, 1);
+	CHECK(SameBytes(FindConstants(commands, &shaders.vertex, 0), &world, sizeof(world)));
+	CHECK(SameBytes(FindConstants(commands, &shaders.vertex, 0) + 128, &noClip, sizeof(noClip)));
+	CHECK(SameBytes(FindConstants(commands, &shaders.vertex, 1) + 64, &view.projection, sizeof(XMFLOAT4X4)));
+	XMFLOAT4 tint = material.GetColorTint();
+	CHECK(SameBytes(FindConstants(commands, &shaders.lighting, 0), &tint, sizeof(tint)));
+	CHECK(SameBytes(FindConstants(commands, &shaders.lighting, 1), &view.cameraPosition, sizeof(XMFLOAT3)));
+
+	// Textures the shader doesn't have are left out
+	CHECK(backend.GetCommandCount(RENDER_COMMAND_SET_TEXTURE) == 1);
+	CHECK(backend.GetCommandCount(RENDER_COMMAND_SET_SAMPLER) == 1);
+
+	// Drawn for the stencil, the portal records no pixel shader, and gets its material's back afterwards
+	Portal portal(quad, &material, 0, XMFLOAT3(1, 0.5f, 0));
+	commands.Reset();
+	backend.ResetCounts();
+	portal.UnbindPSAndDraw(commands, view.view, view.projection, view.cameraPosition);
+	backend.Execute(commands);
+	CHECK(commands.GetCommands()[0].pipeline.pixelShader == nullptr);
+	CHECK(backend.GetCommandCount(RENDER_COMMAND_SET_CONSTANTS) == 2);
+	CHECK(backend.GetCommandCount(RENDER_COMMAND_SET_TEXTURE) == 0);
+	CHECK(backend.GetCommandCount(RENDER_COMMAND_DRAW_INDEXED) == 1);
+	CHECK(material.GetPixelShader() == &shaders.lighting);
+
+	// The cache is whatever texture the backend made for it
+	CHECK(!portal.HasValidCache());
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMLoadFloat4x4(&view.view) * XMLoadFloat4x4(&view.projection));
+	portal.SetCache(&albedoTexture, viewProj);
+	CHECK(portal.HasValidCache() && portal.GetCache() == &albedoTexture);
+	CHECK(commands.SetTexture(material.GetPixelShader(), "Albedo", portal.GetCache()));
+	CHECK(!commands.SetTexture(material.GetPixelShader(), "PortalCache", portal.GetCache()));
+
+	delete quad;
+}
+
+// Deepest level a frame drew an inner scene at, from its "GPU inner scene" zones
+static int DeepestInnerScene(const CommandBuffer& commands)
+{
+	int deepest = 0;
+	for (const RenderCommand* zone : FindCommands(commands, RENDER_COMMAND_BEGIN_ZONE)) {
+		if (strcmp(zone->zone.name, "GPU inner scene") == 0) {
+			deepest = (std::max)(deepest, zone->zone.arg);
+		}
+	}
+	return deepest;
+}
+
+// A whole recursive portal frame recorded through PortalRenderer reaches the recursion limit, and comes out the same
+// whether the views' draw lists are recorded up front on worker threads or one at a time while drawing
+TEST(PortalFramesRecordTheSameInParallelAndSerial)
+{
+	PortalRoom room(40);
+	PortalRenderSettings settings;
+	settings.adaptiveRecursion = false;
+
+	CommandBuffer frames[2];
+	for (int parallel = 0; parallel < 2; parallel++) {
+		settings.parallelRecording = parallel != 0;
+		room.renderer.SetSettings(settings);
+		room.RecordFrame(frames[parallel], 3);
+		room.backend.Execute(frames[parallel]);
+	}
+	const vector<RenderCommand>& serial = frames[0].GetCommands();
+	const vector<RenderCommand>& parallel = frames[1].GetCommands();
+	CHECK(serial.size() == parallel.size());
+	CHECK(frames[0].GetConstantDataSize() == frames[1].GetConstantDataSize());
+	size_t differences = 0;
+	for (size_t i = 0; i < (std::min)(serial.size(), parallel.size()); i++) {
+		bool same = serial[i].type == parallel[i].type;
+		if (same && serial[i].type == RENDER_COMMAND_SET_CONSTANTS) {
+			same = serial[i].constants.shader == parallel[i].constants.shader && serial[i].constants.size == parallel[i].constants.size &&
+				memcmp(frames[0].GetConstantData(serial[i]), frames[1].GetConstantData(parallel[i]), serial[i].constants.size) == 0;
+		}
+		else if (same && (serial[i].type == RENDER_COMMAND_DRAW_INDEXED || serial[i].type == RENDER_COMMAND_DRAW_INDEXED_INSTANCED)) {
+			same = serial[i].draw.vertexBuffer == parallel[i].draw.vertexBuffer && serial[i].draw.indexCount == parallel[i].draw.indexCount &&
+				serial[i].draw.instanceCount == parallel[i].draw.instanceCount;
+		}
+		if (!same && differences++ == 0) {
+			printf("  command %zu is type %d serially, %d in parallel\n", i, serial[i].type, parallel[i].type);
+		}
+	}
+	CHECK(differences == 0);
+
+	// Looking through a portal at its own destination goes all the way down
+	CHECK(DeepestInnerScene(frames[0]) == 4);
+	CHECK(DeepestInnerScene(frames[1]) == 4);
+
+	// One level less is a smaller frame that stops one level sooner
+	CommandBuffer shallow;
+	room.RecordFrame(shallow, 2);
+	CHECK(DeepestInnerScene(shallow) == 3);
+	CHECK(shallow.GetCommands().size() < parallel.size());
+}
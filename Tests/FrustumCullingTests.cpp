@@ -0,0 +1,145 @@
+#include "Test.h"
+#include "FrustumCulling.h"
+#include "PortalMath.h"
+#include <random>
+
+using namespace DirectX;
+using namespace std;
+
+// Looking down +z from the origin, at a square screen
+static void MakeCamera(XMFLOAT4X4& view, XMFLOAT4X4& projection)
+{
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 100.0f));
+}
+
+static bool PointInside(const CullFrustum& frustum, const XMFLOAT3& point)
+{
+	for (const XMFLOAT4& plane : frustum.planes) {
+		if (plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Random boxes of all sizes around the camera, culled against random openings of the screen. The wide tests give
+// Intersects' answer for every box, in whichever lane it lands, the padding lanes of the last block are never
+// visible, and no box with a corner inside the frustum is culled.
+TEST(WideCullingMatchesIntersects)
+{
+	XMFLOAT4X4 view, projection;
+	MakeCamera(view, projection);
+	mt19937 random(21);
+	uniform_real_distribution<float> position(-60, 60);
+	uniform_real_distribution<float> extent(0.01f, 5);
+	uniform_real_distribution<float> device(-1, 1);
+
+	for (size_t boxCount : { 1, 3, 4, 1001 }) {
+		vector<BoundingBox> boxes;
+		for (size_t i = 0; i < boxCount; i++) {
+			boxes.push_back(BoundingBox(XMFLOAT3(position(random), position(random), position(random) + 50),
+				XMFLOAT3(extent(random), extent(random), extent(random))));
+		}
+		vector<BoundsBlock4> blocks;
+		FrustumCulling::BuildBlocks(boxes.data(), boxes.size(), blocks);
+		CHECK(blocks.size() == (boxCount + 3) / 4);
+
+		for (int r = 0; r < 8; r++) {
+			float left = device(random), top = device(random), right = device(random), bottom = device(random);
+			XMFLOAT4 screenRect = r == 0 ? XMFLOAT4(-1, 1, 1, -1) :
+				XMFLOAT4((std::min)(left, right), (std::max)(top, bottom), (std::max)(left, right), (std::min)(top, bottom));
+			CullFrustum frustum;
+			FrustumCulling::BuildFrustum(view, projection, screenRect, frustum);
+
+			vector<unsigned char> visible;
+			FrustumCulling::Cull(frustum, blocks, visible);
+			CHECK(visible.size() == blocks.size() * 4);
+			size_t mismatches = 0, inside = 0, missed = 0;
+			for (size_t i = 0; i < visible.size(); i++) {
+				bool wide = visible[i] != 0;
+				bool lane = (FrustumCulling::IntersectBlock(frustum, blocks[i / 4]) >> (i % 4) & 1) != 0;
+				if (i >= boxCount) {
+					CHECK(!wide && !lane);
+					continue;
+				}
+				bool reference = FrustumCulling::Intersects(frustum, boxes[i]);
+				inside += reference;
+				if (wide != reference || lane != reference) {
+					if (mismatches++ == 0) {
+						printf("  box %zu: Cull %d, IntersectBlock %d, Intersects %d\n", i, wide, lane, reference);
+					}
+				}
+
+				XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+				boxes[i].GetCorners(corners);
+				for (const XMFLOAT3& corner : corners) {
+					if (PointInside(frustum, corner) && !reference) {
+						missed++;
+						break;
+					}
+				}
+			}
+			CHECK(mismatches == 0);
+			CHECK(missed == 0);
+			// Some were seen and some weren't, for the bigger sets at least
+			if (boxCount > 100) {
+				CHECK(inside > 0 && inside < boxCount);
+			}
+		}
+	}
+}
+
+// Seen through a portal 5 units ahead, the oblique projection's near plane is the portal. A box between the camera and
+// the portal is culled, though the plain frustum keeps it, and one beyond the portal isn't.
+TEST(ObliqueNearPlaneCullsBoxesBehindThePortal)
+{
+	XMFLOAT4X4 view, projection;
+	MakeCamera(view, projection);
+	XMFLOAT4X4 oblique = PortalMath::ObliqueProjection(view, projection, XMFLOAT3(0, 0, 5), XMFLOAT3(0, 0, 1));
+	XMFLOAT4 screenRect(-1, 1, 1, -1);
+	CullFrustum plain, clipped;
+	FrustumCulling::BuildFrustum(view, projection, screenRect, plain);
+	FrustumCulling::BuildFrustum(view, oblique, screenRect, clipped);
+
+	BoundingBox boxes[] = {
+		BoundingBox(XMFLOAT3(0, 0, 2), XMFLOAT3(0.5f, 0.5f, 0.5f)),		// Between the camera and the portal
+		BoundingBox(XMFLOAT3(0, 0, 10), XMFLOAT3(0.5f, 0.5f, 0.5f)),	// Beyond it
+		BoundingBox(XMFLOAT3(0, 0, 5), XMFLOAT3(0.5f, 0.5f, 0.5f)) };	// Through it
+	vector<BoundsBlock4> blocks;
+	FrustumCulling::BuildBlocks(boxes, 3, blocks);
+	vector<unsigned char> visible;
+	FrustumCulling::Cull(clipped, blocks, visible);
+
+	CHECK(FrustumCulling::Intersects(plain, boxes[0]));
+	CHECK(!FrustumCulling::Intersects(clipped, boxes[0]) && !visible[0]);
+	CHECK(FrustumCulling::Intersects(clipped, boxes[1]) && visible[1]);
+	CHECK(FrustumCulling::Intersects(clipped, boxes[2]) && visible[2]);
+}
+
+// Narrowing the frustum to a portal's opening on the right of the screen culls a box on the left that the whole
+// screen sees, and keeps one on the right
+TEST(ScreenRectNarrowingCulls)
+{
+	XMFLOAT4X4 view, projection;
+	MakeCamera(view, projection);
+	CullFrustum whole, opening;
+	FrustumCulling::BuildFrustum(view, projection, XMFLOAT4(-1, 1, 1, -1), whole);
+	FrustumCulling::BuildFrustum(view, projection, XMFLOAT4(0.25f, 0.5f, 0.75f, -0.5f), opening);
+
+	// At z = 10 the screen spans x and y from -10 to 10, and the opening x from 2.5 to 7.5 and y from -5 to 5
+	BoundingBox left(XMFLOAT3(-5, 0, 10), XMFLOAT3(1, 1, 1));
+	BoundingBox right(XMFLOAT3(5, 0, 10), XMFLOAT3(1, 1, 1));
+	BoundingBox above(XMFLOAT3(5, 8, 10), XMFLOAT3(1, 1, 1));
+	BoundingBox edge(XMFLOAT3(1.75f, 0, 10), XMFLOAT3(1, 1, 1));	// Reaches just into the opening
+	CHECK(FrustumCulling::Intersects(whole, left) && !FrustumCulling::Intersects(opening, left));
+	CHECK(FrustumCulling::Intersects(whole, right) && FrustumCulling::Intersects(opening, right));
+	CHECK(FrustumCulling::Intersects(whole, above) && !FrustumCulling::Intersects(opening, above));
+	CHECK(FrustumCulling::Intersects(opening, edge));
+
+	BoundingBox boxes[] = { left, right, above, edge };
+	vector<BoundsBlock4> blocks;
+	FrustumCulling::BuildBlocks(boxes, 4, blocks);
+	CHECK(FrustumCulling::IntersectBlock(opening, blocks[0]) == 0xA);
+	CHECK(FrustumCulling::IntersectBlock(whole, blocks[0]) == 0xF);
+}
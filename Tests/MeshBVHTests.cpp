@@ -0,0 +1,164 @@
+#include "Test.h"
+#include "MeshBVH.h"
+#include "ObjLoader.h"
+#include <float.h>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+using namespace std;
+
+// The closest hit found by testing every triangle, the same way Raycast treats distances
+static bool BruteForceRaycast(const vector<Vertex>& vertices, const vector<unsigned int>& indices,
+	XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& outHit)
+{
+	bool hit = false;
+	float closest = maxDistance;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		float t, u, v;
+		if (RayTriangle::Intersect(origin, direction,
+			vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position,
+			0.0001f, closest, t, u, v)) {
+			hit = true;
+			closest = t;
+			outHit.distance = t;
+			outHit.triangle = (unsigned int)(i / 3);
+			outHit.u = u;
+			outHit.v = v;
+		}
+	}
+	return hit;
+}
+
+TEST(RaycastMatchesBruteForce)
+{
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "sphere.obj", "torus.obj" };
+	mt19937 random(42);
+	for (const char* model : models) {
+		string filepath = string(PORTALS_ASSETS_DIR "/Models/") + model;
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		CHECK(ObjLoader::Load(filepath.c_str(), vertices, indices));
+		MeshBVH bvh;
+		bvh.Build(vertices, indices);
+		CHECK(bvh.GetTriangleCount() == indices.size() / 3);
+
+		XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX), boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (const Vertex& vertex : vertices) {
+			boundsMin = XMFLOAT3(fminf(boundsMin.x, vertex.Position.x), fminf(boundsMin.y, vertex.Position.y), fminf(boundsMin.z, vertex.Position.z));
+			boundsMax = XMFLOAT3(fmaxf(boundsMax.x, vertex.Position.x), fmaxf(boundsMax.y, vertex.Position.y), fmaxf(boundsMax.z, vertex.Position.z));
+		}
+		// Origins anywhere in twice the bounds, inside the mesh included, aimed at points around it so some miss
+		uniform_real_distribution<float> x(2 * boundsMin.x, 2 * boundsMax.x);
+		uniform_real_distribution<float> y(2 * boundsMin.y, 2 * boundsMax.y);
+		uniform_real_distribution<float> z(2 * boundsMin.z, 2 * boundsMax.z);
+
+		int hits = 0, mismatches = 0;
+		for (int i = 0; i < 2000; i++) {
+			XMFLOAT3 origin(x(random), y(random), z(random));
+			XMFLOAT3 direction(x(random) - origin.x, y(random) - origin.y, z(random) - origin.z);
+			// Some rays stop short of the far side, so maxDistance has to cut off hits too
+			float maxDistance = i % 4 == 0 ? 0.5f : 10.0f;
+
+			RayHit expected = {}, actual = {};
+			bool expectedHit = BruteForceRaycast(vertices, indices, origin, direction, maxDistance, expected);
+			bool actualHit = bvh.Raycast(origin, direction, maxDistance, actual);
+			CHECK(bvh.RaycastAny(origin, direction, maxDistance) == expectedHit);
+			if (actualHit != expectedHit) {
+				mismatches++;
+				continue;
+			}
+			if (!actualHit) {
+				continue;
+			}
+			hits++;
+			CHECK_NEAR(actual.distance, expected.distance, 1e-4);
+			// Rays through a shared edge may report either triangle, but always one that was hit at that distance
+			if (actual.triangle != expected.triangle) {
+				unsigned int first = actual.triangle * 3;
+				float t, u, v;
+				CHECK(RayTriangle::Intersect(origin, direction, vertices[indices[first]].Position, vertices[indices[first + 1]].Position,
+					vertices[indices[first + 2]].Position, 0.0001f, maxDistance, t, u, v));
+				CHECK_NEAR(t, expected.distance, 1e-4);
+			}
+			else {
+				CHECK_NEAR(actual.u, expected.u, 1e-4);
+				CHECK_NEAR(actual.v, expected.v, 1e-4);
+			}
+		}
+		if (mismatches > 0) {
+			printf("  %s: %d of 2000 rays disagree with brute force about hitting\n", model, mismatches);
+		}
+		CHECK(mismatches == 0);
+		// Enough rays hit for the comparison to mean something
+		CHECK(hits > 200);
+	}
+}
+
+TEST(RaycastHitsAKnownTriangle)
+{
+	// Two triangles facing each other along z, one behind the other
+	vector<Vertex> vertices(6);
+	vertices[0].Position = XMFLOAT3(-1, -1, 2);
+	vertices[1].Position = XMFLOAT3(1, -1, 2);
+	vertices[2].Position = XMFLOAT3(0, 1, 2);
+	vertices[3].Position = XMFLOAT3(-1, -1, 5);
+	vertices[4].Position = XMFLOAT3(1, -1, 5);
+	vertices[5].Position = XMFLOAT3(0, 1, 5);
+	vector<unsigned int> indices = { 3, 4, 5, 0, 1, 2 };
+	MeshBVH bvh;
+	bvh.Build(vertices, indices);
+
+	RayHit hit;
+	CHECK(bvh.Raycast(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 2), 10, hit));
+	CHECK(hit.triangle == 1);
+	CHECK_NEAR(hit.distance, 1.0, 1e-6);
+
+	// From the far side the other one is first, since triangles are two sided
+	CHECK(bvh.Raycast(XMFLOAT3(0, 0, 7), XMFLOAT3(0, 0, -1), 10, hit));
+	CHECK(hit.triangle == 0);
+	CHECK_NEAR(hit.distance, 2.0, 1e-6);
+
+	// Stopping short of the first triangle, or pointing away, misses
+	CHECK(!bvh.Raycast(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 1.5f, hit));
+	CHECK(!bvh.RaycastAny(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, -1), 10));
+	CHECK(bvh.RaycastAny(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 10));
+}
+
+// A BVH loaded back from what Save wrote answers every ray exactly like the one that was built, the way a mesh
+// loaded from its cache has to
+TEST(SavedBVHLoadsBackUnchanged)
+{
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	CHECK(ObjLoader::Load(PORTALS_ASSETS_DIR "/Models/torus.obj", vertices, indices));
+	MeshBVH built;
+	built.Build(vertices, indices);
+	vector<char> data(MeshBVH::GetSerializedSize(built.GetNodeCount(), built.GetBlockCount(), built.GetTriangleCount()));
+	built.Save(data.data());
+	MeshBVH loaded;
+	loaded.Load(data.data(), built.GetNodeCount(), built.GetBlockCount(), built.GetTriangleCount());
+	CHECK(loaded.GetNodeCount() == built.GetNodeCount());
+	CHECK(loaded.GetBlockCount() == built.GetBlockCount());
+	CHECK(loaded.GetTriangleCount() == built.GetTriangleCount());
+
+	mt19937 random(5);
+	uniform_real_distribution<float> coordinate(-3, 3);
+	int hits = 0;
+	for (int i = 0; i < 1000; i++) {
+		XMFLOAT3 origin(coordinate(random), coordinate(random), coordinate(random));
+		XMFLOAT3 direction(-origin.x + coordinate(random) / 3, -origin.y + coordinate(random) / 3, -origin.z + coordinate(random) / 3);
+		RayHit expected = {}, actual = {};
+		bool expectedHit = built.Raycast(origin, direction, 2, expected);
+		CHECK(loaded.Raycast(origin, direction, 2, actual) == expectedHit);
+		CHECK(loaded.RaycastAny(origin, direction, 2) == expectedHit);
+		if (expectedHit) {
+			hits++;
+			CHECK(actual.triangle == expected.triangle && actual.distance == expected.distance);
+			XMFLOAT3 expectedNormal = built.GetTriangleNormal(expected.triangle);
+			XMFLOAT3 actualNormal = loaded.GetTriangleNormal(actual.triangle);
+			CHECK(actualNormal.x == expectedNormal.x && actualNormal.y == expectedNormal.y && actualNormal.z == expectedNormal.z);
+		}
+	}
+	CHECK(hits > 100);
+}
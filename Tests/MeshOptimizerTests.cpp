@@ -0,0 +1,83 @@
+#include "Test.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <array>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+typedef array<float, 3 * 8> Triangle;	// Position, normal and uv of each corner
+
+// Every triangle's corners, starting from the smallest so the same triangle compares equal however its
+// corners were rotated, but not if its winding changed. Sorted so the order of the triangles doesn't matter.
+static vector<Triangle> SortedTriangles(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+{
+	vector<Triangle> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		array<array<float, 8>, 3> corners;
+		for (int k = 0; k < 3; k++) {
+			const Vertex& v = vertices[indices[i + k]];
+			corners[k] = { v.Position.x, v.Position.y, v.Position.z, v.Normal.x, v.Normal.y, v.Normal.z, v.UV.x, v.UV.y };
+		}
+		int first = (int)(min_element(corners.begin(), corners.end()) - corners.begin());
+		Triangle triangle;
+		for (int k = 0; k < 3; k++) {
+			copy(corners[(first + k) % 3].begin(), corners[(first + k) % 3].end(), triangle.begin() + k * 8);
+		}
+		triangles.push_back(triangle);
+	}
+	sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(OptimizeKeepsEveryTriangleAndImprovesTheCache)
+{
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models) {
+		string filepath = string(PORTALS_ASSETS_DIR "/Models/") + model;
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		CHECK(ObjLoader::Load(filepath.c_str(), vertices, indices));
+		vector<Vertex> optimizedVertices = vertices;
+		vector<unsigned int> optimizedIndices = indices;
+		MeshOptimizer::Optimize(optimizedVertices, optimizedIndices);
+
+		CHECK(optimizedIndices.size() == indices.size());
+		CHECK(optimizedVertices.size() <= vertices.size());
+		CHECK(SortedTriangles(optimizedVertices, optimizedIndices) == SortedTriangles(vertices, indices));
+
+		// Vertices are stored in the order the index buffer first uses them
+		unsigned int nextVertex = 0;
+		for (unsigned int index : optimizedIndices) {
+			CHECK(index <= nextVertex);
+			if (index == nextVertex) {
+				nextVertex++;
+			}
+		}
+		CHECK(nextVertex == optimizedVertices.size());
+
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(optimizedIndices.data(), optimizedIndices.size(), optimizedVertices.size());
+		if (after.acmr > before.acmr) {
+			printf("  %s: ACMR went from %.3f to %.3f\n", model, before.acmr, after.acmr);
+		}
+		CHECK(after.acmr <= before.acmr);
+		CHECK(after.atvr >= 1.0f && after.atvr <= before.atvr);
+	}
+}
+
+TEST(AnalyzeVertexCacheCountsMisses)
+{
+	// A strip of 4 triangles over 6 vertices: every vertex is loaded once while it fits in the cache
+	unsigned int strip[] = { 0, 1, 2, 2, 1, 3, 2, 3, 4, 4, 3, 5 };
+	VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(strip, 12, 6);
+	CHECK_NEAR(stats.acmr, 6.0 / 4.0, 1e-6);
+	CHECK_NEAR(stats.atvr, 1.0, 1e-6);
+
+	// Coming back to a triangle after another one has pushed it out of a 3 vertex cache loads it again
+	unsigned int revisit[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	CHECK_NEAR(MeshOptimizer::AnalyzeVertexCache(revisit, 9, 6).acmr, 2.0, 1e-6);
+	CHECK_NEAR(MeshOptimizer::AnalyzeVertexCache(revisit, 9, 6, 3).acmr, 3.0, 1e-6);
+}
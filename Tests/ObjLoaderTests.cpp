@@ -0,0 +1,153 @@
+#include "Test.h"
+#include "ObjLoader.h"
+#include <string.h>
+#include <string>
+
+using namespace DirectX;
+using namespace std;
+
+static bool ParseText(const char* text, vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+	return ObjLoader::Parse(text, strlen(text), vertices, indices);
+}
+
+static bool SameFloats(const float* a, const float* b, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (a[i] != b[i]) return false;
+	}
+	return true;
+}
+
+// Triangle by triangle, every corner of the new loader's mesh is the same vertex the legacy loader produced.
+// The legacy loader never fills in tangents, so those aren't compared.
+static void CheckMatchesLegacy(const char* name)
+{
+	string filepath = string(PORTALS_ASSETS_DIR "/Models/") + name;
+	vector<Vertex> vertices, legacyVertices;
+	vector<unsigned int> indices, legacyIndices;
+	CHECK(ObjLoader::Load(filepath.c_str(), vertices, indices));
+	CHECK(ObjLoader::LoadLegacy(filepath.c_str(), legacyVertices, legacyIndices));
+	CHECK(indices.size() == legacyIndices.size());
+	if (indices.size() != legacyIndices.size()) {
+		printf("  %s: %zu indices, legacy loader has %zu\n", name, indices.size(), legacyIndices.size());
+		return;
+	}
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		const Vertex& vertex = vertices[indices[i]];
+		const Vertex& legacy = legacyVertices[legacyIndices[i]];
+		if (!SameFloats(&vertex.Position.x, &legacy.Position.x, 3) ||
+			!SameFloats(&vertex.Normal.x, &legacy.Normal.x, 3) ||
+			!SameFloats(&vertex.UV.x, &legacy.UV.x, 2)) {
+			mismatches++;
+		}
+	}
+	if (mismatches > 0) {
+		printf("  %s: %zu of %zu corners differ from the legacy loader\n", name, mismatches, indices.size());
+	}
+	CHECK(mismatches == 0);
+	// Shared corners are only stored once
+	CHECK(vertices.size() <= legacyVertices.size());
+}
+
+TEST(LoadMatchesTheLegacyLoader)
+{
+	// Every model with positions, uvs and normals, which is all the legacy loader can read
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models) {
+		CheckMatchesLegacy(model);
+	}
+}
+
+TEST(ParseSharesRepeatedCorners)
+{
+	const char* text =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 0 1\n"
+		"f 1/1/1 2/2/1 3/3/1\n"
+		"f 1/1/1 3/3/1 4/4/1\n";
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	CHECK(ParseText(text, vertices, indices));
+	CHECK(vertices.size() == 4);
+	CHECK(indices.size() == 6);
+
+	// Converted to left handed: z and the winding flipped, v measured from the top
+	unsigned int expected[] = { 0, 2, 1, 0, 3, 2 };
+	CHECK(memcmp(indices.data(), expected, sizeof(expected)) == 0);
+	CHECK(vertices[0].Normal.z == -1.0f);
+	CHECK(vertices[2].UV.x == 1.0f && vertices[2].UV.y == 0.0f);
+}
+
+TEST(ParseFansPolygonsAndReadsEveryCornerFormat)
+{
+	// A pentagon with relative indices, then the same corners with no uvs and with nothing but positions
+	const char* text =
+		"v 0 0 0\nv 2 0 0\nv 3 1 0\nv 1 2 0\nv -1 1 0\n"
+		"vt 0.5 0.25\n"
+		"vn 0 0 -1\n"
+		"f -5/-1/-1 -4/-1/-1 -3/-1/-1 -2/-1/-1 -1/-1/-1\n"
+		"f 1//1 2//1 3//1\n"
+		"f 1 2 3\n";
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	CHECK(ParseText(text, vertices, indices));
+	CHECK(indices.size() == (3 + 1 + 1) * 3);
+	CHECK(vertices.size() == 5 + 3 + 3);
+	CHECK(vertices[0].UV.x == 0.5f && vertices[0].UV.y == 0.75f);
+	CHECK(vertices[0].Normal.z == 1.0f);
+	// No uv reads as the bottom left corner, as it did in the legacy loader
+	CHECK(vertices[5].UV.x == 0.0f && vertices[5].UV.y == 1.0f);
+	CHECK(vertices[8].Normal.x == 0.0f && vertices[8].Normal.y == 0.0f && vertices[8].Normal.z == 0.0f);
+}
+
+TEST(ParseReadsNumbersLikeTheStandardLibrary)
+{
+	const char* numbers[] = { "0.000001", "-12.5", "3.14159274", "1e-3", "-2.5E+2", "123456.789", "0.1", "+7" };
+	for (const char* number : numbers) {
+		string text = string("v ") + number + " 0 0\nf 1 1 1\n";
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		CHECK(ObjLoader::Parse(text.c_str(), text.size(), vertices, indices));
+		CHECK(vertices.size() == 1 && vertices[0].Position.x == strtof(number, nullptr));
+	}
+}
+
+TEST(ParseRejectsIndicesOutsideTheirLists)
+{
+	const char* header = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nvn 0 0 1\n";
+	const char* faces[] = {
+		"f 1 2 4\n",			// Past the end
+		"f 0 1 2\n",			// Position 0 doesn't exist
+		"f -4 -2 -1\n",			// Relative, before the start
+		"f 1/2 2/1 3/1\n",		// Past the end of the uvs
+		"f 1/-2 2/1 3/1\n",		// Relative uv before the start
+		"f 1//2 2//1 3//1\n",	// Past the end of the normals
+		"f 1//-2 2//1 3//1\n",	// Relative normal before the start
+	};
+	for (const char* face : faces) {
+		string text = string(header) + face;
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		if (ObjLoader::Parse(text.c_str(), text.size(), vertices, indices)) {
+			printf("  accepted %s", face);
+			CHECK(false);
+		}
+	}
+
+	// The same faces in range are fine
+	string text = string(header) + "f -3/-1/-1 2/1/1 3/1/1\n";
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	CHECK(ObjLoader::Parse(text.c_str(), text.size(), vertices, indices));
+}
+
+TEST(LoadFailsWithoutAFile)
+{
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	CHECK(!ObjLoader::Load(PORTALS_ASSETS_DIR "/Models/missing.obj", vertices, indices));
+}
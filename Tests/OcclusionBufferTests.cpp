@@ -0,0 +1,215 @@
+#include "Test.h"
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <math.h>
+#include <random>
+
+using namespace DirectX;
+using namespace std;
+
+// Pixels this close to a triangle's edge can land either side of it depending on rounding, so they aren't compared
+#define EDGE_MARGIN 1e-3
+#define DEPTH_TOLERANCE 1e-5
+
+// A plain one pixel at a time rasterizer in double precision, sampling at pixel centers like the occlusion buffer.
+// Pixels near an edge are marked instead of drawn.
+struct ReferenceBuffer {
+	vector<double> depth;
+	vector<bool> nearEdge;
+	int left, top, right, bottom;
+
+	ReferenceBuffer(int left, int top, int right, int bottom)
+		: depth(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT, 1.0), nearEdge(depth.size(), false),
+		left(left), top(top), right(right), bottom(bottom)
+	{
+	}
+
+	// Pixel x and y and depth of a world space point, or false if it's on or behind the near plane
+	static bool Project(const XMFLOAT4X4& m, const XMFLOAT3& p, double out[3])
+	{
+		double clip[4];
+		for (int c = 0; c < 4; c++) {
+			clip[c] = p.x * m.m[0][c] + p.y * m.m[1][c] + p.z * m.m[2][c] + m.m[3][c];
+		}
+		if (clip[3] < 1e-5 || clip[2] < 0) {
+			return false;
+		}
+		out[0] = (clip[0] / clip[3] * 0.5 + 0.5) * OCCLUSION_BUFFER_WIDTH;
+		out[1] = (0.5 - clip[1] / clip[3] * 0.5) * OCCLUSION_BUFFER_HEIGHT;
+		out[2] = clip[2] / clip[3];
+		return true;
+	}
+
+	void Draw(const XMFLOAT4X4& viewProjection, const XMFLOAT3* corners)
+	{
+		double v[3][3];
+		for (int i = 0; i < 3; i++) {
+			if (!Project(viewProjection, corners[i], v[i])) return;
+		}
+		double area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+		if (fabs(area) < 1e-6) return;
+
+		for (int y = top; y < bottom; y++) {
+			for (int x = left; x < right; x++) {
+				double px = x + 0.5, py = y + 0.5;
+				// Barycentric weights, and how far inside the nearest edge the pixel center is (negative outside)
+				double weights[3];
+				double inside = 1e30;
+				for (int i = 0; i < 3; i++) {
+					const double* p = v[(i + 1) % 3];
+					const double* q = v[(i + 2) % 3];
+					weights[i] = ((q[0] - p[0]) * (py - p[1]) - (q[1] - p[1]) * (px - p[0])) / area;
+					double length = sqrt((q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]));
+					inside = (std::min)(inside, weights[i] * fabs(area) / length);
+				}
+				size_t index = y * OCCLUSION_BUFFER_WIDTH + x;
+				if (fabs(inside) < EDGE_MARGIN) {
+					nearEdge[index] = true;
+				}
+				else if (inside > 0) {
+					depth[index] = (std::min)(depth[index], weights[0] * v[0][2] + weights[1] * v[1][2] + weights[2] * v[2][2]);
+				}
+			}
+		}
+	}
+};
+
+// Random triangles of all sizes and windings in front of the camera, two big walls for the boxes to hide behind, and
+// a triangle through the near plane that has to be left out
+static vector<XMFLOAT3> RandomOccluders(mt19937& random)
+{
+	uniform_real_distribution<float> x(-12, 12);
+	uniform_real_distribution<float> y(-6, 6);
+	uniform_real_distribution<float> z(2, 40);
+	uniform_real_distribution<float> offset(-4, 4);
+	vector<XMFLOAT3> triangles;
+	for (int t = 0; t < 200; t++) {
+		XMFLOAT3 center(x(random), y(random), z(random));
+		for (int i = 0; i < 3; i++) {
+			triangles.push_back(XMFLOAT3(center.x + offset(random), center.y + offset(random), center.z + offset(random)));
+		}
+	}
+	XMFLOAT3 walls[] = {
+		XMFLOAT3(-8, -6, 10), XMFLOAT3(-8, 6, 10), XMFLOAT3(1, 6, 10),
+		XMFLOAT3(-8, -6, 10), XMFLOAT3(1, 6, 10), XMFLOAT3(1, -6, 10),
+		XMFLOAT3(0, -6, 12), XMFLOAT3(9, -6, 14), XMFLOAT3(9, 6, 14),
+		XMFLOAT3(0, -6, 12), XMFLOAT3(9, 6, 14), XMFLOAT3(0, 6, 12),
+		XMFLOAT3(-3, -3, -8), XMFLOAT3(3, -3, 20), XMFLOAT3(0, 3, 20) };
+	triangles.insert(triangles.end(), begin(walls), end(walls));
+	return triangles;
+}
+
+static void MakeCamera(XMFLOAT4X4& view, XMFLOAT4X4& projection, XMFLOAT4X4& viewProjection)
+{
+	XMStoreFloat4x4(&view, XMMatrixLookAtLH(XMVectorSet(0, 0, -5, 1), XMVectorSet(0, 0, 0, 1), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, (float)OCCLUSION_BUFFER_WIDTH / OCCLUSION_BUFFER_HEIGHT, 0.1f, 100.0f));
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+}
+
+// Every pixel away from an edge has the depth the reference gives it, inside the screen rect, and is untouched outside it
+TEST(DepthMatchesTheReferenceRasterizer)
+{
+	XMFLOAT4X4 view, projection, viewProjection;
+	MakeCamera(view, projection, viewProjection);
+	XMFLOAT4 screenRects[] = { XMFLOAT4(-1, 1, 1, -1), XMFLOAT4(-0.5f, 0.5f, 0.25f, -0.75f) };
+	mt19937 random(99);
+	vector<XMFLOAT3> triangles = RandomOccluders(random);
+
+	for (const XMFLOAT4& screenRect : screenRects) {
+		OcclusionBuffer buffer;
+		buffer.Begin(view, projection, screenRect);
+		buffer.DrawOccluders(triangles.data(), triangles.size() / 3);
+		buffer.Finish();
+
+		ReferenceBuffer reference(
+			(int)floorf((screenRect.x * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH),
+			(int)floorf((0.5f - screenRect.y * 0.5f) * OCCLUSION_BUFFER_HEIGHT),
+			(int)ceilf((screenRect.z * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH),
+			(int)ceilf((0.5f - screenRect.w * 0.5f) * OCCLUSION_BUFFER_HEIGHT));
+		for (size_t t = 0; t < triangles.size(); t += 3) {
+			reference.Draw(viewProjection, &triangles[t]);
+		}
+
+		const float* depth = buffer.GetDepth();
+		size_t covered = 0, skipped = 0, mismatches = 0;
+		for (size_t i = 0; i < reference.depth.size(); i++) {
+			if (reference.nearEdge[i]) {
+				skipped++;
+				continue;
+			}
+			covered += reference.depth[i] < 1.0;
+			if (fabs(depth[i] - reference.depth[i]) > DEPTH_TOLERANCE) {
+				if (mismatches++ == 0) {
+					printf("  pixel %zu, %zu is %g, reference %g\n", i % OCCLUSION_BUFFER_WIDTH, i / OCCLUSION_BUFFER_WIDTH, depth[i], reference.depth[i]);
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+		// Enough was drawn for the comparison to mean something, and few pixels were left out of it
+		CHECK(covered > reference.depth.size() / 8);
+		CHECK(skipped < reference.depth.size() / 50);
+	}
+}
+
+// A box is only ever culled when the reference depth is nearer than all of it at every pixel it could cover
+TEST(CulledBoxesAreHiddenInTheReference)
+{
+	XMFLOAT4X4 view, projection, viewProjection;
+	MakeCamera(view, projection, viewProjection);
+	mt19937 random(7);
+	vector<XMFLOAT3> triangles = RandomOccluders(random);
+
+	OcclusionBuffer buffer;
+	buffer.Begin(view, projection, XMFLOAT4(-1, 1, 1, -1));
+	buffer.DrawOccluders(triangles.data(), triangles.size() / 3);
+	buffer.Finish();
+	ReferenceBuffer reference(0, 0, OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+	for (size_t t = 0; t < triangles.size(); t += 3) {
+		reference.Draw(viewProjection, &triangles[t]);
+	}
+
+	uniform_real_distribution<float> x(-15, 15);
+	uniform_real_distribution<float> y(-8, 8);
+	uniform_real_distribution<float> z(0, 60);
+	uniform_real_distribution<float> extent(0.05f, 2);
+	int culled = 0;
+	for (int b = 0; b < 2000; b++) {
+		BoundingBox box(XMFLOAT3(x(random), y(random), z(random)), XMFLOAT3(extent(random), extent(random), extent(random)));
+		if (buffer.IsVisible(box)) {
+			continue;
+		}
+		culled++;
+
+		XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+		box.GetCorners(corners);
+		double minX = 1e30, minY = 1e30, maxX = -1e30, maxY = -1e30, nearest = 1e30;
+		bool projected = true;
+		for (const XMFLOAT3& corner : corners) {
+			double pixel[3];
+			if (!ReferenceBuffer::Project(viewProjection, corner, pixel)) {
+				projected = false;
+				continue;
+			}
+			minX = (std::min)(minX, pixel[0]);
+			minY = (std::min)(minY, pixel[1]);
+			maxX = (std::max)(maxX, pixel[0]);
+			maxY = (std::max)(maxY, pixel[1]);
+			nearest = (std::min)(nearest, pixel[2]);
+		}
+		CHECK(projected);
+
+		bool hidden = true;
+		for (int py = (std::max)(0, (int)floor(minY)); py <= (std::min)(OCCLUSION_BUFFER_HEIGHT - 1, (int)floor(maxY)); py++) {
+			for (int px = (std::max)(0, (int)floor(minX)); px <= (std::min)(OCCLUSION_BUFFER_WIDTH - 1, (int)floor(maxX)); px++) {
+				size_t index = py * OCCLUSION_BUFFER_WIDTH + px;
+				hidden &= reference.nearEdge[index] || nearest >= reference.depth[index] - DEPTH_TOLERANCE;
+			}
+		}
+		if (!hidden) {
+			printf("  box at %g, %g, %g was culled but shows in the reference\n", box.Center.x, box.Center.y, box.Center.z);
+		}
+		CHECK(hidden);
+	}
+	// The walls hide plenty
+	CHECK(culled > 100);
+}
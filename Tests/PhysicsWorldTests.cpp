@@ -0,0 +1,163 @@
+#include "Test.h"
+#include "PhysicsWorld.h"
+#include <string.h>
+#include <memory>
+#include <random>
+
+using namespace DirectX;
+using namespace std;
+
+// A unit cube around the origin, for bodies and colliders alike. Scaled to size by their transforms.
+static Mesh* MakeCube(RenderBackend* backend)
+{
+	Vertex vertices[8] = {};
+	for (int i = 0; i < 8; i++) {
+		vertices[i].Position = XMFLOAT3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+		vertices[i].Normal = XMFLOAT3(0, 1, 0);
+	}
+	unsigned int indices[36] = {
+		0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 4, 6, 0, 6, 2,
+		1, 3, 7, 1, 7, 5,	0, 1, 5, 0, 5, 4,	2, 6, 7, 2, 7, 3 };
+	return new Mesh(vertices, 8, indices, 36, backend);
+}
+
+// Everything a world needs to run, owned in one place
+struct PhysicsScene {
+	NullRenderBackend backend;
+	unique_ptr<Mesh> cube;
+	unique_ptr<Material> material;
+	vector<unique_ptr<Entity>> entities;
+	vector<unique_ptr<Portal>> portals;
+	PhysicsWorld world;
+
+	PhysicsScene()
+	{
+		cube.reset(MakeCube(&backend));
+		material.reset(new Material(XMFLOAT4(1, 1, 1, 1), nullptr, nullptr, 0));
+	}
+
+	Entity* Add(XMFLOAT3 position, XMFLOAT3 size)
+	{
+		entities.emplace_back(new Entity(cube.get(), material.get()));
+		Transform* transform = entities.back()->GetTransform();
+		transform->SetPosition(position.x, position.y, position.z);
+		transform->SetScale(size.x, size.y, size.z);
+		return entities.back().get();
+	}
+
+	vector<Portal*> GetPortals()
+	{
+		vector<Portal*> list;
+		for (auto& portal : portals) {
+			list.push_back(portal.get());
+		}
+		return list;
+	}
+};
+
+// Positions and velocities of every body after each frame of a run
+struct BodyState {
+	XMFLOAT3 position;
+	XMFLOAT3 velocity;
+};
+
+// A walled room with a portal on the back wall leading out of the front one, and bodies of both shapes thrown around
+// it at random. The frame times are random too, so the steps don't line up with the frames.
+static vector<BodyState> RunRoom(unsigned int seed, int frames)
+{
+	PhysicsScene scene;
+	scene.world.AddStatic(scene.Add(XMFLOAT3(0, -0.25f, 0), XMFLOAT3(10, 0.5f, 10)));
+	scene.world.AddStatic(scene.Add(XMFLOAT3(-5.2f, 3, 0), XMFLOAT3(0.4f, 6, 10)));
+	scene.world.AddStatic(scene.Add(XMFLOAT3(5.2f, 3, 0), XMFLOAT3(0.4f, 6, 10)));
+	scene.world.AddStatic(scene.Add(XMFLOAT3(0, 3, -5.2f), XMFLOAT3(10, 6, 0.4f)));
+	scene.world.AddStatic(scene.Add(XMFLOAT3(0, 3, 5.2f), XMFLOAT3(10, 6, 0.4f)));
+
+	for (int i = 0; i < 2; i++) {
+		scene.portals.emplace_back(new Portal(scene.cube.get(), scene.material.get(), i, XMFLOAT3(1, 1, 1)));
+		Transform* transform = scene.portals.back()->GetTransform();
+		transform->SetPosition(0, 1.5f, i == 0 ? -5.0f : 5.0f);
+		transform->SetPitchYawRoll(0, i == 0 ? 0 : XM_PI, 0);
+		transform->SetScale(1, 1.5f, 0.01f);
+	}
+	scene.portals[0]->SetDestination(scene.portals[1].get());
+	scene.portals[1]->SetDestination(scene.portals[0].get());
+
+	mt19937 random(seed);
+	uniform_real_distribution<float> position(-4, 4);
+	uniform_real_distribution<float> speed(-15, 15);
+	uniform_real_distribution<float> size(0.1f, 0.8f);
+	vector<Entity*> bodies;
+	for (int i = 0; i < 24; i++) {
+		float s = size(random);
+		Entity* body = scene.Add(XMFLOAT3(position(random), 1 + (position(random) + 4) / 2, position(random)), XMFLOAT3(s, s, s));
+		body->SetVelocity(XMFLOAT3(speed(random), speed(random), speed(random)));
+		scene.world.AddBody(body, i % 2 == 0 ? PHYSICS_SHAPE_SPHERE : PHYSICS_SHAPE_BOX);
+		bodies.push_back(body);
+	}
+
+	uniform_real_distribution<float> frameTime(1 / 240.0f, 1 / 20.0f);
+	vector<BodyState> states;
+	for (int f = 0; f < frames; f++) {
+		scene.world.Update(frameTime(random), scene.GetPortals(), nullptr);
+		for (Entity* body : bodies) {
+			states.push_back({ body->GetTransform()->GetPosition(), body->GetVelocity() });
+		}
+	}
+	return states;
+}
+
+TEST(StepsAreDeterministic)
+{
+	vector<BodyState> first = RunRoom(1234, 600);
+	vector<BodyState> second = RunRoom(1234, 600);
+	CHECK(first.size() == second.size());
+	if (first.size() != second.size()) return;
+
+	// Bit for bit, not just close
+	for (size_t i = 0; i < first.size(); i++) {
+		if (memcmp(&first[i], &second[i], sizeof(BodyState)) != 0) {
+			printf("  body %zu differs on frame %zu\n", i % 24, i / 24);
+			CHECK(false);
+			return;
+		}
+	}
+
+	// And the run actually went somewhere: the bodies are no longer where they started
+	vector<BodyState> start = RunRoom(1234, 1);
+	CHECK(memcmp(&start[0], &first[first.size() - 24], sizeof(BodyState) * 24) != 0);
+}
+
+// One step at this speed carries the body several times the wall's thickness plus its own size, so without
+// substeps it would start the step on one side of the wall and end it on the other without ever touching it
+TEST(FastBodiesDontTunnelThroughThinWalls)
+{
+	const float wallMin = 5.0f;
+	const float wallThickness = 0.05f;
+	int shapes[] = { PHYSICS_SHAPE_BOX, PHYSICS_SHAPE_SPHERE };
+	float speeds[] = { 80.0f, 200.0f, -200.0f };
+	for (int shape : shapes) {
+		for (float speed : speeds) {
+			PhysicsScene scene;
+			scene.world.SetGravity(XMFLOAT3(0, 0, 0));
+			float side = speed > 0 ? -1.0f : 1.0f;
+			scene.world.AddStatic(scene.Add(XMFLOAT3(wallMin + wallThickness / 2, 0, 0), XMFLOAT3(wallThickness, 10, 10)));
+			Entity* body = scene.Add(XMFLOAT3(wallMin + wallThickness / 2 + side * 3, 0, 0), XMFLOAT3(0.2f, 0.2f, 0.2f));
+			body->SetVelocity(XMFLOAT3(speed, 0, 0));
+			scene.world.AddBody(body, shape);
+			CHECK(fabsf(speed) * scene.world.GetStepTime() > 2 * (wallThickness + 0.2f));
+
+			vector<Portal*> portals;
+			for (int i = 0; i < 30; i++) {
+				scene.world.Step(portals);
+			}
+			float x = body->GetTransform()->GetPosition().x;
+			bool sameSide = side < 0 ? x + 0.1f <= wallMin + 1e-4f : x - 0.1f >= wallMin + wallThickness - 1e-4f;
+			if (!sameSide) {
+				printf("  shape %d at %g went through the wall to x = %g\n", shape, speed, x);
+			}
+			CHECK(sameSide);
+			// Bounced back, or at least stopped
+			CHECK(body->GetVelocity().x * side >= 0);
+		}
+	}
+}
@@ -0,0 +1,267 @@
+#include "Test.h"
+#include "PortalMath.h"
+
+using namespace DirectX;
+
+#define TOLERANCE 1e-4
+
+static XMFLOAT4X4 ToFloat4x4(FXMMATRIX m)
+{
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, m);
+	return result;
+}
+
+// Portal with the unit circle mesh scaled to width x height, turned by yaw and placed at position
+static XMFLOAT4X4 PortalWorld(XMFLOAT3 position, float yaw, float width = 1, float height = 2)
+{
+	return ToFloat4x4(XMMatrixScaling(width, height, 1) * XMMatrixRotationY(yaw) * XMMatrixTranslation(position.x, position.y, position.z));
+}
+
+static PortalMath::PortalFrame PortalFrameAt(XMFLOAT3 position, XMFLOAT3 forward, float width = 1, float height = 2)
+{
+	PortalMath::PortalFrame frame;
+	frame.position = position;
+	frame.forward = forward;
+	frame.up = XMFLOAT3(0, 1, 0);
+	XMStoreFloat3(&frame.right, XMVector3Cross(XMLoadFloat3(&frame.up), XMLoadFloat3(&forward)));
+	frame.halfExtents = XMFLOAT2(width, height);
+	return frame;
+}
+
+static void CheckPoint(const XMFLOAT3& actual, float x, float y, float z)
+{
+	CHECK_NEAR(actual.x, x, TOLERANCE);
+	CHECK_NEAR(actual.y, y, TOLERANCE);
+	CHECK_NEAR(actual.z, z, TOLERANCE);
+}
+
+// Clip space position of point, after the perspective divide
+static XMFLOAT4 Project(const XMFLOAT4X4& projection, XMFLOAT3 point)
+{
+	XMFLOAT4 clip;
+	XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(point.x, point.y, point.z, 1), XMLoadFloat4x4(&projection)));
+	return clip;
+}
+
+TEST(SourceToDestinationTurnsAroundIntoTheDestination)
+{
+	// Facing portals, 10 apart: in front of one comes out in front of the other, mirrored across both
+	XMFLOAT4X4 source = PortalWorld(XMFLOAT3(0, 0, 0), 0);
+	XMFLOAT4X4 destination = PortalWorld(XMFLOAT3(10, 0, 0), 0);
+	XMFLOAT4X4 sourceToDestination = PortalMath::SourceToDestination(source, destination);
+	CheckPoint(PortalMath::TransformPoint(XMFLOAT3(0, 0, 1), sourceToDestination), 10, 0, -1);
+	CheckPoint(PortalMath::TransformPoint(XMFLOAT3(0.5f, 1, 3), sourceToDestination), 9.5f, 1, -3);
+
+	// Destination turned a quarter to the right and raised
+	destination = ToFloat4x4(XMMatrixRotationY(XM_PIDIV2) * XMMatrixTranslation(5, 2, 0));
+	sourceToDestination = PortalMath::SourceToDestination(ToFloat4x4(XMMatrixIdentity()), destination);
+	CheckPoint(PortalMath::TransformPoint(XMFLOAT3(1, 2, 3), sourceToDestination), 2, 4, 1);
+}
+
+TEST(SourceToDestinationIsUndoneByTheWayBack)
+{
+	XMFLOAT4X4 a = PortalWorld(XMFLOAT3(3, 1, -2), 0.7f, 1.5f, 2.5f);
+	XMFLOAT4X4 b = PortalWorld(XMFLOAT3(-4, 2, 6), -2.1f, 1.5f, 2.5f);
+	XMFLOAT4X4 there = PortalMath::SourceToDestination(a, b);
+	XMFLOAT4X4 back = PortalMath::SourceToDestination(b, a);
+	XMFLOAT4X4 result = ToFloat4x4(XMLoadFloat4x4(&there) * XMLoadFloat4x4(&back));
+	for (int row = 0; row < 4; row++) {
+		for (int column = 0; column < 4; column++) {
+			CHECK_NEAR(result.m[row][column], row == column ? 1.0f : 0.0f, TOLERANCE);
+		}
+	}
+}
+
+TEST(PortalViewSeesTheDestinationAsTheCameraSeesTheSource)
+{
+	// Camera 5 back from the origin, looking down +z
+	XMFLOAT4X4 view = ToFloat4x4(XMMatrixTranslation(0, 0, 5));
+	XMFLOAT4X4 source = PortalWorld(XMFLOAT3(0, 0, 0), 0);
+	XMFLOAT4X4 destination = PortalWorld(XMFLOAT3(10, 0, 0), 0);
+	XMFLOAT4X4 portalView = PortalMath::PortalViewMatrix(view, source, destination);
+
+	// 3 behind the source portal is 3 in front of the destination, and 8 ahead of the camera either way
+	CheckPoint(PortalMath::TransformPoint(XMFLOAT3(10, 0, -3), portalView), 0, 0, 8);
+	CheckPoint(PortalMath::TransformPoint(XMFLOAT3(0, 0, 3), view), 0, 0, 8);
+
+	// Any point, for portals at arbitrary angles
+	source = PortalWorld(XMFLOAT3(2, 1, 7), 0.4f);
+	destination = PortalWorld(XMFLOAT3(-6, 3, -1), 2.5f);
+	view = ToFloat4x4(XMMatrixInverse(nullptr, XMMatrixRotationRollPitchYaw(0.2f, -0.6f, 0) * XMMatrixTranslation(1, 2, -3)));
+	portalView = PortalMath::PortalViewMatrix(view, source, destination);
+	XMFLOAT4X4 sourceToDestination = PortalMath::SourceToDestination(source, destination);
+	XMFLOAT3 point(0.5f, 1.5f, 9);
+	XMFLOAT3 expected = PortalMath::TransformPoint(point, view);
+	CheckPoint(PortalMath::TransformPoint(PortalMath::TransformPoint(point, sourceToDestination), portalView), expected.x, expected.y, expected.z);
+}
+
+TEST(ObliqueProjectionPutsTheNearPlaneOnThePortal)
+{
+	XMFLOAT4X4 view = ToFloat4x4(XMMatrixIdentity());
+	XMFLOAT4X4 projection = ToFloat4x4(XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f));
+	XMFLOAT4X4 oblique = PortalMath::ObliqueProjection(view, projection, XMFLOAT3(0, 0, 5), XMFLOAT3(0, 0, 1), 0);
+
+	// Only the depth column changes
+	for (int row = 0; row < 4; row++) {
+		CHECK(oblique.m[row][0] == projection.m[row][0]);
+		CHECK(oblique.m[row][1] == projection.m[row][1]);
+		CHECK(oblique.m[row][3] == projection.m[row][3]);
+	}
+
+	// Depth 0 on the portal plane, clipped in front of it and kept beyond it
+	XMFLOAT4 onPlane = Project(oblique, XMFLOAT3(1, -0.5f, 5));
+	CHECK_NEAR(onPlane.z / onPlane.w, 0, TOLERANCE);
+	CHECK(Project(oblique, XMFLOAT3(0, 0, 4)).z < 0);
+	XMFLOAT4 beyond = Project(oblique, XMFLOAT3(0, 0, 20));
+	CHECK(beyond.z > 0 && beyond.z <= beyond.w);
+
+	// The default offset moves the plane 0.01 further along the normal, past the wall the portal is offset from
+	oblique = PortalMath::ObliqueProjection(view, projection, XMFLOAT3(0, 0, 5), XMFLOAT3(0, 0, 1));
+	onPlane = Project(oblique, XMFLOAT3(0, 0, 5.01f));
+	CHECK_NEAR(onPlane.z / onPlane.w, 0, TOLERANCE);
+	CHECK(Project(oblique, XMFLOAT3(0, 0, 5)).z < 0);
+	CHECK(Project(oblique, XMFLOAT3(0, 0, 5.02f)).z > 0);
+}
+
+TEST(ObliqueProjectionFollowsATiltedPortal)
+{
+	// Camera turned and moved away from the origin, portal plane at 45 degrees through (2, 0, 6)
+	XMMATRIX cameraWorld = XMMatrixRotationY(0.3f) * XMMatrixTranslation(1, 0, -1);
+	XMFLOAT4X4 view = ToFloat4x4(XMMatrixInverse(nullptr, cameraWorld));
+	XMFLOAT4X4 projection = ToFloat4x4(XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+	XMFLOAT3 normal(0.70710678f, 0, 0.70710678f);
+	XMFLOAT4X4 oblique = PortalMath::ObliqueProjection(view, projection, XMFLOAT3(2, 0, 6), normal, 0);
+	XMFLOAT4X4 viewProjection = ToFloat4x4(XMLoadFloat4x4(&view) * XMLoadFloat4x4(&oblique));
+
+	XMFLOAT3 planePoints[] = { XMFLOAT3(2, 0, 6), XMFLOAT3(3, 1, 5), XMFLOAT3(1, -2, 7) };
+	for (const XMFLOAT3& point : planePoints) {
+		XMFLOAT4 clip = Project(viewProjection, point);
+		CHECK_NEAR(clip.z / clip.w, 0, TOLERANCE);
+	}
+	CHECK(Project(viewProjection, XMFLOAT3(1.5f, 0, 5.5f)).z < 0);
+	CHECK(Project(viewProjection, XMFLOAT3(2.5f, 0, 6.5f)).z > 0);
+}
+
+TEST(ProjectPortalQuadBoundsTheVisiblePortal)
+{
+	// 90 degree square view from the origin. The unit quad 4 ahead spans 37.5 to 62.5 pixels, rounded outwards.
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 100.0f);
+	XMMATRIX facing = XMMatrixRotationY(XM_PI) * XMMatrixTranslation(0, 0, 4);
+	PortalMath::ScreenRect rect;
+	CHECK(PortalMath::ProjectPortalQuad(ToFloat4x4(facing * projection), 100, 100, rect));
+	CHECK(rect.left == 37 && rect.top == 37 && rect.right == 63 && rect.bottom == 63);
+
+	// Off to the side, and clamped to the screen
+	XMMATRIX side = XMMatrixScaling(2, 2, 1) * XMMatrixRotationY(XM_PI) * XMMatrixTranslation(5.5f, 2.3f, 6);
+	CHECK(PortalMath::ProjectPortalQuad(ToFloat4x4(side * projection), 200, 100, rect));
+	CHECK(rect.left == 158 && rect.top == 14 && rect.right == 200 && rect.bottom == 48);
+
+	// Seen from behind
+	XMMATRIX away = XMMatrixTranslation(0, 0, 4);
+	CHECK(!PortalMath::ProjectPortalQuad(ToFloat4x4(away * projection), 100, 100, rect));
+	// Behind the camera
+	XMMATRIX behind = XMMatrixRotationY(XM_PI) * XMMatrixTranslation(0, 0, -5);
+	CHECK(!PortalMath::ProjectPortalQuad(ToFloat4x4(behind * projection), 100, 100, rect));
+}
+
+TEST(ProjectPortalQuadClipsAgainstTheCamera)
+{
+	// A wide portal the camera stands in the middle of still covers what's in front of the camera
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 100.0f);
+	XMMATRIX straddling = XMMatrixScaling(10, 10, 1) * XMMatrixRotationY(XM_PI - 0.3f) * XMMatrixTranslation(0, 0, 1);
+	PortalMath::ScreenRect rect;
+	CHECK(PortalMath::ProjectPortalQuad(ToFloat4x4(straddling * projection), 100, 100, rect));
+	CHECK(rect.left == 0 && rect.top == 0 && rect.right == 100 && rect.bottom == 100);
+}
+
+TEST(SweptCrossingFindsWhereTheMoverReachesThePortal)
+{
+	PortalMath::PortalFrame frame = PortalFrameAt(XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 1));
+	float time = -1;
+	CHECK(PortalMath::SweptCrossing(frame, XMFLOAT3(0, 1, 2), XMFLOAT3(0, 1, -2), time));
+	CHECK_NEAR(time, 0.5, TOLERANCE);
+	CHECK(PortalMath::SweptCrossing(frame, XMFLOAT3(0.5f, 2, 1), XMFLOAT3(0.5f, 2, -3), time));
+	CHECK_NEAR(time, 0.25, TOLERANCE);
+
+	// Wrong way round, stopping short, or passing beside the opening
+	CHECK(!PortalMath::SweptCrossing(frame, XMFLOAT3(0, 1, -2), XMFLOAT3(0, 1, 2), time));
+	CHECK(!PortalMath::SweptCrossing(frame, XMFLOAT3(0, 1, 2), XMFLOAT3(0, 1, 0.1f), time));
+	CHECK(!PortalMath::SweptCrossing(frame, XMFLOAT3(1.2f, 1, 2), XMFLOAT3(1.2f, 1, -2), time));
+	// Inside the bounding rectangle, but outside the ellipse
+	CHECK(!PortalMath::SweptCrossing(frame, XMFLOAT3(0.9f, 2.8f, 1), XMFLOAT3(0.9f, 2.8f, -1), time));
+}
+
+TEST(SweptCrossingCatchesMoversThatSkipOverThePortal)
+{
+	// Steps far longer than the portal is deep, where testing only the end points would tunnel straight through
+	PortalMath::PortalFrame frame = PortalFrameAt(XMFLOAT3(10, 3, 0), XMFLOAT3(-1, 0, 0), 1.2f, 2.4f);
+	float time = -1;
+	CHECK(PortalMath::SweptCrossing(frame, XMFLOAT3(9.999f, 3, 0), XMFLOAT3(10.001f, 3, 0), time));
+	CHECK_NEAR(time, 0.5, 1e-3);
+	CHECK(PortalMath::SweptCrossing(frame, XMFLOAT3(-90, 3, 0), XMFLOAT3(110, 3, 0), time));
+	CHECK_NEAR(time, 0.5, TOLERANCE);
+	// At an angle, through the edge of the opening
+	CHECK(PortalMath::SweptCrossing(frame, XMFLOAT3(0, 3, -1), XMFLOAT3(20, 3, 3.2f), time));
+	CHECK_NEAR(time, 0.5, TOLERANCE);
+	CHECK(!PortalMath::SweptCrossing(frame, XMFLOAT3(0, 3, -1), XMFLOAT3(20, 3, 3.6f), time));
+	// Straight down through a floor portal
+	PortalMath::PortalFrame floor = PortalFrameAt(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1));
+	floor.forward = XMFLOAT3(0, 1, 0);
+	floor.up = XMFLOAT3(0, 0, 1);
+	floor.right = XMFLOAT3(1, 0, 0);
+	CHECK(PortalMath::SweptCrossing(floor, XMFLOAT3(0, 50, 0.5f), XMFLOAT3(0, -50, 0.5f), time));
+	CHECK_NEAR(time, 0.5, TOLERANCE);
+}
+
+TEST(PortalPlaneAndDistances)
+{
+	PortalMath::PortalFrame frame = PortalFrameAt(XMFLOAT3(2, 0, 3), XMFLOAT3(0, 0, -1));
+	XMFLOAT4 plane = PortalMath::PortalPlane(frame);
+	CHECK_NEAR(plane.z, -1, TOLERANCE);
+	CHECK_NEAR(plane.w, 3, TOLERANCE);
+	CHECK_NEAR(PortalMath::SignedDistance(frame, XMFLOAT3(5, 4, 1)), 2, TOLERANCE);
+	CHECK_NEAR(PortalMath::SignedDistance(frame, XMFLOAT3(0, 0, 4)), -1, TOLERANCE);
+	CHECK_NEAR(PortalMath::PlanarDistance(frame, XMFLOAT3(5, 4, 1)), 5, TOLERANCE);
+}
+
+TEST(StraddlesAndInOpening)
+{
+	PortalMath::PortalFrame frame = PortalFrameAt(XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 1));
+	XMFLOAT3 extents(0.25f, 0.25f, 0.25f);
+	CHECK(PortalMath::Straddles(frame, XMFLOAT3(0, 1, 0.1f), extents));
+	CHECK(!PortalMath::Straddles(frame, XMFLOAT3(0, 1, 0.3f), extents));		// Not touching the plane yet
+	CHECK(!PortalMath::Straddles(frame, XMFLOAT3(0, 1, -0.1f), extents));		// Center already through
+	CHECK(!PortalMath::Straddles(frame, XMFLOAT3(1.5f, 1, 0.1f), extents));	// Beside the opening
+
+	CHECK(PortalMath::InOpening(frame, XMFLOAT3(0.5f, 2, 0.05f), 0.1f));
+	CHECK(!PortalMath::InOpening(frame, XMFLOAT3(0.5f, 2, 0.2f), 0.1f));
+	CHECK(!PortalMath::InOpening(frame, XMFLOAT3(0.9f, 2.8f, 0), 0.1f));
+}
+
+// The angles give the same orientation as expected, however they wrap
+static void CheckOrientation(const XMFLOAT3& pitchYawRoll, FXMMATRIX expected)
+{
+	XMMATRIX actual = XMMatrixRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+	for (int row = 0; row < 3; row++) {
+		XMFLOAT3 axis, expectedAxis;
+		XMStoreFloat3(&axis, actual.r[row]);
+		XMStoreFloat3(&expectedAxis, expected.r[row]);
+		CheckPoint(axis, expectedAxis.x, expectedAxis.y, expectedAxis.z);
+	}
+}
+
+TEST(TeleportPitchYawRollTurnsWithThePortals)
+{
+	// Portals facing the same way: walking in turns you around, keeping pitch
+	XMFLOAT4X4 sourceToDestination = PortalMath::SourceToDestination(PortalWorld(XMFLOAT3(0, 0, 0), 0), PortalWorld(XMFLOAT3(10, 0, 0), 0));
+	XMFLOAT3 upright = PortalMath::TeleportPitchYawRoll(XMFLOAT3(0.2f, 0.5f, 0), sourceToDestination, true);
+	CHECK_NEAR(upright.x, 0.2f, TOLERANCE);
+	CheckOrientation(upright, XMMatrixRotationRollPitchYaw(0.2f, 0.5f + XM_PI, 0));
+
+	// A tumbling body comes out turned by the portals, however it was oriented
+	sourceToDestination = PortalMath::SourceToDestination(PortalWorld(XMFLOAT3(0, 0, 0), 0), PortalWorld(XMFLOAT3(4, 0, 2), 1.1f));
+	XMFLOAT3 angles(0.3f, -0.7f, 0.4f);
+	XMFLOAT3 turned = PortalMath::TeleportPitchYawRoll(angles, sourceToDestination, false);
+	CheckOrientation(turned, XMMatrixRotationRollPitchYaw(angles.x, angles.y, angles.z) * XMMatrixRotationY(XM_PI + 1.1f));
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "FakeShaders.h"
+#include "PortalRenderer.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+// A walled room with a portal on the back wall leading out of the front one, so the camera looking at the back wall
+// sees the room again through it, as deep as the recursion goes. Crates are scattered around the floor. Everything is
+// drawn through fake shaders into whatever backend the commands are replayed by, so whole frames can be recorded
+// without a GPU.
+struct PortalRoom {
+	NullRenderBackend backend;
+	FakeShaders shaders;
+	std::unique_ptr<Mesh> cube;
+	std::unique_ptr<Mesh> quad;
+	std::unique_ptr<Material> material;
+	std::unique_ptr<Material> portalMaterial;
+	std::vector<std::unique_ptr<Entity>> entities;
+	std::vector<std::unique_ptr<Portal>> portals;
+	PortalScene scene;
+	PortalRenderer renderer;
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT3 cameraPosition;
+	// Stand ins for the backend's texture and sampler, which the command buffer only passes along
+	char texture = 0;
+	char sampler = 0;
+
+	PortalRoom(int crateCount, unsigned int width = 1280, unsigned int height = 720)
+	{
+		using namespace DirectX;
+
+		// A unit cube around the origin, scaled to size by each entity's transform
+		Vertex vertices[8] = {};
+		for (int i = 0; i < 8; i++) {
+			vertices[i].Position = XMFLOAT3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+			vertices[i].Normal = XMFLOAT3(0, 1, 0);
+		}
+		unsigned int indices[36] = {
+			0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 4, 6, 0, 6, 2,
+			1, 3, 7, 1, 7, 5,	0, 1, 5, 0, 5, 4,	2, 6, 7, 2, 7, 3 };
+		cube.reset(new Mesh(vertices, 8, indices, 36, &backend));
+
+		// The portals' unit quad, facing -z
+		Vertex quadVertices[4] = {};
+		for (int i = 0; i < 4; i++) {
+			quadVertices[i].Position = XMFLOAT3(i == 0 || i == 1 ? -0.5f : 0.5f, i == 1 || i == 2 ? 0.5f : -0.5f, 0);
+			quadVertices[i].Normal = XMFLOAT3(0, 0, -1);
+		}
+		unsigned int quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+		quad.reset(new Mesh(quadVertices, 4, quadIndices, 6, &backend));
+
+		material.reset(new Material(XMFLOAT4(1, 1, 1, 1), &shaders.lighting, &shaders.vertex, 0.5f));
+		material->SetInstancedVertexShaders(&shaders.instanced, nullptr);
+		material->AddTexture("Albedo", &texture);
+		material->AddSampler("BasicSampler", &sampler);
+		portalMaterial.reset(new Material(XMFLOAT4(1, 1, 1, 1), &shaders.portal, &shaders.vertex, 0));
+		portalMaterial->AddSampler("BasicSampler", &sampler);
+
+		unsigned int wallTags = ENTITY_TAG_SOLID | ENTITY_TAG_OCCLUDER | ENTITY_TAG_WALL;
+		Add(XMFLOAT3(0, -0.25f, 0), XMFLOAT3(10, 0.5f, 10), wallTags);
+		Add(XMFLOAT3(-5.2f, 3, 0), XMFLOAT3(0.4f, 6, 10), wallTags);
+		Add(XMFLOAT3(5.2f, 3, 0), XMFLOAT3(0.4f, 6, 10), wallTags);
+		Add(XMFLOAT3(0, 3, -5.2f), XMFLOAT3(10, 6, 0.4f), wallTags);
+		Add(XMFLOAT3(0, 3, 5.2f), XMFLOAT3(10, 6, 0.4f), wallTags);
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-4, 4);
+		std::uniform_real_distribution<float> size(0.2f, 1);
+		for (int i = 0; i < crateCount; i++) {
+			float s = size(random);
+			Add(XMFLOAT3(position(random), s / 2, position(random)), XMFLOAT3(s, s, s), ENTITY_TAG_SOLID);
+		}
+
+		for (int i = 0; i < 2; i++) {
+			portals.emplace_back(new Portal(quad.get(), portalMaterial.get(), i, XMFLOAT3(1, 0.5f, 0)));
+			Transform* transform = portals.back()->GetTransform();
+			transform->SetPosition(0, 2, i == 0 ? -4.99f : 4.99f);
+			transform->SetPitchYawRoll(0, i == 0 ? 0 : XM_PI, 0);
+			transform->SetScale(2, 3, 1);
+			scene.portals.push_back({ portals.back().get(), 1, 0 });
+		}
+		portals[0]->SetDestination(portals[1].get());
+		portals[1]->SetDestination(portals[0].get());
+
+		scene.physicsWorld = nullptr;
+		scene.lights.resize(2);
+		scene.lights[0].Type = LIGHT_TYPE_DIRECTIONAL;
+		scene.lights[0].Direction = XMFLOAT3(0.3f, -1, 0.2f);
+		scene.lights[1].Type = LIGHT_TYPE_POINT;
+		scene.lights[1].Position = XMFLOAT3(0, 4, 0);
+		scene.ambientColor = XMFLOAT3(0.1f, 0.1f, 0.1f);
+
+		// Standing in the middle of the room, facing the back wall's portal
+		cameraPosition = XMFLOAT3(0, 2, 2);
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&cameraPosition), XMVectorSet(0, 0, -1, 0), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)width / height, 0.01f, 100.0f));
+		renderer.SetScreenSize(width, height);
+	}
+
+	Entity* Add(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 size, unsigned int tags)
+	{
+		entities.emplace_back(new Entity(cube.get(), material.get()));
+		Entity* entity = entities.back().get();
+		entity->GetTransform()->SetPosition(position.x, position.y, position.z);
+		entity->GetTransform()->SetScale(size.x, size.y, size.z);
+		entity->SetTags(tags);
+		scene.entities.push_back(entity);
+		return entity;
+	}
+
+	void RecordFrame(CommandBuffer& commands, int recursion)
+	{
+		renderer.RecordFrame(commands, scene, view, projection, cameraPosition, recursion);
+	}
+};
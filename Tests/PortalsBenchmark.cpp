@@ -0,0 +1,23 @@
+#include "Benchmark.h"
+#include "PortalRoom.h"
+#include <stdlib.h>
+
+// Times the portal and transform math, then records a frame of the portal room, three levels of portals deep, into a
+// NullRenderBackend over and over, and prints the time each frame takes to record and how many of each command it
+// holds. No window or GPU is needed, so the CPU cost of a recursive portal frame can be measured anywhere the tests run.
+// Usage: PortalsBenchmark [frames]
+int main(int argc, char** argv)
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 200;
+	if (frames < 1) {
+		printf("Usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	Benchmark::RunPortalMathBenchmark(10000);
+	Benchmark::RunTransformBenchmark(10000);
+
+	PortalRoom room(200);
+	Benchmark::RunFrameRecordingBenchmark([&room](CommandBuffer& commands) { room.RecordFrame(commands, 3); }, frames);
+	return 0;
+}
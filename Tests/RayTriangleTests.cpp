@@ -0,0 +1,186 @@
+#include "Test.h"
+#include "RayTriangle.h"
+#include <float.h>
+#include <random>
+
+using namespace DirectX;
+using namespace std;
+
+// Triangles scattered through a box around the origin, and rays from around the box aimed near one of them,
+// so that plenty of the tests hit and plenty just miss past an edge
+struct RandomScene {
+	mt19937 random;
+	uniform_real_distribution<float> coordinate;
+	uniform_real_distribution<float> barycentric;
+	RandomScene(unsigned int seed) : random(seed), coordinate(-5.0f, 5.0f), barycentric(-0.25f, 1.0f) {}
+
+	XMFLOAT3 Point() { return XMFLOAT3(coordinate(random), coordinate(random), coordinate(random)); }
+	void Triangle(XMFLOAT3 out[3])
+	{
+		XMFLOAT3 center = Point();
+		for (int k = 0; k < 3; k++) {
+			XMFLOAT3 offset = Point();
+			out[k] = XMFLOAT3(center.x + offset.x * 0.5f, center.y + offset.y * 0.5f, center.z + offset.z * 0.5f);
+		}
+	}
+	void Ray(const XMFLOAT3 triangle[3], XMFLOAT3& origin, XMFLOAT3& direction)
+	{
+		origin = Point();
+		origin = XMFLOAT3(origin.x * 2, origin.y * 2, origin.z * 2);
+		float a = barycentric(random), b = barycentric(random);
+		XMFLOAT3 target(
+			triangle[0].x + a * (triangle[1].x - triangle[0].x) + b * (triangle[2].x - triangle[0].x),
+			triangle[0].y + a * (triangle[1].y - triangle[0].y) + b * (triangle[2].y - triangle[0].y),
+			triangle[0].z + a * (triangle[1].z - triangle[0].z) + b * (triangle[2].z - triangle[0].z));
+		direction = XMFLOAT3(target.x - origin.x, target.y - origin.y, target.z - origin.z);
+	}
+};
+
+// The scalar test over each triangle, keeping the closest hit the way the wide versions do
+static int ClosestScalar(const XMFLOAT3* positions, int count, XMFLOAT3 origin, XMFLOAT3 direction,
+	float minDistance, float maxDistance, float& outDistance, float& outU, float& outV)
+{
+	int closest = -1;
+	for (int i = 0; i < count; i++) {
+		float t, u, v;
+		if (RayTriangle::Intersect(origin, direction, positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2],
+			minDistance, maxDistance, t, u, v) && (closest < 0 || t < outDistance)) {
+			closest = i;
+			outDistance = t;
+			outU = u;
+			outV = v;
+		}
+	}
+	return closest;
+}
+
+TEST(IntersectBlockMatchesScalar)
+{
+	RandomScene scene(7);
+	int hits = 0, mismatches = 0;
+	for (int i = 0; i < 20000; i++) {
+		// Partly filled blocks too, so the padding lanes are exercised
+		int count = 1 + i % 4;
+		XMFLOAT3 positions[12];
+		for (int k = 0; k < count; k++) {
+			scene.Triangle(&positions[k * 3]);
+		}
+		TriangleBlock4 block;
+		RayTriangle::BuildBlock(positions, count, block);
+		XMFLOAT3 origin, direction;
+		scene.Ray(&positions[(i / 4) % count * 3], origin, direction);
+
+		float expectedT = 0, expectedU = 0, expectedV = 0;
+		int expected = ClosestScalar(positions, count, origin, direction, 0.0001f, 2.0f, expectedT, expectedU, expectedV);
+		float t, u, v;
+		int lane = RayTriangle::IntersectBlock(block, origin, direction, 0.0001f, 2.0f, t, u, v);
+		CHECK(RayTriangle::IntersectBlockAny(block, origin, direction, 0.0001f, 2.0f) == (expected >= 0));
+		if (lane != expected) {
+			mismatches++;
+			continue;
+		}
+		if (lane >= 0) {
+			hits++;
+			CHECK_NEAR(t, expectedT, 1e-5);
+			CHECK_NEAR(u, expectedU, 1e-5);
+			CHECK_NEAR(v, expectedV, 1e-5);
+		}
+	}
+	if (mismatches > 0) {
+		printf("  %d of 20000 blocks picked a different triangle than the scalar test\n", mismatches);
+	}
+	CHECK(mismatches == 0);
+	CHECK(hits > 1000);
+}
+
+TEST(IntersectPacketMatchesScalar)
+{
+	RandomScene scene(11);
+	int hits = 0, mismatches = 0;
+	for (int i = 0; i < 2000; i++) {
+		// Each packet against a handful of triangles, keeping the closest hit per ray
+		XMFLOAT3 positions[8 * 3];
+		for (int k = 0; k < 8; k++) {
+			scene.Triangle(&positions[k * 3]);
+		}
+		XMFLOAT3 origins[4], directions[4];
+		RayPacket4 rays;
+		for (int lane = 0; lane < 4; lane++) {
+			scene.Ray(&positions[(i + lane) % 8 * 3], origins[lane], directions[lane]);
+			(&rays.ox.x)[lane] = origins[lane].x;
+			(&rays.oy.x)[lane] = origins[lane].y;
+			(&rays.oz.x)[lane] = origins[lane].z;
+			(&rays.dx.x)[lane] = directions[lane].x;
+			(&rays.dy.x)[lane] = directions[lane].y;
+			(&rays.dz.x)[lane] = directions[lane].z;
+		}
+
+		XMFLOAT4 distance(2.0f, 2.0f, 2.0f, 2.0f), u(0, 0, 0, 0), v(0, 0, 0, 0);
+		int hitLanes = 0;
+		for (int k = 0; k < 8; k++) {
+			hitLanes |= RayTriangle::IntersectPacket(rays, positions[k * 3], positions[k * 3 + 1], positions[k * 3 + 2], 0.0001f, distance, u, v);
+		}
+
+		for (int lane = 0; lane < 4; lane++) {
+			float expectedT = 0, expectedU = 0, expectedV = 0;
+			bool expectedHit = ClosestScalar(positions, 8, origins[lane], directions[lane], 0.0001f, 2.0f, expectedT, expectedU, expectedV) >= 0;
+			bool hit = (hitLanes & (1 << lane)) != 0;
+			if (hit != expectedHit) {
+				mismatches++;
+				continue;
+			}
+			if (hit) {
+				hits++;
+				CHECK_NEAR((&distance.x)[lane], expectedT, 1e-5);
+				CHECK_NEAR((&u.x)[lane], expectedU, 1e-5);
+				CHECK_NEAR((&v.x)[lane], expectedV, 1e-5);
+			}
+			else {
+				CHECK((&distance.x)[lane] == 2.0f);
+			}
+		}
+	}
+	if (mismatches > 0) {
+		printf("  %d of 8000 packet rays disagree with the scalar test about hitting\n", mismatches);
+	}
+	CHECK(mismatches == 0);
+	CHECK(hits > 1000);
+}
+
+TEST(MissesParallelRaysEmptyLanesAndOutOfRangeHits)
+{
+	// One triangle in the z = 1 plane, in the first lane of a block
+	XMFLOAT3 triangle[3] = { XMFLOAT3(-1, -1, 1), XMFLOAT3(1, -1, 1), XMFLOAT3(0, 1, 1) };
+	TriangleBlock4 block;
+	RayTriangle::BuildBlock(triangle, 1, block);
+	float t, u, v;
+
+	// Straight through the middle
+	CHECK(RayTriangle::IntersectBlock(block, XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 0, FLT_MAX, t, u, v) == 0);
+	CHECK_NEAR(t, 1.0, 1e-6);
+	// Along the plane, parallel to it
+	CHECK(!RayTriangle::Intersect(XMFLOAT3(-2, 0, 1), XMFLOAT3(1, 0, 0), triangle[0], triangle[1], triangle[2], 0, FLT_MAX, t, u, v));
+	CHECK(RayTriangle::IntersectBlock(block, XMFLOAT3(-2, 0, 1), XMFLOAT3(1, 0, 0), 0, FLT_MAX, t, u, v) == -1);
+	// The hit is at exactly 1, and both ends of the range are exclusive
+	CHECK(RayTriangle::IntersectBlock(block, XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 0, 1.0f, t, u, v) == -1);
+	CHECK(RayTriangle::IntersectBlock(block, XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 1.0f, FLT_MAX, t, u, v) == -1);
+	CHECK(!RayTriangle::Intersect(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), triangle[0], triangle[1], triangle[2], 0, 1.0f, t, u, v));
+	// Padding lanes sit at the origin with zero edges, and never hit a ray through it
+	CHECK(!RayTriangle::IntersectBlockAny(block, XMFLOAT3(0, 0, -1), XMFLOAT3(0.3f, 0.2f, 0.1f), 0, 0.5f));
+
+	// BuildBlocks splits triangles into blocks of four, the last one padded
+	XMFLOAT3 positions[5 * 3];
+	for (int i = 0; i < 5; i++) {
+		positions[i * 3] = XMFLOAT3(-1, -1, (float)i + 1);
+		positions[i * 3 + 1] = XMFLOAT3(1, -1, (float)i + 1);
+		positions[i * 3 + 2] = XMFLOAT3(0, 1, (float)i + 1);
+	}
+	vector<TriangleBlock4> blocks;
+	RayTriangle::BuildBlocks(positions, 5, blocks);
+	CHECK(blocks.size() == 2);
+	CHECK(RayTriangle::IntersectBlock(blocks[1], XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 0, FLT_MAX, t, u, v) == 0);
+	CHECK_NEAR(t, 5.0, 1e-6);
+	// From behind, the nearest triangle of the first block is the fourth
+	CHECK(RayTriangle::IntersectBlock(blocks[0], XMFLOAT3(0, 0, 10), XMFLOAT3(0, 0, -1), 0, FLT_MAX, t, u, v) == 3);
+	CHECK_NEAR(t, 6.0, 1e-6);
+}
@@ -0,0 +1,251 @@
+#include "Test.h"
+#include "SceneBVH.h"
+#include "RayTriangle.h"
+#include <math.h>
+#include <memory>
+#include <random>
+
+using namespace DirectX;
+using namespace std;
+
+// A unit cube around the origin, scaled, turned and moved into place by each entity's transform
+static Mesh* MakeCube(RenderBackend* backend)
+{
+	Vertex vertices[8] = {};
+	for (int i = 0; i < 8; i++) {
+		vertices[i].Position = XMFLOAT3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+		vertices[i].Normal = XMFLOAT3(0, 1, 0);
+	}
+	unsigned int indices[36] = {
+		0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 4, 6, 0, 6, 2,
+		1, 3, 7, 1, 7, 5,	0, 1, 5, 0, 5, 4,	2, 6, 7, 2, 7, 3 };
+	return new Mesh(vertices, 8, indices, 36, backend);
+}
+
+// Random cubes of random sizes, turns and tags scattered through a box 40 units across
+struct RandomScene {
+	NullRenderBackend backend;
+	unique_ptr<Mesh> cube;
+	unique_ptr<Material> material;
+	vector<unique_ptr<Entity>> entities;
+	mt19937 random;
+
+	RandomScene(unsigned int seed) : random(seed)
+	{
+		cube.reset(MakeCube(&backend));
+		material.reset(new Material(XMFLOAT4(1, 1, 1, 1), nullptr, nullptr, 0));
+	}
+
+	Entity* Add()
+	{
+		uniform_real_distribution<float> position(-20, 20);
+		uniform_real_distribution<float> size(0.2f, 3);
+		uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+		uniform_int_distribution<unsigned int> tags(0, 3);
+		entities.emplace_back(new Entity(cube.get(), material.get()));
+		Entity* entity = entities.back().get();
+		entity->GetTransform()->SetPosition(position(random), position(random), position(random));
+		entity->GetTransform()->SetPitchYawRoll(angle(random), angle(random), angle(random));
+		entity->GetTransform()->SetScale(size(random), size(random), size(random));
+		entity->SetTags(tags(random));
+		return entity;
+	}
+};
+
+// The closest hit found by testing every world space triangle of every entity with one of the tags
+static bool BruteForceRaycast(const vector<Entity*>& entities, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance,
+	unsigned int tagMask, SceneRayHit& outHit)
+{
+	bool hit = false;
+	float closest = maxDistance;
+	for (Entity* entity : entities) {
+		if ((entity->GetTags() & tagMask) == 0) {
+			continue;
+		}
+		XMFLOAT4X4 world = entity->GetTransform()->GetWorldMatrix();
+		XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+		const vector<Vertex>& vertices = entity->GetMesh()->GetVertices();
+		const vector<unsigned int>& indices = entity->GetMesh()->GetIndices();
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			XMFLOAT3 corners[3];
+			for (int c = 0; c < 3; c++) {
+				XMStoreFloat3(&corners[c], XMVector3TransformCoord(XMLoadFloat3(&vertices[indices[i + c]].Position), worldMatrix));
+			}
+			float t, u, v;
+			if (RayTriangle::Intersect(origin, direction, corners[0], corners[1], corners[2], 0.0001f, closest, t, u, v)) {
+				hit = true;
+				closest = t;
+				outHit.entity = entity;
+				outHit.triangle = (unsigned int)(i / 3);
+				outHit.distance = t;
+			}
+		}
+	}
+	return hit;
+}
+
+// Random rays through the scene with random tag masks, checked against the brute force cast. Returns the number of
+// rays that hit something.
+static int CheckRaycasts(SceneBVH& bvh, const vector<Entity*>& entities, mt19937& random, int rayCount)
+{
+	uniform_real_distribution<float> coordinate(-25, 25);
+	uniform_int_distribution<unsigned int> tags(1, 3);
+	int hits = 0, mismatches = 0;
+	for (int i = 0; i < rayCount; i++) {
+		XMFLOAT3 origin(coordinate(random), coordinate(random), coordinate(random));
+		XMFLOAT3 direction(coordinate(random) - origin.x, coordinate(random) - origin.y, coordinate(random) - origin.z);
+		unsigned int tagMask = i % 5 == 0 ? ENTITY_TAG_ALL : tags(random);
+		// Some rays stop short, so maxDistance has to cut off hits too
+		float maxDistance = i % 4 == 0 ? 0.3f : 1.0f;
+
+		SceneRayHit expected = {}, actual = {};
+		bool expectedHit = BruteForceRaycast(entities, origin, direction, maxDistance, tagMask, expected);
+		bool actualHit = bvh.RaycastScene(origin, direction, maxDistance, tagMask, actual);
+		if (actualHit != expectedHit) {
+			if (mismatches++ == 0) {
+				printf("  ray %d with tags %u: hit %d, brute force %d\n", i, tagMask, actualHit, expectedHit);
+			}
+			continue;
+		}
+		if (!actualHit) {
+			continue;
+		}
+		hits++;
+		CHECK_NEAR(actual.distance, expected.distance, 1e-4);
+		CHECK((actual.entity->GetTags() & tagMask) != 0);
+		// Where two entities touch at the hit, either can be reported
+		if (actual.entity != expected.entity) {
+			CHECK(fabsf(actual.distance - expected.distance) < 1e-4f);
+		}
+	}
+	CHECK(mismatches == 0);
+	return hits;
+}
+
+static vector<Entity*> GetEntities(RandomScene& scene)
+{
+	vector<Entity*> list;
+	for (auto& entity : scene.entities) {
+		list.push_back(entity.get());
+	}
+	return list;
+}
+
+TEST(RaycastMatchesBruteForce)
+{
+	RandomScene scene(12);
+	SceneBVH bvh;
+	for (int i = 0; i < 300; i++) {
+		bvh.Insert(scene.Add());
+	}
+	CHECK(bvh.GetEntityCount() == 300);
+	vector<Entity*> entities = GetEntities(scene);
+	CHECK(CheckRaycasts(bvh, entities, scene.random, 3000) > 300);
+	// Nothing has the tags nobody was given
+	XMFLOAT3 origin(-25, 0, 0), direction(50, 0, 0);
+	SceneRayHit hit;
+	CHECK(!bvh.RaycastScene(origin, direction, 1, ENTITY_TAG_WALL, hit));
+}
+
+// Entities nudged within their leaf's margin and ones moved far beyond it, and ones whose tags changed, are all found
+// where they are now after an update, and never where they were
+TEST(UpdateFollowsMovedEntities)
+{
+	RandomScene scene(34);
+	SceneBVH bvh;
+	for (int i = 0; i < 200; i++) {
+		bvh.Insert(scene.Add());
+	}
+	vector<Entity*> entities = GetEntities(scene);
+	bvh.Update();
+
+	uniform_real_distribution<float> nudge(-0.05f, 0.05f);
+	uniform_real_distribution<float> position(-20, 20);
+	for (size_t i = 0; i < entities.size(); i++) {
+		Transform* transform = entities[i]->GetTransform();
+		if (i % 3 == 0) {
+			transform->MoveAbsolute(nudge(scene.random), nudge(scene.random), nudge(scene.random));
+		}
+		else if (i % 3 == 1) {
+			transform->SetPosition(position(scene.random), position(scene.random), position(scene.random));
+		}
+		if (i % 7 == 0) {
+			entities[i]->SetTags(entities[i]->GetTags() ^ ENTITY_TAG_PORTALABLE);
+		}
+	}
+	bvh.Update();
+	CHECK(bvh.GetEntityCount() == 200);
+	CHECK(CheckRaycasts(bvh, entities, scene.random, 3000) > 200);
+
+	// A lone cube moved across the scene is hit where it went, and missed where it was
+	SceneBVH single;
+	Entity* mover = scene.Add();
+	mover->SetTags(ENTITY_TAG_SOLID);
+	mover->GetTransform()->SetPosition(0, 0, 0);
+	single.Insert(mover);
+	mover->GetTransform()->SetPosition(10, 0, 0);
+	single.Update();
+	SceneRayHit hit;
+	CHECK(single.RaycastScene(XMFLOAT3(10, 10, 0), XMFLOAT3(0, -20, 0), 1, ENTITY_TAG_ALL, hit) && hit.entity == mover);
+	CHECK(!single.RaycastScene(XMFLOAT3(0, 10, 0), XMFLOAT3(0, -20, 0), 1, ENTITY_TAG_ALL, hit));
+}
+
+// Removed entities are never hit, and the rest still are
+TEST(RemovedEntitiesAreNeverHit)
+{
+	RandomScene scene(56);
+	SceneBVH bvh;
+	for (int i = 0; i < 300; i++) {
+		bvh.Insert(scene.Add());
+	}
+	vector<Entity*> remaining;
+	for (size_t i = 0; i < scene.entities.size(); i++) {
+		if (i % 3 == 0) {
+			bvh.Remove(scene.entities[i].get());
+		}
+		else {
+			remaining.push_back(scene.entities[i].get());
+		}
+	}
+	CHECK(bvh.GetEntityCount() == remaining.size());
+	CHECK(CheckRaycasts(bvh, remaining, scene.random, 3000) > 200);
+
+	for (Entity* entity : remaining) {
+		bvh.Remove(entity);
+	}
+	CHECK(bvh.GetEntityCount() == 0);
+	SceneRayHit hit;
+	CHECK(!bvh.RaycastScene(XMFLOAT3(-25, 0, 0), XMFLOAT3(50, 0, 0), 1, ENTITY_TAG_ALL, hit));
+}
+
+// Entities inserted in a line, the order that turns an unbalanced tree into a list, still give a tree whose height
+// grows with the log of the entity count, and it stays that way as they're removed from one end
+TEST(RotationsKeepTheTreeBalanced)
+{
+	RandomScene scene(78);
+	SceneBVH bvh;
+	for (int i = 0; i < 1024; i++) {
+		Entity* entity = scene.Add();
+		entity->GetTransform()->SetPosition((float)i, 0, 0);
+		entity->GetTransform()->SetPitchYawRoll(0, 0, 0);
+		entity->GetTransform()->SetScale(0.5f, 0.5f, 0.5f);
+		entity->SetTags(ENTITY_TAG_SOLID);
+		bvh.Insert(entity);
+	}
+	int height = bvh.GetHeight();
+	printf("  height %d for 1024 entities\n", height);
+	CHECK(height >= 10 && height <= 20);
+
+	for (int i = 0; i < 768; i++) {
+		bvh.Remove(scene.entities[i].get());
+	}
+	CHECK(bvh.GetEntityCount() == 256);
+	CHECK(bvh.GetHeight() >= 8 && bvh.GetHeight() <= 16);
+
+	// Every one left is still found at the end of a ray along the line
+	SceneRayHit hit;
+	CHECK(bvh.RaycastScene(XMFLOAT3(-10, 0, 0), XMFLOAT3(2000, 0, 0), 1, ENTITY_TAG_ALL, hit));
+	CHECK(hit.entity == scene.entities[768].get());
+	CHECK(bvh.RaycastScene(XMFLOAT3(2000, 0, 0), XMFLOAT3(-2000, 0, 0), 1, ENTITY_TAG_ALL, hit));
+	CHECK(hit.entity == scene.entities[1023].get());
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+// A minimal harness for the headless tests. TEST registers a function that TestMain.cpp runs, and every failed CHECK
+// is printed with its file and line. The executable exits with the number of failed tests, so ctest sees any failure.
+
+struct TestCase {
+	const char* name;
+	void (*run)();
+};
+
+std::vector<TestCase>& GetTests();
+// Records a failed check against the test currently running
+void FailCheck(const char* file, int line, const char* expression);
+
+struct TestRegistration {
+	TestRegistration(const char* name, void (*run)()) { GetTests().push_back({ name, run }); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) FailCheck(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		double checkActual = (actual), checkExpected = (expected); \
+		if (!(fabs(checkActual - checkExpected) <= (tolerance))) { \
+			char checkMessage[256]; \
+			snprintf(checkMessage, sizeof(checkMessage), "%s is %g, expected %g", #actual, checkActual, checkExpected); \
+			FailCheck(__FILE__, __LINE__, checkMessage); \
+		} \
+	} while (0)
@@ -0,0 +1,31 @@
+#include "Test.h"
+
+static int failedChecks = 0;
+
+std::vector<TestCase>& GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void FailCheck(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): check failed: %s\n", file, line, expression);
+	failedChecks++;
+}
+
+int main()
+{
+	int failedTests = 0;
+	for (const TestCase& test : GetTests()) {
+		int checksBefore = failedChecks;
+		test.run();
+		bool passed = failedChecks == checksBefore;
+		printf("%s %s\n", passed ? "[pass]" : "[FAIL]", test.name);
+		if (!passed) {
+			failedTests++;
+		}
+	}
+	printf("%d of %d tests passed\n", (int)GetTests().size() - failedTests, (int)GetTests().size());
+	return failedTests;
+}
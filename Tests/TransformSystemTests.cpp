@@ -0,0 +1,108 @@
+#include "Test.h"
+#include "TransformSystem.h"
+#include <random>
+
+using namespace DirectX;
+using namespace std;
+
+// Largest difference between any two elements
+static float MatrixDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+{
+	float worst = 0;
+	for (int r = 0; r < 4; r++) {
+		for (int c = 0; c < 4; c++) {
+			worst = fmaxf(worst, fabsf(a.m[r][c] - b.m[r][c]));
+		}
+	}
+	return worst;
+}
+
+// Positions, angles all the way round and non-uniform scales, some of them mirrored
+static void Randomize(Transform& transform, mt19937& random)
+{
+	uniform_real_distribution<float> position(-50.0f, 50.0f);
+	uniform_real_distribution<float> angle(-XM_2PI, XM_2PI);
+	uniform_real_distribution<float> scale(0.1f, 4.0f);
+	uniform_int_distribution<int> sign(0, 1);
+	transform.SetPosition(position(random), position(random), position(random));
+	transform.SetPitchYawRoll(angle(random), angle(random), angle(random));
+	transform.SetScale(scale(random), scale(random), sign(random) ? -scale(random) : scale(random));
+}
+
+// The batch update has to match what each Transform works out lazily for itself. Counts that aren't a multiple of
+// four leave padding lanes in the last iteration.
+TEST(UpdateMatricesMatchesTheScalarTransform)
+{
+	mt19937 random(1234);
+	size_t counts[] = { 1, 3, 4, 5, 13, 64 };
+	for (size_t count : counts) {
+		vector<Transform> batched(count);
+		vector<Transform> scalar(count);
+		TransformSystem system;
+		for (size_t i = 0; i < count; i++) {
+			Randomize(batched[i], random);
+			scalar[i].SetPosition(batched[i].GetPosition().x, batched[i].GetPosition().y, batched[i].GetPosition().z);
+			scalar[i].SetPitchYawRoll(batched[i].GetPitchYawRoll().x, batched[i].GetPitchYawRoll().y, batched[i].GetPitchYawRoll().z);
+			scalar[i].SetScale(batched[i].GetScale().x, batched[i].GetScale().y, batched[i].GetScale().z);
+			system.Add(&batched[i]);
+		}
+		system.UpdateMatrices();
+
+		for (size_t i = 0; i < count; i++) {
+			CHECK_NEAR(MatrixDifference(batched[i].GetWorldMatrix(), scalar[i].GetWorldMatrix()), 0, 1e-4);
+			CHECK_NEAR(MatrixDifference(batched[i].GetWorldInverseTranspose(), scalar[i].GetWorldInverseTranspose()), 0, 1e-4);
+
+			// The inverse the batch wrote back takes points home again
+			XMFLOAT3 point(1.5f, -2.0f, 3.25f);
+			XMFLOAT3 roundTrip = batched[i].InverseTransformPoint(batched[i].TransformPoint(point));
+			CHECK_NEAR(roundTrip.x, point.x, 1e-3);
+			CHECK_NEAR(roundTrip.y, point.y, 1e-3);
+			CHECK_NEAR(roundTrip.z, point.z, 1e-3);
+		}
+	}
+}
+
+TEST(UpdateMatricesOnlyTouchesDirtyTransforms)
+{
+	Transform moved, still;
+	TransformSystem system;
+	system.Add(&moved);
+	system.Add(&still);
+	system.UpdateMatrices();
+
+	XMFLOAT4X4 stillWorld = still.GetWorldMatrix();
+	moved.SetPosition(1, 2, 3);
+	system.UpdateMatrices();
+	XMFLOAT4X4 world = moved.GetWorldMatrix();
+	CHECK(world._41 == 1 && world._42 == 2 && world._43 == 3);
+	CHECK(MatrixDifference(still.GetWorldMatrix(), stillWorld) == 0);
+
+	// Changes after the update still show up, from the Transform's own lazy update
+	moved.SetPosition(4, 5, 6);
+	world = moved.GetWorldMatrix();
+	CHECK(world._41 == 4 && world._42 == 5 && world._43 == 6);
+
+	system.Remove(&moved);
+	CHECK(system.GetCount() == 1);
+}
+
+TEST(ComputeMatricesMatchesDirectXMath)
+{
+	// The kernel on its own against the matrices DirectXMath builds, four transforms and one padding lane's worth
+	float px[] = { 1, -2, 3, 0 }, py[] = { 4, 5, -6, 0 }, pz[] = { 7, 8, 9, 0 };
+	float pitch[] = { 0.3f, -1.2f, 2.5f, 0 }, yaw[] = { 1.1f, 0.0f, -3.0f, 0 }, roll[] = { -0.7f, 0.4f, 1.9f, 0 };
+	float sx[] = { 1, 2, 0.5f, 1 }, sy[] = { 1, 3, 0.25f, 1 }, sz[] = { 1, -1, 4, 1 };
+	XMFLOAT4X4 world[4], inverseTranspose[4];
+	TransformSystem::ComputeMatrices(px, py, pz, pitch, yaw, roll, sx, sy, sz, 3, world, inverseTranspose);
+
+	for (int i = 0; i < 3; i++) {
+		XMMATRIX expected = XMMatrixScaling(sx[i], sy[i], sz[i]) *
+			XMMatrixRotationRollPitchYaw(pitch[i], yaw[i], roll[i]) *
+			XMMatrixTranslation(px[i], py[i], pz[i]);
+		XMFLOAT4X4 expectedWorld, expectedInverseTranspose;
+		XMStoreFloat4x4(&expectedWorld, expected);
+		XMStoreFloat4x4(&expectedInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, expected)));
+		CHECK_NEAR(MatrixDifference(world[i], expectedWorld), 0, 1e-5);
+		CHECK_NEAR(MatrixDifference(inverseTranspose[i], expectedInverseTranspose), 0, 1e-5);
+	}
+}
@@ -0,0 +1,124 @@
+#include "Test.h"
+#include "VertexPacking.h"
+#include "ObjLoader.h"
+#include <string>
+
+using namespace DirectX;
+using namespace std;
+
+static XMFLOAT3 Normalized(XMFLOAT3 v)
+{
+	float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+	return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+}
+
+// Any unit vector perpendicular to the normal stands in for the tangent Mesh would calculate
+static XMFLOAT3 Perpendicular(XMFLOAT3 n)
+{
+	XMFLOAT3 axis = fabsf(n.x) < 0.9f ? XMFLOAT3(1, 0, 0) : XMFLOAT3(0, 1, 0);
+	return Normalized(XMFLOAT3(n.y * axis.z - n.z * axis.y, n.z * axis.x - n.x * axis.z, n.x * axis.y - n.y * axis.x));
+}
+
+static float AngleBetween(XMFLOAT3 a, XMFLOAT3 b)
+{
+	float cx = a.y * b.z - a.z * b.y;
+	float cy = a.z * b.x - a.x * b.z;
+	float cz = a.x * b.y - a.y * b.x;
+	return atan2f(sqrtf(cx * cx + cy * cy + cz * cz), a.x * b.x + a.y * b.y + a.z * b.z) * 180.0f / XM_PI;
+}
+
+// The worst angle snorm16 octahedral encoding should ever be off by, in degrees
+static const float directionTolerance = 0.005f;
+
+TEST(PackedModelsStayWithinTolerance)
+{
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models) {
+		string filepath = string(PORTALS_ASSETS_DIR "/Models/") + model;
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		CHECK(ObjLoader::Load(filepath.c_str(), vertices, indices));
+
+		XMFLOAT3 boundsMin = vertices[0].Position;
+		XMFLOAT3 boundsMax = vertices[0].Position;
+		for (Vertex& vertex : vertices) {
+			vertex.Tangent = Perpendicular(Normalized(vertex.Normal));
+			boundsMin = XMFLOAT3(fminf(boundsMin.x, vertex.Position.x), fminf(boundsMin.y, vertex.Position.y), fminf(boundsMin.z, vertex.Position.z));
+			boundsMax = XMFLOAT3(fmaxf(boundsMax.x, vertex.Position.x), fmaxf(boundsMax.y, vertex.Position.y), fmaxf(boundsMax.z, vertex.Position.z));
+		}
+
+		// Each axis is off by at most half a unorm16 step of the bounds, with a little room for float rounding
+		float dx = boundsMax.x - boundsMin.x;
+		float dy = boundsMax.y - boundsMin.y;
+		float dz = boundsMax.z - boundsMin.z;
+		float positionTolerance = 0.5f / 65535.0f * sqrtf(dx * dx + dy * dy + dz * dz) * 1.01f;
+
+		VertexPackingError error = VertexPacking::MeasureError(vertices.data(), vertices.size(), boundsMin, boundsMax);
+		CHECK_NEAR(error.position, 0, positionTolerance);
+		CHECK_NEAR(error.normal, 0, directionTolerance);
+		CHECK_NEAR(error.tangent, 0, directionTolerance);
+
+		// Half precision keeps uvs to within half a unit in the last place, 2^-11 of their size
+		for (const Vertex& vertex : vertices) {
+			Vertex decoded = VertexPacking::Unpack(VertexPacking::Pack(vertex, boundsMin, boundsMax), boundsMin, boundsMax);
+			CHECK_NEAR(decoded.UV.x, vertex.UV.x, fabsf(vertex.UV.x) * ldexpf(1, -11));
+			CHECK_NEAR(decoded.UV.y, vertex.UV.y, fabsf(vertex.UV.y) * ldexpf(1, -11));
+		}
+	}
+}
+
+TEST(OctahedralEncodingCoversTheSphere)
+{
+	// A latitude and longitude sweep, which crosses both the folded edges and the poles
+	float worst = 0;
+	for (int i = 0; i <= 90; i++) {
+		float pitch = XM_PI * i / 90.0f - XM_PIDIV2;
+		for (int j = 0; j < 180; j++) {
+			float yaw = XM_2PI * j / 180.0f;
+			XMFLOAT3 direction(cosf(pitch) * cosf(yaw), cosf(pitch) * sinf(yaw), sinf(pitch));
+			short encoded[2];
+			VertexPacking::EncodeOctahedral(direction, encoded);
+			worst = fmaxf(worst, AngleBetween(VertexPacking::DecodeOctahedral(encoded), direction));
+		}
+	}
+	CHECK_NEAR(worst, 0, directionTolerance);
+
+	// The axes come back exactly
+	XMFLOAT3 axes[] = { XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1) };
+	for (XMFLOAT3 axis : axes) {
+		short encoded[2];
+		VertexPacking::EncodeOctahedral(axis, encoded);
+		XMFLOAT3 decoded = VertexPacking::DecodeOctahedral(encoded);
+		CHECK(decoded.x == axis.x && decoded.y == axis.y && decoded.z == axis.z);
+	}
+}
+
+TEST(EveryFiniteHalfRoundTrips)
+{
+	for (unsigned int half = 0; half <= 0xFFFF; half++) {
+		if (((half >> 10) & 0x1F) == 31) {
+			continue;
+		}
+		if (VertexPacking::FloatToHalf(VertexPacking::HalfToFloat((unsigned short)half)) != half) {
+			printf("  half 0x%04X doesn't round trip\n", half);
+			CHECK(false);
+		}
+	}
+}
+
+TEST(FloatToHalfRoundsToNearestEven)
+{
+	CHECK(VertexPacking::FloatToHalf(1.0f) == 0x3C00);
+	CHECK(VertexPacking::FloatToHalf(-2.0f) == 0xC000);
+	CHECK(VertexPacking::FloatToHalf(65504.0f) == 0x7BFF);
+	// Halfway between 65504 and the next step rounds up into infinity
+	CHECK(VertexPacking::FloatToHalf(65520.0f) == 0x7C00);
+	// Halfway cases go to the even neighbour
+	CHECK(VertexPacking::FloatToHalf(1.0f + ldexpf(1, -11)) == 0x3C00);
+	CHECK(VertexPacking::FloatToHalf(1.0f + 3 * ldexpf(1, -11)) == 0x3C02);
+	// Subnormals, and values too small for them
+	CHECK(VertexPacking::FloatToHalf(ldexpf(1, -24)) == 0x0001);
+	CHECK(VertexPacking::FloatToHalf(ldexpf(1, -25)) == 0x0000);
+	CHECK(VertexPacking::FloatToHalf(ldexpf(3, -26)) == 0x0001);
+	CHECK(VertexPacking::FloatToHalf(ldexpf(1, -30)) == 0x0000);
+}
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/FrameRecordingTests.dir/Tests/FrameRecordingTests.cpp.o"
+  "CMakeFiles/FrameRecordingTests.dir/Tests/FrameRecordingTests.cpp.o.d"
+  "CMakeFiles/FrameRecordingTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/FrameRecordingTests.dir/Tests/TestMain.cpp.o.d"
+  "FrameRecordingTests"
+  "FrameRecordingTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/FrameRecordingTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/FrustumCullingTests.dir/Tests/FrustumCullingTests.cpp.o"
+  "CMakeFiles/FrustumCullingTests.dir/Tests/FrustumCullingTests.cpp.o.d"
+  "CMakeFiles/FrustumCullingTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/FrustumCullingTests.dir/Tests/TestMain.cpp.o.d"
+  "FrustumCullingTests"
+  "FrustumCullingTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/FrustumCullingTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/MeshBVHTests.dir/Tests/MeshBVHTests.cpp.o"
+  "CMakeFiles/MeshBVHTests.dir/Tests/MeshBVHTests.cpp.o.d"
+  "CMakeFiles/MeshBVHTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/MeshBVHTests.dir/Tests/TestMain.cpp.o.d"
+  "MeshBVHTests"
+  "MeshBVHTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/MeshBVHTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
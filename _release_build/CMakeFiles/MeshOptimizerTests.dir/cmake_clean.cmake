@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/MeshOptimizerTests.dir/Tests/MeshOptimizerTests.cpp.o"
+  "CMakeFiles/MeshOptimizerTests.dir/Tests/MeshOptimizerTests.cpp.o.d"
+  "CMakeFiles/MeshOptimizerTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/MeshOptimizerTests.dir/Tests/TestMain.cpp.o.d"
+  "MeshOptimizerTests"
+  "MeshOptimizerTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/MeshOptimizerTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
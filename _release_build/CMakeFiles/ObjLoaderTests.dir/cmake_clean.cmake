@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ObjLoaderTests.dir/Tests/ObjLoaderTests.cpp.o"
+  "CMakeFiles/ObjLoaderTests.dir/Tests/ObjLoaderTests.cpp.o.d"
+  "CMakeFiles/ObjLoaderTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/ObjLoaderTests.dir/Tests/TestMain.cpp.o.d"
+  "ObjLoaderTests"
+  "ObjLoaderTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ObjLoaderTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
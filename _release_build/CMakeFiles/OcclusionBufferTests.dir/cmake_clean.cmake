@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/OcclusionBufferTests.dir/Tests/OcclusionBufferTests.cpp.o"
+  "CMakeFiles/OcclusionBufferTests.dir/Tests/OcclusionBufferTests.cpp.o.d"
+  "CMakeFiles/OcclusionBufferTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/OcclusionBufferTests.dir/Tests/TestMain.cpp.o.d"
+  "OcclusionBufferTests"
+  "OcclusionBufferTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/OcclusionBufferTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/PhysicsWorldTests.dir/Tests/PhysicsWorldTests.cpp.o"
+  "CMakeFiles/PhysicsWorldTests.dir/Tests/PhysicsWorldTests.cpp.o.d"
+  "CMakeFiles/PhysicsWorldTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/PhysicsWorldTests.dir/Tests/TestMain.cpp.o.d"
+  "PhysicsWorldTests"
+  "PhysicsWorldTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/PhysicsWorldTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/PortalMath.dir/Portals/PortalMath.cpp.o"
+  "CMakeFiles/PortalMath.dir/Portals/PortalMath.cpp.o.d"
+  "libPortalMath.a"
+  "libPortalMath.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/PortalMath.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/PortalMathTests.dir/Tests/PortalMathTests.cpp.o"
+  "CMakeFiles/PortalMathTests.dir/Tests/PortalMathTests.cpp.o.d"
+  "CMakeFiles/PortalMathTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/PortalMathTests.dir/Tests/TestMain.cpp.o.d"
+  "PortalMathTests"
+  "PortalMathTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/PortalMathTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/PortalsBenchmark.dir/Portals/Benchmark.cpp.o"
+  "CMakeFiles/PortalsBenchmark.dir/Portals/Benchmark.cpp.o.d"
+  "CMakeFiles/PortalsBenchmark.dir/Tests/PortalsBenchmark.cpp.o"
+  "CMakeFiles/PortalsBenchmark.dir/Tests/PortalsBenchmark.cpp.o.d"
+  "PortalsBenchmark"
+  "PortalsBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/PortalsBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
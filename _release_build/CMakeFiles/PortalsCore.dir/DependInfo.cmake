@@ -0,0 +1,41 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/Portals/BoundsSystem.cpp" "CMakeFiles/PortalsCore.dir/Portals/BoundsSystem.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/BoundsSystem.cpp.o.d"
+  "/root/repo/Portals/DrawList.cpp" "CMakeFiles/PortalsCore.dir/Portals/DrawList.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/DrawList.cpp.o.d"
+  "/root/repo/Portals/Entity.cpp" "CMakeFiles/PortalsCore.dir/Portals/Entity.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/Entity.cpp.o.d"
+  "/root/repo/Portals/FrustumCulling.cpp" "CMakeFiles/PortalsCore.dir/Portals/FrustumCulling.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/FrustumCulling.cpp.o.d"
+  "/root/repo/Portals/Material.cpp" "CMakeFiles/PortalsCore.dir/Portals/Material.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/Material.cpp.o.d"
+  "/root/repo/Portals/Mesh.cpp" "CMakeFiles/PortalsCore.dir/Portals/Mesh.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/Mesh.cpp.o.d"
+  "/root/repo/Portals/MeshBVH.cpp" "CMakeFiles/PortalsCore.dir/Portals/MeshBVH.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/MeshBVH.cpp.o.d"
+  "/root/repo/Portals/MeshOptimizer.cpp" "CMakeFiles/PortalsCore.dir/Portals/MeshOptimizer.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/MeshOptimizer.cpp.o.d"
+  "/root/repo/Portals/ObjLoader.cpp" "CMakeFiles/PortalsCore.dir/Portals/ObjLoader.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/ObjLoader.cpp.o.d"
+  "/root/repo/Portals/OcclusionBuffer.cpp" "CMakeFiles/PortalsCore.dir/Portals/OcclusionBuffer.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/OcclusionBuffer.cpp.o.d"
+  "/root/repo/Portals/PhysicsWorld.cpp" "CMakeFiles/PortalsCore.dir/Portals/PhysicsWorld.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/PhysicsWorld.cpp.o.d"
+  "/root/repo/Portals/Portal.cpp" "CMakeFiles/PortalsCore.dir/Portals/Portal.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/Portal.cpp.o.d"
+  "/root/repo/Portals/PortalRenderer.cpp" "CMakeFiles/PortalsCore.dir/Portals/PortalRenderer.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/PortalRenderer.cpp.o.d"
+  "/root/repo/Portals/PortalTraversal.cpp" "CMakeFiles/PortalsCore.dir/Portals/PortalTraversal.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/PortalTraversal.cpp.o.d"
+  "/root/repo/Portals/Profiler.cpp" "CMakeFiles/PortalsCore.dir/Portals/Profiler.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/Profiler.cpp.o.d"
+  "/root/repo/Portals/RayTriangle.cpp" "CMakeFiles/PortalsCore.dir/Portals/RayTriangle.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/RayTriangle.cpp.o.d"
+  "/root/repo/Portals/RenderCommands.cpp" "CMakeFiles/PortalsCore.dir/Portals/RenderCommands.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/RenderCommands.cpp.o.d"
+  "/root/repo/Portals/RenderShader.cpp" "CMakeFiles/PortalsCore.dir/Portals/RenderShader.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/RenderShader.cpp.o.d"
+  "/root/repo/Portals/SceneBVH.cpp" "CMakeFiles/PortalsCore.dir/Portals/SceneBVH.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/SceneBVH.cpp.o.d"
+  "/root/repo/Portals/Transform.cpp" "CMakeFiles/PortalsCore.dir/Portals/Transform.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/Transform.cpp.o.d"
+  "/root/repo/Portals/TransformSystem.cpp" "CMakeFiles/PortalsCore.dir/Portals/TransformSystem.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/TransformSystem.cpp.o.d"
+  "/root/repo/Portals/VertexPacking.cpp" "CMakeFiles/PortalsCore.dir/Portals/VertexPacking.cpp.o" "gcc" "CMakeFiles/PortalsCore.dir/Portals/VertexPacking.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_release_build/CMakeFiles/PortalMath.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,53 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/PortalsCore.dir/Portals/BoundsSystem.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/BoundsSystem.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/DrawList.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/DrawList.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/Entity.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/Entity.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/FrustumCulling.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/FrustumCulling.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/Material.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/Material.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/Mesh.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/Mesh.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/MeshBVH.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/MeshBVH.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/MeshOptimizer.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/MeshOptimizer.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/ObjLoader.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/ObjLoader.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/OcclusionBuffer.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/OcclusionBuffer.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/PhysicsWorld.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/PhysicsWorld.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/Portal.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/Portal.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/PortalRenderer.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/PortalRenderer.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/PortalTraversal.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/PortalTraversal.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/Profiler.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/Profiler.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/RayTriangle.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/RayTriangle.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/RenderCommands.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/RenderCommands.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/RenderShader.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/RenderShader.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/SceneBVH.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/SceneBVH.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/Transform.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/Transform.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/TransformSystem.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/TransformSystem.cpp.o.d"
+  "CMakeFiles/PortalsCore.dir/Portals/VertexPacking.cpp.o"
+  "CMakeFiles/PortalsCore.dir/Portals/VertexPacking.cpp.o.d"
+  "libPortalsCore.a"
+  "libPortalsCore.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/PortalsCore.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/RayTriangleTests.dir/Tests/RayTriangleTests.cpp.o"
+  "CMakeFiles/RayTriangleTests.dir/Tests/RayTriangleTests.cpp.o.d"
+  "CMakeFiles/RayTriangleTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/RayTriangleTests.dir/Tests/TestMain.cpp.o.d"
+  "RayTriangleTests"
+  "RayTriangleTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/RayTriangleTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/SceneBVHTests.dir/Tests/SceneBVHTests.cpp.o"
+  "CMakeFiles/SceneBVHTests.dir/Tests/SceneBVHTests.cpp.o.d"
+  "CMakeFiles/SceneBVHTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/SceneBVHTests.dir/Tests/TestMain.cpp.o.d"
+  "SceneBVHTests"
+  "SceneBVHTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/SceneBVHTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/TransformSystemTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/TransformSystemTests.dir/Tests/TestMain.cpp.o.d"
+  "CMakeFiles/TransformSystemTests.dir/Tests/TransformSystemTests.cpp.o"
+  "CMakeFiles/TransformSystemTests.dir/Tests/TransformSystemTests.cpp.o.d"
+  "TransformSystemTests"
+  "TransformSystemTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/TransformSystemTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/Tests/TestMain.cpp" "CMakeFiles/VertexPackingTests.dir/Tests/TestMain.cpp.o" "gcc" "CMakeFiles/VertexPackingTests.dir/Tests/TestMain.cpp.o.d"
+  "/root/repo/Tests/VertexPackingTests.cpp" "CMakeFiles/VertexPackingTests.dir/Tests/VertexPackingTests.cpp.o" "gcc" "CMakeFiles/VertexPackingTests.dir/Tests/VertexPackingTests.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_release_build/CMakeFiles/PortalsCore.dir/DependInfo.cmake"
+  "/root/repo/_release_build/CMakeFiles/PortalMath.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
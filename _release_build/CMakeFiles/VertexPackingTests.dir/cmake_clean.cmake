@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/VertexPackingTests.dir/Tests/TestMain.cpp.o"
+  "CMakeFiles/VertexPackingTests.dir/Tests/TestMain.cpp.o.d"
+  "CMakeFiles/VertexPackingTests.dir/Tests/VertexPackingTests.cpp.o"
+  "CMakeFiles/VertexPackingTests.dir/Tests/VertexPackingTests.cpp.o.d"
+  "VertexPackingTests"
+  "VertexPackingTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/VertexPackingTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
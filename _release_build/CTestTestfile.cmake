@@ -0,0 +1,32 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_release_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(PortalMathTests "/root/repo/_release_build/PortalMathTests")
+set_tests_properties(PortalMathTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;115;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(ObjLoaderTests "/root/repo/_release_build/ObjLoaderTests")
+set_tests_properties(ObjLoaderTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;116;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(MeshOptimizerTests "/root/repo/_release_build/MeshOptimizerTests")
+set_tests_properties(MeshOptimizerTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;117;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(VertexPackingTests "/root/repo/_release_build/VertexPackingTests")
+set_tests_properties(VertexPackingTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;118;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(TransformSystemTests "/root/repo/_release_build/TransformSystemTests")
+set_tests_properties(TransformSystemTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;119;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(RayTriangleTests "/root/repo/_release_build/RayTriangleTests")
+set_tests_properties(RayTriangleTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;120;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(MeshBVHTests "/root/repo/_release_build/MeshBVHTests")
+set_tests_properties(MeshBVHTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;121;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(FrameRecordingTests "/root/repo/_release_build/FrameRecordingTests")
+set_tests_properties(FrameRecordingTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;122;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(PhysicsWorldTests "/root/repo/_release_build/PhysicsWorldTests")
+set_tests_properties(PhysicsWorldTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;123;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(OcclusionBufferTests "/root/repo/_release_build/OcclusionBufferTests")
+set_tests_properties(OcclusionBufferTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;124;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(FrustumCullingTests "/root/repo/_release_build/FrustumCullingTests")
+set_tests_properties(FrustumCullingTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;125;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(SceneBVHTests "/root/repo/_release_build/SceneBVHTests")
+set_tests_properties(SceneBVHTests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;112;add_test;/root/repo/CMakeLists.txt;126;add_portals_test;/root/repo/CMakeLists.txt;0;")
+add_test(PortalsBenchmark "/root/repo/_release_build/PortalsBenchmark" "5")
+set_tests_properties(PortalsBenchmark PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;133;add_test;/root/repo/CMakeLists.txt;0;")